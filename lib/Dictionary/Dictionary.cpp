@@ -0,0 +1,388 @@
+#include "Dictionary.h"
+
+#include <Epub/search/TextMatcher.h>
+#include <Logging.h>
+#include <Serialization.h>
+#include <Utf8.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace {
+constexpr char MAGIC[6] = {'C', 'P', 'D', 'I', 'C', 'T'};
+constexpr uint8_t DICTIONARY_FILE_VERSION = 1;
+constexpr int MAX_STRIPPED_CHARS = 3;
+constexpr size_t MIN_STEM_CHARS = 3;
+
+// Letters and digits; punctuation around a word is trimmed before lookup, punctuation inside it is kept
+bool isWordCodepoint(const uint32_t cp) {
+  if (cp < 0x80) {
+    return (cp >= 'a' && cp <= 'z') || (cp >= '0' && cp <= '9');
+  }
+  if (cp < 0xC0 || cp == 0xD7 || cp == 0xF7) {
+    return false;
+  }
+  return !(cp >= 0x2000 && cp <= 0x2BFF) && !(cp >= 0x3000 && cp <= 0x303F);
+}
+
+void appendUtf8(std::string& out, const uint32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+size_t codepointCount(const std::string& text) {
+  size_t count = 0;
+  for (const char c : text) {
+    count += (static_cast<uint8_t>(c) & 0xC0) != 0x80;
+  }
+  return count;
+}
+
+uint32_t readLe32(const uint8_t* bytes) {
+  return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+}  // namespace
+
+std::string Dictionary::makeKey(const std::string& word) {
+  std::string key;
+  // Byte length of `key` up to its last letter or digit, to drop trailing punctuation
+  size_t wordEnd = 0;
+  bool pendingSpace = false;
+  const auto* cursor = reinterpret_cast<const unsigned char*>(word.c_str());
+  while (*cursor) {
+    uint32_t cp = *cursor;
+    if (cp < 0x80) {
+      cursor++;
+      if (cp >= 'A' && cp <= 'Z') {
+        cp += 'a' - 'A';
+      } else if (cp <= ' ') {
+        cp = ' ';
+      }
+    } else {
+      cp = TextMatcher::foldCodepoint(utf8NextCodepoint(&cursor));
+      if (cp == 0) {
+        continue;
+      }
+    }
+
+    if (cp == ' ') {
+      pendingSpace = !key.empty();
+      continue;
+    }
+    if (key.empty() && !isWordCodepoint(cp)) {
+      continue;  // Leading punctuation
+    }
+    if (pendingSpace) {
+      key.resize(wordEnd);
+      key += ' ';
+      pendingSpace = false;
+    }
+    appendUtf8(key, cp);
+    if (isWordCodepoint(cp)) {
+      wordEnd = key.size();
+    }
+  }
+  key.resize(wordEnd);
+  return key;
+}
+
+std::vector<std::string> Dictionary::findInstalled() {
+  std::vector<std::string> paths;
+  auto dir = Storage.open(kDirectory);
+  if (!dir || !dir.isDirectory()) {
+    if (dir) dir.close();
+    return paths;
+  }
+
+  char fileName[128];
+  const size_t extensionLength = strlen(kExtension);
+  for (auto entry = dir.openNextFile(); entry; entry = dir.openNextFile()) {
+    entry.getName(fileName, sizeof(fileName));
+    const bool isFile = !entry.isDirectory();
+    entry.close();
+    const size_t length = strlen(fileName);
+    if (isFile && fileName[0] != '.' && length > extensionLength &&
+        strcasecmp(fileName + length - extensionLength, kExtension) == 0) {
+      paths.push_back(std::string(kDirectory) + "/" + fileName);
+    }
+  }
+  dir.close();
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+bool Dictionary::open(const std::string& path) {
+  close();
+  if (!Storage.openFileForRead("DCT", path, file)) {
+    return false;
+  }
+
+  char magic[sizeof(MAGIC)];
+  uint8_t version, reserved;
+  uint32_t blockBytes, blockKeysOffset, blockKeysLength;
+  uint16_t nameLength;
+  file.read(reinterpret_cast<uint8_t*>(magic), sizeof(magic));
+  serialization::readPod(file, version);
+  serialization::readPod(file, reserved);
+  if (memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version != DICTIONARY_FILE_VERSION) {
+    LOG_ERR("DCT", "%s is not a version %u dictionary", path.c_str(), DICTIONARY_FILE_VERSION);
+    close();
+    return false;
+  }
+  serialization::readPod(file, entryCount);
+  serialization::readPod(file, blockBytes);
+  serialization::readPod(file, blockCount);
+  serialization::readPod(file, indexOffset);
+  serialization::readPod(file, blockKeysOffset);
+  serialization::readPod(file, blockKeysLength);
+  serialization::readPod(file, chunkSize);
+  serialization::readPod(file, chunkCount);
+  serialization::readPod(file, chunkTableOffset);
+  serialization::readPod(file, definitionsLength);
+  serialization::readPod(file, nameLength);
+  name.resize(nameLength);
+  file.read(reinterpret_cast<uint8_t*>(&name[0]), nameLength);
+
+  if (blockBytes != kIndexBlockBytes || chunkSize == 0 || chunkSize > kMaxChunkBytes ||
+      static_cast<uint64_t>(chunkCount) * chunkSize < definitionsLength) {
+    LOG_ERR("DCT", "%s has an unsupported layout", path.c_str());
+    close();
+    return false;
+  }
+
+  // The sparse block index: one key per 4 KB of headwords
+  blockKeys.resize(blockKeysLength);
+  if (!file.seek(blockKeysOffset) ||
+      file.read(reinterpret_cast<uint8_t*>(&blockKeys[0]), blockKeysLength) != static_cast<int>(blockKeysLength)) {
+    LOG_ERR("DCT", "Failed to read block index of %s", path.c_str());
+    close();
+    return false;
+  }
+  // Strip the length bytes in place, keeping where each key starts
+  blockKeyOffsets.clear();
+  blockKeyOffsets.reserve(blockCount + 1);
+  size_t read = 0;
+  size_t written = 0;
+  for (uint32_t i = 0; i < blockCount; i++) {
+    const uint8_t length = read < blockKeys.size() ? static_cast<uint8_t>(blockKeys[read]) : 0;
+    if (length == 0 || read + 1 + length > blockKeys.size()) {
+      LOG_ERR("DCT", "Corrupt block index in %s", path.c_str());
+      close();
+      return false;
+    }
+    blockKeyOffsets.push_back(static_cast<uint32_t>(written));
+    memmove(&blockKeys[written], &blockKeys[read + 1], length);
+    read += 1 + length;
+    written += length;
+  }
+  blockKeyOffsets.push_back(static_cast<uint32_t>(written));
+  blockKeys.resize(written);
+  blockKeys.shrink_to_fit();
+
+  LOG_DBG("DCT", "Opened %s: %u entries in %u blocks", name.c_str(), entryCount, blockCount);
+  return true;
+}
+
+void Dictionary::close() {
+  if (file) {
+    file.close();
+  }
+  blockKeys.clear();
+  blockKeys.shrink_to_fit();
+  blockKeyOffsets.clear();
+  blockKeyOffsets.shrink_to_fit();
+  entryCount = blockCount = 0;
+}
+
+uint32_t Dictionary::findBlock(const std::string& key) const {
+  // The last block whose first key sorts before `key`: entries equal to it may end the previous block
+  uint32_t low = 0;
+  uint32_t high = blockCount;
+  uint32_t block = 0;
+  while (low < high) {
+    const uint32_t mid = low + (high - low) / 2;
+    const uint32_t start = blockKeyOffsets[mid];
+    if (blockKeys.compare(start, blockKeyOffsets[mid + 1] - start, key) < 0) {
+      block = mid;
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return block;
+}
+
+bool Dictionary::findEntries(const std::string& key, std::vector<Entry>& matches) {
+  matches.clear();
+  std::unique_ptr<uint8_t[]> block(new (std::nothrow) uint8_t[kIndexBlockBytes]);
+  if (!block) {
+    LOG_ERR("DCT", "Not enough memory for an index block");
+    return false;
+  }
+
+  bool passed = false;
+  for (uint32_t index = findBlock(key); index < blockCount && !passed && matches.size() < kMaxResults; index++) {
+    if (!file.seek(indexOffset + index * kIndexBlockBytes) ||
+        file.read(block.get(), kIndexBlockBytes) != static_cast<int>(kIndexBlockBytes)) {
+      LOG_ERR("DCT", "Failed to read index block %u", index);
+      return false;
+    }
+
+    size_t position = 0;
+    while (position < kIndexBlockBytes && block[position] != 0) {
+      // u8 key length, key, u8 headword length (0 when the headword is the key), headword, u32 offset, u32 length
+      const uint8_t keyLength = block[position];
+      const auto* entryKey = reinterpret_cast<const char*>(block.get() + position + 1);
+      const size_t headwordAt = position + 1 + keyLength;
+      if (headwordAt >= kIndexBlockBytes || headwordAt + 1 + block[headwordAt] + 8 > kIndexBlockBytes) {
+        LOG_ERR("DCT", "Corrupt index block %u", index);
+        return false;
+      }
+      const uint8_t headwordLength = block[headwordAt];
+      const uint8_t* fields = block.get() + headwordAt + 1 + headwordLength;
+      position = headwordAt + 1 + headwordLength + 8;
+
+      const int order = key.compare(0, std::string::npos, entryKey, keyLength);
+      if (order < 0) {
+        passed = true;
+        break;
+      }
+      if (order == 0 && matches.size() < kMaxResults) {
+        Entry match;
+        if (headwordLength > 0) {
+          match.headword.assign(reinterpret_cast<const char*>(block.get() + headwordAt + 1), headwordLength);
+        } else {
+          match.headword.assign(entryKey, keyLength);
+        }
+        match.offset = readLe32(fields);
+        match.length = readLe32(fields + 4);
+        matches.push_back(std::move(match));
+      }
+    }
+  }
+
+  return true;
+}
+
+bool Dictionary::lookup(const std::string& word, std::vector<Result>& results) {
+  results.clear();
+  std::string key = makeKey(word);
+  if (!file || key.empty() || blockCount == 0) {
+    return false;
+  }
+
+  // No exact match: drop up to three trailing characters so "walked" or "houses" still find "walk" and "house"
+  std::vector<Entry> matches;
+  for (int stripped = 0; stripped <= MAX_STRIPPED_CHARS; stripped++) {
+    if (!findEntries(key, matches)) {
+      return false;
+    }
+    if (!matches.empty() || codepointCount(key) <= MIN_STEM_CHARS) {
+      break;
+    }
+    utf8RemoveLastChar(key);
+  }
+
+  for (auto& match : matches) {
+    Result result;
+    result.headword = std::move(match.headword);
+    if (!readDefinition(match.offset, match.length, result.definition)) {
+      return false;
+    }
+    results.push_back(std::move(result));
+  }
+  return !results.empty();
+}
+
+bool Dictionary::readDefinition(const uint32_t offset, const uint32_t fullLength, std::string& definition) {
+  if (fullLength == 0 || offset >= definitionsLength || fullLength > definitionsLength - offset) {
+    LOG_ERR("DCT", "Definition out of range");
+    return false;
+  }
+  const uint32_t length = std::min(fullLength, kMaxDefinitionBytes);
+  const uint32_t firstChunk = offset / chunkSize;
+  const uint32_t lastChunk = (offset + length - 1) / chunkSize;
+
+  // Compressed chunk boundaries, then every chunk the definition touches in one read
+  const uint32_t boundaryCount = lastChunk - firstChunk + 2;
+  std::vector<uint32_t> boundaries(boundaryCount);
+  if (!file.seek(chunkTableOffset + firstChunk * sizeof(uint32_t)) ||
+      file.read(reinterpret_cast<uint8_t*>(boundaries.data()), boundaryCount * sizeof(uint32_t)) !=
+          static_cast<int>(boundaryCount * sizeof(uint32_t))) {
+    return false;
+  }
+  // Deflate never grows a chunk by more than a few bytes per 16 KB; anything larger is a corrupt table
+  const uint32_t compressedLength = boundaries.back() - boundaries.front();
+  if (boundaries.back() <= boundaries.front() || compressedLength > 2 * (boundaryCount - 1) * kMaxChunkBytes) {
+    LOG_ERR("DCT", "Corrupt chunk table");
+    return false;
+  }
+  std::unique_ptr<uint8_t[]> compressed(new (std::nothrow) uint8_t[compressedLength]);
+  std::unique_ptr<uint8_t[]> chunk(new (std::nothrow) uint8_t[chunkSize]);
+  std::unique_ptr<tinfl_decompressor> inflator(new (std::nothrow) tinfl_decompressor);
+  if (!compressed || !chunk || !inflator) {
+    LOG_ERR("DCT", "Not enough memory to read a definition");
+    return false;
+  }
+  if (!file.seek(boundaries.front()) ||
+      file.read(compressed.get(), compressedLength) != static_cast<int>(compressedLength)) {
+    return false;
+  }
+
+  definition.clear();
+  definition.reserve(length);
+  for (uint32_t index = firstChunk; index <= lastChunk; index++) {
+    const uint32_t chunkStart = index * chunkSize;
+    const uint32_t chunkLength = std::min(chunkSize, definitionsLength - chunkStart);
+    if (boundaries[index - firstChunk + 1] < boundaries[index - firstChunk]) {
+      LOG_ERR("DCT", "Corrupt chunk table");
+      return false;
+    }
+    size_t inBytes = boundaries[index - firstChunk + 1] - boundaries[index - firstChunk];
+    size_t outBytes = chunkLength;
+    tinfl_init(inflator.get());
+    const tinfl_status status =
+        tinfl_decompress(inflator.get(), compressed.get() + (boundaries[index - firstChunk] - boundaries.front()),
+                         &inBytes, chunk.get(), chunk.get(), &outBytes, TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+    if (status != TINFL_STATUS_DONE || outBytes != chunkLength) {
+      LOG_ERR("DCT", "Failed to inflate chunk %u (status %d)", index, status);
+      return false;
+    }
+
+    const uint32_t from = std::max(offset, chunkStart) - chunkStart;
+    const uint32_t to = std::min(offset + length, chunkStart + chunkLength) - chunkStart;
+    definition.append(reinterpret_cast<const char*>(chunk.get()) + from, to - from);
+  }
+
+  // A cut-off definition may end inside a multi-byte character
+  if (length < fullLength) {
+    const size_t end = definition.size();
+    size_t lead = end;
+    while (lead > 0 && (static_cast<uint8_t>(definition[lead - 1]) & 0xC0) == 0x80) {
+      lead--;
+    }
+    if (lead > 0) {
+      const auto first = static_cast<uint8_t>(definition[lead - 1]);
+      const size_t expected = first >= 0xF0 ? 4 : first >= 0xE0 ? 3 : first >= 0xC0 ? 2 : 1;
+      if (end - (lead - 1) < expected) {
+        definition.resize(lead - 1);
+      }
+    }
+  }
+  return true;
+}
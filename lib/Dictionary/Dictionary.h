@@ -0,0 +1,71 @@
+#pragma once
+#include <HalStorage.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Offline dictionary in the .cpdict format written by scripts/convert_dictionary.py (see docs/file-formats.md).
+//
+// Headwords are folded to lookup keys and sorted into fixed 4 KB index blocks. Only the first key of each block is
+// kept in RAM, so a lookup binary-searches that sparse index and then reads a single block. Definitions are plain
+// text, deflated in independent chunks the way dictzip does it, so only the chunk holding a definition is read and
+// inflated. A lookup is three reads: the index block, the chunk's offsets and the compressed chunk.
+class Dictionary {
+ public:
+  static constexpr const char* kDirectory = "/dictionaries";
+  static constexpr const char* kExtension = ".cpdict";
+  static constexpr uint32_t kIndexBlockBytes = 4096;
+  static constexpr uint32_t kMaxChunkBytes = 32 * 1024;
+  // Longer definitions are cut off
+  static constexpr uint32_t kMaxDefinitionBytes = 8 * 1024;
+  // Homographs and synonyms sharing a key
+  static constexpr size_t kMaxResults = 4;
+
+  struct Result {
+    std::string headword;
+    std::string definition;
+  };
+
+  ~Dictionary() { close(); }
+
+  bool open(const std::string& path);
+  void close();
+  bool isOpen() const { return static_cast<bool>(file); }
+  const std::string& getName() const { return name; }
+
+  // Looks up a word as it appears in the text: case, curly quotes and surrounding punctuation don't matter, and a
+  // few trailing characters are dropped if there is no exact match. Returns false if nothing matched or the
+  // dictionary couldn't be read.
+  bool lookup(const std::string& word, std::vector<Result>& results);
+
+  // Folds a word to its lookup key; must match fold_key() in scripts/convert_dictionary.py.
+  static std::string makeKey(const std::string& word);
+  // Paths of the dictionaries in kDirectory, sorted by name
+  static std::vector<std::string> findInstalled();
+
+ private:
+  struct Entry {
+    std::string headword;
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  FsFile file;
+  std::string name;
+  uint32_t entryCount = 0;
+  uint32_t blockCount = 0;
+  uint32_t indexOffset = 0;
+  uint32_t chunkSize = 0;
+  uint32_t chunkCount = 0;
+  uint32_t chunkTableOffset = 0;
+  uint32_t definitionsLength = 0;
+  // First key of every index block, back to back; blockKeyOffsets has blockCount + 1 entries
+  std::string blockKeys;
+  std::vector<uint32_t> blockKeyOffsets;
+
+  uint32_t findBlock(const std::string& key) const;
+  // Collects up to kMaxResults entries whose key is exactly `key`; false on a read error
+  bool findEntries(const std::string& key, std::vector<Entry>& matches);
+  bool readDefinition(uint32_t offset, uint32_t length, std::string& definition);
+};
@@ -1,5 +1,6 @@
 #include "Epub.h"
 
+#include <BmpRowWriter.h>
 #include <FsHelpers.h>
 #include <HalStorage.h>
 #include <JpegToBmpConverter.h>
@@ -7,6 +8,9 @@
 #include <PngToBmpConverter.h>
 #include <ZipFile.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include "Epub/parsers/ContainerParser.h"
 #include "Epub/parsers/ContentOpfParser.h"
 #include "Epub/parsers/TocNavParser.h"
@@ -488,190 +492,147 @@ std::string Epub::getCoverBmpPath(bool cropped) const {
   return cachePath + "/" + coverFileName + ".bmp";
 }
 
-bool Epub::generateCoverBmp(bool cropped) const {
-  // Already generated, return true
-  if (Storage.exists(getCoverBmpPath(cropped).c_str())) {
+namespace {
+bool hrefEndsWith(const std::string& href, const char* suffix) {
+  const size_t len = strlen(suffix);
+  return href.size() >= len && href.compare(href.size() - len, len, suffix) == 0;
+}
+
+bool isJpegHref(const std::string& href) { return hrefEndsWith(href, ".jpg") || hrefEndsWith(href, ".jpeg"); }
+bool isPngHref(const std::string& href) { return hrefEndsWith(href, ".png"); }
+}  // namespace
+
+Epub::CoverBmpRequest Epub::coverRequest(const bool cropped) const {
+  return {getCoverBmpPath(cropped), BmpRowWriter::kCoverMaxWidth, BmpRowWriter::kCoverMaxHeight, false, cropped};
+}
+
+Epub::CoverBmpRequest Epub::thumbRequest(const int height) const {
+  // Generate 1-bit BMP for fast home screen rendering (no gray passes needed)
+  return {getThumbBmpPath(height), static_cast<int>(height * 0.6), height, true, true};
+}
+
+bool Epub::writeCoverBmps(std::vector<CoverBmpRequest> requests) const {
+  requests.erase(std::remove_if(requests.begin(), requests.end(),
+                                [](const CoverBmpRequest& request) { return Storage.exists(request.path.c_str()); }),
+                 requests.end());
+  if (requests.empty()) {
     return true;
   }
 
-  if (!bookMetadataCache || !bookMetadataCache->isLoaded()) {
-    LOG_ERR("EBP", "Cannot generate cover BMP, cache not loaded");
+  const auto& coverImageHref = bookMetadataCache->coreMetadata.coverItemHref;
+  const bool isJpeg = isJpegHref(coverImageHref);
+  LOG_DBG("EBP", "Generating %d BMP(s) from %s cover image", static_cast<int>(requests.size()),
+          isJpeg ? "JPG" : "PNG");
+
+  // Extract the image once; every output is written from the same decode
+  const auto coverTempPath = getCachePath() + (isJpeg ? "/.cover.jpg" : "/.cover.png");
+  FsFile coverImage;
+  if (!Storage.openFileForWrite("EBP", coverTempPath, coverImage)) {
     return false;
   }
+  readItemContentsToStream(coverImageHref, coverImage, 1024);
+  coverImage.close();
 
-  const auto coverImageHref = bookMetadataCache->coreMetadata.coverItemHref;
-  if (coverImageHref.empty()) {
-    LOG_ERR("EBP", "No known cover image");
+  if (!Storage.openFileForRead("EBP", coverTempPath, coverImage)) {
     return false;
   }
 
-  if (coverImageHref.substr(coverImageHref.length() - 4) == ".jpg" ||
-      coverImageHref.substr(coverImageHref.length() - 5) == ".jpeg") {
-    LOG_DBG("EBP", "Generating BMP from JPG cover image (%s mode)", cropped ? "cropped" : "fit");
-    const auto coverJpgTempPath = getCachePath() + "/.cover.jpg";
-
-    FsFile coverJpg;
-    if (!Storage.openFileForWrite("EBP", coverJpgTempPath, coverJpg)) {
-      return false;
-    }
-    readItemContentsToStream(coverImageHref, coverJpg, 1024);
-    coverJpg.close();
-
-    if (!Storage.openFileForRead("EBP", coverJpgTempPath, coverJpg)) {
-      return false;
-    }
+  std::vector<FsFile> outputs(requests.size());
+  std::vector<BmpOutputSpec> specs;
+  specs.reserve(requests.size());
+  bool success = true;
+  for (size_t i = 0; i < requests.size() && success; i++) {
+    const auto& request = requests[i];
+    success = Storage.openFileForWrite("EBP", request.path, outputs[i]);
+    specs.push_back({&outputs[i], request.targetWidth, request.targetHeight, request.oneBit, request.crop});
+  }
+  if (success) {
+    success = isJpeg ? JpegToBmpConverter::jpegFileToBmpStreams(coverImage, specs.data(), specs.size())
+                     : PngToBmpConverter::pngFileToBmpStreams(coverImage, specs.data(), specs.size());
+  }
+  coverImage.close();
+  for (auto& output : outputs) {
+    output.close();
+  }
+  Storage.remove(coverTempPath.c_str());
 
-    FsFile coverBmp;
-    if (!Storage.openFileForWrite("EBP", getCoverBmpPath(cropped), coverBmp)) {
-      coverJpg.close();
-      return false;
-    }
-    const bool success = JpegToBmpConverter::jpegFileToBmpStream(coverJpg, coverBmp, cropped);
-    coverJpg.close();
-    coverBmp.close();
-    Storage.remove(coverJpgTempPath.c_str());
-
-    if (!success) {
-      LOG_ERR("EBP", "Failed to generate BMP from cover image");
-      Storage.remove(getCoverBmpPath(cropped).c_str());
+  if (!success) {
+    LOG_ERR("EBP", "Failed to generate BMP from cover image");
+    for (const auto& request : requests) {
+      Storage.remove(request.path.c_str());
     }
-    LOG_DBG("EBP", "Generated BMP from JPG cover image, success: %s", success ? "yes" : "no");
-    return success;
   }
+  LOG_DBG("EBP", "Generated BMP(s) from cover image, success: %s", success ? "yes" : "no");
+  return success;
+}
 
-  if (coverImageHref.substr(coverImageHref.length() - 4) == ".png") {
-    LOG_DBG("EBP", "Generating BMP from PNG cover image (%s mode)", cropped ? "cropped" : "fit");
-    const auto coverPngTempPath = getCachePath() + "/.cover.png";
+bool Epub::generateCoverBmp(bool cropped) const {
+  // Already generated, return true
+  if (Storage.exists(getCoverBmpPath(cropped).c_str())) {
+    return true;
+  }
 
-    FsFile coverPng;
-    if (!Storage.openFileForWrite("EBP", coverPngTempPath, coverPng)) {
-      return false;
-    }
-    readItemContentsToStream(coverImageHref, coverPng, 1024);
-    coverPng.close();
+  if (!bookMetadataCache || !bookMetadataCache->isLoaded()) {
+    LOG_ERR("EBP", "Cannot generate cover BMP, cache not loaded");
+    return false;
+  }
 
-    if (!Storage.openFileForRead("EBP", coverPngTempPath, coverPng)) {
-      return false;
-    }
+  const auto& coverImageHref = bookMetadataCache->coreMetadata.coverItemHref;
+  if (coverImageHref.empty()) {
+    LOG_ERR("EBP", "No known cover image");
+    return false;
+  }
 
-    FsFile coverBmp;
-    if (!Storage.openFileForWrite("EBP", getCoverBmpPath(cropped), coverBmp)) {
-      coverPng.close();
-      return false;
-    }
-    const bool success = PngToBmpConverter::pngFileToBmpStream(coverPng, coverBmp, cropped);
-    coverPng.close();
-    coverBmp.close();
-    Storage.remove(coverPngTempPath.c_str());
-
-    if (!success) {
-      LOG_ERR("EBP", "Failed to generate BMP from PNG cover image");
-      Storage.remove(getCoverBmpPath(cropped).c_str());
-    }
-    LOG_DBG("EBP", "Generated BMP from PNG cover image, success: %s", success ? "yes" : "no");
-    return success;
+  if (!isJpegHref(coverImageHref) && !isPngHref(coverImageHref)) {
+    LOG_ERR("EBP", "Cover image is not a supported format, skipping");
+    return false;
   }
 
-  LOG_ERR("EBP", "Cover image is not a supported format, skipping");
-  return false;
+  LOG_DBG("EBP", "Generating cover BMP (%s mode)", cropped ? "cropped" : "fit");
+  return writeCoverBmps({coverRequest(cropped)});
 }
 
 std::string Epub::getThumbBmpPath() const { return cachePath + "/thumb_[HEIGHT].bmp"; }
 std::string Epub::getThumbBmpPath(int height) const { return cachePath + "/thumb_" + std::to_string(height) + ".bmp"; }
 
-bool Epub::generateThumbBmp(int height) const {
-  // Already generated, return true
-  if (Storage.exists(getThumbBmpPath(height).c_str())) {
+bool Epub::generateThumbBmp(int height) const { return generateCoverBmps({height}, false); }
+
+bool Epub::generateCoverBmps(const std::vector<int>& thumbHeights, const bool includeCovers) const {
+  std::vector<CoverBmpRequest> requests;
+  if (includeCovers) {
+    requests.push_back(coverRequest(false));
+    requests.push_back(coverRequest(true));
+  }
+  for (const int height : thumbHeights) {
+    requests.push_back(thumbRequest(height));
+  }
+
+  // Already generated (including "no cover" markers), return true
+  if (std::all_of(requests.begin(), requests.end(),
+                  [](const CoverBmpRequest& request) { return Storage.exists(request.path.c_str()); })) {
     return true;
   }
 
   if (!bookMetadataCache || !bookMetadataCache->isLoaded()) {
-    LOG_ERR("EBP", "Cannot generate thumb BMP, cache not loaded");
+    LOG_ERR("EBP", "Cannot generate cover BMPs, cache not loaded");
     return false;
   }
 
-  const auto coverImageHref = bookMetadataCache->coreMetadata.coverItemHref;
+  const auto& coverImageHref = bookMetadataCache->coreMetadata.coverItemHref;
   if (coverImageHref.empty()) {
     LOG_DBG("EBP", "No known cover image for thumbnail");
-  } else if (coverImageHref.substr(coverImageHref.length() - 4) == ".jpg" ||
-             coverImageHref.substr(coverImageHref.length() - 5) == ".jpeg") {
-    LOG_DBG("EBP", "Generating thumb BMP from JPG cover image");
-    const auto coverJpgTempPath = getCachePath() + "/.cover.jpg";
-
-    FsFile coverJpg;
-    if (!Storage.openFileForWrite("EBP", coverJpgTempPath, coverJpg)) {
-      return false;
-    }
-    readItemContentsToStream(coverImageHref, coverJpg, 1024);
-    coverJpg.close();
-
-    if (!Storage.openFileForRead("EBP", coverJpgTempPath, coverJpg)) {
-      return false;
-    }
-
-    FsFile thumbBmp;
-    if (!Storage.openFileForWrite("EBP", getThumbBmpPath(height), thumbBmp)) {
-      coverJpg.close();
-      return false;
-    }
-    // Use smaller target size for Continue Reading card (half of screen: 240x400)
-    // Generate 1-bit BMP for fast home screen rendering (no gray passes needed)
-    int THUMB_TARGET_WIDTH = height * 0.6;
-    int THUMB_TARGET_HEIGHT = height;
-    const bool success = JpegToBmpConverter::jpegFileTo1BitBmpStreamWithSize(coverJpg, thumbBmp, THUMB_TARGET_WIDTH,
-                                                                             THUMB_TARGET_HEIGHT);
-    coverJpg.close();
-    thumbBmp.close();
-    Storage.remove(coverJpgTempPath.c_str());
-
-    if (!success) {
-      LOG_ERR("EBP", "Failed to generate thumb BMP from JPG cover image");
-      Storage.remove(getThumbBmpPath(height).c_str());
-    }
-    LOG_DBG("EBP", "Generated thumb BMP from JPG cover image, success: %s", success ? "yes" : "no");
-    return success;
-  } else if (coverImageHref.substr(coverImageHref.length() - 4) == ".png") {
-    LOG_DBG("EBP", "Generating thumb BMP from PNG cover image");
-    const auto coverPngTempPath = getCachePath() + "/.cover.png";
-
-    FsFile coverPng;
-    if (!Storage.openFileForWrite("EBP", coverPngTempPath, coverPng)) {
-      return false;
-    }
-    readItemContentsToStream(coverImageHref, coverPng, 1024);
-    coverPng.close();
-
-    if (!Storage.openFileForRead("EBP", coverPngTempPath, coverPng)) {
-      return false;
-    }
-
-    FsFile thumbBmp;
-    if (!Storage.openFileForWrite("EBP", getThumbBmpPath(height), thumbBmp)) {
-      coverPng.close();
-      return false;
-    }
-    int THUMB_TARGET_WIDTH = height * 0.6;
-    int THUMB_TARGET_HEIGHT = height;
-    const bool success =
-        PngToBmpConverter::pngFileTo1BitBmpStreamWithSize(coverPng, thumbBmp, THUMB_TARGET_WIDTH, THUMB_TARGET_HEIGHT);
-    coverPng.close();
-    thumbBmp.close();
-    Storage.remove(coverPngTempPath.c_str());
-
-    if (!success) {
-      LOG_ERR("EBP", "Failed to generate thumb BMP from PNG cover image");
-      Storage.remove(getThumbBmpPath(height).c_str());
-    }
-    LOG_DBG("EBP", "Generated thumb BMP from PNG cover image, success: %s", success ? "yes" : "no");
-    return success;
+  } else if (isJpegHref(coverImageHref) || isPngHref(coverImageHref)) {
+    return writeCoverBmps(std::move(requests));
   } else {
     LOG_ERR("EBP", "Cover image is not a supported format, skipping thumbnail");
   }
 
-  // Write an empty bmp file to avoid generation attempts in the future
-  FsFile thumbBmp;
-  Storage.openFileForWrite("EBP", getThumbBmpPath(height), thumbBmp);
-  thumbBmp.close();
+  // Write empty thumbnail files to avoid generation attempts in the future
+  for (const int height : thumbHeights) {
+    FsFile thumbBmp;
+    Storage.openFileForWrite("EBP", getThumbBmpPath(height), thumbBmp);
+    thumbBmp.close();
+  }
   return false;
 }
 
@@ -36,6 +36,18 @@ class Epub {
   bool parseTocNavFile() const;
   void parseCssFiles() const;
 
+  struct CoverBmpRequest {
+    std::string path;
+    int targetWidth;
+    int targetHeight;
+    bool oneBit;
+    bool crop;
+  };
+  CoverBmpRequest coverRequest(bool cropped) const;
+  CoverBmpRequest thumbRequest(int height) const;
+  // Extracts and decodes the cover image once, writing every requested BMP that doesn't exist yet
+  bool writeCoverBmps(std::vector<CoverBmpRequest> requests) const;
+
  public:
   explicit Epub(std::string filepath, const std::string& cacheDir) : filepath(std::move(filepath)) {
     // create a cache key based on the filepath
@@ -56,6 +68,9 @@ class Epub {
   std::string getThumbBmpPath() const;
   std::string getThumbBmpPath(int height) const;
   bool generateThumbBmp(int height) const;
+  // Generates the thumbnails for every height (plus both full-screen covers if `includeCovers`) from a single decode
+  // of the cover image. Books without a usable cover get empty thumbnail files so they aren't retried.
+  bool generateCoverBmps(const std::vector<int>& thumbHeights, bool includeCovers = true) const;
   uint8_t* readItemContentsToBytes(const std::string& itemHref, size_t* size = nullptr,
                                    bool trailingNullByte = false) const;
   bool readItemContentsToStream(const std::string& itemHref, Print& out, size_t chunkSize) const;
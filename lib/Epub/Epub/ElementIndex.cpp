@@ -0,0 +1,336 @@
+#include "ElementIndex.h"
+
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+constexpr uint8_t ELEMENT_INDEX_VERSION = 1;
+// version + element count + table offset
+constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+// parent + tag + ordinal + source offset
+constexpr uint32_t RECORD_SIZE = sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint32_t);
+// Parent of the elements directly below the root element, which is not recorded itself
+constexpr uint16_t ROOT_PARENT = 0xFFFF;
+constexpr uint32_t MAX_ELEMENTS = 0xFFFE;
+constexpr size_t MAX_TAGS = 255;
+constexpr uint32_t MAX_STRING_LENGTH = 256;
+
+bool readBoundedString(FsFile& file, std::string& s) {
+  uint32_t length = 0;
+  serialization::readPod(file, length);
+  if (length > MAX_STRING_LENGTH) {
+    return false;
+  }
+  s.resize(length);
+  return length == 0 || file.read(&s[0], length) == static_cast<int>(length);
+}
+}  // namespace
+
+bool ElementIndexWriter::begin(const std::string& path, std::vector<std::string> anchors) {
+  abort();
+  this->path = path;
+  if (!Storage.openFileForWrite("EIX", path, file)) {
+    return false;
+  }
+  this->anchors = std::move(anchors);
+  anchorOffsets.assign(this->anchors.size(), UINT32_MAX);
+  tags.clear();
+  stack.clear();
+  elementCount = 0;
+  overflow = false;
+  bufferLength = 0;
+
+  serialization::writePod(file, ELEMENT_INDEX_VERSION);
+  serialization::writePod(file, elementCount);            // Placeholder
+  serialization::writePod(file, static_cast<uint32_t>(0));  // Placeholder for the table offset
+  return true;
+}
+
+void ElementIndexWriter::startElement(const char* name, const char* id, const uint32_t sourceOffset) {
+  if (!file || overflow) {
+    return;
+  }
+  // Paths start below the root element (<html>)
+  if (stack.empty()) {
+    stack.push_back({ROOT_PARENT, {}});
+    return;
+  }
+  if (elementCount >= MAX_ELEMENTS) {
+    overflow = true;
+    return;
+  }
+
+  auto tagIt = std::find(tags.begin(), tags.end(), name);
+  if (tagIt == tags.end()) {
+    if (tags.size() >= MAX_TAGS) {
+      overflow = true;
+      return;
+    }
+    tagIt = tags.insert(tags.end(), name);
+  }
+  const auto tag = static_cast<uint8_t>(tagIt - tags.begin());
+
+  auto& childCounts = stack.back().childCounts;
+  auto countIt = std::find_if(childCounts.begin(), childCounts.end(),
+                              [tag](const std::pair<uint8_t, uint16_t>& count) { return count.first == tag; });
+  uint16_t ordinal = 1;
+  if (countIt == childCounts.end()) {
+    childCounts.emplace_back(tag, ordinal);
+  } else {
+    ordinal = ++countIt->second;
+  }
+
+  if (bufferLength + RECORD_SIZE > sizeof(buffer)) {
+    flush();
+  }
+  const uint16_t parent = stack.back().index;
+  memcpy(buffer + bufferLength, &parent, sizeof(parent));
+  buffer[bufferLength + 2] = tag;
+  memcpy(buffer + bufferLength + 3, &ordinal, sizeof(ordinal));
+  memcpy(buffer + bufferLength + 5, &sourceOffset, sizeof(sourceOffset));
+  bufferLength += RECORD_SIZE;
+
+  if (id && *id) {
+    for (size_t i = 0; i < anchors.size(); i++) {
+      if (anchorOffsets[i] == UINT32_MAX && anchors[i] == id) {
+        anchorOffsets[i] = sourceOffset;
+      }
+    }
+  }
+
+  stack.push_back({static_cast<uint16_t>(elementCount), {}});
+  elementCount++;
+}
+
+void ElementIndexWriter::endElement() {
+  if (!file || overflow || stack.empty()) {
+    return;
+  }
+  stack.pop_back();
+}
+
+void ElementIndexWriter::flush() {
+  if (bufferLength > 0) {
+    file.write(buffer, bufferLength);
+    bufferLength = 0;
+  }
+}
+
+bool ElementIndexWriter::finish() {
+  if (!file) {
+    return false;
+  }
+  if (overflow) {
+    LOG_DBG("EIX", "Chapter too large for an element index: %s", path.c_str());
+    abort();
+    return false;
+  }
+  flush();
+
+  const uint32_t tableOffset = file.position();
+  serialization::writePod(file, static_cast<uint8_t>(tags.size()));
+  for (const auto& tag : tags) {
+    serialization::writeString(file, tag);
+  }
+  const auto found =
+      static_cast<uint16_t>(std::count_if(anchorOffsets.begin(), anchorOffsets.end(),
+                                          [](const uint32_t offset) { return offset != UINT32_MAX; }));
+  serialization::writePod(file, found);
+  for (size_t i = 0; i < anchors.size(); i++) {
+    if (anchorOffsets[i] != UINT32_MAX) {
+      serialization::writeString(file, anchors[i]);
+      serialization::writePod(file, anchorOffsets[i]);
+    }
+  }
+
+  file.seek(sizeof(uint8_t));
+  serialization::writePod(file, elementCount);
+  serialization::writePod(file, tableOffset);
+  file.close();
+  tags.clear();
+  stack.clear();
+  anchors.clear();
+  anchorOffsets.clear();
+  return true;
+}
+
+void ElementIndexWriter::abort() {
+  if (!file) {
+    return;
+  }
+  file.close();
+  Storage.remove(path.c_str());
+  tags.clear();
+  stack.clear();
+}
+
+bool ElementIndex::openIndex(const std::string& indexPath, FsFile& file, Tables& tables) {
+  if (!Storage.exists(indexPath.c_str()) || !Storage.openFileForRead("EIX", indexPath, file)) {
+    return false;
+  }
+  uint8_t version = 0;
+  uint32_t tableOffset = 0;
+  serialization::readPod(file, version);
+  serialization::readPod(file, tables.elementCount);
+  serialization::readPod(file, tableOffset);
+  bool ok = version == ELEMENT_INDEX_VERSION && tables.elementCount <= MAX_ELEMENTS &&
+            tableOffset == HEADER_SIZE + tables.elementCount * RECORD_SIZE && file.seek(tableOffset);
+
+  uint8_t tagCount = 0;
+  serialization::readPod(file, tagCount);
+  tables.tags.resize(tagCount);
+  for (auto& tag : tables.tags) {
+    ok = ok && readBoundedString(file, tag);
+  }
+  uint16_t anchorCount = 0;
+  serialization::readPod(file, anchorCount);
+  for (uint16_t i = 0; ok && i < anchorCount; i++) {
+    std::pair<std::string, uint32_t> anchor;
+    ok = readBoundedString(file, anchor.first);
+    serialization::readPod(file, anchor.second);
+    tables.anchors.push_back(std::move(anchor));
+  }
+
+  if (!ok || !file.seek(HEADER_SIZE)) {
+    LOG_DBG("EIX", "Ignoring unreadable element index %s", indexPath.c_str());
+    file.close();
+    return false;
+  }
+  return true;
+}
+
+template <typename Fn>
+bool ElementIndex::readRecords(FsFile& file, const uint32_t count, Fn&& onRecord) {
+  uint8_t buffer[RECORD_SIZE * 64];
+  uint32_t index = 0;
+  while (index < count) {
+    const uint32_t batch = std::min<uint32_t>(count - index, sizeof(buffer) / RECORD_SIZE);
+    const int bytes = static_cast<int>(batch * RECORD_SIZE);
+    if (file.read(buffer, bytes) != bytes) {
+      return false;
+    }
+    for (uint32_t i = 0; i < batch; i++, index++) {
+      const uint8_t* data = buffer + i * RECORD_SIZE;
+      Record record;
+      memcpy(&record.parent, data, sizeof(record.parent));
+      record.tag = data[2];
+      memcpy(&record.ordinal, data + 3, sizeof(record.ordinal));
+      memcpy(&record.offset, data + 5, sizeof(record.offset));
+      if (!onRecord(index, record)) {
+        return true;
+      }
+    }
+  }
+  return true;
+}
+
+bool ElementIndex::findOffset(const std::string& indexPath, const std::string& elementPath, uint32_t& offset) {
+  FsFile file;
+  Tables tables;
+  if (!openIndex(indexPath, file, tables)) {
+    return false;
+  }
+
+  // Element steps as (tag, index); a tag the chapter doesn't use matches nothing
+  std::vector<std::pair<int, uint16_t>> steps;
+  size_t pos = 0;
+  while (pos < elementPath.size()) {
+    if (elementPath[pos] == '/') {
+      pos++;
+      continue;
+    }
+    const size_t end = std::min(elementPath.find('/', pos), elementPath.size());
+    const std::string step = elementPath.substr(pos, end - pos);
+    pos = end;
+    if (step.find('(') != std::string::npos) {
+      break;  // text(), comment(): the element path ends here
+    }
+    const size_t bracket = step.find('[');
+    const int index = bracket == std::string::npos ? 1 : atoi(step.c_str() + bracket + 1);
+    if (index <= 0) {
+      break;
+    }
+    const auto tagIt = std::find(tables.tags.begin(), tables.tags.end(), step.substr(0, bracket));
+    steps.emplace_back(tagIt == tables.tags.end() ? -1 : static_cast<int>(tagIt - tables.tags.begin()),
+                       static_cast<uint16_t>(index));
+  }
+
+  // Walk down the path. Records come in document order, so a match's children follow it, and the first record whose
+  // parent comes before the match is past its subtree.
+  int current = -1;
+  size_t matched = 0;
+  const bool ok = readRecords(file, tables.elementCount, [&](const uint32_t index, const Record& record) {
+    if (matched == steps.size()) {
+      return false;
+    }
+    const int parent = record.parent == ROOT_PARENT ? -1 : record.parent;
+    if (parent < current) {
+      return false;
+    }
+    if (parent == current && record.tag == steps[matched].first && record.ordinal == steps[matched].second) {
+      current = static_cast<int>(index);
+      offset = record.offset;
+      matched++;
+    }
+    return true;
+  });
+  file.close();
+  return ok && matched > 0;
+}
+
+bool ElementIndex::findPath(const std::string& indexPath, const uint32_t offset, std::string& elementPath) {
+  FsFile file;
+  Tables tables;
+  if (!openIndex(indexPath, file, tables)) {
+    return false;
+  }
+
+  // Open elements down to the current record
+  std::vector<Record> stack;
+  std::vector<uint16_t> stackIndices;
+  bool found = false;
+  const bool ok = readRecords(file, tables.elementCount, [&](const uint32_t index, const Record& record) {
+    while (!stackIndices.empty() && stackIndices.back() != record.parent) {
+      stack.pop_back();
+      stackIndices.pop_back();
+    }
+    stack.push_back(record);
+    stackIndices.push_back(static_cast<uint16_t>(index));
+    found = record.offset >= offset;
+    return !found;
+  });
+  file.close();
+  if (!ok || !found) {
+    return false;
+  }
+
+  elementPath.clear();
+  for (const auto& record : stack) {
+    if (record.tag >= tables.tags.size()) {
+      return false;
+    }
+    elementPath += "/" + tables.tags[record.tag] + "[" + std::to_string(record.ordinal) + "]";
+  }
+  return true;
+}
+
+bool ElementIndex::findAnchor(const std::string& indexPath, const std::string& anchor, uint32_t& offset) {
+  FsFile file;
+  Tables tables;
+  if (!openIndex(indexPath, file, tables)) {
+    return false;
+  }
+  file.close();
+  const auto it =
+      std::find_if(tables.anchors.begin(), tables.anchors.end(),
+                   [&anchor](const std::pair<std::string, uint32_t>& entry) { return entry.first == anchor; });
+  if (it == tables.anchors.end()) {
+    return false;
+  }
+  offset = it->second;
+  return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <HalStorage.h>
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Map from a chapter's DOM to byte offsets in its XHTML, stored next to the section file as sections/<n>.idx. Every
+// element below the root is recorded in document order with its parent, its tag and its position among siblings of
+// the same tag, which is exactly what a KOReader XPointer such as /body/div[2]/p[5] addresses. Elements carrying one
+// of the chapter's TOC anchors are listed as well. The section's page offset map turns an offset into a page, so a
+// synced position or a TOC entry resolves to its page without estimating.
+//
+// Records are 9 bytes and are streamed to the card while the chapter is parsed; nothing but the open element path is
+// kept in memory.
+class ElementIndexWriter {
+ public:
+  // Starts an index at `path`. `anchors` are the element ids to remember (fragment identifiers of the chapter's TOC
+  // entries).
+  bool begin(const std::string& path, std::vector<std::string> anchors);
+  void startElement(const char* name, const char* id, uint32_t sourceOffset);
+  void endElement();
+  // Writes the tag and anchor tables. False if the index could not be written or the chapter was too large for it, in
+  // which case the file is removed.
+  bool finish();
+  void abort();
+
+ private:
+  struct Frame {
+    uint16_t index;
+    std::vector<std::pair<uint8_t, uint16_t>> childCounts;  // tag -> same-tag children so far
+  };
+
+  FsFile file;
+  std::string path;
+  std::vector<std::string> tags;
+  std::vector<std::string> anchors;
+  std::vector<uint32_t> anchorOffsets;
+  std::vector<Frame> stack;
+  uint32_t elementCount = 0;
+  bool overflow = false;
+  uint8_t buffer[576] = {};
+  size_t bufferLength = 0;
+
+  void flush();
+};
+
+class ElementIndex {
+ public:
+  // Offset of the element at `elementPath`, e.g. "/body/div[2]/p[5]/text().12"; a step without an index means [1].
+  // Steps after the last element (text(), character offsets) are ignored. A path that stops matching resolves to the
+  // deepest element matched. False if not even the first step matches.
+  static bool findOffset(const std::string& indexPath, const std::string& elementPath, uint32_t& offset);
+  // Path of the first element that starts at or after `offset`, with every step indexed.
+  static bool findPath(const std::string& indexPath, uint32_t offset, std::string& elementPath);
+  // Offset of the element with id `anchor`, if it is one of the anchors the index was built with.
+  static bool findAnchor(const std::string& indexPath, const std::string& anchor, uint32_t& offset);
+
+ private:
+  struct Tables {
+    uint32_t elementCount = 0;
+    std::vector<std::string> tags;
+    std::vector<std::pair<std::string, uint32_t>> anchors;
+  };
+  struct Record {
+    uint16_t parent;
+    uint8_t tag;
+    uint16_t ordinal;
+    uint32_t offset;
+  };
+
+  static bool openIndex(const std::string& indexPath, FsFile& file, Tables& tables);
+  // Feeds the records in document order to `onRecord` until it returns false.
+  template <typename Fn>
+  static bool readRecords(FsFile& file, uint32_t count, Fn&& onRecord);
+};
@@ -48,10 +48,15 @@ std::unique_ptr<PageImage> PageImage::deserialize(FsFile& file) {
   return std::unique_ptr<PageImage>(new PageImage(std::move(ib), xPos, yPos));
 }
 
-void Page::render(GfxRenderer& renderer, const int fontId, const int xOffset, const int yOffset) const {
+bool Page::render(GfxRenderer& renderer, const int fontId, const int xOffset, const int yOffset,
+                  const std::function<bool()>& stop) const {
   for (auto& element : elements) {
+    if (stop && stop()) {
+      return false;
+    }
     element->render(renderer, fontId, xOffset, yOffset);
   }
+  return true;
 }
 
 bool Page::serialize(FsFile& file) const {
@@ -94,3 +99,31 @@ std::unique_ptr<Page> Page::deserialize(FsFile& file) {
 
   return page;
 }
+
+bool Page::visitText(FsFile& file, std::string& scratch,
+                     const std::function<void(const std::string& word, bool lastInLine)>& onWord) {
+  uint16_t count;
+  serialization::readPod(file, count);
+
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t tag;
+    serialization::readPod(file, tag);
+
+    if (tag == TAG_PageLine) {
+      int16_t xPos;
+      int16_t yPos;
+      serialization::readPod(file, xPos);
+      serialization::readPod(file, yPos);
+      if (!TextBlock::visitWords(file, scratch, onWord)) {
+        return false;
+      }
+    } else if (tag == TAG_PageImage) {
+      PageImage::deserialize(file);
+    } else {
+      LOG_ERR("PGE", "Text visit failed: Unknown tag %u", tag);
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -2,6 +2,7 @@
 #include <HalStorage.h>
 
 #include <algorithm>
+#include <functional>
 #include <utility>
 #include <vector>
 
@@ -35,6 +36,7 @@ class PageLine final : public PageElement {
   void render(GfxRenderer& renderer, int fontId, int xOffset, int yOffset) override;
   bool serialize(FsFile& file) override;
   PageElementTag getTag() const override { return TAG_PageLine; }
+  const TextBlock& getBlock() const { return *block; }
   static std::unique_ptr<PageLine> deserialize(FsFile& file);
 };
 
@@ -55,9 +57,14 @@ class Page {
  public:
   // the list of block index and line numbers on this page
   std::vector<std::shared_ptr<PageElement>> elements;
-  void render(GfxRenderer& renderer, int fontId, int xOffset, int yOffset) const;
+  // Stops between elements once `stop` returns true, and returns false if it did
+  bool render(GfxRenderer& renderer, int fontId, int xOffset, int yOffset,
+              const std::function<bool()>& stop = nullptr) const;
   bool serialize(FsFile& file) const;
   static std::unique_ptr<Page> deserialize(FsFile& file);
+  // Streams the words of a serialized page line by line, skipping images, without building the page.
+  static bool visitText(FsFile& file, std::string& scratch,
+                        const std::function<void(const std::string& word, bool lastInLine)>& onWord);
 
   // Check if page contains any images (used to force full refresh)
   bool hasImages() const {
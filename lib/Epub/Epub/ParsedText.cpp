@@ -317,7 +317,7 @@ bool ParsedText::hyphenateWordAtIndex(const size_t wordIndex, const int availabl
                                       const int fontId, std::vector<uint16_t>& wordWidths,
                                       const bool allowFallbackBreaks, std::vector<bool>* continuesVec) {
   // Guard against invalid indices or zero available width before attempting to split.
-  if (availableWidth <= 0 || wordIndex >= words.size()) {
+  if (availableWidth <= 0 || wordIndex >= words.size() || !hyphenationWorkspace) {
     return false;
   }
 
@@ -330,25 +330,31 @@ bool ParsedText::hyphenateWordAtIndex(const size_t wordIndex, const int availabl
   const std::string& word = *wordIt;
   const auto style = *styleIt;
 
-  // Collect candidate breakpoints (byte offsets and hyphen requirements).
-  auto breakInfos = Hyphenator::breakOffsets(word, allowFallbackBreaks);
-  if (breakInfos.empty()) {
+  // Collect candidate breakpoints (byte offsets and hyphen requirements) into the parser's workspace
+  auto& workspace = *hyphenationWorkspace;
+  const size_t breakCount = Hyphenator::breakOffsets(word, allowFallbackBreaks, workspace);
+  if (breakCount == 0) {
     return false;
   }
 
   size_t chosenOffset = 0;
   int chosenWidth = -1;
   bool chosenNeedsHyphen = true;
+  // Reused across candidates so probing prefixes doesn't allocate per breakpoint.
+  std::string prefix;
+  prefix.reserve(word.size() + 1);
 
   // Iterate over each legal breakpoint and retain the widest prefix that still fits.
-  for (const auto& info : breakInfos) {
+  for (size_t i = 0; i < breakCount; ++i) {
+    const auto& info = workspace.breaks[i];
     const size_t offset = info.byteOffset;
     if (offset == 0 || offset >= word.size()) {
       continue;
     }
 
     const bool needsHyphen = info.requiresInsertedHyphen;
-    const int prefixWidth = measureWordWidth(renderer, fontId, word.substr(0, offset), style, needsHyphen);
+    prefix.assign(word, 0, offset);
+    const int prefixWidth = measureWordWidth(renderer, fontId, prefix, style, needsHyphen);
     if (prefixWidth > availableWidth || prefixWidth <= chosenWidth) {
       continue;  // Skip if too wide or not an improvement
     }
@@ -10,6 +10,7 @@
 
 #include "blocks/BlockStyle.h"
 #include "blocks/TextBlock.h"
+#include "hyphenation/Hyphenator.h"
 
 class GfxRenderer;
 
@@ -20,6 +21,8 @@ class ParsedText {
   BlockStyle blockStyle;
   bool extraParagraphSpacing;
   bool hyphenationEnabled;
+  // Scratch space for splitting words, owned by the parser building the section; without one no word is split
+  Hyphenator::Workspace* hyphenationWorkspace;
 
   void applyParagraphIndent();
   std::vector<size_t> computeLineBreaks(const GfxRenderer& renderer, int fontId, int pageWidth, int spaceWidth,
@@ -37,8 +40,12 @@ class ParsedText {
 
  public:
   explicit ParsedText(const bool extraParagraphSpacing, const bool hyphenationEnabled = false,
-                      const BlockStyle& blockStyle = BlockStyle())
-      : blockStyle(blockStyle), extraParagraphSpacing(extraParagraphSpacing), hyphenationEnabled(hyphenationEnabled) {}
+                      const BlockStyle& blockStyle = BlockStyle(),
+                      Hyphenator::Workspace* hyphenationWorkspace = nullptr)
+      : blockStyle(blockStyle),
+        extraParagraphSpacing(extraParagraphSpacing),
+        hyphenationEnabled(hyphenationEnabled),
+        hyphenationWorkspace(hyphenationWorkspace) {}
   ~ParsedText() = default;
 
   void addWord(std::string word, EpdFontFamily::Style fontStyle, bool underline = false, bool attachToPrevious = false);
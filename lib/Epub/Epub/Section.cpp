@@ -3,16 +3,114 @@
 #include <HalStorage.h>
 #include <Logging.h>
 #include <Serialization.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
+#include <algorithm>
+
+#include "ElementIndex.h"
 #include "Page.h"
+#include "hyphenation/HyphenationCache.h"
 #include "hyphenation/Hyphenator.h"
 #include "parsers/ChapterHtmlSlimParser.h"
 
 namespace {
-constexpr uint8_t SECTION_FILE_VERSION = 13;
 constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + sizeof(int) + sizeof(float) + sizeof(bool) + sizeof(uint8_t) +
                                  sizeof(uint16_t) + sizeof(uint16_t) + sizeof(uint16_t) + sizeof(bool) + sizeof(bool) +
                                  sizeof(uint32_t);
+// Bump when the entry layout or the bundled hyphenation patterns change.
+constexpr uint8_t HYPHENATION_CACHE_FILE_VERSION = 1;
+
+// Restores the book's hyphenation break cache if it was written for the same language; otherwise leaves it empty.
+void loadHyphenationCache(const std::string& path, const std::string& language, HyphenationCache& cache) {
+  if (!Storage.exists(path.c_str())) {
+    return;
+  }
+  FsFile cacheFile;
+  if (!Storage.openFileForRead("SCT", path, cacheFile)) {
+    return;
+  }
+
+  uint8_t version;
+  uint16_t capacity;
+  std::string fileLanguage;
+  serialization::readPod(cacheFile, version);
+  serialization::readPod(cacheFile, capacity);
+  if (version != HYPHENATION_CACHE_FILE_VERSION || capacity != HyphenationCache::kCapacity) {
+    cacheFile.close();
+    LOG_DBG("SCT", "Ignoring hyphenation cache: format mismatch");
+    return;
+  }
+  serialization::readString(cacheFile, fileLanguage);
+  if (fileLanguage != language) {
+    cacheFile.close();
+    LOG_DBG("SCT", "Ignoring hyphenation cache for language %s", fileLanguage.c_str());
+    return;
+  }
+
+  constexpr size_t tableBytes = sizeof(HyphenationCache::Entry) * HyphenationCache::kCapacity;
+  if (cacheFile.read(reinterpret_cast<uint8_t*>(cache.entries()), tableBytes) != static_cast<int>(tableBytes)) {
+    cache.clear();
+  }
+  cacheFile.close();
+  cache.markClean();
+}
+
+void saveHyphenationCache(const std::string& path, const std::string& language, HyphenationCache& cache) {
+  if (!cache.isDirty()) {
+    return;
+  }
+  FsFile cacheFile;
+  if (!Storage.openFileForWrite("SCT", path, cacheFile)) {
+    return;
+  }
+  serialization::writePod(cacheFile, HYPHENATION_CACHE_FILE_VERSION);
+  serialization::writePod(cacheFile, static_cast<uint16_t>(HyphenationCache::kCapacity));
+  serialization::writeString(cacheFile, language);
+  cacheFile.write(reinterpret_cast<const uint8_t*>(cache.entries()),
+                  sizeof(HyphenationCache::Entry) * HyphenationCache::kCapacity);
+  cacheFile.close();
+  cache.markClean();
+}
+
+// Passes the chapter through to the temp file while it is inflated and feeds the same bytes to a preview parser
+// until that has produced its page.
+class PreviewTee final : public Print {
+  Print& out;
+  ChapterHtmlSlimParser* preview;
+
+ public:
+  PreviewTee(Print& out, ChapterHtmlSlimParser* preview) : out(out), preview(preview) {}
+
+  size_t write(const uint8_t b) override { return write(&b, 1); }
+  size_t write(const uint8_t* buffer, const size_t size) override {
+    if (preview && !preview->isStopped() && !preview->parseChunk(reinterpret_cast<const char*>(buffer), size, false)) {
+      preview = nullptr;
+    }
+    return out.write(buffer, size);
+  }
+};
+// Page holding `target` given where each page starts; see Section::findPageForProgress()
+int pageForOffset(const std::vector<uint32_t>& offsets, const uint32_t sourceSize, const uint32_t target) {
+  const auto next = std::upper_bound(offsets.begin(), offsets.end(), target);
+  if (next == offsets.begin()) {
+    return 0;
+  }
+  const int last = static_cast<int>(next - offsets.begin()) - 1;
+
+  // Every page of a block that spans pages carries the block's offset, so spread the target over them
+  int first = last;
+  while (first > 0 && offsets[first - 1] == offsets[last]) {
+    first--;
+  }
+  const uint32_t blockStart = offsets[last];
+  const uint32_t blockEnd = next == offsets.end() ? sourceSize : *next;
+  if (first == last || blockEnd <= blockStart) {
+    return last;
+  }
+  const uint64_t span = static_cast<uint64_t>(last - first + 1) * (target - blockStart);
+  return std::min(last, first + static_cast<int>(span / (blockEnd - blockStart)));
+}
 }  // namespace
 
 uint32_t Section::onPageComplete(std::unique_ptr<Page> page) {
@@ -40,12 +138,12 @@ void Section::writeSectionFileHeader(const int fontId, const float lineCompressi
     LOG_DBG("SCT", "File not open for writing header");
     return;
   }
-  static_assert(HEADER_SIZE == sizeof(SECTION_FILE_VERSION) + sizeof(fontId) + sizeof(lineCompression) +
+  static_assert(HEADER_SIZE == sizeof(FILE_VERSION) + sizeof(fontId) + sizeof(lineCompression) +
                                    sizeof(extraParagraphSpacing) + sizeof(paragraphAlignment) + sizeof(viewportWidth) +
                                    sizeof(viewportHeight) + sizeof(pageCount) + sizeof(hyphenationEnabled) +
                                    sizeof(embeddedStyle) + sizeof(uint32_t),
                 "Header size mismatch");
-  serialization::writePod(file, SECTION_FILE_VERSION);
+  serialization::writePod(file, FILE_VERSION);
   serialization::writePod(file, fontId);
   serialization::writePod(file, lineCompression);
   serialization::writePod(file, extraParagraphSpacing);
@@ -69,7 +167,7 @@ bool Section::loadSectionFile(const int fontId, const float lineCompression, con
   {
     uint8_t version;
     serialization::readPod(file, version);
-    if (version != SECTION_FILE_VERSION) {
+    if (version != FILE_VERSION) {
       file.close();
       LOG_ERR("SCT", "Deserialization failed: Unknown version %u", version);
       clearCache();
@@ -111,6 +209,9 @@ bool Section::loadSectionFile(const int fontId, const float lineCompression, con
 
 // Your updated class method (assuming you are using the 'SD' object, which is a wrapper for a specific filesystem)
 bool Section::clearCache() const {
+  if (Storage.exists(indexPath.c_str())) {
+    Storage.remove(indexPath.c_str());
+  }
   if (!Storage.exists(filePath.c_str())) {
     LOG_DBG("SCT", "Cache does not exist, no action needed");
     return true;
@@ -128,7 +229,8 @@ bool Section::clearCache() const {
 bool Section::createSectionFile(const int fontId, const float lineCompression, const bool extraParagraphSpacing,
                                 const uint8_t paragraphAlignment, const uint16_t viewportWidth,
                                 const uint16_t viewportHeight, const bool hyphenationEnabled, const bool embeddedStyle,
-                                const std::function<void()>& popupFn) {
+                                const std::function<void()>& popupFn, const float previewProgress,
+                                const std::function<void(std::unique_ptr<Page>)>& previewFn) {
   const auto localPath = epub->getSpineItem(spineIndex).href;
   const auto tmpHtmlPath = epub->getCachePath() + "/.tmp_" + std::to_string(spineIndex) + ".html";
 
@@ -138,6 +240,51 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
     Storage.mkdir(sectionsDir.c_str());
   }
 
+  // Derive the content base directory and image cache path prefix for the parser
+  size_t lastSlash = localPath.find_last_of('/');
+  std::string contentBase = (lastSlash != std::string::npos) ? localPath.substr(0, lastSlash + 1) : "";
+  std::string imageBasePath = epub->getCachePath() + "/img_" + std::to_string(spineIndex) + "_";
+
+  CssParser* cssParser = nullptr;
+  if (embeddedStyle) {
+    cssParser = epub->getCssParser();
+    if (cssParser) {
+      if (!cssParser->loadFromCache()) {
+        LOG_ERR("SCT", "Failed to load CSS from cache");
+      }
+    }
+  }
+  Hyphenator::setPreferredLanguage(epub->getLanguage());
+
+  // A jump deep into a chapter that isn't cached yet would otherwise wait for the whole chapter to be paginated.
+  // Lay out one approximate page from the requested position while the chapter is inflated, show it, and then
+  // paginate exactly as usual.
+  std::unique_ptr<ChapterHtmlSlimParser> preview;
+  bool previewShown = false;
+  if (previewFn && previewProgress > 0.0f) {
+    const size_t chapterStart = spineIndex > 0 ? epub->getCumulativeSpineItemSize(spineIndex - 1) : 0;
+    size_t chapterSize = epub->getCumulativeSpineItemSize(spineIndex) - chapterStart;
+    if (chapterSize > 0 || epub->getItemSize(localPath, &chapterSize)) {
+      preview.reset(new (std::nothrow) ChapterHtmlSlimParser(
+          epub, tmpHtmlPath, renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment,
+          viewportWidth, viewportHeight, hyphenationEnabled,
+          [&](std::unique_ptr<Page> page, uint32_t) {
+            if (page) {
+              previewFn(std::move(page));
+              previewShown = true;
+            }
+            preview->stop();
+          },
+          embeddedStyle, contentBase, imageBasePath, nullptr, cssParser));
+      if (preview) {
+        preview->setPreviewFrom(static_cast<uint32_t>(std::min(previewProgress, 1.0f) * chapterSize));
+        if (!preview->beginParse()) {
+          preview.reset();
+        }
+      }
+    }
+  }
+
   // Retry logic for SD card timing issues
   bool success = false;
   uint32_t fileSize = 0;
@@ -145,6 +292,7 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
     if (attempt > 0) {
       LOG_DBG("SCT", "Retrying stream (attempt %d)...", attempt + 1);
       delay(50);  // Brief delay before retry
+      preview.reset();  // It has already seen part of the failed stream
     }
 
     // Remove any incomplete file from previous attempt before retrying
@@ -156,7 +304,8 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
     if (!Storage.openFileForWrite("SCT", tmpHtmlPath, tmpHtml)) {
       continue;
     }
-    success = epub->readItemContentsToStream(localPath, tmpHtml, 1024);
+    PreviewTee tee(tmpHtml, preview.get());
+    success = epub->readItemContentsToStream(localPath, tee, 1024);
     fileSize = tmpHtml.size();
     tmpHtml.close();
 
@@ -167,8 +316,19 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
     }
   }
 
+  if (preview) {
+    // Short chapter or a position in its last page: the preview parser hasn't produced a page yet
+    if (!preview->isStopped()) {
+      preview->finishParse();
+    }
+    preview.reset();
+  }
+
   if (!success) {
     LOG_ERR("SCT", "Failed to stream item contents to temp file after retries");
+    if (cssParser) {
+      cssParser->clear();
+    }
     return false;
   }
 
@@ -180,31 +340,70 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
   writeSectionFileHeader(fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
                          viewportHeight, hyphenationEnabled, embeddedStyle);
   std::vector<uint32_t> lut = {};
+  std::vector<uint32_t> sourceOffsets = {};
 
-  // Derive the content base directory and image cache path prefix for the parser
-  size_t lastSlash = localPath.find_last_of('/');
-  std::string contentBase = (lastSlash != std::string::npos) ? localPath.substr(0, lastSlash + 1) : "";
-  std::string imageBasePath = epub->getCachePath() + "/img_" + std::to_string(spineIndex) + "_";
-
-  CssParser* cssParser = nullptr;
-  if (embeddedStyle) {
-    cssParser = epub->getCssParser();
-    if (cssParser) {
-      if (!cssParser->loadFromCache()) {
-        LOG_ERR("SCT", "Failed to load CSS from cache");
+  ChapterHtmlSlimParser visitor(
+      epub, tmpHtmlPath, renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
+      viewportHeight, hyphenationEnabled,
+      [this, &lut, &sourceOffsets](std::unique_ptr<Page> page, const uint32_t sourceOffset) {
+        lut.emplace_back(this->onPageComplete(std::move(page)));
+        sourceOffsets.emplace_back(sourceOffset);
+      },
+      embeddedStyle, contentBase, imageBasePath, previewShown ? nullptr : popupFn, cssParser);
+
+  // Element paths and TOC anchors, so synced positions and TOC entries resolve to their page
+  std::unique_ptr<ElementIndexWriter> elementIndex(new (std::nothrow) ElementIndexWriter());
+  if (elementIndex) {
+    std::vector<std::string> anchors;
+    for (int i = 0; i < epub->getTocItemsCount(); i++) {
+      auto tocItem = epub->getTocItem(i);
+      if (tocItem.spineIndex == spineIndex && !tocItem.anchor.empty()) {
+        anchors.push_back(std::move(tocItem.anchor));
       }
     }
+    if (elementIndex->begin(indexPath, std::move(anchors))) {
+      visitor.setElementIndex(elementIndex.get());
+    } else {
+      elementIndex.reset();
+    }
   }
 
-  ChapterHtmlSlimParser visitor(
-      epub, tmpHtmlPath, renderer, fontId, lineCompression, extraParagraphSpacing, paragraphAlignment, viewportWidth,
-      viewportHeight, hyphenationEnabled,
-      [this, &lut](std::unique_ptr<Page> page) { lut.emplace_back(this->onPageComplete(std::move(page))); },
-      embeddedStyle, contentBase, imageBasePath, popupFn, cssParser);
-  Hyphenator::setPreferredLanguage(epub->getLanguage());
+  // Long words recur at line ends across the whole book, so the break cache is shared by every section build and
+  // persisted next to the book's other caches.
+  std::unique_ptr<HyphenationCache> hyphenationCache;
+  const auto hyphenationCachePath = epub->getCachePath() + "/hyphenation.bin";
+  if (hyphenationEnabled) {
+    hyphenationCache.reset(new (std::nothrow) HyphenationCache());
+    if (hyphenationCache) {
+      loadHyphenationCache(hyphenationCachePath, epub->getLanguage(), *hyphenationCache);
+      Hyphenator::setCache(hyphenationCache.get());
+    }
+  }
+
+  const uint32_t parseStart = millis();
   success = visitor.parseAndBuildPages();
+  // Layout runs nested in expat callbacks on 8KB task stacks; watch how close it gets
+  LOG_DBG("SCT", "Parsed section %d in %lu ms, %u bytes of stack to spare", spineIndex, millis() - parseStart,
+          static_cast<unsigned>(uxTaskGetStackHighWaterMark(nullptr)));
+
+  if (hyphenationCache) {
+    Hyphenator::setCache(nullptr);
+    const auto hits = static_cast<unsigned>(hyphenationCache->hits());
+    const auto lookups = hits + static_cast<unsigned>(hyphenationCache->misses());
+    LOG_DBG("SCT", "Hyphenation cache: %u/%u hits (%u%%)", hits, lookups, lookups ? hits * 100 / lookups : 0);
+    if (success) {
+      saveHyphenationCache(hyphenationCachePath, epub->getLanguage(), *hyphenationCache);
+    }
+  }
 
   Storage.remove(tmpHtmlPath.c_str());
+  if (elementIndex) {
+    if (success) {
+      elementIndex->finish();
+    } else {
+      elementIndex->abort();
+    }
+  }
   if (!success) {
     LOG_ERR("SCT", "Failed to parse XML and build pages");
     file.close();
@@ -233,6 +432,12 @@ bool Section::createSectionFile(const int fontId, const float lineCompression, c
     return false;
   }
 
+  // Byte-offset map for findPageForProgress()
+  serialization::writePod(file, fileSize);
+  for (const uint32_t& offset : sourceOffsets) {
+    serialization::writePod(file, offset);
+  }
+
   // Go back and write LUT offset
   file.seek(HEADER_SIZE - sizeof(uint32_t) - sizeof(pageCount));
   serialization::writePod(file, pageCount);
@@ -261,3 +466,85 @@ std::unique_ptr<Page> Section::loadPageFromSectionFile() {
   file.close();
   return page;
 }
+
+bool Section::readSourceOffsets(std::vector<uint32_t>& offsets, uint32_t& sourceSize) {
+  if (pageCount == 0 || !Storage.openFileForRead("SCT", filePath, file)) {
+    return false;
+  }
+
+  file.seek(HEADER_SIZE - sizeof(uint32_t));
+  uint32_t lutOffset;
+  serialization::readPod(file, lutOffset);
+  file.seek(lutOffset + sizeof(uint32_t) * pageCount);
+  serialization::readPod(file, sourceSize);
+  offsets.resize(pageCount);
+  const int bytes = static_cast<int>(sizeof(uint32_t) * pageCount);
+  const bool ok = sourceSize > 0 && file.read(reinterpret_cast<uint8_t*>(offsets.data()), bytes) == bytes;
+  file.close();
+  return ok;
+}
+
+int Section::findPageForProgress(const float progress) {
+  std::vector<uint32_t> offsets;
+  uint32_t sourceSize = 0;
+  if (!readSourceOffsets(offsets, sourceSize)) {
+    return -1;
+  }
+  return pageForOffset(offsets, sourceSize, static_cast<uint32_t>(std::clamp(progress, 0.0f, 1.0f) * sourceSize));
+}
+
+int Section::findPageForSourceOffset(const uint32_t sourceOffset) {
+  std::vector<uint32_t> offsets;
+  uint32_t sourceSize = 0;
+  if (!readSourceOffsets(offsets, sourceSize)) {
+    return -1;
+  }
+  return pageForOffset(offsets, sourceSize, std::min(sourceOffset, sourceSize));
+}
+
+int Section::findPageForElementPath(const std::string& elementPath) {
+  uint32_t offset = 0;
+  if (!ElementIndex::findOffset(indexPath, elementPath, offset)) {
+    return -1;
+  }
+  return findPageForSourceOffset(offset);
+}
+
+int Section::findPageForAnchor(const std::string& anchor) {
+  uint32_t offset = 0;
+  if (!ElementIndex::findAnchor(indexPath, anchor, offset)) {
+    return -1;
+  }
+  return findPageForSourceOffset(offset);
+}
+
+std::string Section::getElementPathForPage(const int page) {
+  std::vector<uint32_t> offsets;
+  uint32_t sourceSize = 0;
+  std::string elementPath;
+  if (page < 0 || page >= pageCount || !readSourceOffsets(offsets, sourceSize) ||
+      !ElementIndex::findPath(indexPath, offsets[page], elementPath)) {
+    return "";
+  }
+  return elementPath;
+}
+
+bool Section::visitPageText(const std::function<void(const std::string& word, bool lastInLine)>& onWord,
+                            const std::function<bool(int page)>& onPageEnd) {
+  if (!Storage.openFileForRead("SCT", filePath, file)) {
+    return false;
+  }
+
+  // Pages are written back to back straight after the header, so they can be read in order without the LUT
+  file.seek(HEADER_SIZE);
+  std::string scratch;
+  bool ok = true;
+  for (int page = 0; page < pageCount && ok; page++) {
+    ok = Page::visitText(file, scratch, onWord);
+    if (ok && !onPageEnd(page)) {
+      break;
+    }
+  }
+  file.close();
+  return ok;
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "Epub.h"
 
@@ -12,14 +14,22 @@ class Section {
   const int spineIndex;
   GfxRenderer& renderer;
   std::string filePath;
+  std::string indexPath;
   FsFile file;
 
   void writeSectionFileHeader(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                               uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled,
                               bool embeddedStyle);
   uint32_t onPageComplete(std::unique_ptr<Page> page);
+  // Reads the byte-offset map: where in the chapter's XHTML each page starts, and the XHTML size
+  bool readSourceOffsets(std::vector<uint32_t>& offsets, uint32_t& sourceSize);
+  // Page holding byte `sourceOffset` of the chapter's XHTML, or -1
+  int findPageForSourceOffset(uint32_t sourceOffset);
 
  public:
+  // Bump when the section file format or the way chapters are laid out into pages changes
+  static constexpr uint8_t FILE_VERSION = 14;
+
   uint16_t pageCount = 0;
   int currentPage = 0;
 
@@ -27,13 +37,29 @@ class Section {
       : epub(epub),
         spineIndex(spineIndex),
         renderer(renderer),
-        filePath(epub->getCachePath() + "/sections/" + std::to_string(spineIndex) + ".bin") {}
+        filePath(epub->getCachePath() + "/sections/" + std::to_string(spineIndex) + ".bin"),
+        indexPath(epub->getCachePath() + "/sections/" + std::to_string(spineIndex) + ".idx") {}
   ~Section() = default;
   bool loadSectionFile(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                        uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled, bool embeddedStyle);
   bool clearCache() const;
   bool createSectionFile(int fontId, float lineCompression, bool extraParagraphSpacing, uint8_t paragraphAlignment,
                          uint16_t viewportWidth, uint16_t viewportHeight, bool hyphenationEnabled, bool embeddedStyle,
-                         const std::function<void()>& popupFn = nullptr);
+                         const std::function<void()>& popupFn = nullptr, float previewProgress = -1.0f,
+                         const std::function<void(std::unique_ptr<Page>)>& previewFn = nullptr);
   std::unique_ptr<Page> loadPageFromSectionFile();
+  // Page holding the text `progress` (0..1) of the way through the chapter's XHTML, from the byte-offset map stored
+  // with the section. -1 if the map can't be read.
+  int findPageForProgress(float progress);
+  // Page where the element at a KOReader-style path ("/body/div[2]/p[5]", relative to the chapter's <html>) starts,
+  // from the element index stored with the section. -1 if the index is missing or the path doesn't match.
+  int findPageForElementPath(const std::string& elementPath);
+  // Page where the element with id `anchor` starts; only the chapter's TOC anchors are indexed. -1 if unknown.
+  int findPageForAnchor(const std::string& anchor);
+  // Path of the first element on `page`, in the form findPageForElementPath() takes. Empty if unavailable.
+  std::string getElementPathForPage(int page);
+  // Streams the words of every page of a section file accepted by loadSectionFile(), in page order. `onPageEnd` runs
+  // after each page and can return false to stop early.
+  bool visitPageText(const std::function<void(const std::string& word, bool lastInLine)>& onWord,
+                     const std::function<bool(int page)>& onPageEnd);
 };
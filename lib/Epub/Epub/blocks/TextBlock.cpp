@@ -4,6 +4,23 @@
 #include <Logging.h>
 #include <Serialization.h>
 
+namespace {
+void readBlockStyle(FsFile& file, BlockStyle& blockStyle) {
+  serialization::readPod(file, blockStyle.alignment);
+  serialization::readPod(file, blockStyle.textAlignDefined);
+  serialization::readPod(file, blockStyle.marginTop);
+  serialization::readPod(file, blockStyle.marginBottom);
+  serialization::readPod(file, blockStyle.marginLeft);
+  serialization::readPod(file, blockStyle.marginRight);
+  serialization::readPod(file, blockStyle.paddingTop);
+  serialization::readPod(file, blockStyle.paddingBottom);
+  serialization::readPod(file, blockStyle.paddingLeft);
+  serialization::readPod(file, blockStyle.paddingRight);
+  serialization::readPod(file, blockStyle.textIndent);
+  serialization::readPod(file, blockStyle.textIndentDefined);
+}
+}  // namespace
+
 void TextBlock::render(const GfxRenderer& renderer, const int fontId, const int x, const int y) const {
   // Validate iterator bounds before rendering
   if (words.size() != wordXpos.size() || words.size() != wordStyles.size()) {
@@ -103,19 +120,31 @@ std::unique_ptr<TextBlock> TextBlock::deserialize(FsFile& file) {
   for (auto& s : wordStyles) serialization::readPod(file, s);
 
   // Style (alignment + margins/padding/indent)
-  serialization::readPod(file, blockStyle.alignment);
-  serialization::readPod(file, blockStyle.textAlignDefined);
-  serialization::readPod(file, blockStyle.marginTop);
-  serialization::readPod(file, blockStyle.marginBottom);
-  serialization::readPod(file, blockStyle.marginLeft);
-  serialization::readPod(file, blockStyle.marginRight);
-  serialization::readPod(file, blockStyle.paddingTop);
-  serialization::readPod(file, blockStyle.paddingBottom);
-  serialization::readPod(file, blockStyle.paddingLeft);
-  serialization::readPod(file, blockStyle.paddingRight);
-  serialization::readPod(file, blockStyle.textIndent);
-  serialization::readPod(file, blockStyle.textIndentDefined);
+  readBlockStyle(file, blockStyle);
 
   return std::unique_ptr<TextBlock>(
       new TextBlock(std::move(words), std::move(wordXpos), std::move(wordStyles), blockStyle));
 }
+
+bool TextBlock::visitWords(FsFile& file, std::string& scratch,
+                           const std::function<void(const std::string& word, bool lastInLine)>& onWord) {
+  uint16_t wc;
+  serialization::readPod(file, wc);
+  if (wc > 10000) {
+    LOG_ERR("TXB", "Word visit failed: word count %u exceeds maximum", wc);
+    return false;
+  }
+
+  for (uint16_t i = 0; i < wc; i++) {
+    serialization::readString(file, scratch);
+    onWord(scratch, i + 1 == wc);
+  }
+
+  // Positions and styles aren't needed for the text
+  if (!file.seek(file.position() + wc * (sizeof(uint16_t) + sizeof(EpdFontFamily::Style)))) {
+    return false;
+  }
+  BlockStyle blockStyle;
+  readBlockStyle(file, blockStyle);
+  return true;
+}
@@ -2,6 +2,7 @@
 #include <EpdFontFamily.h>
 #include <HalStorage.h>
 
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
@@ -27,10 +28,17 @@ class TextBlock final : public Block {
   ~TextBlock() override = default;
   void setBlockStyle(const BlockStyle& blockStyle) { this->blockStyle = blockStyle; }
   const BlockStyle& getBlockStyle() const { return blockStyle; }
+  const std::list<std::string>& getWords() const { return words; }
+  const std::list<uint16_t>& getWordXpos() const { return wordXpos; }
+  const std::list<EpdFontFamily::Style>& getWordStyles() const { return wordStyles; }
   bool isEmpty() override { return words.empty(); }
   // given a renderer works out where to break the words into lines
   void render(const GfxRenderer& renderer, int fontId, int x, int y) const;
   BlockType getType() override { return TEXT_BLOCK; }
   bool serialize(FsFile& file) const;
   static std::unique_ptr<TextBlock> deserialize(FsFile& file);
+  // Streams the words of a serialized block without materialising it; `scratch` holds each word in turn. Leaves the
+  // file positioned after the block, like deserialize().
+  static bool visitWords(FsFile& file, std::string& scratch,
+                         const std::function<void(const std::string& word, bool lastInLine)>& onWord);
 };
@@ -0,0 +1,80 @@
+#include "HyphenationCache.h"
+
+#include <cstring>
+
+uint64_t HyphenationCache::fnvHash64(const std::string& word) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const char c : word) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+bool HyphenationCache::lookup(const std::string& word, Hyphenator::BreakInfo* breaks, size_t& count) {
+  const uint64_t hash = fnvHash64(word);
+  Entry* set = setFor(hash);
+  for (size_t way = 0; way < kWays; ++way) {
+    Entry& entry = set[way];
+    if (entry.length == 0 || entry.hash != hash || entry.length != word.size()) {
+      continue;
+    }
+    for (size_t i = 0; i < entry.breakCount; ++i) {
+      breaks[i] = {entry.offsets[i], (entry.noHyphenMask & (1u << i)) == 0};
+    }
+    count = entry.breakCount;
+    if (entry.uses < UINT8_MAX) {
+      entry.uses++;
+    }
+    hits_++;
+    return true;
+  }
+  misses_++;
+  return false;
+}
+
+void HyphenationCache::store(const std::string& word, const Hyphenator::BreakInfo* breaks, const size_t count) {
+  if (word.empty() || word.size() > UINT8_MAX || count > kMaxBreaks) {
+    return;
+  }
+
+  const uint64_t hash = fnvHash64(word);
+  Entry* set = setFor(hash);
+
+  // Prefer an empty way, otherwise the least used one. A victim that has been reused keeps its slot and is aged
+  // instead, so it has to lose its popularity before a newcomer may take over.
+  Entry* victim = &set[0];
+  for (size_t way = 0; way < kWays; ++way) {
+    if (set[way].length == 0) {
+      victim = &set[way];
+      break;
+    }
+    if (set[way].uses < victim->uses) {
+      victim = &set[way];
+    }
+  }
+  if (victim->length != 0 && victim->uses > 1) {
+    victim->uses--;
+    return;
+  }
+
+  Entry entry = {};
+  entry.hash = hash;
+  entry.length = static_cast<uint8_t>(word.size());
+  entry.breakCount = static_cast<uint8_t>(count);
+  entry.uses = 1;
+  for (size_t i = 0; i < count; ++i) {
+    entry.offsets[i] = static_cast<uint8_t>(breaks[i].byteOffset);
+    if (!breaks[i].requiresInsertedHyphen) {
+      entry.noHyphenMask |= 1u << i;
+    }
+  }
+  *victim = entry;
+  dirty_ = true;
+}
+
+void HyphenationCache::clear() {
+  memset(table_, 0, sizeof(table_));
+  hits_ = misses_ = 0;
+  dirty_ = false;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Hyphenator.h"
+
+// Bounded word -> break-offset memo consulted by Hyphenator::breakOffsets. The same long words keep landing at line
+// ends throughout a book (and again when ParsedText retries with fallback breaks), so remembering their language
+// breaks lets the Liang trie walk run once per word instead of once per attempt.
+//
+// Four-way set associative with a saturating use counter per entry. A new word only displaces the least used way once
+// that way has been aged down to a single use, so the most frequently hyphenated words of the book stay resident
+// instead of being flushed by one-off words. Words are identified by their FNV-1a 64-bit hash and
+// byte length (as in ZipFile's size lookup) instead of being stored, keeping each entry at 32 bytes.
+class HyphenationCache {
+ public:
+  static constexpr size_t kSets = 32;
+  static constexpr size_t kWays = 4;
+  static constexpr size_t kCapacity = kSets * kWays;
+  static constexpr size_t kMaxBreaks = 16;
+
+  struct Entry {
+    uint64_t hash;
+    uint8_t length;  // Word length in bytes; 0 marks an empty slot.
+    uint8_t breakCount;
+    uint8_t uses;
+    uint8_t reserved;
+    uint32_t noHyphenMask;  // Bit i set: offsets[i] follows an explicit hyphen and needs no inserted '-'.
+    uint8_t offsets[kMaxBreaks];
+  };
+  static_assert(sizeof(Entry) == 32, "HyphenationCache::Entry layout is persisted; keep it packed");
+
+  HyphenationCache() { clear(); }
+
+  // Returns true and copies the cached language breaks (no fallback breaks) into `breaks` when `word` is known.
+  bool lookup(const std::string& word, Hyphenator::BreakInfo* breaks, size_t& count);
+  // Remembers the language breaks for `word`. Words that cannot be represented (too long, too many breaks) are skipped.
+  void store(const std::string& word, const Hyphenator::BreakInfo* breaks, size_t count);
+  void clear();
+
+  uint32_t hits() const { return hits_; }
+  uint32_t misses() const { return misses_; }
+  void resetStats() { hits_ = misses_ = 0; }
+  bool isDirty() const { return dirty_; }
+  void markClean() { dirty_ = false; }
+
+  // Raw table access for persisting the cache alongside a book's other caches.
+  Entry* entries() { return table_; }
+  const Entry* entries() const { return table_; }
+
+ private:
+  Entry table_[kCapacity];
+  uint32_t hits_ = 0;
+  uint32_t misses_ = 0;
+  bool dirty_ = false;
+
+  static uint64_t fnvHash64(const std::string& word);
+  Entry* setFor(uint64_t hash) { return &table_[(hash % kSets) * kWays]; }
+};
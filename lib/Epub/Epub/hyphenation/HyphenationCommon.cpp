@@ -67,6 +67,54 @@ bool isLatinLetter(const uint32_t cp) {
 
 bool isCyrillicLetter(const uint32_t cp) { return (cp >= 0x0400 && cp <= 0x052F); }
 
+bool isExtendedLetter(const uint32_t cp) {
+  if (isLatinLetter(cp) || isCyrillicLetter(cp)) {
+    return true;
+  }
+  // Latin Extended-A (Central European, Baltic, Turkish, ...)
+  if (cp >= 0x0100 && cp <= 0x017F) {
+    return true;
+  }
+  // Greek and Coptic letters, including tonos forms
+  return cp == 0x0386 || (cp >= 0x0388 && cp <= 0x03CE && cp != 0x038B && cp != 0x038D && cp != 0x03A2);
+}
+
+uint32_t toLowerExtended(const uint32_t cp) {
+  if (cp < 0x0100) {
+    return toLowerLatinImpl(cp);
+  }
+  if (cp >= 0x0400 && cp <= 0x052F) {
+    return toLowerCyrillicImpl(cp);
+  }
+  // Latin Extended-A interleaves upper/lower pairs; the parity of the uppercase member flips twice in the block.
+  if (cp == 0x0130) {
+    return 'i';  // İ
+  }
+  if ((cp <= 0x0137 && cp % 2 == 0) || (cp >= 0x0139 && cp <= 0x0148 && cp % 2 == 1) ||
+      (cp >= 0x014A && cp <= 0x0177 && cp % 2 == 0) || (cp >= 0x0179 && cp <= 0x017E && cp % 2 == 1)) {
+    return cp + 1;
+  }
+  // Greek capitals
+  if (cp >= 0x0391 && cp <= 0x03AB && cp != 0x03A2) {
+    return cp + 0x20;
+  }
+  switch (cp) {
+    case 0x0386:      // Ά
+      return 0x03AC;  // ά
+    case 0x0388:      // Έ
+    case 0x0389:      // Ή
+    case 0x038A:      // Ί
+      return cp + 0x25;
+    case 0x038C:      // Ό
+      return 0x03CC;  // ό
+    case 0x038E:      // Ύ
+    case 0x038F:      // Ώ
+      return cp + 0x3F;
+    default:
+      return toLowerLatinImpl(cp);
+  }
+}
+
 bool isAlphabetic(const uint32_t cp) { return isLatinLetter(cp) || isCyrillicLetter(cp); }
 
 bool isPunctuation(const uint32_t cp) {
@@ -135,14 +183,14 @@ bool isExplicitHyphen(const uint32_t cp) {
 
 bool isSoftHyphen(const uint32_t cp) { return cp == 0x00AD; }
 
-void trimSurroundingPunctuationAndFootnote(std::vector<CodepointInfo>& cps) {
-  if (cps.empty()) {
+void trimSurroundingPunctuationAndFootnote(const CodepointInfo*& cps, size_t& count) {
+  if (count == 0) {
     return;
   }
 
   // Remove trailing footnote references like [12], even if punctuation trails after the closing bracket.
-  if (cps.size() >= 3) {
-    int end = static_cast<int>(cps.size()) - 1;
+  if (count >= 3) {
+    int end = static_cast<int>(count) - 1;
     while (end >= 0 && isPunctuation(cps[end].value)) {
       --end;
     }
@@ -152,19 +200,30 @@ void trimSurroundingPunctuationAndFootnote(std::vector<CodepointInfo>& cps) {
         --pos;
       }
       if (pos >= 0 && cps[pos].value == '[' && end - pos > 1) {
-        cps.erase(cps.begin() + pos, cps.end());
+        count = static_cast<size_t>(pos);
       }
     }
   }
 
-  while (!cps.empty() && isPunctuation(cps.front().value)) {
-    cps.erase(cps.begin());
+  while (count > 0 && isPunctuation(cps[0].value)) {
+    ++cps;
+    --count;
   }
-  while (!cps.empty() && isPunctuation(cps.back().value)) {
-    cps.pop_back();
+  while (count > 0 && isPunctuation(cps[count - 1].value)) {
+    --count;
   }
 }
 
+void trimSurroundingPunctuationAndFootnote(std::vector<CodepointInfo>& cps) {
+  const CodepointInfo* begin = cps.data();
+  size_t count = cps.size();
+  trimSurroundingPunctuationAndFootnote(begin, count);
+
+  const auto first = static_cast<size_t>(begin - cps.data());
+  cps.erase(cps.begin() + static_cast<std::ptrdiff_t>(first + count), cps.end());
+  cps.erase(cps.begin(), cps.begin() + static_cast<std::ptrdiff_t>(first));
+}
+
 std::vector<CodepointInfo> collectCodepoints(const std::string& word) {
   std::vector<CodepointInfo> cps;
   cps.reserve(word.size());
@@ -179,3 +238,19 @@ std::vector<CodepointInfo> collectCodepoints(const std::string& word) {
 
   return cps;
 }
+
+size_t collectCodepoints(const std::string& word, CodepointInfo* out, const size_t capacity) {
+  const unsigned char* base = reinterpret_cast<const unsigned char*>(word.c_str());
+  const unsigned char* ptr = base;
+  size_t count = 0;
+  while (*ptr != 0) {
+    if (count == capacity) {
+      return 0;
+    }
+    const unsigned char* current = ptr;
+    const uint32_t cp = utf8NextCodepoint(&ptr);
+    out[count++] = {cp, static_cast<size_t>(current - base)};
+  }
+
+  return count;
+}
@@ -10,16 +10,31 @@ struct CodepointInfo {
   size_t byteOffset;
 };
 
+// Upper bound on the UTF-8 length of a single word handed to the hyphenator. ChapterHtmlSlimParser flushes words at
+// MAX_WORD_SIZE (200) bytes; the slack covers the em-space indent ParsedText prepends to a paragraph's first word.
+// Every codepoint takes at least one byte, so this also bounds the codepoint count.
+constexpr size_t kMaxHyphenationWordBytes = 208;
+
 uint32_t toLowerLatin(uint32_t cp);
 uint32_t toLowerCyrillic(uint32_t cp);
 
 bool isLatinLetter(uint32_t cp);
 bool isCyrillicLetter(uint32_t cp);
 
+// Broader letter set and case folding (Latin-1, Latin Extended-A, Greek, Cyrillic) used for tries loaded at runtime,
+// whose script is not known in advance.
+bool isExtendedLetter(uint32_t cp);
+uint32_t toLowerExtended(uint32_t cp);
+
 bool isAlphabetic(uint32_t cp);
 bool isPunctuation(uint32_t cp);
 bool isAsciiDigit(uint32_t cp);
 bool isExplicitHyphen(uint32_t cp);
 bool isSoftHyphen(uint32_t cp);
 void trimSurroundingPunctuationAndFootnote(std::vector<CodepointInfo>& cps);
+// In-place variant for fixed buffers: trims by advancing `cps` and shrinking `count`.
+void trimSurroundingPunctuationAndFootnote(const CodepointInfo*& cps, size_t& count);
 std::vector<CodepointInfo> collectCodepoints(const std::string& word);
+// Allocation-free variant: decodes into `out` and returns the codepoint count, or 0 if the word is empty or needs
+// more than `capacity` entries.
+size_t collectCodepoints(const std::string& word, CodepointInfo* out, size_t capacity);
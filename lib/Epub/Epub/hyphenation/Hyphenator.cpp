@@ -1,11 +1,11 @@
 #include "Hyphenator.h"
 
-#include <vector>
-
+#include "HyphenationCache.h"
 #include "HyphenationCommon.h"
 #include "LanguageRegistry.h"
 
 const LanguageHyphenator* Hyphenator::cachedHyphenator_ = nullptr;
+HyphenationCache* Hyphenator::cache_ = nullptr;
 
 namespace {
 
@@ -27,71 +27,80 @@ const LanguageHyphenator* hyphenatorForLanguage(const std::string& langTag) {
 }
 
 // Maps a codepoint index back to its byte offset inside the source word.
-size_t byteOffsetForIndex(const std::vector<CodepointInfo>& cps, const size_t index) {
-  return (index < cps.size()) ? cps[index].byteOffset : (cps.empty() ? 0 : cps.back().byteOffset);
+size_t byteOffsetForIndex(const CodepointInfo* cps, const size_t count, const size_t index) {
+  return (index < count) ? cps[index].byteOffset : (count == 0 ? 0 : cps[count - 1].byteOffset);
 }
 
-// Builds a vector of break information from explicit hyphen markers in the given codepoints.
-std::vector<Hyphenator::BreakInfo> buildExplicitBreakInfos(const std::vector<CodepointInfo>& cps) {
-  std::vector<Hyphenator::BreakInfo> breaks;
+// Collects break information from explicit hyphen markers in the given codepoints.
+size_t buildExplicitBreakInfos(const CodepointInfo* cps, const size_t count, Hyphenator::BreakInfo* out) {
+  size_t found = 0;
 
   // Scan every codepoint looking for explicit/soft hyphen markers that are surrounded by letters.
-  for (size_t i = 1; i + 1 < cps.size(); ++i) {
+  for (size_t i = 1; i + 1 < count; ++i) {
     const uint32_t cp = cps[i].value;
     if (!isExplicitHyphen(cp) || !isAlphabetic(cps[i - 1].value) || !isAlphabetic(cps[i + 1].value)) {
       continue;
     }
     // Offset points to the next codepoint so rendering starts after the hyphen marker.
-    breaks.push_back({cps[i + 1].byteOffset, isSoftHyphen(cp)});
+    out[found++] = {static_cast<uint16_t>(cps[i + 1].byteOffset), isSoftHyphen(cp)};
   }
 
-  return breaks;
+  return found;
 }
 
 }  // namespace
 
-std::vector<Hyphenator::BreakInfo> Hyphenator::breakOffsets(const std::string& word, const bool includeFallback) {
+size_t Hyphenator::breakOffsets(const std::string& word, const bool includeFallback, Workspace& workspace) {
   if (word.empty()) {
-    return {};
+    return 0;
+  }
+
+  // A cached word skips the explicit-marker scan and trie walk; only fallback breaks still need its codepoints.
+  size_t found = 0;
+  const bool cached = cache_ && cache_->lookup(word, workspace.breaks, found);
+  if (cached && (found > 0 || !includeFallback)) {
+    return found;
   }
 
   // Convert to codepoints and normalize word boundaries.
-  auto cps = collectCodepoints(word);
-  trimSurroundingPunctuationAndFootnote(cps);
+  const CodepointInfo* cps = workspace.codepoints;
+  size_t count = collectCodepoints(word, workspace.codepoints, kMaxHyphenationWordBytes);
+  trimSurroundingPunctuationAndFootnote(cps, count);
   const auto* hyphenator = cachedHyphenator_;
 
-  // Explicit hyphen markers (soft or hard) take precedence over language breaks.
-  auto explicitBreakInfos = buildExplicitBreakInfos(cps);
-  if (!explicitBreakInfos.empty()) {
-    return explicitBreakInfos;
-  }
+  if (!cached) {
+    // Explicit hyphen markers (soft or hard) take precedence over language breaks.
+    found = buildExplicitBreakInfos(cps, count, workspace.breaks);
+
+    // Ask language hyphenator for legal break points.
+    if (found == 0 && hyphenator) {
+      found = hyphenator->breakIndexes(cps, count, workspace.liang);
+      for (size_t i = 0; i < found; ++i) {
+        workspace.breaks[i] = {static_cast<uint16_t>(byteOffsetForIndex(cps, count, workspace.liang.breakIndexes[i])),
+                               true};
+      }
+    }
 
-  // Ask language hyphenator for legal break points.
-  std::vector<size_t> indexes;
-  if (hyphenator) {
-    indexes = hyphenator->breakIndexes(cps);
+    if (cache_) {
+      cache_->store(word, workspace.breaks, found);
+    }
   }
 
   // Only add fallback breaks if needed
-  if (includeFallback && indexes.empty()) {
+  if (includeFallback && found == 0) {
     const size_t minPrefix = hyphenator ? hyphenator->minPrefix() : LiangWordConfig::kDefaultMinPrefix;
     const size_t minSuffix = hyphenator ? hyphenator->minSuffix() : LiangWordConfig::kDefaultMinSuffix;
-    for (size_t idx = minPrefix; idx + minSuffix <= cps.size(); ++idx) {
-      indexes.push_back(idx);
+    for (size_t idx = minPrefix; idx + minSuffix <= count; ++idx) {
+      workspace.breaks[found++] = {static_cast<uint16_t>(byteOffsetForIndex(cps, count, idx)), true};
     }
   }
 
-  if (indexes.empty()) {
-    return {};
-  }
+  return found;
+}
 
-  std::vector<Hyphenator::BreakInfo> breaks;
-  breaks.reserve(indexes.size());
-  for (const size_t idx : indexes) {
-    breaks.push_back({byteOffsetForIndex(cps, idx), true});
+void Hyphenator::setPreferredLanguage(const std::string& lang) {
+  cachedHyphenator_ = hyphenatorForLanguage(lang);
+  if (!cachedHyphenator_) {
+    releaseExternalHyphenator();
   }
-
-  return breaks;
 }
-
-void Hyphenator::setPreferredLanguage(const std::string& lang) { cachedHyphenator_ = hyphenatorForLanguage(lang); }
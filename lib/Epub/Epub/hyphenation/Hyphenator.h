@@ -1,24 +1,43 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
-#include <vector>
 
+#include "LiangHyphenation.h"
+
+class HyphenationCache;
 class LanguageHyphenator;
 
 class Hyphenator {
  public:
   struct BreakInfo {
-    size_t byteOffset;
+    uint16_t byteOffset;
     bool requiresInsertedHyphen;
   };
-  // Returns byte offsets where the word may be hyphenated. When includeFallback is true, all positions obeying the
-  // minimum prefix/suffix constraints are returned even if no language-specific rule matches.
-  static std::vector<BreakInfo> breakOffsets(const std::string& word, bool includeFallback);
+
+  // Caller-owned scratch space for breakOffsets(). It is fixed-size (~3.5KB on the device) so hyphenating a word never
+  // touches the heap; too big for a task stack, so a section build allocates one up front. Results are read back from
+  // `breaks`.
+  struct Workspace {
+    CodepointInfo codepoints[kMaxHyphenationWordBytes];
+    LiangWorkspace liang;
+    BreakInfo breaks[kMaxHyphenationWordBytes];
+  };
+
+  // Computes byte offsets where the word may be hyphenated into workspace.breaks and returns how many were found.
+  // When includeFallback is true, all positions obeying the minimum prefix/suffix constraints are returned even if no
+  // language-specific rule matches. Words longer than kMaxHyphenationWordBytes yield no breaks.
+  static size_t breakOffsets(const std::string& word, bool includeFallback, Workspace& workspace);
 
   // Provide a publication-level language hint (e.g. "en", "en-US", "ru") used to select hyphenation rules.
   static void setPreferredLanguage(const std::string& lang);
 
+  // Attach a break cache consulted before running the language hyphenator (nullptr detaches). The cache is owned by
+  // the caller and must only hold breaks computed for the current preferred language.
+  static void setCache(HyphenationCache* cache) { cache_ = cache; }
+
  private:
   static const LanguageHyphenator* cachedHyphenator_;
-};
\ No newline at end of file
+  static HyphenationCache* cache_;
+};
@@ -2,22 +2,40 @@
 
 #include "LiangHyphenation.h"
 
-// Generic Liang-backed hyphenator that stores pattern metadata plus language-specific helpers.
+// Generic Liang-backed hyphenator that stores pattern metadata plus language-specific helpers. The patterns either
+// live in flash (generated headers) or are paged in from a file via PagedHyphenationTrie.
 class LanguageHyphenator {
  public:
   LanguageHyphenator(const SerializedHyphenationPatterns& patterns, bool (*isLetterFn)(uint32_t),
                      uint32_t (*toLowerFn)(uint32_t), size_t minPrefix = LiangWordConfig::kDefaultMinPrefix,
                      size_t minSuffix = LiangWordConfig::kDefaultMinSuffix)
-      : patterns_(patterns), config_(isLetterFn, toLowerFn, minPrefix, minSuffix) {}
+      : patterns_(&patterns), config_(isLetterFn, toLowerFn, minPrefix, minSuffix) {}
+
+  LanguageHyphenator(PagedHyphenationTrie& trie, bool (*isLetterFn)(uint32_t), uint32_t (*toLowerFn)(uint32_t),
+                     size_t minPrefix = LiangWordConfig::kDefaultMinPrefix,
+                     size_t minSuffix = LiangWordConfig::kDefaultMinSuffix)
+      : pagedTrie_(&trie), config_(isLetterFn, toLowerFn, minPrefix, minSuffix) {}
 
   std::vector<size_t> breakIndexes(const std::vector<CodepointInfo>& cps) const {
-    return liangBreakIndexes(cps, patterns_, config_);
+    LiangWorkspace workspace;
+    const size_t found = breakIndexes(cps.data(), cps.size(), workspace);
+    return std::vector<size_t>(workspace.breakIndexes, workspace.breakIndexes + found);
+  }
+
+  // Allocation-free variant; results land in workspace.breakIndexes.
+  size_t breakIndexes(const CodepointInfo* cps, const size_t count, LiangWorkspace& workspace) const {
+    if (pagedTrie_) {
+      return liangBreakIndexes(cps, count, *pagedTrie_, config_, workspace);
+    }
+    return liangBreakIndexes(cps, count, *patterns_, config_, workspace);
   }
 
+  const LiangWordConfig& config() const { return config_; }
   size_t minPrefix() const { return config_.minPrefix; }
   size_t minSuffix() const { return config_.minSuffix; }
 
  protected:
-  const SerializedHyphenationPatterns& patterns_;
+  const SerializedHyphenationPatterns* patterns_ = nullptr;
+  PagedHyphenationTrie* pagedTrie_ = nullptr;
   LiangWordConfig config_;
 };
@@ -21,15 +21,18 @@ LanguageHyphenator russianHyphenator(ru_patterns, isCyrillicLetter, toLowerCyril
 LanguageHyphenator spanishHyphenator(es_patterns, isLatinLetter, toLowerLatin);
 LanguageHyphenator italianHyphenator(it_patterns, isLatinLetter, toLowerLatin);
 
+ExternalHyphenatorProvider externalProvider = nullptr;
+ExternalHyphenatorRelease externalRelease = nullptr;
+
 using EntryArray = std::array<LanguageEntry, 6>;
 
 const EntryArray& entries() {
-  static const EntryArray kEntries = {{{"english", "en", &englishHyphenator},
-                                       {"french", "fr", &frenchHyphenator},
-                                       {"german", "de", &germanHyphenator},
-                                       {"russian", "ru", &russianHyphenator},
-                                       {"spanish", "es", &spanishHyphenator},
-                                       {"italian", "it", &italianHyphenator}}};
+  static const EntryArray kEntries = {{{"english", "en", &englishHyphenator, &en_patterns},
+                                       {"french", "fr", &frenchHyphenator, &fr_patterns},
+                                       {"german", "de", &germanHyphenator, &de_patterns},
+                                       {"russian", "ru", &russianHyphenator, &ru_patterns},
+                                       {"spanish", "es", &spanishHyphenator, &es_patterns},
+                                       {"italian", "it", &italianHyphenator, &it_patterns}}};
   return kEntries;
 }
 
@@ -39,7 +42,22 @@ const LanguageHyphenator* getLanguageHyphenatorForPrimaryTag(const std::string&
   const auto& allEntries = entries();
   const auto it = std::find_if(allEntries.begin(), allEntries.end(),
                                [&primaryTag](const LanguageEntry& entry) { return primaryTag == entry.primaryTag; });
-  return (it != allEntries.end()) ? it->hyphenator : nullptr;
+  if (it != allEntries.end()) {
+    releaseExternalHyphenator();
+    return it->hyphenator;
+  }
+  return externalProvider ? externalProvider(primaryTag) : nullptr;
+}
+
+void setExternalHyphenatorProvider(const ExternalHyphenatorProvider provider, const ExternalHyphenatorRelease release) {
+  externalProvider = provider;
+  externalRelease = release;
+}
+
+void releaseExternalHyphenator() {
+  if (externalRelease) {
+    externalRelease();
+  }
 }
 
 LanguageEntryView getLanguageEntries() {
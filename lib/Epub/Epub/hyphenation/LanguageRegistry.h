@@ -9,6 +9,7 @@ struct LanguageEntry {
   const char* cliName;
   const char* primaryTag;
   const LanguageHyphenator* hyphenator;
+  const SerializedHyphenationPatterns* patterns;
 };
 
 struct LanguageEntryView {
@@ -19,8 +20,18 @@ struct LanguageEntryView {
   const LanguageEntry* end() const { return data + size; }
 };
 
-// Returns the Liang-backed hyphenator for a given primary language tag (e.g., "en", "fr").
+// Resolves languages that have no built-in trie, e.g. hypher tries stored on the SD card. Returns nullptr when the
+// language is unavailable.
+using ExternalHyphenatorProvider = const LanguageHyphenator* (*)(const std::string& primaryTag);
+// Frees whatever the provider keeps loaded once a built-in language (or none) is in use
+using ExternalHyphenatorRelease = void (*)();
+
+// Returns the Liang-backed hyphenator for a given primary language tag (e.g., "en", "fr"). Built-in languages win;
+// anything else is forwarded to the external provider, if one is installed.
 const LanguageHyphenator* getLanguageHyphenatorForPrimaryTag(const std::string& primaryTag);
 
+void setExternalHyphenatorProvider(ExternalHyphenatorProvider provider, ExternalHyphenatorRelease release = nullptr);
+void releaseExternalHyphenator();
+
 // Exposes the list of supported languages primarily for tooling/tests.
 LanguageEntryView getLanguageEntries();
@@ -1,13 +1,12 @@
 #include "LiangHyphenation.h"
 
 #include <algorithm>
-#include <vector>
 
 /*
  * Liang hyphenation pipeline overview (Typst-style binary trie variant)
  * --------------------------------------------------------------------
  * 1.  Input normalization (buildAugmentedWord)
- *     - Accepts a vector of CodepointInfo structs emitted by the EPUB text
+ *     - Accepts a span of CodepointInfo structs emitted by the EPUB text
  *       parser. Each codepoint is validated with LiangWordConfig::isLetter so
  *       we abort early on digits, punctuation, etc. If the word is valid we
  *       build an "augmented" byte sequence: leading '.', lowercase UTF-8 bytes
@@ -15,7 +14,8 @@
  *       UTF-8 byte offset for each character and a reverse lookup table that
  *       maps UTF-8 byte indexes back to codepoint indexes. This lets the rest
  *       of the algorithm stay byte-oriented (matching the serialized automaton)
- *       while still emitting hyphen positions in codepoint space.
+ *       while still emitting hyphen positions in codepoint space. All of these
+ *       tables live in the caller's fixed-size LiangWorkspace.
  *
  * 2.  Automaton decoding
  *     - SerializedHyphenationPatterns stores a contiguous blob generated from
@@ -24,8 +24,9 @@
  *       nodes, and an optional pointer into a shared "levels" list. We parse
  *       that layout lazily via decodeState/transition, keeping everything in
  *       flash memory; no heap allocations besides the stack-local AutomatonState
- *       structs. getAutomaton caches parseAutomaton results per blob pointer so
- *       multiple words hitting the same language only pay the cost once.
+ *       structs. The walk is templated over a byte accessor so the same code
+ *       also serves tries loaded from SD through PagedHyphenationTrie, which
+ *       only keeps a few pages of the automaton in RAM.
  *
  * 3.  Pattern application
  *     - We walk the augmented bytes left-to-right. For each starting byte we
@@ -39,122 +40,136 @@
  *
  * 4.  Output filtering
  *     - collectBreakIndexes converts odd-valued score entries back to codepoint
- *       break positions while enforcing `minPrefix`/`minSuffix` constraints from
- *       LiangWordConfig. The caller (language-specific hyphenators) can then
- *       translate these indexes into renderer glyph offsets, page layout data,
- *       etc.
+ *       break positions (written to LiangWorkspace::breakIndexes) while
+ *       enforcing `minPrefix`/`minSuffix` constraints from LiangWordConfig.
+ *       The caller (language-specific hyphenators) can then translate these
+ *       indexes into renderer glyph offsets, page layout data, etc.
  *
  * Keeping the entire algorithm small and deterministic is critical on the
  * ESP32-C3: we avoid recursion, dynamic allocations per node, or copying the
  * trie. All lookups stay within the generated blob, which lives in flash, and
- * the working buffers (augmented bytes/scores) scale with the word length rather
- * than the pattern corpus.
+ * the working buffers (augmented bytes/scores) are bounded by
+ * kMaxHyphenationWordBytes, so hyphenating a word never touches the heap.
  */
 
 namespace {
 
-using EmbeddedAutomaton = SerializedHyphenationPatterns;
-
-struct AugmentedWord {
-  std::vector<uint8_t> bytes;
-  std::vector<size_t> charByteOffsets;
-  std::vector<int32_t> byteToCharIndex;
-
-  bool empty() const { return bytes.empty(); }
-  size_t charCount() const { return charByteOffsets.size(); }
-};
-
-// Encode a single Unicode codepoint into UTF-8 and append to the provided buffer.
-size_t encodeUtf8(uint32_t cp, std::vector<uint8_t>& out) {
+// Encode a single Unicode codepoint into UTF-8 at `out`, returning the number of bytes written (0 if the encoding
+// needs more than `room` bytes).
+size_t encodeUtf8(uint32_t cp, uint8_t* out, const size_t room) {
   if (cp <= 0x7Fu) {
-    out.push_back(static_cast<uint8_t>(cp));
+    if (room < 1) return 0;
+    out[0] = static_cast<uint8_t>(cp);
     return 1;
   }
   if (cp <= 0x7FFu) {
-    out.push_back(static_cast<uint8_t>(0xC0u | ((cp >> 6) & 0x1Fu)));
-    out.push_back(static_cast<uint8_t>(0x80u | (cp & 0x3Fu)));
+    if (room < 2) return 0;
+    out[0] = static_cast<uint8_t>(0xC0u | ((cp >> 6) & 0x1Fu));
+    out[1] = static_cast<uint8_t>(0x80u | (cp & 0x3Fu));
     return 2;
   }
   if (cp <= 0xFFFFu) {
-    out.push_back(static_cast<uint8_t>(0xE0u | ((cp >> 12) & 0x0Fu)));
-    out.push_back(static_cast<uint8_t>(0x80u | ((cp >> 6) & 0x3Fu)));
-    out.push_back(static_cast<uint8_t>(0x80u | (cp & 0x3Fu)));
+    if (room < 3) return 0;
+    out[0] = static_cast<uint8_t>(0xE0u | ((cp >> 12) & 0x0Fu));
+    out[1] = static_cast<uint8_t>(0x80u | ((cp >> 6) & 0x3Fu));
+    out[2] = static_cast<uint8_t>(0x80u | (cp & 0x3Fu));
     return 3;
   }
-  out.push_back(static_cast<uint8_t>(0xF0u | ((cp >> 18) & 0x07u)));
-  out.push_back(static_cast<uint8_t>(0x80u | ((cp >> 12) & 0x3Fu)));
-  out.push_back(static_cast<uint8_t>(0x80u | ((cp >> 6) & 0x3Fu)));
-  out.push_back(static_cast<uint8_t>(0x80u | (cp & 0x3Fu)));
+  if (room < 4) return 0;
+  out[0] = static_cast<uint8_t>(0xF0u | ((cp >> 18) & 0x07u));
+  out[1] = static_cast<uint8_t>(0x80u | ((cp >> 12) & 0x3Fu));
+  out[2] = static_cast<uint8_t>(0x80u | ((cp >> 6) & 0x3Fu));
+  out[3] = static_cast<uint8_t>(0x80u | (cp & 0x3Fu));
   return 4;
 }
 
-// Build the dotted, lowercase UTF-8 representation plus lookup tables.
-AugmentedWord buildAugmentedWord(const std::vector<CodepointInfo>& cps, const LiangWordConfig& config) {
-  AugmentedWord word;
-  if (cps.empty()) {
-    return word;
+// Build the dotted, lowercase UTF-8 representation plus lookup tables inside `ws`.
+// Returns false (leaving ws empty) for non-letters or words that exceed the workspace.
+bool buildAugmentedWord(const CodepointInfo* cps, const size_t count, const LiangWordConfig& config,
+                        LiangWorkspace& ws) {
+  constexpr size_t kMax = LiangWorkspace::kMaxBytes;
+  ws.byteCount = 0;
+  ws.charCount = 0;
+  if (count == 0 || count + 2 > kMax) {
+    return false;
   }
 
-  word.bytes.reserve(cps.size() * 2 + 2);
-  word.charByteOffsets.reserve(cps.size() + 2);
-
-  word.charByteOffsets.push_back(0);
-  word.bytes.push_back('.');
+  ws.charByteOffsets[ws.charCount++] = 0;
+  ws.bytes[ws.byteCount++] = '.';
 
-  for (const auto& info : cps) {
-    if (!config.isLetter(info.value)) {
-      word.bytes.clear();
-      word.charByteOffsets.clear();
-      word.byteToCharIndex.clear();
-      return word;
+  for (size_t i = 0; i < count; ++i) {
+    if (!config.isLetter(cps[i].value)) {
+      ws.byteCount = 0;
+      ws.charCount = 0;
+      return false;
     }
-    word.charByteOffsets.push_back(word.bytes.size());
-    encodeUtf8(config.toLower(info.value), word.bytes);
+    ws.charByteOffsets[ws.charCount++] = static_cast<uint8_t>(ws.byteCount);
+    // Keep one byte in reserve for the trailing sentinel.
+    const size_t written = encodeUtf8(config.toLower(cps[i].value), ws.bytes + ws.byteCount, kMax - 1 - ws.byteCount);
+    if (written == 0) {
+      ws.byteCount = 0;
+      ws.charCount = 0;
+      return false;
+    }
+    ws.byteCount += written;
   }
 
-  word.charByteOffsets.push_back(word.bytes.size());
-  word.bytes.push_back('.');
+  ws.charByteOffsets[ws.charCount++] = static_cast<uint8_t>(ws.byteCount);
+  ws.bytes[ws.byteCount++] = '.';
 
-  word.byteToCharIndex.assign(word.bytes.size(), -1);
-  for (size_t i = 0; i < word.charByteOffsets.size(); ++i) {
-    const size_t offset = word.charByteOffsets[i];
-    if (offset < word.byteToCharIndex.size()) {
-      word.byteToCharIndex[offset] = static_cast<int32_t>(i);
-    }
+  std::fill_n(ws.byteToCharIndex, ws.byteCount, LiangWorkspace::kNoChar);
+  for (size_t i = 0; i < ws.charCount; ++i) {
+    ws.byteToCharIndex[ws.charByteOffsets[i]] = static_cast<uint8_t>(i);
   }
-  return word;
+  return true;
 }
 
-// Decoded view of a single trie node pulled straight out of the serialized blob.
+// Byte accessors the automaton walk is instantiated with. Both expose the blob in the same coordinates (the hypher
+// file minus its 4-byte root header); the flash variant compiles down to plain pointer reads.
+struct FlashTrie {
+  const SerializedHyphenationPatterns& patterns;
+
+  size_t size() const { return patterns.size; }
+  uint8_t operator[](const size_t addr) const { return patterns.data[addr]; }
+};
+
+struct PagedTrie {
+  PagedHyphenationTrie& trie;
+
+  size_t size() const { return trie.size(); }
+  uint8_t operator[](const size_t addr) const { return trie.byteAt(addr); }
+};
+
+// Decoded view of a single trie node, as addresses into the serialized blob.
 // - transitions: contiguous list of next-byte values
 // - targets: packed relative offsets (1/2/3 bytes) for each transition
-// - levels: optional pointer into the global levels list with packed dist/level pairs
+// - levels: optional slice of the global levels list with packed dist/level pairs
 struct AutomatonState {
-  const uint8_t* data = nullptr;
-  size_t size = 0;
+  bool isValid = false;
   size_t addr = 0;
   uint8_t stride = 1;
   size_t childCount = 0;
-  const uint8_t* transitions = nullptr;
-  const uint8_t* targets = nullptr;
-  const uint8_t* levels = nullptr;
+  size_t transitions = 0;
+  size_t targets = 0;
+  size_t levels = 0;
   size_t levelsLen = 0;
 
-  bool valid() const { return data != nullptr; }
+  bool valid() const { return isValid; }
 };
 
 // Interpret the node located at `addr`, returning transition metadata.
-AutomatonState decodeState(const EmbeddedAutomaton& automaton, size_t addr) {
+template <typename Trie>
+AutomatonState decodeState(const Trie& automaton, size_t addr) {
   AutomatonState state;
-  if (addr >= automaton.size) {
+  const size_t size = automaton.size();
+  if (addr >= size) {
     return state;
   }
 
-  const uint8_t* base = automaton.data + addr;
-  size_t remaining = automaton.size - addr;
+  size_t remaining = size - addr;
   size_t pos = 0;
 
-  const uint8_t header = base[pos++];
+  const uint8_t header = automaton[addr + pos++];
   // Header layout (bits):
   //   7        - hasLevels flag
   //   6..5     - stride selector (0 -> 1 byte, otherwise 1|2|3)
@@ -169,66 +184,68 @@ AutomatonState decodeState(const EmbeddedAutomaton& automaton, size_t addr) {
     if (pos >= remaining) {
       return AutomatonState{};
     }
-    childCount = base[pos++];
+    childCount = automaton[addr + pos++];
   }
 
-  const uint8_t* levelsPtr = nullptr;
+  size_t levels = 0;
   size_t levelsLen = 0;
   if (hasLevels) {
     if (pos + 1 >= remaining) {
       return AutomatonState{};
     }
-    const uint8_t offsetHi = base[pos++];
-    const uint8_t offsetLoLen = base[pos++];
+    const uint8_t offsetHi = automaton[addr + pos++];
+    const uint8_t offsetLoLen = automaton[addr + pos++];
     // The 12-bit offset (hi<<4 | top nibble) points into the blob-level levels list.
     // The bottom nibble stores how many packed entries belong to this node.
     const size_t offset = (static_cast<size_t>(offsetHi) << 4) | (offsetLoLen >> 4);
     levelsLen = offsetLoLen & 0x0Fu;
-    if (offset + levelsLen > automaton.size) {
+    if (offset < 4u || offset + levelsLen > size) {
       return AutomatonState{};
     }
-    levelsPtr = automaton.data + offset - 4u;
+    levels = offset - 4u;
   }
 
   if (pos + childCount > remaining) {
     return AutomatonState{};
   }
-  const uint8_t* transitions = base + pos;
+  const size_t transitions = addr + pos;
   pos += childCount;
 
   const size_t targetsBytes = childCount * stride;
   if (pos + targetsBytes > remaining) {
     return AutomatonState{};
   }
-  const uint8_t* targets = base + pos;
 
-  state.data = automaton.data;
-  state.size = automaton.size;
+  state.isValid = true;
   state.addr = addr;
   state.stride = stride;
   state.childCount = childCount;
   state.transitions = transitions;
-  state.targets = targets;
-  state.levels = levelsPtr;
+  state.targets = addr + pos;
+  state.levels = levels;
   state.levelsLen = levelsLen;
   return state;
 }
 
-// Convert the packed stride-sized delta back into a signed offset.
-int32_t decodeDelta(const uint8_t* buf, uint8_t stride) {
+// Convert the packed stride-sized delta at `addr` back into a signed offset.
+template <typename Trie>
+int32_t decodeDelta(const Trie& automaton, const size_t addr, uint8_t stride) {
   if (stride == 1) {
-    return static_cast<int8_t>(buf[0]);
+    return static_cast<int8_t>(automaton[addr]);
   }
   if (stride == 2) {
-    return static_cast<int16_t>((static_cast<uint16_t>(buf[0]) << 8) | static_cast<uint16_t>(buf[1]));
+    return static_cast<int16_t>((static_cast<uint16_t>(automaton[addr]) << 8) |
+                                static_cast<uint16_t>(automaton[addr + 1]));
   }
-  const int32_t unsignedVal =
-      (static_cast<int32_t>(buf[0]) << 16) | (static_cast<int32_t>(buf[1]) << 8) | static_cast<int32_t>(buf[2]);
+  const int32_t unsignedVal = (static_cast<int32_t>(automaton[addr]) << 16) |
+                              (static_cast<int32_t>(automaton[addr + 1]) << 8) |
+                              static_cast<int32_t>(automaton[addr + 2]);
   return unsignedVal - (1 << 23);
 }
 
 // Follow a single byte transition from `state`, decoding the child node on success.
-bool transition(const EmbeddedAutomaton& automaton, const AutomatonState& state, uint8_t letter, AutomatonState& out) {
+template <typename Trie>
+bool transition(const Trie& automaton, const AutomatonState& state, uint8_t letter, AutomatonState& out) {
   if (!state.valid()) {
     return false;
   }
@@ -236,15 +253,14 @@ bool transition(const EmbeddedAutomaton& automaton, const AutomatonState& state,
   // Children remain sorted by letter in the serialized blob, but the lists are
   // short enough that a linear scan keeps code size down compared to binary search.
   for (size_t idx = 0; idx < state.childCount; ++idx) {
-    if (state.transitions[idx] != letter) {
+    if (automaton[state.transitions + idx] != letter) {
       continue;
     }
-    const uint8_t* deltaPtr = state.targets + idx * state.stride;
-    const int32_t delta = decodeDelta(deltaPtr, state.stride);
+    const int32_t delta = decodeDelta(automaton, state.targets + idx * state.stride, state.stride);
     // Deltas are relative to the current node's address, allowing us to keep all
     // targets within 24 bits while still referencing further nodes in the blob.
     const int64_t nextAddr = static_cast<int64_t>(state.addr) + delta;
-    if (nextAddr < 0 || static_cast<size_t>(nextAddr) >= automaton.size) {
+    if (nextAddr < 0 || static_cast<size_t>(nextAddr) >= automaton.size()) {
       return false;
     }
     out = decodeState(automaton, static_cast<size_t>(nextAddr));
@@ -255,13 +271,10 @@ bool transition(const EmbeddedAutomaton& automaton, const AutomatonState& state,
 
 // Converts odd score positions back into codepoint indexes, honoring min prefix/suffix constraints.
 // Each break corresponds to scores[breakIndex + 1] because of the leading '.' sentinel.
-// Convert odd score entries into hyphen positions while honoring prefix/suffix limits.
-std::vector<size_t> collectBreakIndexes(const std::vector<CodepointInfo>& cps, const std::vector<uint8_t>& scores,
-                                        const size_t minPrefix, const size_t minSuffix) {
-  std::vector<size_t> indexes;
-  const size_t cpCount = cps.size();
+size_t collectBreakIndexes(const size_t cpCount, LiangWorkspace& ws, const size_t minPrefix, const size_t minSuffix) {
+  size_t found = 0;
   if (cpCount < 2) {
-    return indexes;
+    return found;
   }
 
   for (size_t breakIndex = 1; breakIndex < cpCount; ++breakIndex) {
@@ -275,81 +288,89 @@ std::vector<size_t> collectBreakIndexes(const std::vector<CodepointInfo>& cps, c
     }
 
     const size_t scoreIdx = breakIndex + 1;
-    if (scoreIdx >= scores.size()) {
+    if (scoreIdx >= ws.charCount) {
       break;
     }
-    if ((scores[scoreIdx] & 1u) == 0) {
+    if ((ws.scores[scoreIdx] & 1u) == 0) {
       continue;
     }
-    indexes.push_back(breakIndex);
+    ws.breakIndexes[found++] = static_cast<uint8_t>(breakIndex);
   }
 
-  return indexes;
+  return found;
 }
 
-}  // namespace
-
-// Entry point that runs the full Liang pipeline for a single word.
-std::vector<size_t> liangBreakIndexes(const std::vector<CodepointInfo>& cps,
-                                      const SerializedHyphenationPatterns& patterns, const LiangWordConfig& config) {
-  const auto augmented = buildAugmentedWord(cps, config);
-  if (augmented.empty()) {
-    return {};
+// Runs the full Liang pipeline for a single word against either trie backing.
+template <typename Trie>
+size_t runLiang(const CodepointInfo* cps, const size_t count, const Trie& automaton, const size_t rootOffset,
+                const LiangWordConfig& config, LiangWorkspace& workspace) {
+  if (!buildAugmentedWord(cps, count, config, workspace)) {
+    return 0;
   }
 
-  const EmbeddedAutomaton& automaton = patterns;
-
-  const AutomatonState root = decodeState(automaton, automaton.rootOffset);
+  const AutomatonState root = decodeState(automaton, rootOffset);
   if (!root.valid()) {
-    return {};
+    return 0;
   }
 
   // Liang scores: one entry per augmented char (leading/trailing dots included).
-  std::vector<uint8_t> scores(augmented.charCount(), 0);
+  LiangWorkspace& ws = workspace;
+  std::fill_n(ws.scores, ws.charCount, static_cast<uint8_t>(0));
 
   // Walk every starting character position and stream bytes through the trie.
-  for (size_t charStart = 0; charStart < augmented.charByteOffsets.size(); ++charStart) {
-    const size_t byteStart = augmented.charByteOffsets[charStart];
+  for (size_t charStart = 0; charStart < ws.charCount; ++charStart) {
+    const size_t byteStart = ws.charByteOffsets[charStart];
     AutomatonState state = root;
 
-    for (size_t cursor = byteStart; cursor < augmented.bytes.size(); ++cursor) {
+    for (size_t cursor = byteStart; cursor < ws.byteCount; ++cursor) {
       AutomatonState next;
-      if (!transition(automaton, state, augmented.bytes[cursor], next)) {
+      if (!transition(automaton, state, ws.bytes[cursor], next)) {
         break;  // No more matches for this prefix.
       }
       state = next;
 
-      if (state.levels && state.levelsLen > 0) {
+      if (state.levelsLen > 0) {
         size_t offset = 0;
         // Each packed byte stores the byte-distance delta and the Liang level digit.
         for (size_t i = 0; i < state.levelsLen; ++i) {
-          const uint8_t packed = state.levels[i];
+          const uint8_t packed = automaton[state.levels + i];
           const size_t dist = static_cast<size_t>(packed / 10);
           const uint8_t level = static_cast<uint8_t>(packed % 10);
 
           offset += dist;
           const size_t splitByte = byteStart + offset;
-          if (splitByte >= augmented.byteToCharIndex.size()) {
+          if (splitByte >= ws.byteCount) {
             continue;
           }
 
-          const int32_t boundary = augmented.byteToCharIndex[splitByte];
-          if (boundary < 0) {
+          const uint8_t boundary = ws.byteToCharIndex[splitByte];
+          if (boundary == LiangWorkspace::kNoChar) {
             continue;  // Mid-codepoint byte, wait for the next one.
           }
-          if (boundary < 2 || boundary + 2 > static_cast<int32_t>(augmented.charCount())) {
+          if (boundary < 2 || static_cast<size_t>(boundary) + 2 > ws.charCount) {
             continue;  // Skip splits that land in the leading/trailing sentinels.
           }
 
-          const size_t idx = static_cast<size_t>(boundary);
-          if (idx >= scores.size()) {
-            continue;
-          }
-          scores[idx] = std::max(scores[idx], level);
+          ws.scores[boundary] = std::max(ws.scores[boundary], level);
         }
       }
     }
   }
 
-  return collectBreakIndexes(cps, scores, config.minPrefix, config.minSuffix);
+  return collectBreakIndexes(count, ws, config.minPrefix, config.minSuffix);
+}
+
+}  // namespace
+
+size_t liangBreakIndexes(const CodepointInfo* cps, const size_t count, const SerializedHyphenationPatterns& patterns,
+                         const LiangWordConfig& config, LiangWorkspace& workspace) {
+  return runLiang(cps, count, FlashTrie{patterns}, patterns.rootOffset, config, workspace);
+}
+
+size_t liangBreakIndexes(const CodepointInfo* cps, const size_t count, PagedHyphenationTrie& trie,
+                         const LiangWordConfig& config, LiangWorkspace& workspace) {
+  if (!trie.valid()) {
+    return 0;
+  }
+  return runLiang(cps, count, PagedTrie{trie}, trie.rootOffset(), config, workspace);
 }
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "HyphenationCommon.h"
+#include "PagedHyphenationTrie.h"
 #include "SerializedHyphenationTrie.h"
 
 // Encapsulates every language-specific dial the Liang algorithm needs at runtime.  The helpers are
@@ -33,6 +34,30 @@ struct LiangWordConfig {
       : isLetter(letterFn), toLower(lowerFn), minPrefix(prefix), minSuffix(suffix) {}
 };
 
-// Shared Liang pattern evaluator used by every language-specific hyphenator.
-std::vector<size_t> liangBreakIndexes(const std::vector<CodepointInfo>& cps,
-                                      const SerializedHyphenationPatterns& patterns, const LiangWordConfig& config);
+// Fixed-capacity scratch space for a single liangBreakIndexes() call, small enough (~1KB) to live on the caller's
+// stack. Every buffer is indexed by augmented byte position, and the augmented word (lowercase UTF-8 between two '.'
+// sentinels) is at most kMaxBytes long, so one byte per entry is enough for offsets and indexes alike.  Words that
+// would not fit are reported as having no breaks instead of being truncated.
+struct LiangWorkspace {
+  static constexpr size_t kMaxBytes = kMaxHyphenationWordBytes + 2;
+  static constexpr uint8_t kNoChar = 0xFF;
+  static_assert(kMaxBytes < kNoChar, "Augmented word offsets must fit in a byte");
+
+  uint8_t bytes[kMaxBytes];
+  uint8_t charByteOffsets[kMaxBytes];
+  uint8_t byteToCharIndex[kMaxBytes];
+  uint8_t scores[kMaxBytes];
+  // Output: codepoint indexes (relative to the cps passed in) where the word may be broken, ascending.
+  uint8_t breakIndexes[kMaxBytes];
+  size_t byteCount = 0;
+  size_t charCount = 0;
+};
+
+// Shared Liang pattern evaluator used by every language-specific hyphenator. Writes the break positions into
+// workspace.breakIndexes and returns how many were found; never allocates.
+size_t liangBreakIndexes(const CodepointInfo* cps, size_t count, const SerializedHyphenationPatterns& patterns,
+                         const LiangWordConfig& config, LiangWorkspace& workspace);
+// Same evaluator over a trie paged in from a file (e.g. an SD-loaded language).
+size_t liangBreakIndexes(const CodepointInfo* cps, size_t count, PagedHyphenationTrie& trie,
+                         const LiangWordConfig& config, LiangWorkspace& workspace);
+
@@ -0,0 +1,170 @@
+#include "PagedHyphenationTrie.h"
+
+#include <algorithm>
+#include <cstring>
+
+PagedHyphenationTrie::PagedHyphenationTrie(std::unique_ptr<Source> source) : source_(std::move(source)) {
+  if (!source_ || source_->size() <= kHeaderSize) {
+    return;
+  }
+
+  uint8_t header[kHeaderSize];
+  if (source_->readAt(0, header, kHeaderSize) != kHeaderSize) {
+    return;
+  }
+  // The file starts with the big-endian root address, counted from the start of the file.
+  const size_t rootAddr = (static_cast<size_t>(header[0]) << 24) | (static_cast<size_t>(header[1]) << 16) |
+                          (static_cast<size_t>(header[2]) << 8) | static_cast<size_t>(header[3]);
+  size_ = source_->size() - kHeaderSize;
+  if (rootAddr < kHeaderSize || rootAddr - kHeaderSize >= size_) {
+    size_ = 0;
+    return;
+  }
+  rootOffset_ = rootAddr - kHeaderSize;
+  valid_ = true;
+
+  loadResidentNodes();
+  pageHits_ = 0;
+  pageMisses_ = 0;
+}
+
+uint8_t PagedHyphenationTrie::byteAt(const size_t addr) {
+  if (addr >= size_) {
+    return 0;
+  }
+
+  // Pages and resident nodes are tracked by file offset, so each page is exactly one card sector.
+  const size_t pos = addr + kHeaderSize;
+  if (pos >= currentBase_ && pos < currentEnd_) {
+    pageHits_++;
+    return currentBytes_[pos - currentBase_];
+  }
+
+  const ResidentNode* node = std::upper_bound(residentNodes_, residentNodes_ + residentCount_, addr,
+                                              [](const size_t a, const ResidentNode& n) { return a < n.addr; });
+  if (node != residentNodes_ && addr < (node - 1)->addr + (node - 1)->length) {
+    --node;
+    pageHits_++;
+    currentBytes_ = resident_ + node->offset;
+    currentBase_ = node->addr + kHeaderSize;
+    currentEnd_ = currentBase_ + node->length;
+    return currentBytes_[pos - currentBase_];
+  }
+
+  const size_t base = pos - pos % kPageSize;
+  Page* page = nullptr;
+  for (auto& candidate : pages_) {
+    if (candidate.base == base) {
+      page = &candidate;
+      break;
+    }
+  }
+  if (page) {
+    pageHits_++;
+  } else {
+    pageMisses_++;
+    page = load(base);
+    if (!page) {
+      return 0;
+    }
+  }
+
+  page->lastUse = ++useClock_;
+  currentBytes_ = page->bytes;
+  currentBase_ = base;
+  currentEnd_ = base + kPageSize;
+  return page->bytes[pos - base];
+}
+
+PagedHyphenationTrie::Page* PagedHyphenationTrie::load(const size_t base) {
+  Page* victim = &pages_[0];
+  for (auto& candidate : pages_) {
+    if (candidate.base == kNoPage) {
+      victim = &candidate;
+      break;
+    }
+    if (candidate.lastUse < victim->lastUse) {
+      victim = &candidate;
+    }
+  }
+  if (currentBytes_ == victim->bytes) {
+    currentBytes_ = nullptr;
+    currentBase_ = currentEnd_ = 0;
+  }
+
+  const size_t fileSize = size_ + kHeaderSize;
+  const size_t length = fileSize - base < kPageSize ? fileSize - base : kPageSize;
+  if (source_->readAt(base, victim->bytes, length) != length) {
+    victim->base = kNoPage;
+    return nullptr;
+  }
+  if (length < kPageSize) {
+    memset(victim->bytes + length, 0, kPageSize - length);
+  }
+  victim->base = base;
+  return victim;
+}
+
+bool PagedHyphenationTrie::readLayout(const size_t addr, NodeLayout& layout) {
+  const uint8_t header = byteAt(addr);
+  size_t length = 1;
+  layout.stride = (header >> 5) & 0x03u;
+  if (layout.stride == 0) {
+    layout.stride = 1;
+  }
+  layout.childCount = header & 0x1Fu;
+  if (layout.childCount == 31u) {
+    layout.childCount = byteAt(addr + length++);
+  }
+  if (header & 0x80u) {
+    length += 2;  // Levels offset and length
+  }
+  layout.targets = addr + length + layout.childCount;
+  layout.length = length + layout.childCount * (1 + layout.stride);
+  return addr + layout.length <= size_;
+}
+
+void PagedHyphenationTrie::loadResidentNodes() {
+  // Breadth-first from the root until the next node doesn't fit; the node table doubles as the queue.
+  size_t count = 0;
+  size_t used = 0;
+  const auto add = [&](const size_t addr) {
+    NodeLayout layout;
+    if (count == kMaxResidentNodes || !readLayout(addr, layout) || used + layout.length > kResidentBytes ||
+        source_->readAt(addr + kHeaderSize, resident_ + used, layout.length) != layout.length) {
+      return false;
+    }
+    residentNodes_[count++] = {static_cast<uint32_t>(addr), static_cast<uint16_t>(used),
+                               static_cast<uint16_t>(layout.length)};
+    used += layout.length;
+    return true;
+  };
+
+  bool full = !add(rootOffset_);
+  for (size_t i = 0; i < count && !full; i++) {
+    NodeLayout layout;
+    readLayout(residentNodes_[i].addr, layout);
+    for (size_t child = 0; child < layout.childCount && !full; child++) {
+      const size_t at = layout.targets + child * layout.stride;
+      int32_t delta;
+      if (layout.stride == 1) {
+        delta = static_cast<int8_t>(byteAt(at));
+      } else if (layout.stride == 2) {
+        delta = static_cast<int16_t>((byteAt(at) << 8) | byteAt(at + 1));
+      } else {
+        delta = ((byteAt(at) << 16) | (byteAt(at + 1) << 8) | byteAt(at + 2)) - (1 << 23);
+      }
+      const int64_t target = static_cast<int64_t>(residentNodes_[i].addr) + delta;
+      if (target < 0 || static_cast<size_t>(target) >= size_) {
+        continue;
+      }
+      const bool seen = std::any_of(residentNodes_, residentNodes_ + count,
+                                    [&](const ResidentNode& node) { return node.addr == target; });
+      full = !seen && !add(static_cast<size_t>(target));
+    }
+  }
+
+  std::sort(residentNodes_, residentNodes_ + count,
+            [](const ResidentNode& a, const ResidentNode& b) { return a.addr < b.addr; });
+  residentCount_ = count;
+}
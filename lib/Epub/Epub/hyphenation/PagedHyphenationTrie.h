@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Read-only view of a hypher binary trie (docs/hyphenation-trie-format.md) stored in a file rather than compiled into
+// flash. Every Liang walk starts at the root, but the nodes one or two letters down are scattered over the whole file,
+// so under LRU alone they are evicted by the deeper nodes of the previous word. The root and the nodes below it are
+// therefore copied breadth-first into a resident arena of kResidentBytes when the trie is opened; the rest of the
+// automaton is read through kPageCount sector-aligned pages recycled least-recently-used. Addresses use the same
+// coordinates as SerializedHyphenationPatterns (the file without its 4-byte root header), so the evaluator can treat
+// both backings identically.
+class PagedHyphenationTrie {
+ public:
+  // Positional reader over the underlying file; FsFile-backed on the device, stdio-backed in host tools.
+  class Source {
+   public:
+    virtual ~Source() = default;
+    virtual size_t size() const = 0;
+    virtual size_t readAt(size_t offset, uint8_t* buffer, size_t length) = 0;
+  };
+
+  static constexpr size_t kPageSize = 512;
+  static constexpr size_t kPageCount = 26;
+  static constexpr size_t kResidentBytes = 2560;
+  static constexpr size_t kMaxResidentNodes = 96;
+
+  explicit PagedHyphenationTrie(std::unique_ptr<Source> source);
+
+  // False when the file is too small or its root header points outside the automaton.
+  bool valid() const { return valid_; }
+  size_t rootOffset() const { return rootOffset_; }
+  size_t size() const { return size_; }
+
+  // Returns the automaton byte at `addr`, paging it in if needed. Out-of-range or unreadable bytes read as 0, which
+  // decodes as a leaf node and simply ends the walk.
+  uint8_t byteAt(size_t addr);
+
+  // Lookups served from the arena or a loaded page, and pages read from the file, since the trie was opened.
+  uint32_t pageHits() const { return pageHits_; }
+  uint32_t pageMisses() const { return pageMisses_; }
+  size_t residentNodes() const { return residentCount_; }
+
+ private:
+  static constexpr size_t kHeaderSize = 4;
+  static constexpr size_t kNoPage = SIZE_MAX;
+
+  struct Page {
+    size_t base = kNoPage;
+    uint32_t lastUse = 0;
+    uint8_t bytes[kPageSize];
+  };
+
+  // A node copied into the arena, covering automaton bytes [addr, addr + length).
+  struct ResidentNode {
+    uint32_t addr;
+    uint16_t offset;
+    uint16_t length;
+  };
+
+  std::unique_ptr<Source> source_;
+  Page pages_[kPageCount];
+  uint8_t resident_[kResidentBytes];
+  ResidentNode residentNodes_[kMaxResidentNodes];
+  size_t residentCount_ = 0;
+  // Range of the page or resident node the last lookup landed in; consecutive reads nearly always stay inside one node.
+  const uint8_t* currentBytes_ = nullptr;
+  size_t currentBase_ = 0;
+  size_t currentEnd_ = 0;
+  uint32_t useClock_ = 0;
+  size_t rootOffset_ = 0;
+  size_t size_ = 0;
+  bool valid_ = false;
+  uint32_t pageHits_ = 0;
+  uint32_t pageMisses_ = 0;
+
+  // Where the parts of a node record lie (see the node encoding in docs/hyphenation-trie-format.md).
+  struct NodeLayout {
+    size_t childCount = 0;
+    size_t stride = 1;
+    size_t targets = 0;  // Address of the first target delta
+    size_t length = 0;
+  };
+
+  Page* load(size_t base);
+  bool readLayout(size_t addr, NodeLayout& layout);
+  void loadResidentNodes();
+};
@@ -0,0 +1,93 @@
+#include "SdHyphenationLoader.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+
+#include <memory>
+#include <new>
+
+#include "HyphenationCommon.h"
+#include "LanguageHyphenator.h"
+#include "PagedHyphenationTrie.h"
+
+namespace {
+
+class SdTrieSource final : public PagedHyphenationTrie::Source {
+  FsFile file;
+
+ public:
+  ~SdTrieSource() override { file.close(); }
+
+  bool open(const std::string& path) { return Storage.openFileForRead("HYP", path, file); }
+
+  size_t size() const override { return file.size(); }
+
+  size_t readAt(const size_t offset, uint8_t* buffer, const size_t length) override {
+    if (!file.seek(offset)) {
+      return 0;
+    }
+    const int read = file.read(buffer, length);
+    return read > 0 ? static_cast<size_t>(read) : 0;
+  }
+};
+
+std::string loadedTag;
+std::unique_ptr<PagedHyphenationTrie> loadedTrie;
+std::unique_ptr<LanguageHyphenator> loadedHyphenator;
+
+bool isPlainTag(const std::string& tag) {
+  if (tag.empty() || tag.size() > 8) {
+    return false;
+  }
+  for (const char c : tag) {
+    if (c < 'a' || c > 'z') {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+void releaseSdHyphenator() {
+  loadedHyphenator.reset();
+  loadedTrie.reset();
+  loadedTag.clear();
+}
+
+const LanguageHyphenator* loadSdHyphenator(const std::string& primaryTag) {
+  if (loadedHyphenator && primaryTag == loadedTag) {
+    return loadedHyphenator.get();
+  }
+  releaseSdHyphenator();
+
+  // Tags come from book metadata; only accept plain subtags so they can't escape the patterns directory.
+  if (!isPlainTag(primaryTag)) {
+    return nullptr;
+  }
+
+  const std::string path = std::string(SD_HYPHENATION_DIR) + "/" + primaryTag + ".bin";
+  if (!Storage.exists(path.c_str())) {
+    return nullptr;
+  }
+  auto source = std::unique_ptr<SdTrieSource>(new (std::nothrow) SdTrieSource());
+  if (!source || !source->open(path)) {
+    return nullptr;
+  }
+
+  auto trie = std::unique_ptr<PagedHyphenationTrie>(new (std::nothrow) PagedHyphenationTrie(std::move(source)));
+  if (!trie || !trie->valid()) {
+    LOG_ERR("HYP", "Invalid hyphenation trie: %s", path.c_str());
+    return nullptr;
+  }
+
+  loadedHyphenator.reset(new (std::nothrow) LanguageHyphenator(*trie, isExtendedLetter, toLowerExtended));
+  if (!loadedHyphenator) {
+    return nullptr;
+  }
+  loadedTrie = std::move(trie);
+  loadedTag = primaryTag;
+  LOG_DBG("HYP", "Loaded hyphenation patterns for '%s' from SD (%u bytes)", primaryTag.c_str(),
+          static_cast<unsigned>(loadedTrie->size()));
+  return loadedHyphenator.get();
+}
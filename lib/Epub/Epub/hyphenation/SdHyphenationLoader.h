@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+class LanguageHyphenator;
+
+// Additional hypher tries are looked up here by primary language tag, e.g. /.crosspoint/hyphenation/pl.bin.
+constexpr char SD_HYPHENATION_DIR[] = "/.crosspoint/hyphenation";
+
+// ExternalHyphenatorProvider that resolves languages without a built-in trie from the SD card. Only the most recently
+// requested language stays loaded (one open file plus the PagedHyphenationTrie page cache); requesting another
+// language releases it, so supporting more languages costs no flash and no extra RAM.
+const LanguageHyphenator* loadSdHyphenator(const std::string& primaryTag);
+// ExternalHyphenatorRelease to pair with it: frees the loaded language once a built-in one (or none) is in use
+void releaseSdHyphenator();
@@ -7,6 +7,7 @@
 #include <expat.h>
 
 #include "../../Epub.h"
+#include "../ElementIndex.h"
 #include "../Page.h"
 #include "../converters/ImageDecoderFactory.h"
 #include "../converters/ImageToFramebufferDecoder.h"
@@ -110,17 +111,52 @@ void ChapterHtmlSlimParser::startNewTextBlock(const BlockStyle& blockStyle) {
       // This handles cases like <div style="margin-bottom:2em"><h1>text</h1></div> where the
       // div's margin should be preserved, even though it has no direct text content.
       currentTextBlock->setBlockStyle(currentTextBlock->getBlockStyle().getCombinedBlockStyle(blockStyle));
+      blockSourceOffset = currentSourceOffset();
       return;
     }
 
     makePages();
   }
-  currentTextBlock.reset(new ParsedText(extraParagraphSpacing, hyphenationEnabled, blockStyle));
+  if (!hyphenationWorkspace) {
+    hyphenationWorkspace.reset(new (std::nothrow) Hyphenator::Workspace());
+  }
+  currentTextBlock.reset(
+      new ParsedText(extraParagraphSpacing, hyphenationEnabled, blockStyle, hyphenationWorkspace.get()));
+  blockSourceOffset = currentSourceOffset();
+}
+
+uint32_t ChapterHtmlSlimParser::currentSourceOffset() const {
+  if (!xmlParser) {
+    return 0;
+  }
+  const XML_Index index = XML_GetCurrentByteIndex(xmlParser);
+  return index > 0 ? static_cast<uint32_t>(index) : 0;
+}
+
+void ChapterHtmlSlimParser::startNewPage(const uint32_t sourceOffset) {
+  currentPage.reset(new Page());
+  currentPageNextY = 0;
+  // A block can start before an image page that interrupts it; keep the offsets in page order
+  if (sourceOffset > pageSourceOffset) {
+    pageSourceOffset = sourceOffset;
+  }
 }
 
 void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char* name, const XML_Char** atts) {
   auto* self = static_cast<ChapterHtmlSlimParser*>(userData);
 
+  // Skipped content is part of the DOM that element paths address, so it is indexed too
+  if (self->elementIndex) {
+    const char* id = nullptr;
+    for (int i = 0; atts && atts[i]; i += 2) {
+      if (strcmp(atts[i], "id") == 0) {
+        id = atts[i + 1];
+        break;
+      }
+    }
+    self->elementIndex->startElement(name, id, self->currentSourceOffset());
+  }
+
   // Middle of skip
   if (self->skipUntilDepth < self->depth) {
     self->depth += 1;
@@ -171,7 +207,8 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
         }
       }
 
-      if (!src.empty()) {
+      // A preview parses straight off the inflate stream and can't read another item from the zip meanwhile
+      if (!src.empty() && !self->previewMode) {
         LOG_DBG("EHP", "Found image: src=%s", src.c_str());
 
         {
@@ -219,20 +256,10 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
               // Create page for image - only break if image won't fit remaining space
               if (self->currentPage && !self->currentPage->elements.empty() &&
                   (self->currentPageNextY + displayHeight > self->viewportHeight)) {
-                self->completePageFn(std::move(self->currentPage));
-                self->currentPage.reset(new Page());
-                if (!self->currentPage) {
-                  LOG_ERR("EHP", "Failed to create new page");
-                  return;
-                }
-                self->currentPageNextY = 0;
+                self->completePageFn(std::move(self->currentPage), self->pageSourceOffset);
+                self->startNewPage(self->currentSourceOffset());
               } else if (!self->currentPage) {
-                self->currentPage.reset(new Page());
-                if (!self->currentPage) {
-                  LOG_ERR("EHP", "Failed to create initial page");
-                  return;
-                }
-                self->currentPageNextY = 0;
+                self->startNewPage(self->currentSourceOffset());
               }
 
               // Create ImageBlock and add to page
@@ -442,8 +469,8 @@ void XMLCALL ChapterHtmlSlimParser::startElement(void* userData, const XML_Char*
 void XMLCALL ChapterHtmlSlimParser::characterData(void* userData, const XML_Char* s, const int len) {
   auto* self = static_cast<ChapterHtmlSlimParser*>(userData);
 
-  // Middle of skip
-  if (self->skipUntilDepth < self->depth) {
+  // Middle of skip, or before the part of the chapter a preview shows
+  if (self->skipUntilDepth < self->depth || self->skippingText()) {
     return;
   }
 
@@ -534,6 +561,10 @@ void XMLCALL ChapterHtmlSlimParser::defaultHandlerExpand(void* userData, const X
 void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* name) {
   auto* self = static_cast<ChapterHtmlSlimParser*>(userData);
 
+  if (self->elementIndex) {
+    self->elementIndex->endElement();
+  }
+
   // Check if any style state will change after we decrement depth
   // If so, we MUST flush the partWordBuffer with the CURRENT style first
   // Note: depth hasn't been decremented yet, so we check against (depth - 1)
@@ -601,7 +632,7 @@ void XMLCALL ChapterHtmlSlimParser::endElement(void* userData, const XML_Char* n
   }
 }
 
-bool ChapterHtmlSlimParser::parseAndBuildPages() {
+bool ChapterHtmlSlimParser::beginParse() {
   auto paragraphAlignmentBlockStyle = BlockStyle();
   paragraphAlignmentBlockStyle.textAlignDefined = true;
   // Resolve None sentinel to Justify for initial block (no CSS context yet)
@@ -611,21 +642,77 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
   paragraphAlignmentBlockStyle.alignment = align;
   startNewTextBlock(paragraphAlignmentBlockStyle);
 
-  const XML_Parser parser = XML_ParserCreate(nullptr);
-  int done;
-
-  if (!parser) {
+  xmlParser = XML_ParserCreate(nullptr);
+  if (!xmlParser) {
     LOG_ERR("EHP", "Couldn't allocate memory for parser");
     return false;
   }
 
   // Handle HTML entities (like &nbsp;) that aren't in XML spec or DTD
   // Using DefaultHandlerExpand preserves normal entity expansion from DOCTYPE
-  XML_SetDefaultHandlerExpand(parser, defaultHandlerExpand);
+  XML_SetDefaultHandlerExpand(xmlParser, defaultHandlerExpand);
+  XML_SetUserData(xmlParser, this);
+  XML_SetElementHandler(xmlParser, startElement, endElement);
+  XML_SetCharacterDataHandler(xmlParser, characterData);
+  return true;
+}
 
+bool ChapterHtmlSlimParser::parseChunk(const char* data, const size_t length, const bool isFinal) {
+  if (stopped) {
+    return true;
+  }
+  if (!xmlParser) {
+    return false;
+  }
+  if (XML_Parse(xmlParser, data, static_cast<int>(length), isFinal) == XML_STATUS_ERROR && !stopped) {
+    LOG_ERR("EHP", "Parse error at line %lu:\n%s", XML_GetCurrentLineNumber(xmlParser),
+            XML_ErrorString(XML_GetErrorCode(xmlParser)));
+    endParse();
+    return false;
+  }
+  return true;
+}
+
+void ChapterHtmlSlimParser::stop() {
+  stopped = true;
+  if (xmlParser) {
+    XML_StopParser(xmlParser, XML_FALSE);
+  }
+}
+
+void ChapterHtmlSlimParser::endParse() {
+  if (!xmlParser) {
+    return;
+  }
+  XML_StopParser(xmlParser, XML_FALSE);                // Stop any pending processing
+  XML_SetElementHandler(xmlParser, nullptr, nullptr);  // Clear callbacks
+  XML_SetCharacterDataHandler(xmlParser, nullptr);
+  XML_ParserFree(xmlParser);
+  xmlParser = nullptr;
+}
+
+void ChapterHtmlSlimParser::finishParse() {
+  endParse();
+  if (stopped) {
+    return;
+  }
+
+  // Process last page if there is still text
+  if (currentTextBlock) {
+    makePages();
+    completePageFn(std::move(currentPage), pageSourceOffset);
+    currentPage.reset();
+    currentTextBlock.reset();
+  }
+}
+
+bool ChapterHtmlSlimParser::parseAndBuildPages() {
   FsFile file;
   if (!Storage.openFileForRead("EHP", filepath, file)) {
-    XML_ParserFree(parser);
+    return false;
+  }
+  if (!beginParse()) {
+    file.close();
     return false;
   }
 
@@ -634,18 +721,12 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
     popupFn();
   }
 
-  XML_SetUserData(parser, this);
-  XML_SetElementHandler(parser, startElement, endElement);
-  XML_SetCharacterDataHandler(parser, characterData);
-
+  int done;
   do {
-    void* const buf = XML_GetBuffer(parser, 1024);
+    void* const buf = XML_GetBuffer(xmlParser, 1024);
     if (!buf) {
       LOG_ERR("EHP", "Couldn't allocate memory for buffer");
-      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-      XML_SetCharacterDataHandler(parser, nullptr);
-      XML_ParserFree(parser);
+      endParse();
       file.close();
       return false;
     }
@@ -654,42 +735,24 @@ bool ChapterHtmlSlimParser::parseAndBuildPages() {
 
     if (len == 0 && file.available() > 0) {
       LOG_ERR("EHP", "File read error");
-      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-      XML_SetCharacterDataHandler(parser, nullptr);
-      XML_ParserFree(parser);
+      endParse();
       file.close();
       return false;
     }
 
     done = file.available() == 0;
 
-    if (XML_ParseBuffer(parser, static_cast<int>(len), done) == XML_STATUS_ERROR) {
-      LOG_ERR("EHP", "Parse error at line %lu:\n%s", XML_GetCurrentLineNumber(parser),
-              XML_ErrorString(XML_GetErrorCode(parser)));
-      XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-      XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-      XML_SetCharacterDataHandler(parser, nullptr);
-      XML_ParserFree(parser);
+    if (XML_ParseBuffer(xmlParser, static_cast<int>(len), done) == XML_STATUS_ERROR && !stopped) {
+      LOG_ERR("EHP", "Parse error at line %lu:\n%s", XML_GetCurrentLineNumber(xmlParser),
+              XML_ErrorString(XML_GetErrorCode(xmlParser)));
+      endParse();
       file.close();
       return false;
     }
-  } while (!done);
+  } while (!done && !stopped);
 
-  XML_StopParser(parser, XML_FALSE);                // Stop any pending processing
-  XML_SetElementHandler(parser, nullptr, nullptr);  // Clear callbacks
-  XML_SetCharacterDataHandler(parser, nullptr);
-  XML_ParserFree(parser);
   file.close();
-
-  // Process last page if there is still text
-  if (currentTextBlock) {
-    makePages();
-    completePageFn(std::move(currentPage));
-    currentPage.reset();
-    currentTextBlock.reset();
-  }
-
+  finishParse();
   return true;
 }
 
@@ -697,9 +760,9 @@ void ChapterHtmlSlimParser::addLineToPage(std::shared_ptr<TextBlock> line) {
   const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
 
   if (currentPageNextY + lineHeight > viewportHeight) {
-    completePageFn(std::move(currentPage));
-    currentPage.reset(new Page());
-    currentPageNextY = 0;
+    completePageFn(std::move(currentPage), pageSourceOffset);
+    // The rest of the current block carries over; pages are located by the block they start in
+    startNewPage(blockSourceOffset);
   }
 
   // Apply horizontal left inset (margin + padding) as x position offset
@@ -715,8 +778,7 @@ void ChapterHtmlSlimParser::makePages() {
   }
 
   if (!currentPage) {
-    currentPage.reset(new Page());
-    currentPageNextY = 0;
+    startNewPage(blockSourceOffset);
   }
 
   const int lineHeight = renderer.getLineHeight(fontId) * lineCompression;
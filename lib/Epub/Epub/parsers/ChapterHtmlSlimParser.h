@@ -15,14 +15,20 @@
 class Page;
 class GfxRenderer;
 class Epub;
+class ElementIndexWriter;
 
 #define MAX_WORD_SIZE 200
 
 class ChapterHtmlSlimParser {
+ public:
+  // Receives each finished page with the byte offset in the chapter's XHTML where the page's first block starts
+  using CompletePageFn = std::function<void(std::unique_ptr<Page> page, uint32_t sourceOffset)>;
+
+ private:
   std::shared_ptr<Epub> epub;
   const std::string& filepath;
   GfxRenderer& renderer;
-  std::function<void(std::unique_ptr<Page>)> completePageFn;
+  CompletePageFn completePageFn;
   std::function<void()> popupFn;  // Popup callback
   int depth = 0;
   int skipUntilDepth = INT_MAX;
@@ -35,8 +41,19 @@ class ChapterHtmlSlimParser {
   int partWordBufferIndex = 0;
   bool nextWordContinues = false;  // true when next flushed word attaches to previous (inline element boundary)
   std::unique_ptr<ParsedText> currentTextBlock = nullptr;
+  // Shared by the text blocks of this build; kept off the task stack and per build so concurrent builds don't collide
+  std::unique_ptr<Hyphenator::Workspace> hyphenationWorkspace = nullptr;
   std::unique_ptr<Page> currentPage = nullptr;
   int16_t currentPageNextY = 0;
+  XML_Parser xmlParser = nullptr;
+  uint32_t blockSourceOffset = 0;
+  uint32_t pageSourceOffset = 0;
+  // Preview mode: text before this offset is skipped (markup is still tracked so styles stay right) and images are
+  // never extracted, since the chapter is still being inflated from the same zip
+  uint32_t textStartOffset = 0;
+  bool previewMode = false;
+  bool stopped = false;
+  ElementIndexWriter* elementIndex = nullptr;
   int fontId;
   float lineCompression;
   bool extraParagraphSpacing;
@@ -64,6 +81,9 @@ class ChapterHtmlSlimParser {
   bool effectiveUnderline = false;
 
   void updateEffectiveInlineStyle();
+  uint32_t currentSourceOffset() const;
+  bool skippingText() const { return textStartOffset > 0 && currentSourceOffset() < textStartOffset; }
+  void startNewPage(uint32_t sourceOffset);
   void startNewTextBlock(const BlockStyle& blockStyle);
   void flushPartWordBuffer();
   void makePages();
@@ -78,7 +98,7 @@ class ChapterHtmlSlimParser {
                                  const int fontId, const float lineCompression, const bool extraParagraphSpacing,
                                  const uint8_t paragraphAlignment, const uint16_t viewportWidth,
                                  const uint16_t viewportHeight, const bool hyphenationEnabled,
-                                 const std::function<void(std::unique_ptr<Page>)>& completePageFn,
+                                 const CompletePageFn& completePageFn,
                                  const bool embeddedStyle, const std::string& contentBase,
                                  const std::string& imageBasePath, const std::function<void()>& popupFn = nullptr,
                                  const CssParser* cssParser = nullptr)
@@ -100,7 +120,27 @@ class ChapterHtmlSlimParser {
         contentBase(contentBase),
         imageBasePath(imageBasePath) {}
 
-  ~ChapterHtmlSlimParser() = default;
+  ~ChapterHtmlSlimParser() { endParse(); }
   bool parseAndBuildPages();
   void addLineToPage(std::shared_ptr<TextBlock> line);
+
+  // Incremental parsing for callers that already have the XHTML in memory chunks, e.g. while it is being inflated.
+  // parseChunk() returns false on a parse error; finishParse() emits the last page.
+  bool beginParse();
+  bool parseChunk(const char* data, size_t length, bool isFinal);
+  void finishParse();
+  // Lays out only what follows `sourceOffset`, without images, so a page near that position can be shown before the
+  // whole chapter is paginated
+  void setPreviewFrom(uint32_t sourceOffset) {
+    textStartOffset = sourceOffset;
+    previewMode = true;
+  }
+  // Records every element and its source offset in `index` while parsing
+  void setElementIndex(ElementIndexWriter* index) { elementIndex = index; }
+  // Ends parsing from inside completePageFn once enough pages have been produced
+  void stop();
+  bool isStopped() const { return stopped; }
+
+ private:
+  void endParse();
 };
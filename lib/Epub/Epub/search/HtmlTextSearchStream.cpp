@@ -0,0 +1,161 @@
+#include "HtmlTextSearchStream.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "../htmlEntities.h"
+
+namespace {
+// Elements whose text is never shown
+const char* const SKIPPED_ELEMENTS[] = {"head", "script", "style"};
+// Elements that can sit inside a word; every other tag is treated as a word break
+const char* const INLINE_ELEMENTS[] = {"a",    "abbr", "b",    "big", "cite", "code", "em",   "font",
+                                       "i",    "kbd",  "mark", "q",   "s",    "samp", "small", "span",
+                                       "strong", "sub", "sup", "tt",  "u",    "var"};
+
+bool isNameChar(const uint8_t c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == ':';
+}
+
+int findName(const char* name, const char* const* names, const int count) {
+  for (int i = 0; i < count; i++) {
+    if (strcmp(name, names[i]) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+}  // namespace
+
+void HtmlTextSearchStream::endTagName() {
+  tagName[tagNameLength] = '\0';
+  constexpr int skippedCount = sizeof(SKIPPED_ELEMENTS) / sizeof(SKIPPED_ELEMENTS[0]);
+  constexpr int inlineCount = sizeof(INLINE_ELEMENTS) / sizeof(INLINE_ELEMENTS[0]);
+
+  if (skipping >= 0) {
+    if (closingTag && strcmp(tagName, SKIPPED_ELEMENTS[skipping]) == 0) {
+      skipping = -1;
+    }
+    return;
+  }
+  if (tagNameLength == 0) {
+    return;  // Comment, doctype or processing instruction
+  }
+  if (!closingTag) {
+    skipping = static_cast<int8_t>(findName(tagName, SKIPPED_ELEMENTS, skippedCount));
+    skipStartedByTag = skipping >= 0;
+  }
+  if (findName(tagName, INLINE_ELEMENTS, inlineCount) < 0) {
+    matcher.feedSeparator();
+  }
+}
+
+void HtmlTextSearchStream::endEntity() {
+  entity[entityLength] = '\0';
+  if (entityLength > 3 && entity[1] == '#') {  // &#233; or &#xE9;
+    const bool hex = entity[2] == 'x' || entity[2] == 'X';
+    const auto cp = static_cast<uint32_t>(strtoul(entity + (hex ? 3 : 2), nullptr, hex ? 16 : 10));
+    if (cp != 0) {
+      matcher.feedCodepoint(cp);
+      return;
+    }
+  } else if (const char* value = lookupHtmlEntity(entity, entityLength)) {
+    matcher.feed(value, strlen(value));
+    return;
+  }
+  matcher.feed(entity, entityLength);
+}
+
+size_t HtmlTextSearchStream::write(const uint8_t data) { return write(&data, 1); }
+
+size_t HtmlTextSearchStream::write(const uint8_t* buffer, const size_t size) {
+  if (cancelled && *cancelled) {
+    // The inflater can't be stopped from here; just let the rest of the chapter drain
+    return size;
+  }
+
+  size_t i = 0;
+  while (i < size) {
+    const uint8_t c = buffer[i];
+    switch (state) {
+      case State::Text: {
+        size_t end = i;
+        while (end < size && buffer[end] != '<' && buffer[end] != '&') {
+          end++;
+        }
+        if (skipping < 0 && end > i) {
+          matcher.feed(reinterpret_cast<const char*>(buffer + i), end - i);
+        }
+        if (end < size) {
+          if (buffer[end] == '<') {
+            state = State::TagName;
+            tagNameLength = 0;
+            closingTag = false;
+            skipStartedByTag = false;
+          } else if (skipping < 0) {
+            state = State::Entity;
+            entity[0] = '&';
+            entityLength = 1;
+          }
+          end++;
+        }
+        i = end;
+        break;
+      }
+
+      case State::TagName:
+        if (c == '/' && tagNameLength == 0 && !closingTag) {
+          closingTag = true;
+        } else if (isNameChar(c)) {
+          if (tagNameLength < sizeof(tagName) - 1) {
+            tagName[tagNameLength++] = static_cast<char>(c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+          }
+        } else {
+          endTagName();
+          state = c == '>' ? State::Text : State::Tag;
+          lastTagByte = c;
+        }
+        i++;
+        break;
+
+      case State::Tag: {
+        const auto* close = static_cast<const uint8_t*>(memchr(buffer + i, '>', size - i));
+        if (!close) {
+          lastTagByte = buffer[size - 1];
+          i = size;
+          break;
+        }
+        // A self-closing <script/> or <style/> has no contents to skip
+        const uint8_t beforeClose = close > buffer + i ? close[-1] : lastTagByte;
+        if (skipStartedByTag && beforeClose == '/') {
+          skipping = -1;
+        }
+        state = State::Text;
+        i = close - buffer + 1;
+        break;
+      }
+
+      case State::Entity:
+        if (c == ';') {
+          entity[entityLength++] = ';';
+          endEntity();
+          state = State::Text;
+          i++;
+        } else if ((isNameChar(c) || c == '#') && entityLength < sizeof(entity) - 2) {
+          entity[entityLength++] = static_cast<char>(c);
+          i++;
+        } else {
+          // Not an entity after all: pass the text through and rescan this byte as text
+          matcher.feed(entity, entityLength);
+          state = State::Text;
+        }
+        break;
+    }
+  }
+
+  offset += size;
+  if (matcher.takeMatches() > 0 && onMatch) {
+    onMatch(offset);
+  }
+  return size;
+}
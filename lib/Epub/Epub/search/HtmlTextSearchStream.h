@@ -0,0 +1,43 @@
+#pragma once
+#include <Print.h>
+
+#include <functional>
+
+#include "TextMatcher.h"
+
+// Strips markup from a chapter as it is inflated and feeds the visible text to a TextMatcher, for searching chapters
+// that have no section cache yet. This is a tag/entity scanner rather than an XML parser: it only needs to tell text
+// from markup, and tolerates the malformed XHTML that expat would reject. Block-level tags count as word breaks;
+// <head>, <script> and <style> contents are skipped.
+class HtmlTextSearchStream final : public Print {
+  enum class State : uint8_t { Text, TagName, Tag, Entity };
+
+  TextMatcher& matcher;
+  const std::function<void(size_t offset)> onMatch;
+  const volatile bool* cancelled;
+
+  State state = State::Text;
+  size_t offset = 0;
+  char tagName[12] = {};
+  uint8_t tagNameLength = 0;
+  bool closingTag = false;
+  // Index into SKIPPED_ELEMENTS of the element whose contents are being skipped, or -1
+  int8_t skipping = -1;
+  bool skipStartedByTag = false;
+  // Last byte seen inside the current tag, to spot "/>" split across writes
+  uint8_t lastTagByte = 0;
+  char entity[12] = {};
+  uint8_t entityLength = 0;
+
+  void endTagName();
+  void endEntity();
+
+ public:
+  // `onMatch` receives the source offset (in bytes) of the chunk in which matches were completed.
+  HtmlTextSearchStream(TextMatcher& matcher, const std::function<void(size_t offset)>& onMatch,
+                       const volatile bool* cancelled = nullptr)
+      : matcher(matcher), onMatch(onMatch), cancelled(cancelled) {}
+
+  size_t write(uint8_t) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+};
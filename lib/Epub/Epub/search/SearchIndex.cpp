@@ -0,0 +1,821 @@
+#include "SearchIndex.h"
+
+#include <Logging.h>
+#include <Utf8.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "../Section.h"
+#include "TextMatcher.h"
+
+namespace {
+constexpr uint8_t SEARCH_INDEX_FILE_VERSION = 2;
+constexpr size_t IO_BUFFER_BYTES = 512;
+
+// Folded codepoints that make up words; everything else separates terms
+bool isTermCodepoint(const uint32_t cp) {
+  if (cp < 0x80) {
+    return (cp >= 'a' && cp <= 'z') || (cp >= '0' && cp <= '9');
+  }
+  if (cp < 0xC0 || cp == 0xD7 || cp == 0xF7) {
+    return false;  // Latin-1 punctuation and symbols
+  }
+  // General punctuation, symbols and arrows, and CJK punctuation
+  return !(cp >= 0x2000 && cp <= 0x2BFF) && !(cp >= 0x3000 && cp <= 0x303F);
+}
+
+void appendToTerm(std::string& term, const uint32_t cp) {
+  char encoded[4];
+  size_t length;
+  if (cp < 0x80) {
+    encoded[0] = static_cast<char>(cp);
+    length = 1;
+  } else if (cp < 0x800) {
+    encoded[0] = static_cast<char>(0xC0 | (cp >> 6));
+    encoded[1] = static_cast<char>(0x80 | (cp & 0x3F));
+    length = 2;
+  } else if (cp < 0x10000) {
+    encoded[0] = static_cast<char>(0xE0 | (cp >> 12));
+    encoded[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    encoded[2] = static_cast<char>(0x80 | (cp & 0x3F));
+    length = 3;
+  } else {
+    encoded[0] = static_cast<char>(0xF0 | (cp >> 18));
+    encoded[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    encoded[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    encoded[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    length = 4;
+  }
+  // Long words are cut at a codepoint boundary; queries are cut the same way, so they still match as prefixes
+  if (term.size() + length <= SearchIndex::kMaxTermBytes) {
+    term.append(encoded, length);
+  }
+}
+
+// Appends the folded term characters of `text` to `term`, handing over each term that a separator completes.
+template <typename OnTerm>
+void appendTerms(const char* text, const size_t length, std::string& term, OnTerm&& onTerm) {
+  const auto* cursor = reinterpret_cast<const unsigned char*>(text);
+  const auto* end = cursor + length;
+  while (cursor < end) {
+    uint32_t cp = *cursor;
+    if (cp < 0x80) {
+      cursor++;
+      if (cp >= 'A' && cp <= 'Z') {
+        cp += 'a' - 'A';
+      }
+    } else {
+      cp = TextMatcher::foldCodepoint(utf8NextCodepoint(&cursor));
+      if (cp == 0) {
+        continue;  // Soft hyphens and zero-width characters don't split words
+      }
+    }
+
+    if (isTermCodepoint(cp)) {
+      appendToTerm(term, cp);
+    } else if (!term.empty()) {
+      onTerm(term);
+      term.clear();
+    }
+  }
+}
+}  // namespace
+
+class SearchIndexFileReader {
+ public:
+  bool open(const std::string& path) { return Storage.openFileForRead("SRC", path, file); }
+  void close() {
+    if (file) {
+      file.close();
+    }
+  }
+
+  bool seek(const uint32_t offset) {
+    position = length = 0;
+    return file.seek(offset);
+  }
+
+  bool get(uint8_t& value) {
+    if (position == length && !fill()) {
+      return false;
+    }
+    value = buffer[position++];
+    return true;
+  }
+
+  bool read(void* out, size_t size) {
+    auto* bytes = static_cast<uint8_t*>(out);
+    while (size > 0) {
+      if (position == length && !fill()) {
+        return false;
+      }
+      const size_t chunk = std::min(size, length - position);
+      memcpy(bytes, buffer + position, chunk);
+      position += chunk;
+      bytes += chunk;
+      size -= chunk;
+    }
+    return true;
+  }
+
+  template <typename T>
+  bool readPod(T& value) {
+    return read(&value, sizeof(T));
+  }
+
+  bool readVarint(uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+      uint8_t byte;
+      if (!get(byte)) {
+        return false;
+      }
+      value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  FsFile file;
+  uint8_t buffer[IO_BUFFER_BYTES] = {};
+  size_t position = 0;
+  size_t length = 0;
+
+  bool fill() {
+    const int count = file.read(buffer, sizeof(buffer));
+    if (count <= 0) {
+      return false;
+    }
+    position = 0;
+    length = static_cast<size_t>(count);
+    return true;
+  }
+};
+
+namespace {
+class IndexFileWriter {
+ public:
+  bool open(const std::string& path) {
+    ok = Storage.openFileForWrite("SRC", path, file);
+    return ok;
+  }
+
+  // Returns false if anything failed to write.
+  bool close() {
+    flushBuffer();
+    file.close();
+    return ok;
+  }
+
+  // Moves back to the start of the file, to fill in the header once everything after it is written.
+  void rewind() {
+    flushBuffer();
+    ok = file.seek(0) && ok;
+    written = 0;
+  }
+
+  void put(const uint8_t value) {
+    if (used == sizeof(buffer)) {
+      flushBuffer();
+    }
+    buffer[used++] = value;
+  }
+
+  void write(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+      if (used == sizeof(buffer)) {
+        flushBuffer();
+      }
+      const size_t chunk = std::min(size, sizeof(buffer) - used);
+      memcpy(buffer + used, bytes, chunk);
+      used += chunk;
+      bytes += chunk;
+      size -= chunk;
+    }
+  }
+
+  template <typename T>
+  void writePod(const T& value) {
+    write(&value, sizeof(T));
+  }
+
+  void writeVarint(uint32_t value) {
+    while (value >= 0x80) {
+      put(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+    put(static_cast<uint8_t>(value));
+  }
+
+  uint32_t position() const { return written + static_cast<uint32_t>(used); }
+
+ private:
+  FsFile file;
+  uint8_t buffer[IO_BUFFER_BYTES] = {};
+  size_t used = 0;
+  uint32_t written = 0;
+  bool ok = false;
+
+  void flushBuffer() {
+    if (used > 0 && file.write(buffer, used) != used) {
+      ok = false;
+    }
+    written += static_cast<uint32_t>(used);
+    used = 0;
+  }
+};
+
+struct Header {
+  SearchIndex::Layout layout;
+  uint16_t spineCount = 0;
+  uint32_t totalPages = 0;
+  uint32_t termCount = 0;
+  uint32_t postingCount = 0;
+  uint32_t blockCount = 0;
+  uint32_t blockTableOffset = 0;
+};
+
+void writeHeader(IndexFileWriter& out, const Header& header) {
+  out.writePod(SEARCH_INDEX_FILE_VERSION);
+  out.writePod(Section::FILE_VERSION);
+  out.writePod(header.layout.fontId);
+  out.writePod(header.layout.lineCompression);
+  out.writePod(header.layout.extraParagraphSpacing);
+  out.writePod(header.layout.paragraphAlignment);
+  out.writePod(header.layout.viewportWidth);
+  out.writePod(header.layout.viewportHeight);
+  out.writePod(header.layout.hyphenationEnabled);
+  out.writePod(header.layout.embeddedStyle);
+  out.writePod(header.spineCount);
+  out.writePod(header.totalPages);
+  out.writePod(header.termCount);
+  out.writePod(header.postingCount);
+  out.writePod(header.blockCount);
+  out.writePod(header.blockTableOffset);
+}
+
+bool readHeader(SearchIndexFileReader& in, Header& header) {
+  uint8_t version;
+  uint8_t sectionVersion;
+  // Page numbers are only valid for sections laid out by the same code
+  if (!in.readPod(version) || version != SEARCH_INDEX_FILE_VERSION || !in.readPod(sectionVersion) ||
+      sectionVersion != Section::FILE_VERSION) {
+    return false;
+  }
+  return in.readPod(header.layout.fontId) && in.readPod(header.layout.lineCompression) &&
+         in.readPod(header.layout.extraParagraphSpacing) && in.readPod(header.layout.paragraphAlignment) &&
+         in.readPod(header.layout.viewportWidth) && in.readPod(header.layout.viewportHeight) &&
+         in.readPod(header.layout.hyphenationEnabled) && in.readPod(header.layout.embeddedStyle) &&
+         in.readPod(header.spineCount) && in.readPod(header.totalPages) && in.readPod(header.termCount) &&
+         in.readPod(header.postingCount) && in.readPod(header.blockCount) && in.readPod(header.blockTableOffset);
+}
+
+bool sameLayout(const SearchIndex::Layout& a, const SearchIndex::Layout& b) {
+  return a.fontId == b.fontId && a.lineCompression == b.lineCompression &&
+         a.extraParagraphSpacing == b.extraParagraphSpacing && a.paragraphAlignment == b.paragraphAlignment &&
+         a.viewportWidth == b.viewportWidth && a.viewportHeight == b.viewportHeight &&
+         a.hyphenationEnabled == b.hyphenationEnabled && a.embeddedStyle == b.embeddedStyle;
+}
+
+// Receives merged terms in sorted order, each followed by its pages in ascending order.
+class TermSink {
+ public:
+  virtual ~TermSink() = default;
+  virtual void beginTerm(const std::string& term, uint32_t pageCount) = 0;
+  virtual void addPage(uint32_t page) = 0;
+  virtual void endTerm() = 0;
+};
+
+// Intermediate run: a sequence of { u8 length, term, varint count, varint page deltas }.
+class RunWriter final : public TermSink {
+ public:
+  IndexFileWriter out;
+
+  void beginTerm(const std::string& term, const uint32_t pageCount) override {
+    out.put(static_cast<uint8_t>(term.size()));
+    out.write(term.data(), term.size());
+    out.writeVarint(pageCount);
+    lastPage = 0;
+  }
+  void addPage(const uint32_t page) override {
+    out.writeVarint(page - lastPage);
+    lastPage = page;
+  }
+  void endTerm() override {}
+
+ private:
+  uint32_t lastPage = 0;
+};
+
+class RunReader {
+ public:
+  SearchIndexFileReader in;
+  std::string term;
+  uint32_t pageCount = 0;
+  bool valid = false;
+  bool error = false;
+
+  void next() {
+    uint8_t length;
+    valid = in.get(length);
+    if (!valid) {
+      return;  // End of run
+    }
+    term.resize(length);
+    if (!in.read(&term[0], length) || !in.readVarint(pageCount)) {
+      valid = false;
+      error = true;
+    }
+  }
+
+  void copyPages(TermSink& sink) {
+    uint32_t page = 0;
+    for (uint32_t i = 0; i < pageCount; i++) {
+      uint32_t delta;
+      if (!in.readVarint(delta)) {
+        error = true;
+        return;
+      }
+      page += delta;
+      sink.addPage(page);
+    }
+  }
+};
+
+// The finished index: postings go straight into the file after the header, while the front-coded dictionary is
+// written to a side file and appended once all postings are in.
+class IndexWriter final : public TermSink {
+ public:
+  IndexFileWriter out;
+  IndexFileWriter dictionary;
+  Header header;
+  // Per block: dictionary offset relative to the dictionary start, then absolute postings offset
+  std::vector<uint32_t> blockHeads;
+
+  void beginTerm(const std::string& term, const uint32_t pageCount) override {
+    if (header.termCount % SearchIndex::kBlockTerms == 0) {
+      blockHeads.push_back(dictionary.position());
+      blockHeads.push_back(out.position());
+      dictionary.put(static_cast<uint8_t>(term.size()));
+      dictionary.write(term.data(), term.size());
+    } else {
+      size_t shared = 0;
+      while (shared < term.size() && shared < previousTerm.size() && term[shared] == previousTerm[shared]) {
+        shared++;
+      }
+      dictionary.put(static_cast<uint8_t>(shared));
+      dictionary.put(static_cast<uint8_t>(term.size() - shared));
+      dictionary.write(term.data() + shared, term.size() - shared);
+    }
+    dictionary.writeVarint(pageCount);
+    previousTerm = term;
+    header.termCount++;
+    header.postingCount += pageCount;
+    termStart = out.position();
+    lastPage = 0;
+  }
+  void addPage(const uint32_t page) override {
+    out.writeVarint(page - lastPage);
+    lastPage = page;
+  }
+  void endTerm() override { dictionary.writeVarint(out.position() - termStart); }
+
+ private:
+  std::string previousTerm;
+  uint32_t termStart = 0;
+  uint32_t lastPage = 0;
+};
+
+// Merges two runs (either path may be empty) into `sink`. `olderPath` must hold the earlier pages.
+bool mergeRuns(const std::string& olderPath, const std::string& newerPath, TermSink& sink) {
+  std::unique_ptr<RunReader> older(new RunReader());
+  std::unique_ptr<RunReader> newer(new RunReader());
+  if ((!olderPath.empty() && !older->in.open(olderPath)) || (!newerPath.empty() && !newer->in.open(newerPath))) {
+    older->in.close();
+    newer->in.close();
+    return false;
+  }
+  if (!olderPath.empty()) older->next();
+  if (!newerPath.empty()) newer->next();
+
+  while (older->valid || newer->valid) {
+    const int order = !newer->valid ? -1 : !older->valid ? 1 : older->term.compare(newer->term);
+    const uint32_t pageCount =
+        order < 0 ? older->pageCount : order > 0 ? newer->pageCount : older->pageCount + newer->pageCount;
+    sink.beginTerm(order <= 0 ? older->term : newer->term, pageCount);
+    if (order <= 0) older->copyPages(sink);
+    if (order >= 0) newer->copyPages(sink);
+    sink.endTerm();
+    if (order <= 0) older->next();
+    if (order >= 0) newer->next();
+  }
+
+  older->in.close();
+  newer->in.close();
+  return !older->error && !newer->error;
+}
+}  // namespace
+
+SearchIndex::SearchIndex(std::string path) : path(std::move(path)) {}
+
+SearchIndex::~SearchIndex() { close(); }
+
+void SearchIndex::splitTerms(const std::string& text, const std::function<void(const std::string& term)>& onTerm) {
+  std::string term;
+  appendTerms(text.data(), text.size(), term, onTerm);
+  if (!term.empty()) {
+    onTerm(term);
+  }
+}
+
+bool SearchIndex::open(const Layout& layout, const uint16_t spineCount) {
+  close();
+  if (!Storage.exists(path.c_str())) {
+    return false;
+  }
+  dictionary.reset(new SearchIndexFileReader());
+  postings.reset(new SearchIndexFileReader());
+  if (!dictionary->open(path) || !postings->open(path)) {
+    close();
+    return false;
+  }
+
+  Header header;
+  if (!readHeader(*dictionary, header) || !sameLayout(header.layout, layout) || header.spineCount != spineCount) {
+    close();
+    LOG_DBG("SRC", "Search index is stale, removing it");
+    Storage.remove(path.c_str());
+    return false;
+  }
+
+  pageCounts.resize(spineCount);
+  uint32_t pages = 0;
+  for (auto& count : pageCounts) {
+    if (!dictionary->readPod(count)) {
+      close();
+      return false;
+    }
+    pages += count;
+  }
+  if (pages != header.totalPages) {
+    close();
+    LOG_ERR("SRC", "Search index page counts are inconsistent");
+    return false;
+  }
+  totalPages = header.totalPages;
+  termCount = header.termCount;
+  blockCount = header.blockCount;
+  blockTableOffset = header.blockTableOffset;
+  return true;
+}
+
+void SearchIndex::close() {
+  if (dictionary) {
+    dictionary->close();
+    dictionary.reset();
+  }
+  if (postings) {
+    postings->close();
+    postings.reset();
+  }
+  pageCounts.clear();
+  totalPages = termCount = blockCount = blockTableOffset = 0;
+}
+
+bool SearchIndex::readBlockHead(const uint32_t block, uint32_t& dictOffset, uint32_t& postingsOffset) {
+  return dictionary->seek(blockTableOffset + block * 2 * sizeof(uint32_t)) && dictionary->readPod(dictOffset) &&
+         dictionary->readPod(postingsOffset);
+}
+
+bool SearchIndex::markPages(const std::string& prefix, std::vector<uint8_t>& pages) {
+  if (blockCount == 0) {
+    return true;
+  }
+
+  // Terms starting with the prefix begin in the last block whose first term sorts before it
+  uint32_t start = 0;
+  uint32_t low = 0;
+  uint32_t high = blockCount;
+  std::string head;
+  while (low < high) {
+    const uint32_t mid = low + (high - low) / 2;
+    uint32_t dictOffset, postingsOffset;
+    uint8_t length;
+    if (!readBlockHead(mid, dictOffset, postingsOffset) || !dictionary->seek(dictOffset) || !dictionary->get(length)) {
+      return false;
+    }
+    head.resize(length);
+    if (!dictionary->read(&head[0], length)) {
+      return false;
+    }
+    if (head < prefix) {
+      start = mid;
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  // Blocks and postings are both stored in term order, so the scan reads on from the start block
+  uint32_t dictOffset, postingsOffset;
+  if (!readBlockHead(start, dictOffset, postingsOffset) || !dictionary->seek(dictOffset)) {
+    return false;
+  }
+  std::string term;
+  for (uint32_t index = start * kBlockTerms; index < termCount; index++) {
+    uint8_t shared = 0;
+    uint8_t length;
+    if ((index % kBlockTerms != 0 && !dictionary->get(shared)) || !dictionary->get(length) || shared > term.size()) {
+      return false;
+    }
+    term.resize(shared + length);
+    uint32_t pageCount, postingsBytes;
+    if (!dictionary->read(&term[shared], length) || !dictionary->readVarint(pageCount) ||
+        !dictionary->readVarint(postingsBytes)) {
+      return false;
+    }
+
+    if (term.compare(0, prefix.size(), prefix) == 0) {
+      if (!postings->seek(postingsOffset)) {
+        return false;
+      }
+      uint32_t page = 0;
+      for (uint32_t i = 0; i < pageCount; i++) {
+        uint32_t delta;
+        if (!postings->readVarint(delta)) {
+          return false;
+        }
+        page += delta;
+        if (page < totalPages) {
+          pages[page / 8] |= static_cast<uint8_t>(1 << (page % 8));
+        }
+      }
+    } else if (term > prefix) {
+      break;
+    }
+    postingsOffset += postingsBytes;
+  }
+  return true;
+}
+
+bool SearchIndex::query(const std::string& query, std::vector<Location>& results, const size_t maxResults) {
+  results.clear();
+  std::vector<std::string> words;
+  splitTerms(query, [&words](const std::string& term) {
+    if (std::find(words.begin(), words.end(), term) == words.end()) {
+      words.push_back(term);
+    }
+  });
+  if (words.empty() || !dictionary) {
+    return false;
+  }
+
+  // One bit per page of the book: pages holding every word survive the AND
+  std::vector<uint8_t> matched((totalPages + 7) / 8, 0xFF);
+  std::vector<uint8_t> wordPages(matched.size());
+  for (const auto& word : words) {
+    std::fill(wordPages.begin(), wordPages.end(), 0);
+    if (!markPages(word, wordPages)) {
+      LOG_ERR("SRC", "Search index read failed");
+      return false;
+    }
+    for (size_t i = 0; i < matched.size(); i++) {
+      matched[i] &= wordPages[i];
+    }
+  }
+
+  uint32_t page = 0;
+  for (uint16_t spineIndex = 0; spineIndex < pageCounts.size(); spineIndex++) {
+    for (uint16_t chapterPage = 0; chapterPage < pageCounts[spineIndex]; chapterPage++, page++) {
+      if (matched[page / 8] & (1 << (page % 8))) {
+        if (results.size() >= maxResults) {
+          return true;
+        }
+        results.push_back({spineIndex, chapterPage});
+      }
+    }
+  }
+  return true;
+}
+
+SearchIndexBuilder::SearchIndexBuilder(std::string path, const SearchIndex::Layout& layout, const uint16_t spineCount)
+    : path(std::move(path)), layout(layout), spineCount(spineCount) {
+  pageCounts.reserve(spineCount);
+  terms.reserve(kBatchBytes / 2);
+  entries.reserve(kBatchBytes / 2 / sizeof(Entry));
+}
+
+SearchIndexBuilder::~SearchIndexBuilder() { removeRuns(); }
+
+std::string SearchIndexBuilder::runPath(const uint32_t id) const { return path + ".run" + std::to_string(id); }
+
+void SearchIndexBuilder::addTerm(const std::string& term) {
+  entries.push_back({static_cast<uint32_t>(terms.size()), page});
+  terms.append(term.c_str(), term.size() + 1);
+}
+
+void SearchIndexBuilder::addWord(const std::string& word, const bool lastInLine) {
+  const auto onTerm = [this](const std::string& term) { addTerm(term); };
+  if (lastInLine && word.size() > 1 && word.back() == '-') {
+    // The layout hyphenated this word; it carries on at the start of the next line
+    appendTerms(word.data(), word.size() - 1, pendingTerm, onTerm);
+    return;
+  }
+  appendTerms(word.data(), word.size(), pendingTerm, onTerm);
+  if (!pendingTerm.empty()) {
+    addTerm(pendingTerm);
+    pendingTerm.clear();
+  }
+}
+
+bool SearchIndexBuilder::endPage() {
+  // A word hyphenated across a page break is indexed on the page where it starts
+  if (!pendingTerm.empty()) {
+    addTerm(pendingTerm);
+    pendingTerm.clear();
+  }
+
+  // Keep each of the page's terms once, and pack them so the dropped repeats give their bytes back
+  const auto pageBegin = entries.begin() + static_cast<std::ptrdiff_t>(pageFirstEntry);
+  if (pageBegin != entries.end()) {
+    const size_t pageFirstByte = pageBegin->term;
+    const char* base = terms.c_str();
+    std::sort(pageBegin, entries.end(),
+              [base](const Entry& a, const Entry& b) { return strcmp(base + a.term, base + b.term) < 0; });
+    const auto sameTerm = [base](const Entry& a, const Entry& b) { return strcmp(base + a.term, base + b.term) == 0; };
+    entries.erase(std::unique(pageBegin, entries.end(), sameTerm), entries.end());
+
+    std::string packed;
+    for (auto it = entries.begin() + static_cast<std::ptrdiff_t>(pageFirstEntry); it != entries.end(); ++it) {
+      const char* term = base + it->term;
+      it->term = static_cast<uint32_t>(pageFirstByte + packed.size());
+      packed.append(term, strlen(term) + 1);
+    }
+    terms.resize(pageFirstByte);
+    terms += packed;
+  }
+
+  page++;
+  pageFirstEntry = entries.size();
+  if (terms.size() + entries.size() * sizeof(Entry) >= kBatchBytes) {
+    flushBatch();
+  }
+  return !failed;
+}
+
+void SearchIndexBuilder::endChapter() {
+  if (pageCounts.size() < spineCount) {
+    pageCounts.push_back(static_cast<uint16_t>(page - chapterFirstPage));
+  }
+  chapterFirstPage = page;
+}
+
+void SearchIndexBuilder::flushBatch() {
+  if (failed || entries.empty()) {
+    terms.clear();
+    entries.clear();
+    pageFirstEntry = 0;
+    return;
+  }
+
+  // Stable, so each term's pages stay in reading order
+  const char* base = terms.c_str();
+  std::stable_sort(entries.begin(), entries.end(),
+                   [base](const Entry& a, const Entry& b) { return strcmp(base + a.term, base + b.term) < 0; });
+
+  Run run{nextRunId++, 0};
+  std::unique_ptr<RunWriter> writer(new RunWriter());
+  failed = !writer->out.open(runPath(run.id));
+  std::string term;
+  for (size_t i = 0; !failed && i < entries.size();) {
+    size_t end = i + 1;
+    while (end < entries.size() && strcmp(base + entries[end].term, base + entries[i].term) == 0) {
+      end++;
+    }
+    term = base + entries[i].term;
+    writer->beginTerm(term, static_cast<uint32_t>(end - i));
+    for (; i < end; i++) {
+      writer->addPage(entries[i].page);
+    }
+    writer->endTerm();
+  }
+  run.bytes = writer->out.position();
+  failed = !writer->out.close() || failed;
+  runs.push_back(run);
+
+  terms.clear();
+  entries.clear();
+  pageFirstEntry = 0;
+
+  // Merge runs of similar size as they pile up, so each page is rewritten only a logarithmic number of times
+  while (!failed && runs.size() >= 2 && runs[runs.size() - 2].bytes <= 2 * runs.back().bytes) {
+    failed = !mergeTopRuns();
+  }
+}
+
+bool SearchIndexBuilder::mergeTopRuns() {
+  const Run newer = runs.back();
+  runs.pop_back();
+  const Run older = runs.back();
+  runs.pop_back();
+
+  Run merged{nextRunId++, 0};
+  std::unique_ptr<RunWriter> writer(new RunWriter());
+  bool ok = writer->out.open(runPath(merged.id)) && mergeRuns(runPath(older.id), runPath(newer.id), *writer);
+  merged.bytes = writer->out.position();
+  ok = writer->out.close() && ok;
+  Storage.remove(runPath(older.id).c_str());
+  Storage.remove(runPath(newer.id).c_str());
+  if (!ok) {
+    LOG_ERR("SRC", "Failed to merge search index runs");
+    Storage.remove(runPath(merged.id).c_str());
+    return false;
+  }
+  runs.push_back(merged);
+  return true;
+}
+
+void SearchIndexBuilder::removeRuns() {
+  for (const auto& run : runs) {
+    Storage.remove(runPath(run.id).c_str());
+  }
+  runs.clear();
+}
+
+bool SearchIndexBuilder::finish(Stats& stats) {
+  flushBatch();
+  while (!failed && runs.size() > 2) {
+    failed = !mergeTopRuns();
+  }
+  if (failed) {
+    removeRuns();
+    return false;
+  }
+  pageCounts.resize(spineCount, 0);
+
+  const std::string tmpPath = path + ".tmp";
+  const std::string dictionaryPath = path + ".dict";
+  std::unique_ptr<IndexWriter> writer(new IndexWriter());
+  writer->header.layout = layout;
+  writer->header.spineCount = spineCount;
+  writer->header.totalPages = page;
+
+  bool ok = writer->out.open(tmpPath) && writer->dictionary.open(dictionaryPath);
+  if (ok) {
+    writeHeader(writer->out, writer->header);
+    for (const uint16_t count : pageCounts) {
+      writer->out.writePod(count);
+    }
+    ok = mergeRuns(runs.empty() ? std::string() : runPath(runs[0].id),
+                   runs.size() < 2 ? std::string() : runPath(runs[1].id), *writer);
+  }
+  removeRuns();
+  ok = writer->dictionary.close() && ok;
+
+  // Append the dictionary and the block table behind the postings
+  const uint32_t dictionaryStart = writer->out.position();
+  if (ok) {
+    std::unique_ptr<SearchIndexFileReader> dictionary(new SearchIndexFileReader());
+    ok = dictionary->open(dictionaryPath);
+    uint8_t byte;
+    while (ok && dictionary->get(byte)) {
+      writer->out.put(byte);
+    }
+    dictionary->close();
+  }
+  Storage.remove(dictionaryPath.c_str());
+
+  writer->header.blockCount = static_cast<uint32_t>(writer->blockHeads.size() / 2);
+  writer->header.blockTableOffset = writer->out.position();
+  for (size_t i = 0; i < writer->blockHeads.size(); i += 2) {
+    writer->out.writePod(dictionaryStart + writer->blockHeads[i]);
+    writer->out.writePod(writer->blockHeads[i + 1]);
+  }
+  const uint32_t fileSize = writer->out.position();
+  writer->out.rewind();
+  writeHeader(writer->out, writer->header);
+  ok = writer->out.close() && ok;
+
+  if (ok) {
+    Storage.remove(path.c_str());
+    FsFile tmpFile = Storage.open(tmpPath.c_str(), O_RDWR);
+    ok = tmpFile && tmpFile.rename(path.c_str());
+    if (tmpFile) tmpFile.close();
+  }
+  if (!ok) {
+    LOG_ERR("SRC", "Failed to write search index");
+    Storage.remove(tmpPath.c_str());
+    return false;
+  }
+
+  stats.terms = writer->header.termCount;
+  stats.postings = writer->header.postingCount;
+  stats.pages = page;
+  stats.bytes = fileSize;
+  return true;
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <HalStorage.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class SearchIndexFileReader;
+
+// Optional per-book inverted index of the words on each page, for instant search in long books. It is built from the
+// section caches, so its pages are only valid for the layout those were built with: the index stores the same layout
+// parameters and section file version as a section file and is discarded as soon as they no longer match.
+//
+// Terms are folded like TextMatcher folds text, split on anything that isn't a letter or digit and cut to
+// kMaxTermBytes. The sorted term dictionary is front-coded in blocks of kBlockTerms behind a block table, so a lookup
+// is a binary search over block heads followed by a short sequential scan. Each term's postings are the pages it
+// appears on, numbered across the whole book and delta/varint encoded.
+class SearchIndex {
+ public:
+  static constexpr size_t kMaxTermBytes = 24;
+  static constexpr uint32_t kBlockTerms = 16;
+
+  // Section layout parameters, as passed to Section::loadSectionFile()
+  struct Layout {
+    int fontId = 0;
+    float lineCompression = 1.0f;
+    bool extraParagraphSpacing = false;
+    uint8_t paragraphAlignment = 0;
+    uint16_t viewportWidth = 0;
+    uint16_t viewportHeight = 0;
+    bool hyphenationEnabled = false;
+    bool embeddedStyle = false;
+  };
+
+  struct Location {
+    uint16_t spineIndex;
+    uint16_t page;
+  };
+
+  explicit SearchIndex(std::string path);
+  ~SearchIndex();
+
+  // Opens the index if it was built for this layout and spine; a stale index is deleted.
+  bool open(const Layout& layout, uint16_t spineCount);
+  void close();
+  uint32_t getTermCount() const { return termCount; }
+  uint16_t getPageCount(const int spineIndex) const { return pageCounts[spineIndex]; }
+
+  // Fills `results` with the pages, in reading order, that contain a word beginning with each word of the query.
+  // Returns false if the query has no words.
+  bool query(const std::string& query, std::vector<Location>& results, size_t maxResults);
+
+  // Splits text into folded search terms.
+  static void splitTerms(const std::string& text, const std::function<void(const std::string& term)>& onTerm);
+
+ private:
+  std::string path;
+  std::unique_ptr<SearchIndexFileReader> dictionary;
+  std::unique_ptr<SearchIndexFileReader> postings;
+  std::vector<uint16_t> pageCounts;
+  uint32_t totalPages = 0;
+  uint32_t termCount = 0;
+  uint32_t blockCount = 0;
+  uint32_t blockTableOffset = 0;
+
+  bool readBlockHead(uint32_t block, uint32_t& dictOffset, uint32_t& postingsOffset);
+  // Sets the bit of every page holding a term that starts with `prefix`
+  bool markPages(const std::string& prefix, std::vector<uint8_t>& pages);
+};
+
+// Builds search.idx from the words of every page, fed in reading order. Terms are gathered in memory up to
+// kBatchBytes, written out as a sorted run, and runs of similar size are merged as they accumulate; the last merge
+// writes the index itself. Peak memory stays around kBatchBytes whatever the size of the book.
+class SearchIndexBuilder {
+ public:
+  static constexpr size_t kBatchBytes = 32 * 1024;
+
+  struct Stats {
+    uint32_t terms = 0;
+    uint32_t postings = 0;
+    uint32_t pages = 0;
+    uint32_t bytes = 0;
+  };
+
+  SearchIndexBuilder(std::string path, const SearchIndex::Layout& layout, uint16_t spineCount);
+  ~SearchIndexBuilder();
+
+  // Adds a word of the current page; `lastInLine` as passed by Section::visitPageText, so words hyphenated at the end
+  // of a line are joined back up.
+  void addWord(const std::string& word, bool lastInLine);
+  // Returns false once the index can't be written.
+  bool endPage();
+  // Chapters must be ended in spine order, including ones that couldn't be read (with no pages).
+  void endChapter();
+  // Writes the index; on failure nothing is left behind.
+  bool finish(Stats& stats);
+
+ private:
+  struct Entry {
+    uint32_t term;  // Offset of the NUL-terminated term in `terms`
+    uint32_t page;
+  };
+  struct Run {
+    uint32_t id;
+    uint32_t bytes;
+  };
+
+  std::string path;
+  SearchIndex::Layout layout;
+  uint16_t spineCount;
+  std::vector<uint16_t> pageCounts;
+  uint32_t page = 0;
+  uint32_t chapterFirstPage = 0;
+
+  std::string terms;
+  std::vector<Entry> entries;
+  size_t pageFirstEntry = 0;
+  std::string pendingTerm;
+
+  std::vector<Run> runs;
+  uint32_t nextRunId = 0;
+  bool failed = false;
+
+  void addTerm(const std::string& term);
+  void flushBatch();
+  std::string runPath(uint32_t id) const;
+  bool mergeTopRuns();
+  void removeRuns();
+};
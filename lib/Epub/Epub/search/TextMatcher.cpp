@@ -0,0 +1,248 @@
+#include "TextMatcher.h"
+
+#include <cstring>
+
+#include "../hyphenation/HyphenationCommon.h"
+
+namespace {
+constexpr uint32_t DROPPED = 0;
+
+struct AsciiFoldTable {
+  uint8_t folded[128];
+
+  constexpr AsciiFoldTable() : folded() {
+    for (int c = 0; c < 128; c++) {
+      folded[c] = (c <= ' ' || c == 0x7F) ? ' ' : (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+  }
+};
+// Control characters and whitespace fold to ' ', capitals to lowercase
+constexpr AsciiFoldTable ASCII_FOLD;
+}  // namespace
+
+uint32_t TextMatcher::foldCodepoint(const uint32_t cp) {
+  switch (cp) {
+    case 0x00A0:  // no-break space
+    case 0x1680:
+    case 0x202F:  // narrow no-break space
+    case 0x205F:
+    case 0x3000:
+      return ' ';
+    case 0x00AD:  // soft hyphen
+    case 0x200B:  // zero-width space
+    case 0x200C:
+    case 0x200D:
+    case 0x2060:  // word joiner
+    case 0xFEFF:
+      return DROPPED;
+    case 0x2018:
+    case 0x2019:
+    case 0x201B:
+    case 0x02BC:
+      return '\'';
+    case 0x201C:
+    case 0x201D:
+    case 0x201F:
+      return '"';
+    default:
+      break;
+  }
+  if (cp >= 0x2000 && cp <= 0x200A) {  // en/em/thin spaces, including the em-space paragraph indent
+    return ' ';
+  }
+  return toLowerExtended(cp);
+}
+
+TextMatcher::TextMatcher(const std::string& query) {
+  // Fold the query through the same path as the text, then take it over as the pattern
+  feed(query);
+  size_t length = windowLength;
+  if (length > 0 && window[length - 1] == ' ') {
+    length--;
+  }
+  if (length > kMaxPatternBytes) {
+    length = kMaxPatternBytes;
+    // Don't cut a multi-byte codepoint in half
+    while (length > 0 && (window[length] & 0xC0) == 0x80) {
+      length--;
+    }
+  }
+  memcpy(pattern, window, length);
+  patternLength = length;
+  reset();
+
+  for (auto& distance : skip) {
+    distance = static_cast<uint8_t>(patternLength);
+  }
+  for (size_t i = 0; i + 1 < patternLength; i++) {
+    skip[pattern[i]] = static_cast<uint8_t>(patternLength - 1 - i);
+  }
+}
+
+void TextMatcher::reset() {
+  windowLength = 0;
+  searchFrom = 0;
+  pendingMatches = 0;
+  partialCodepoint = 0;
+  partialRemaining = 0;
+  lastWasSpace = true;
+}
+
+void TextMatcher::shiftWindow() {
+  scan();
+  // Keep enough tail for a match that straddles the boundary
+  const size_t keep = patternLength > 0 ? patternLength - 1 : 0;
+  const size_t dropped = windowLength - keep;
+  memmove(window, window + dropped, keep);
+  windowLength = keep;
+  searchFrom = searchFrom > dropped ? searchFrom - dropped : 0;
+}
+
+void TextMatcher::appendCodepoint(uint32_t cp) {
+  if (cp >= 0x80) {
+    cp = foldCodepoint(cp);
+    if (cp == DROPPED) {
+      return;
+    }
+  }
+  if (cp == ' ') {
+    if (!lastWasSpace) {
+      if (windowLength == kWindowBytes) {
+        shiftWindow();
+      }
+      window[windowLength++] = ' ';
+      lastWasSpace = true;
+    }
+    return;
+  }
+  lastWasSpace = false;
+
+  uint8_t encoded[4];
+  size_t length;
+  if (cp < 0x80) {
+    encoded[0] = static_cast<uint8_t>(cp);
+    length = 1;
+  } else if (cp < 0x800) {
+    encoded[0] = static_cast<uint8_t>(0xC0 | (cp >> 6));
+    encoded[1] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    length = 2;
+  } else if (cp < 0x10000) {
+    encoded[0] = static_cast<uint8_t>(0xE0 | (cp >> 12));
+    encoded[1] = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+    encoded[2] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    length = 3;
+  } else {
+    encoded[0] = static_cast<uint8_t>(0xF0 | (cp >> 18));
+    encoded[1] = static_cast<uint8_t>(0x80 | ((cp >> 12) & 0x3F));
+    encoded[2] = static_cast<uint8_t>(0x80 | ((cp >> 6) & 0x3F));
+    encoded[3] = static_cast<uint8_t>(0x80 | (cp & 0x3F));
+    length = 4;
+  }
+  if (windowLength + length > kWindowBytes) {
+    shiftWindow();
+  }
+  memcpy(window + windowLength, encoded, length);
+  windowLength += length;
+}
+
+void TextMatcher::feed(const char* data, const size_t length) {
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+  size_t i = 0;
+  while (i < length) {
+    // ASCII fast path: most book text never leaves it. State is kept in locals because byte stores into the window
+    // would otherwise force the compiler to reload every member on each iteration.
+    if (partialRemaining == 0) {
+      size_t fill = windowLength;
+      bool space = lastWasSpace;
+      for (; i < length && bytes[i] < 0x80; i++) {
+        const uint8_t folded = ASCII_FOLD.folded[bytes[i]];
+        const bool isSpace = folded == ' ';
+        if (isSpace && space) {
+          continue;
+        }
+        space = isSpace;
+        if (fill == kWindowBytes) {
+          windowLength = fill;
+          shiftWindow();
+          fill = windowLength;
+        }
+        window[fill++] = folded;
+      }
+      windowLength = fill;
+      lastWasSpace = space;
+      if (i == length) {
+        break;
+      }
+    }
+
+    const uint8_t byte = bytes[i];
+    if ((byte & 0xC0) == 0x80) {
+      i++;
+      if (partialRemaining == 0) {
+        continue;  // Stray continuation byte
+      }
+      partialCodepoint = (partialCodepoint << 6) | (byte & 0x3F);
+      if (--partialRemaining == 0) {
+        appendCodepoint(partialCodepoint);
+      }
+      continue;
+    }
+
+    // Anything else ends an unfinished sequence, which is dropped
+    partialRemaining = 0;
+    if (byte < 0x80) {
+      continue;  // Picked up by the fast path
+    }
+    i++;
+    if ((byte & 0xE0) == 0xC0) {
+      partialCodepoint = byte & 0x1F;
+      partialRemaining = 1;
+    } else if ((byte & 0xF0) == 0xE0) {
+      partialCodepoint = byte & 0x0F;
+      partialRemaining = 2;
+    } else if ((byte & 0xF8) == 0xF0) {
+      partialCodepoint = byte & 0x07;
+      partialRemaining = 3;
+    }
+  }
+}
+
+void TextMatcher::feedCodepoint(const uint32_t cp) {
+  if (cp < 0x80) {
+    const char c = static_cast<char>(cp);
+    feed(&c, 1);
+    return;
+  }
+  partialRemaining = 0;
+  appendCodepoint(cp);
+}
+
+void TextMatcher::feedSeparator() { appendCodepoint(' '); }
+
+void TextMatcher::scan() {
+  const size_t m = patternLength;
+  if (m == 0 || windowLength < m) {
+    return;
+  }
+
+  size_t pos = searchFrom;
+  const uint8_t lastPatternByte = pattern[m - 1];
+  while (pos + m <= windowLength) {
+    const uint8_t last = window[pos + m - 1];
+    if (last == lastPatternByte && memcmp(window + pos, pattern, m - 1) == 0) {
+      pendingMatches++;
+      pos += m;
+    } else {
+      pos += skip[last];
+    }
+  }
+  // Skipped starts were ruled out by bytes already in the window, so the next scan resumes here
+  searchFrom = pos;
+}
+
+size_t TextMatcher::takeMatches() {
+  scan();
+  const size_t matches = pendingMatches;
+  pendingMatches = 0;
+  return matches;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Case-insensitive substring matcher over streamed UTF-8 text, used by in-book search. Text and query are folded the
+// same way: Latin, Greek and Cyrillic letters are lowercased, runs of whitespace (including no-break and em spaces)
+// collapse to one space, soft hyphens and zero-width characters are dropped and curly quotes become ASCII, so "don't"
+// finds "Don’t" across a line break.
+//
+// Folded bytes go into a fixed window that is scanned with Boyer-Moore-Horspool whenever it fills or matches are
+// collected; the last pattern-length bytes carry over so matches spanning feeds are found. Memory use is constant.
+// UTF-8 is self-synchronising, so a byte match of a folded pattern always starts on a codepoint boundary.
+class TextMatcher {
+ public:
+  static constexpr size_t kMaxPatternBytes = 64;
+  static constexpr size_t kWindowBytes = 2048;
+
+  explicit TextMatcher(const std::string& query);
+
+  // Maps a non-ASCII codepoint to its folded form: ' ' for whitespace, 0 for characters search ignores.
+  static uint32_t foldCodepoint(uint32_t cp);
+
+  // False if the query folds to nothing (empty or whitespace only).
+  bool isValid() const { return patternLength > 0; }
+
+  // Appends text; a codepoint split across calls is completed by the next call.
+  void feed(const char* data, size_t length);
+  void feed(const std::string& text) { feed(text.data(), text.size()); }
+  // Appends a single decoded codepoint, e.g. from a character reference.
+  void feedCodepoint(uint32_t cp);
+  // Appends a word boundary (equivalent to feeding a space).
+  void feedSeparator();
+
+  // Returns the number of matches completed since the previous call, scanning anything still buffered.
+  size_t takeMatches();
+
+  // Forgets buffered text, e.g. between chapters.
+  void reset();
+
+ private:
+  uint8_t pattern[kMaxPatternBytes] = {};
+  size_t patternLength = 0;
+  uint8_t skip[256] = {};
+
+  uint8_t window[kWindowBytes] = {};
+  size_t windowLength = 0;
+  // Window offset of the first match start not yet ruled out.
+  size_t searchFrom = 0;
+  size_t pendingMatches = 0;
+
+  uint32_t partialCodepoint = 0;
+  uint8_t partialRemaining = 0;
+  bool lastWasSpace = true;
+
+  void appendCodepoint(uint32_t cp);
+  void shiftWindow();
+  void scan();
+};
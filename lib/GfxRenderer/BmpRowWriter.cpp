@@ -0,0 +1,238 @@
+#include "BmpRowWriter.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "BitmapHelpers.h"
+
+// ============================================================================
+// IMAGE PROCESSING OPTIONS - Toggle these to test different configurations
+// ============================================================================
+constexpr bool USE_8BIT_OUTPUT = false;  // true: 8-bit grayscale (no quantization), false: 2-bit (4 levels)
+// Dithering method selection (only one should be true, or all false for simple quantization):
+constexpr bool USE_ATKINSON = true;          // Atkinson dithering (cleaner than F-S, less error diffusion)
+constexpr bool USE_FLOYD_STEINBERG = false;  // Floyd-Steinberg error diffusion (can cause "worm" artifacts)
+// ============================================================================
+
+namespace {
+inline void write16(Print& out, const uint16_t value) {
+  out.write(value & 0xFF);
+  out.write((value >> 8) & 0xFF);
+}
+
+inline void write32(Print& out, const uint32_t value) {
+  out.write(value & 0xFF);
+  out.write((value >> 8) & 0xFF);
+  out.write((value >> 16) & 0xFF);
+  out.write((value >> 24) & 0xFF);
+}
+
+inline void write32Signed(Print& out, const int32_t value) {
+  out.write(value & 0xFF);
+  out.write((value >> 8) & 0xFF);
+  out.write((value >> 16) & 0xFF);
+  out.write((value >> 24) & 0xFF);
+}
+
+// Writes the file and DIB headers for a top-down BMP followed by a grayscale palette of `colors` entries
+void writeBmpHeader(Print& bmpOut, const int width, const int height, const int bitsPerPixel, const int bytesPerRow) {
+  const int colors = 1 << bitsPerPixel;
+  const uint32_t paletteSize = colors * 4;
+  const uint32_t imageSize = bytesPerRow * height;
+  const uint32_t dataOffset = 14 + 40 + paletteSize;
+
+  // BMP File Header (14 bytes)
+  bmpOut.write('B');
+  bmpOut.write('M');
+  write32(bmpOut, dataOffset + imageSize);  // File size
+  write32(bmpOut, 0);                       // Reserved
+  write32(bmpOut, dataOffset);              // Offset to pixel data
+
+  // DIB Header (BITMAPINFOHEADER - 40 bytes)
+  write32(bmpOut, 40);
+  write32Signed(bmpOut, width);
+  write32Signed(bmpOut, -height);  // Negative height = top-down bitmap
+  write16(bmpOut, 1);              // Color planes
+  write16(bmpOut, bitsPerPixel);
+  write32(bmpOut, 0);  // BI_RGB (no compression)
+  write32(bmpOut, imageSize);
+  write32(bmpOut, 2835);  // xPixelsPerMeter (72 DPI)
+  write32(bmpOut, 2835);  // yPixelsPerMeter (72 DPI)
+  write32(bmpOut, colors);
+  write32(bmpOut, colors);
+
+  // Evenly spaced grays, BGRA: 1-bit is black/white, 2-bit is black, dark gray (85), light gray (170), white
+  for (int i = 0; i < colors; i++) {
+    const auto level = static_cast<uint8_t>(i * 255 / (colors - 1));
+    bmpOut.write(level);
+    bmpOut.write(level);
+    bmpOut.write(level);
+    bmpOut.write(static_cast<uint8_t>(0));
+  }
+}
+}  // namespace
+
+BmpRowWriter::BmpRowWriter(const BmpOutputSpec& spec, const int srcWidth, const int srcHeight)
+    : spec(spec), srcWidth(srcWidth), outWidth(srcWidth), outHeight(srcHeight) {
+  const int targetWidth = spec.targetWidth;
+  const int targetHeight = spec.targetHeight;
+  if (targetWidth > 0 && targetHeight > 0 && (srcWidth > targetWidth || srcHeight > targetHeight)) {
+    // Calculate scale to fit within target dimensions while maintaining aspect ratio
+    const float scaleToFitWidth = static_cast<float>(targetWidth) / srcWidth;
+    const float scaleToFitHeight = static_cast<float>(targetHeight) / srcHeight;
+    // When cropping, scale to the smaller dimension so the image fills the target; otherwise fit inside it
+    const float scale = spec.crop ? (scaleToFitWidth > scaleToFitHeight ? scaleToFitWidth : scaleToFitHeight)
+                                  : (scaleToFitWidth < scaleToFitHeight ? scaleToFitWidth : scaleToFitHeight);
+
+    outWidth = static_cast<int>(srcWidth * scale);
+    outHeight = static_cast<int>(srcHeight * scale);
+
+    // Ensure at least 1 pixel
+    if (outWidth < 1) outWidth = 1;
+    if (outHeight < 1) outHeight = 1;
+
+    scaleX_fp = (static_cast<uint32_t>(srcWidth) << 16) / outWidth;
+    scaleY_fp = (static_cast<uint32_t>(srcHeight) << 16) / outHeight;
+    needsScaling = true;
+
+    LOG_DBG("BMP", "Pre-scaling %dx%d -> %dx%d (%s %dx%d)", srcWidth, srcHeight, outWidth, outHeight,
+            spec.crop ? "fill" : "fit", targetWidth, targetHeight);
+  }
+}
+
+BmpRowWriter::~BmpRowWriter() {
+  free(rowBuffer);
+  free(scaledRow);
+  delete[] rowAccum;
+  delete[] rowCount;
+  delete atkinsonDitherer;
+  delete fsDitherer;
+  delete atkinson1BitDitherer;
+}
+
+bool BmpRowWriter::begin() {
+  int bitsPerPixel;
+  if (USE_8BIT_OUTPUT && !spec.oneBit) {
+    bitsPerPixel = 8;
+    bytesPerRow = (outWidth + 3) / 4 * 4;
+  } else if (spec.oneBit) {
+    bitsPerPixel = 1;
+    bytesPerRow = (outWidth + 31) / 32 * 4;  // 1 bit per pixel, round up to 4-byte boundary
+  } else {
+    bitsPerPixel = 2;
+    bytesPerRow = (outWidth * 2 + 31) / 32 * 4;
+  }
+
+  rowBuffer = static_cast<uint8_t*>(malloc(bytesPerRow));
+  if (needsScaling) {
+    scaledRow = static_cast<uint8_t*>(malloc(outWidth));
+    rowAccum = new (std::nothrow) uint32_t[outWidth]();
+    rowCount = new (std::nothrow) uint16_t[outWidth]();
+    nextOutY_srcStart = scaleY_fp;  // First boundary is at scaleY_fp (source Y for outY=1)
+  }
+  if (!rowBuffer || (needsScaling && (!scaledRow || !rowAccum || !rowCount))) {
+    LOG_ERR("BMP", "Failed to allocate row buffers for %dx%d output", outWidth, outHeight);
+    return false;
+  }
+
+  // Dithering runs on output dimensions (after prescaling)
+  if (spec.oneBit) {
+    // For 1-bit output, use Atkinson dithering for better quality
+    atkinson1BitDitherer = new Atkinson1BitDitherer(outWidth);
+  } else if (!USE_8BIT_OUTPUT) {
+    if (USE_ATKINSON) {
+      atkinsonDitherer = new AtkinsonDitherer(outWidth);
+    } else if (USE_FLOYD_STEINBERG) {
+      fsDitherer = new FloydSteinbergDitherer(outWidth);
+    }
+  }
+
+  writeBmpHeader(*spec.out, outWidth, outHeight, bitsPerPixel, bytesPerRow);
+  return true;
+}
+
+void BmpRowWriter::pushRow(const uint8_t* gray, const int srcY) {
+  if (!needsScaling) {
+    // No scaling - direct output (1:1 mapping)
+    emitRow(gray, srcY);
+    return;
+  }
+
+  // Fixed-point area averaging: output pixel X covers source range [outX * scaleX_fp >> 16, (outX+1) * scaleX_fp >> 16)
+  for (int outX = 0; outX < outWidth; outX++) {
+    const int srcXStart = (static_cast<uint32_t>(outX) * scaleX_fp) >> 16;
+    const int srcXEnd = (static_cast<uint32_t>(outX + 1) * scaleX_fp) >> 16;
+
+    int sum = 0;
+    int count = 0;
+    for (int srcX = srcXStart; srcX < srcXEnd && srcX < srcWidth; srcX++) {
+      sum += gray[srcX];
+      count++;
+    }
+
+    // Handle edge case: if no pixels in range, use nearest
+    if (count == 0 && srcXStart < srcWidth) {
+      sum = gray[srcXStart];
+      count = 1;
+    }
+
+    rowAccum[outX] += sum;
+    rowCount[outX] += count;
+  }
+
+  // Output a row once the source Y crosses the next boundary
+  const uint32_t srcY_fp = static_cast<uint32_t>(srcY + 1) << 16;
+  if (srcY_fp >= nextOutY_srcStart && currentOutY < outHeight) {
+    for (int x = 0; x < outWidth; x++) {
+      scaledRow[x] = rowCount[x] > 0 ? rowAccum[x] / rowCount[x] : 0;
+    }
+    emitRow(scaledRow, currentOutY);
+    currentOutY++;
+
+    // Reset accumulators for next output row
+    memset(rowAccum, 0, outWidth * sizeof(uint32_t));
+    memset(rowCount, 0, outWidth * sizeof(uint16_t));
+    nextOutY_srcStart = static_cast<uint32_t>(currentOutY + 1) * scaleY_fp;
+  }
+}
+
+void BmpRowWriter::emitRow(const uint8_t* gray, const int outY) {
+  memset(rowBuffer, 0, bytesPerRow);
+
+  if (USE_8BIT_OUTPUT && !spec.oneBit) {
+    for (int x = 0; x < outWidth; x++) {
+      rowBuffer[x] = adjustPixel(gray[x]);
+    }
+  } else if (spec.oneBit) {
+    for (int x = 0; x < outWidth; x++) {
+      const uint8_t bit =
+          atkinson1BitDitherer ? atkinson1BitDitherer->processPixel(gray[x], x) : quantize1bit(gray[x], x, outY);
+      // Pack 1-bit value: MSB first, 8 pixels per byte
+      rowBuffer[x / 8] |= bit << (7 - (x % 8));
+    }
+    if (atkinson1BitDitherer) atkinson1BitDitherer->nextRow();
+  } else {
+    for (int x = 0; x < outWidth; x++) {
+      const uint8_t adjusted = adjustPixel(gray[x]);
+      uint8_t twoBit;
+      if (atkinsonDitherer) {
+        twoBit = atkinsonDitherer->processPixel(adjusted, x);
+      } else if (fsDitherer) {
+        twoBit = fsDitherer->processPixel(adjusted, x);
+      } else {
+        twoBit = quantize(adjusted, x, outY);
+      }
+      rowBuffer[(x * 2) / 8] |= twoBit << (6 - ((x * 2) % 8));
+    }
+    if (atkinsonDitherer)
+      atkinsonDitherer->nextRow();
+    else if (fsDitherer)
+      fsDitherer->nextRow();
+  }
+
+  spec.out->write(rowBuffer, bytesPerRow);
+}
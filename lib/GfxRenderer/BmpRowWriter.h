@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+class Print;
+class AtkinsonDitherer;
+class Atkinson1BitDitherer;
+class FloydSteinbergDitherer;
+
+// One BMP to produce from a decoded image.
+struct BmpOutputSpec {
+  Print* out;
+  int targetWidth;  // Bounding size; images are only ever scaled down
+  int targetHeight;
+  bool oneBit;  // 1-bit output (thumbnails) instead of dithered 2-bit
+  bool crop;    // Scale to fill the target (cropped when drawn) instead of fitting inside it
+};
+
+// Scales, dithers and writes grayscale source rows as a 1- or 2-bit BMP. The JPEG and PNG converters feed each decoded
+// row to one writer per requested output, so a cover and all of its thumbnails come out of a single decode.
+class BmpRowWriter {
+ public:
+  // Default bounding size for full-screen covers (portrait display size)
+  static constexpr int kCoverMaxWidth = 480;
+  static constexpr int kCoverMaxHeight = 800;
+
+  BmpRowWriter(const BmpOutputSpec& spec, int srcWidth, int srcHeight);
+  ~BmpRowWriter();
+
+  BmpRowWriter(const BmpRowWriter&) = delete;
+  BmpRowWriter& operator=(const BmpRowWriter&) = delete;
+
+  // Allocates the working buffers and writes the BMP header. Returns false if memory runs out.
+  bool begin();
+
+  // Consumes one source row of `srcWidth` gray pixels. Rows must arrive top to bottom.
+  void pushRow(const uint8_t* gray, int srcY);
+
+ private:
+  BmpOutputSpec spec;
+  int srcWidth;
+  int outWidth;
+  int outHeight;
+  int bytesPerRow = 0;
+  // 16.16 fixed point source pixels per output pixel
+  uint32_t scaleX_fp = 65536;
+  uint32_t scaleY_fp = 65536;
+  bool needsScaling = false;
+
+  uint8_t* rowBuffer = nullptr;
+  uint32_t* rowAccum = nullptr;  // Sum of source pixels per output X (area averaging)
+  uint16_t* rowCount = nullptr;  // Number of source pixels accumulated per output X
+
+  uint8_t* scaledRow = nullptr;  // Averaged gray values of the output row being emitted
+  int currentOutY = 0;
+  uint32_t nextOutY_srcStart = 0;  // Source Y where the next output row starts (16.16)
+
+  AtkinsonDitherer* atkinsonDitherer = nullptr;
+  FloydSteinbergDitherer* fsDitherer = nullptr;
+  Atkinson1BitDitherer* atkinson1BitDitherer = nullptr;
+
+  // Quantizes `gray` (outWidth pixels) into the BMP pixel format and writes it as output row `outY`
+  void emitRow(const uint8_t* gray, int outY);
+};
@@ -642,13 +642,7 @@ void GfxRenderer::fillPolygon(const int* xPoints, const int* yPoints, int numPoi
   free(nodeX);
 }
 
-// For performance measurement (using static to allow "const" methods)
-static unsigned long start_ms = 0;
-
-void GfxRenderer::clearScreen(const uint8_t color) const {
-  start_ms = millis();
-  display.clearScreen(color);
-}
+void GfxRenderer::clearScreen(const uint8_t color) const { display.clearScreen(color); }
 
 void GfxRenderer::invertScreen() const {
   for (int i = 0; i < HalDisplay::BUFFER_SIZE; i++) {
@@ -657,9 +651,12 @@ void GfxRenderer::invertScreen() const {
 }
 
 void GfxRenderer::displayBuffer(const HalDisplay::RefreshMode refreshMode) const {
-  auto elapsed = millis() - start_ms;
-  LOG_DBG("GFX", "Time = %lu ms from clearScreen to displayBuffer", elapsed);
+  const unsigned long start = millis();
+  if (firstFrameAt == 0) {
+    firstFrameAt = start;
+  }
   display.displayBuffer(refreshMode, fadingFix);
+  panelMs += millis() - start;
 }
 
 std::string GfxRenderer::truncatedText(const int fontId, const char* text, const int maxWidth,
@@ -861,7 +858,14 @@ void GfxRenderer::copyGrayscaleLsbBuffers() const { display.copyGrayscaleLsbBuff
 
 void GfxRenderer::copyGrayscaleMsbBuffers() const { display.copyGrayscaleMsbBuffers(frameBuffer); }
 
-void GfxRenderer::displayGrayBuffer() const { display.displayGrayBuffer(fadingFix); }
+void GfxRenderer::displayGrayBuffer() const {
+  const unsigned long start = millis();
+  if (firstFrameAt == 0) {
+    firstFrameAt = start;
+  }
+  display.displayGrayBuffer(fadingFix);
+  panelMs += millis() - start;
+}
 
 void GfxRenderer::freeBwBufferChunks() {
   for (auto& bwBufferChunk : bwBufferChunks) {
@@ -36,6 +36,8 @@ class GfxRenderer {
   uint8_t* frameBuffer = nullptr;
   uint8_t* bwBufferChunks[BW_BUFFER_NUM_CHUNKS] = {nullptr};
   std::map<int, EpdFontFamily> fontMap;
+  mutable unsigned long firstFrameAt = 0;
+  mutable unsigned long panelMs = 0;
   void renderChar(const EpdFontFamily& fontFamily, uint32_t cp, int* x, const int* y, bool pixelState,
                   EpdFontFamily::Style style) const;
   void freeBwBufferChunks();
@@ -69,6 +71,14 @@ class GfxRenderer {
   int getScreenWidth() const;
   int getScreenHeight() const;
   void displayBuffer(HalDisplay::RefreshMode refreshMode = HalDisplay::FAST_REFRESH) const;
+  // Frames handed to the panel since the last resetFrameTiming(): when the first one was (0 if none) and how long
+  // transferring and refreshing took in total. Used for render latency statistics.
+  void resetFrameTiming() const {
+    firstFrameAt = 0;
+    panelMs = 0;
+  }
+  unsigned long getFirstFrameAt() const { return firstFrameAt; }
+  unsigned long getPanelMs() const { return panelMs; }
   // EXPERIMENTAL: Windowed update - display only a rectangular region
   // void displayWindow(int x, int y, int width, int height) const;
   void invertScreen() const;
@@ -157,6 +157,9 @@ enum class StrId : uint16_t {
   STR_SYNC_SERVER_URL,
   STR_DOCUMENT_MATCHING,
   STR_AUTHENTICATE,
+  STR_HASH_LIBRARY,
+  STR_HASHING,
+  STR_BINARY_MATCHING_ONLY,
   STR_KOREADER_USERNAME,
   STR_KOREADER_PASSWORD,
   STR_FILENAME,
@@ -361,6 +364,19 @@ enum class StrId : uint16_t {
   STR_GOAL_20,
   STR_GOAL_30,
   STR_GOAL_50,
+  STR_SEARCH_BOOK,
+  STR_SEARCH_PROGRESS_FORMAT,
+  STR_SEARCH_MATCHES_FORMAT,
+  STR_NO_MATCHES,
+  STR_SEARCH_PAGE_FORMAT,
+  STR_SEARCH_APPROX_FORMAT,
+  STR_BUILD_SEARCH_INDEX,
+  STR_SEARCH_INDEX_PROGRESS_FORMAT,
+  STR_SEARCH_INDEX_DONE_FORMAT,
+  STR_SEARCH_INDEX_FAILED,
+  STR_LOOKUP_WORD,
+  STR_NO_DICTIONARY,
+  STR_WORD_NOT_FOUND,
   // Sentinel - must be last
   _COUNT
 };
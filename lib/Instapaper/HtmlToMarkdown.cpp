@@ -24,36 +24,27 @@ bool tagStartsWith(const std::string& tag, const char* prefix) {
   return true;
 }
 
-// Decode HTML entity at position, returns decoded char count (0 if not an entity)
-std::string decodeEntity(const std::string& html, size_t pos, size_t& consumed) {
-  if (pos >= html.size() || html[pos] != '&') {
-    consumed = 0;
-    return "";
-  }
-
-  size_t end = html.find(';', pos);
-  if (end == std::string::npos || end - pos > 10) {
-    consumed = 0;
-    return "";
-  }
-
-  std::string entity = html.substr(pos + 1, end - pos - 1);
-  consumed = end - pos + 1;
-
+struct NamedEntity {
+  const char* name;
+  const char* text;
+};
+
+const NamedEntity NAMED_ENTITIES[] = {
+    {"amp", "&"},     {"lt", "<"},      {"gt", ">"},      {"quot", "\""},   {"apos", "'"},     {"nbsp", " "},
+    {"mdash", "--"},  {"#8212", "--"},  {"ndash", "-"},   {"#8211", "-"},   {"lsquo", "'"},    {"#8216", "'"},
+    {"rsquo", "'"},   {"#8217", "'"},   {"ldquo", "\""},  {"#8220", "\""},  {"rdquo", "\""},   {"#8221", "\""},
+    {"hellip", "..."}, {"#8230", "..."},
+};
+
+// Decode the name of an HTML entity (between '&' and ';'), returns false if it isn't one
+bool decodeEntity(const std::string& entity, std::string& decoded) {
   // Named entities
-  if (entity == "amp") return "&";
-  if (entity == "lt") return "<";
-  if (entity == "gt") return ">";
-  if (entity == "quot") return "\"";
-  if (entity == "apos") return "'";
-  if (entity == "nbsp") return " ";
-  if (entity == "mdash" || entity == "#8212") return "--";
-  if (entity == "ndash" || entity == "#8211") return "-";
-  if (entity == "lsquo" || entity == "#8216") return "'";
-  if (entity == "rsquo" || entity == "#8217") return "'";
-  if (entity == "ldquo" || entity == "#8220") return "\"";
-  if (entity == "rdquo" || entity == "#8221") return "\"";
-  if (entity == "hellip" || entity == "#8230") return "...";
+  for (const auto& named : NAMED_ENTITIES) {
+    if (entity == named.name) {
+      decoded = named.text;
+      return true;
+    }
+  }
 
   // Numeric entities
   if (entity.size() > 1 && entity[0] == '#') {
@@ -63,28 +54,24 @@ std::string decodeEntity(const std::string& html, size_t pos, size_t& consumed)
     } else {
       codepoint = atoi(entity.c_str() + 1);
     }
-    if (codepoint > 0 && codepoint < 128) {
-      return std::string(1, static_cast<char>(codepoint));
-    }
-    // For non-ASCII, try UTF-8 encoding
+    // For non-ASCII, use UTF-8 encoding
     if (codepoint > 0) {
-      std::string utf8;
+      decoded.clear();
       if (codepoint < 0x80) {
-        utf8 += static_cast<char>(codepoint);
+        decoded += static_cast<char>(codepoint);
       } else if (codepoint < 0x800) {
-        utf8 += static_cast<char>(0xC0 | (codepoint >> 6));
-        utf8 += static_cast<char>(0x80 | (codepoint & 0x3F));
+        decoded += static_cast<char>(0xC0 | (codepoint >> 6));
+        decoded += static_cast<char>(0x80 | (codepoint & 0x3F));
       } else if (codepoint < 0x10000) {
-        utf8 += static_cast<char>(0xE0 | (codepoint >> 12));
-        utf8 += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
-        utf8 += static_cast<char>(0x80 | (codepoint & 0x3F));
+        decoded += static_cast<char>(0xE0 | (codepoint >> 12));
+        decoded += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+        decoded += static_cast<char>(0x80 | (codepoint & 0x3F));
       }
-      return utf8;
+      return true;
     }
   }
 
-  consumed = 0;
-  return "";
+  return false;
 }
 
 // Extract href attribute from tag content like: a href="http://example.com" class="..."
@@ -114,229 +101,288 @@ std::string extractHref(const std::string& tagContent) {
 
 }  // namespace
 
-std::string HtmlToMarkdown::convert(const std::string& html) {
+namespace HtmlToMarkdown {
+
+std::string convert(const std::string& html) {
   std::string out;
   out.reserve(html.size() / 2);
+  Converter converter([&out](const char* data, size_t length) { out.append(data, length); });
+  converter.feed(html.data(), html.size());
+  converter.finish();
+  return out;
+}
 
-  enum State { TEXT, TAG, SKIP_CONTENT } state = TEXT;
-
-  std::string tagContent;
-  std::string linkHref;
-  std::string linkText;
-  bool inLink = false;
-  bool inBold = false;
-  bool inItalic = false;
-  bool inBlockquote = false;
-  bool skipUntilClose = false;
-  std::string skipTag;
-  bool lastWasNewline = true;  // Start as if we just had a newline
-
-  size_t i = 0;
-  while (i < html.size()) {
-    char c = html[i];
-
-    if (state == SKIP_CONTENT) {
-      // Skip <script> and <style> block contents
-      if (c == '<') {
-        size_t end = html.find('>', i);
-        if (end != std::string::npos) {
-          std::string tag = html.substr(i + 1, end - i - 1);
-          // Remove leading /
-          if (!tag.empty() && tag[0] == '/') {
-            tag = tag.substr(1);
-            // Remove attributes
-            size_t sp = tag.find(' ');
-            if (sp != std::string::npos) tag = tag.substr(0, sp);
-            if (tagEquals(tag, skipTag.c_str())) {
-              state = TEXT;
-            }
-          }
-          i = end + 1;
-          continue;
-        }
-      }
-      i++;
-      continue;
-    }
-
-    if (state == TAG) {
-      if (c == '>') {
-        state = TEXT;
-
-        // Process the tag
-        bool isClosing = !tagContent.empty() && tagContent[0] == '/';
-        std::string rawTag = tagContent;
-        if (isClosing) rawTag = rawTag.substr(1);
-
-        // Remove attributes to get tag name
-        size_t sp = rawTag.find(' ');
-        std::string tagName = (sp != std::string::npos) ? rawTag.substr(0, sp) : rawTag;
+void Converter::feed(const char* data, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    process(data[i]);
+  }
+}
 
-        // Remove trailing / for self-closing tags
-        if (!tagName.empty() && tagName.back() == '/') tagName.pop_back();
+void Converter::finish() {
+  // A '&' that never got its ';' is plain text
+  while (state == ENTITY) {
+    state = TEXT;
+    std::string rest = entity;
+    emitText('&');
+    for (char c : rest) process(c);
+  }
+  state = TEXT;
 
-        // Convert to lowercase for comparison
-        std::transform(tagName.begin(), tagName.end(), tagName.begin(), ::tolower);
+  // Trim trailing whitespace
+  pendingSpace.clear();
+  put('\n');
+  flush();
+}
 
-        // Skip script/style blocks
-        if (!isClosing && (tagName == "script" || tagName == "style")) {
-          state = SKIP_CONTENT;
-          skipTag = tagName;
-        }
-        // Headers
-        else if (tagName.size() == 2 && tagName[0] == 'h' && tagName[1] >= '1' && tagName[1] <= '6') {
-          if (!isClosing) {
-            if (!lastWasNewline) out += "\n\n";
-            int level = tagName[1] - '0';
-            for (int h = 0; h < level; h++) out += '#';
-            out += ' ';
-            lastWasNewline = false;
-          } else {
-            out += "\n\n";
-            lastWasNewline = true;
-          }
-        }
-        // Paragraphs
-        else if (tagName == "p" || tagName == "div") {
-          if (isClosing) {
-            out += "\n\n";
-            lastWasNewline = true;
-          } else if (!lastWasNewline) {
-            out += "\n\n";
-            lastWasNewline = true;
-          }
-        }
-        // Bold
-        else if (tagName == "strong" || tagName == "b") {
-          out += "**";
-          inBold = !isClosing;
-          lastWasNewline = false;
-        }
-        // Italic
-        else if (tagName == "em" || tagName == "i") {
-          out += "*";
-          inItalic = !isClosing;
-          lastWasNewline = false;
-        }
-        // List items
-        else if (tagName == "li") {
-          if (!isClosing) {
-            if (!lastWasNewline) out += "\n";
-            out += "- ";
-            lastWasNewline = false;
-          } else {
-            out += "\n";
-            lastWasNewline = true;
-          }
-        }
-        // Unordered/ordered list
-        else if (tagName == "ul" || tagName == "ol") {
-          if (isClosing) {
-            if (!lastWasNewline) out += "\n";
-            lastWasNewline = true;
-          }
-        }
-        // Blockquote
-        else if (tagName == "blockquote") {
-          if (!isClosing) {
-            if (!lastWasNewline) out += "\n\n";
-            out += "> ";
-            inBlockquote = true;
-            lastWasNewline = false;
-          } else {
-            out += "\n\n";
-            inBlockquote = false;
-            lastWasNewline = true;
-          }
-        }
-        // Line break
-        else if (tagName == "br" || tagName == "br/") {
-          out += "\n";
-          if (inBlockquote) out += "> ";
-          lastWasNewline = true;
-        }
-        // Links
-        else if (tagName == "a") {
-          if (!isClosing) {
-            linkHref = extractHref(rawTag);
-            linkText.clear();
-            inLink = true;
-          } else if (inLink) {
-            if (!linkHref.empty()) {
-              out += "[" + linkText + "](" + linkHref + ")";
-            } else {
-              out += linkText;
-            }
-            inLink = false;
-            linkText.clear();
-            linkHref.clear();
-            lastWasNewline = false;
-          }
-        }
-        // hr
-        else if (tagName == "hr" || tagName == "hr/") {
-          if (!lastWasNewline) out += "\n";
-          out += "\n---\n\n";
-          lastWasNewline = true;
-        }
-        // All other tags are stripped
+void Converter::process(char c) {
+  if (state == SKIP_CONTENT) {
+    // Skip <script> and <style> block contents
+    if (c == '<') {
+      state = SKIP_TAG;
+      tagContent.clear();
+    }
+    return;
+  }
 
-        i++;
-        continue;
-      }
+  if (state == SKIP_TAG) {
+    if (c != '>') {
       tagContent += c;
-      i++;
-      continue;
+      return;
+    }
+    state = SKIP_CONTENT;
+    // Only the matching closing tag ends the block
+    if (!tagContent.empty() && tagContent[0] == '/') {
+      std::string tag = tagContent.substr(1);
+      // Remove attributes
+      size_t sp = tag.find(' ');
+      if (sp != std::string::npos) tag = tag.substr(0, sp);
+      if (tagEquals(tag, skipTag.c_str())) {
+        state = TEXT;
+      }
     }
+    return;
+  }
 
-    // TEXT state
-    if (c == '<') {
-      state = TAG;
-      tagContent.clear();
-      i++;
-      continue;
+  if (state == TAG) {
+    if (c == '>') {
+      state = TEXT;
+      processTag();
+    } else {
+      tagContent += c;
     }
+    return;
+  }
 
-    // Handle HTML entities
-    if (c == '&') {
-      size_t consumed;
-      std::string decoded = decodeEntity(html, i, consumed);
-      if (consumed > 0) {
+  if (state == ENTITY) {
+    if (c == ';') {
+      state = TEXT;
+      std::string decoded;
+      if (decodeEntity(entity, decoded)) {
         if (inLink) {
           linkText += decoded;
         } else {
-          out += decoded;
+          emit(decoded);
           lastWasNewline = false;
         }
-        i += consumed;
-        continue;
+        return;
       }
+      entity += c;
+    } else if (entity.size() < 9) {
+      entity += c;
+      return;
+    } else {
+      entity += c;
+      state = TEXT;
     }
+    // Not an entity: the '&' is text and what followed it is processed as usual
+    std::string rest = entity;
+    emitText('&');
+    for (char r : rest) process(r);
+    return;
+  }
+
+  // TEXT state
+  if (c == '<') {
+    state = TAG;
+    tagContent.clear();
+    return;
+  }
+
+  // Handle HTML entities
+  if (c == '&') {
+    state = ENTITY;
+    entity.clear();
+    return;
+  }
+
+  emitText(c);
+}
+
+void Converter::emitText(char c) {
+  // Regular text
+  if (inLink) {
+    linkText += c;
+    return;
+  }
+  // Collapse whitespace
+  if (c == '\n' || c == '\r' || c == '\t') {
+    c = ' ';
+  }
+  if (c == ' ' && lastWasNewline) {
+    // Skip leading whitespace after newline
+  } else {
+    emit(c);
+    lastWasNewline = (c == '\n');
+  }
+}
+
+void Converter::processTag() {
+  // Process the tag
+  bool isClosing = !tagContent.empty() && tagContent[0] == '/';
+  std::string rawTag = tagContent;
+  if (isClosing) rawTag = rawTag.substr(1);
+
+  // Remove attributes to get tag name
+  size_t sp = rawTag.find(' ');
+  std::string tagName = (sp != std::string::npos) ? rawTag.substr(0, sp) : rawTag;
+
+  // Remove trailing / for self-closing tags
+  if (!tagName.empty() && tagName.back() == '/') tagName.pop_back();
 
-    // Regular text
-    if (inLink) {
-      linkText += c;
+  // Convert to lowercase for comparison
+  std::transform(tagName.begin(), tagName.end(), tagName.begin(), ::tolower);
+
+  // Skip script/style blocks
+  if (!isClosing && (tagName == "script" || tagName == "style")) {
+    state = SKIP_CONTENT;
+    skipTag = tagName;
+  }
+  // Headers
+  else if (tagName.size() == 2 && tagName[0] == 'h' && tagName[1] >= '1' && tagName[1] <= '6') {
+    if (!isClosing) {
+      if (!lastWasNewline) emit("\n\n");
+      int level = tagName[1] - '0';
+      for (int h = 0; h < level; h++) emit('#');
+      emit(' ');
+      lastWasNewline = false;
     } else {
-      // Collapse whitespace
-      if (c == '\n' || c == '\r' || c == '\t') {
-        c = ' ';
-      }
-      if (c == ' ' && lastWasNewline) {
-        // Skip leading whitespace after newline
+      emit("\n\n");
+      lastWasNewline = true;
+    }
+  }
+  // Paragraphs
+  else if (tagName == "p" || tagName == "div") {
+    if (isClosing) {
+      emit("\n\n");
+      lastWasNewline = true;
+    } else if (!lastWasNewline) {
+      emit("\n\n");
+      lastWasNewline = true;
+    }
+  }
+  // Bold
+  else if (tagName == "strong" || tagName == "b") {
+    emit("**");
+    inBold = !isClosing;
+    lastWasNewline = false;
+  }
+  // Italic
+  else if (tagName == "em" || tagName == "i") {
+    emit('*');
+    inItalic = !isClosing;
+    lastWasNewline = false;
+  }
+  // List items
+  else if (tagName == "li") {
+    if (!isClosing) {
+      if (!lastWasNewline) emit('\n');
+      emit("- ");
+      lastWasNewline = false;
+    } else {
+      emit('\n');
+      lastWasNewline = true;
+    }
+  }
+  // Unordered/ordered list
+  else if (tagName == "ul" || tagName == "ol") {
+    if (isClosing) {
+      if (!lastWasNewline) emit('\n');
+      lastWasNewline = true;
+    }
+  }
+  // Blockquote
+  else if (tagName == "blockquote") {
+    if (!isClosing) {
+      if (!lastWasNewline) emit("\n\n");
+      emit("> ");
+      inBlockquote = true;
+      lastWasNewline = false;
+    } else {
+      emit("\n\n");
+      inBlockquote = false;
+      lastWasNewline = true;
+    }
+  }
+  // Line break
+  else if (tagName == "br" || tagName == "br/") {
+    emit('\n');
+    if (inBlockquote) emit("> ");
+    lastWasNewline = true;
+  }
+  // Links
+  else if (tagName == "a") {
+    if (!isClosing) {
+      linkHref = extractHref(rawTag);
+      linkText.clear();
+      inLink = true;
+    } else if (inLink) {
+      if (!linkHref.empty()) {
+        emit("[" + linkText + "](" + linkHref + ")");
       } else {
-        out += c;
-        lastWasNewline = (c == '\n');
+        emit(linkText);
       }
+      inLink = false;
+      linkText.clear();
+      linkHref.clear();
+      lastWasNewline = false;
     }
-
-    i++;
   }
+  // hr
+  else if (tagName == "hr" || tagName == "hr/") {
+    if (!lastWasNewline) emit('\n');
+    emit("\n---\n\n");
+    lastWasNewline = true;
+  }
+  // All other tags are stripped
+}
 
-  // Trim trailing whitespace
-  while (!out.empty() && (out.back() == ' ' || out.back() == '\n' || out.back() == '\r')) {
-    out.pop_back();
+void Converter::emit(const std::string& s) {
+  for (char c : s) emit(c);
+}
+
+void Converter::emit(char c) {
+  if (c == ' ' || c == '\n' || c == '\r') {
+    pendingSpace += c;
+    // A run this long is not the end of the article, and holding it back would make the buffer unbounded
+    if (pendingSpace.size() < 64) return;
+  } else {
+    pendingSpace += c;
   }
-  out += "\n";
+  for (char held : pendingSpace) put(held);
+  pendingSpace.clear();
+}
 
-  return out;
+void Converter::put(char c) {
+  buffer[bufferLength++] = c;
+  outputBytes++;
+  if (bufferLength == sizeof(buffer)) flush();
+}
+
+void Converter::flush() {
+  if (bufferLength > 0) {
+    sink(buffer, bufferLength);
+    bufferLength = 0;
+  }
 }
+
+}  // namespace HtmlToMarkdown
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <functional>
 #include <string>
 
 namespace HtmlToMarkdown {
@@ -6,4 +8,49 @@ namespace HtmlToMarkdown {
 // Convert HTML to Markdown. Designed for Instapaper's clean article HTML.
 std::string convert(const std::string& html);
 
+// Incremental form of convert(): HTML is fed in pieces of any size as it arrives and Markdown leaves through `sink` in
+// small blocks, so an article never has to be held in memory as a whole.
+class Converter {
+ public:
+  using Sink = std::function<void(const char* data, size_t length)>;
+
+  explicit Converter(Sink sink) : sink(std::move(sink)) {}
+
+  void feed(const char* data, size_t length);
+  // Ends the document: trims trailing whitespace, writes the final newline and flushes
+  void finish();
+
+  size_t getOutputBytes() const { return outputBytes; }
+
+ private:
+  enum State { TEXT, TAG, ENTITY, SKIP_CONTENT, SKIP_TAG };
+
+  Sink sink;
+  State state = TEXT;
+  std::string tagContent;
+  std::string entity;
+  std::string linkHref;
+  std::string linkText;
+  bool inLink = false;
+  bool inBold = false;
+  bool inItalic = false;
+  bool inBlockquote = false;
+  std::string skipTag;
+  bool lastWasNewline = true;  // Start as if we just had a newline
+
+  // Whitespace is held back until more text follows, so the end of the document can be trimmed
+  std::string pendingSpace;
+  char buffer[256];
+  size_t bufferLength = 0;
+  size_t outputBytes = 0;
+
+  void process(char c);
+  void processTag();
+  void emitText(char c);
+  void emit(const std::string& s);
+  void emit(char c);
+  void put(char c);
+  void flush();
+};
+
 }  // namespace HtmlToMarkdown
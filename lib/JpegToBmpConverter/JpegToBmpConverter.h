@@ -2,15 +2,16 @@
 
 class FsFile;
 class Print;
+struct BmpOutputSpec;
 class ZipFile;
 
 class JpegToBmpConverter {
   static unsigned char jpegReadCallback(unsigned char* pBuf, unsigned char buf_size,
                                         unsigned char* pBytes_actually_read, void* pCallback_data);
-  static bool jpegFileToBmpStreamInternal(class FsFile& jpegFile, Print& bmpOut, int targetWidth, int targetHeight,
-                                          bool oneBit, bool crop = true);
 
  public:
+  // Decodes the image once and writes every requested BMP (e.g. cover, cropped cover and thumbnails) from it
+  static bool jpegFileToBmpStreams(FsFile& jpegFile, const BmpOutputSpec* outputs, int outputCount);
   static bool jpegFileToBmpStream(FsFile& jpegFile, Print& bmpOut, bool crop = true);
   // Convert with custom target size (for thumbnails)
   static bool jpegFileToBmpStreamWithSize(FsFile& jpegFile, Print& bmpOut, int targetMaxWidth, int targetMaxHeight);
@@ -3,8 +3,22 @@
 #include <HalStorage.h>
 #include <Logging.h>
 #include <MD5Builder.h>
+#include <Serialization.h>
 
 namespace {
+constexpr uint8_t HASH_CACHE_VERSION = 1;
+constexpr char HASH_CACHE_FILE[] = "/koreader_id.bin";
+constexpr size_t HASH_LENGTH = 32;
+
+uint32_t fatTimestamp(FsFile& file) {
+  uint16_t date = 0;
+  uint16_t time = 0;
+  if (!file.getModifyDateTime(&date, &time)) {
+    return 0;
+  }
+  return (static_cast<uint32_t>(date) << 16) | time;
+}
+
 // Extract filename from path (everything after last '/')
 std::string getFilename(const std::string& path) {
   const size_t pos = path.rfind('/');
@@ -47,9 +61,65 @@ std::string KOReaderDocumentId::calculate(const std::string& filePath) {
     LOG_DBG("KODoc", "Failed to open file: %s", filePath.c_str());
     return "";
   }
+  LOG_DBG("KODoc", "Calculating hash for file: %s", filePath.c_str());
+  std::string result = hashFile(file);
+  file.close();
+  return result;
+}
+
+std::string KOReaderDocumentId::calculate(const std::string& filePath, const std::string& cacheDir) {
+  if (cacheDir.empty()) {
+    return calculate(filePath);
+  }
+
+  FsFile file;
+  if (!Storage.openFileForRead("KODoc", filePath, file)) {
+    LOG_DBG("KODoc", "Failed to open file: %s", filePath.c_str());
+    return "";
+  }
+  const auto fileSize = static_cast<uint32_t>(file.fileSize());
+  const uint32_t modified = fatTimestamp(file);
+
+  // The stored hash is only trusted for the same size and mtime
+  const std::string cachePath = cacheDir + HASH_CACHE_FILE;
+  FsFile cacheFile;
+  if (Storage.exists(cachePath.c_str()) && Storage.openFileForRead("KODoc", cachePath, cacheFile)) {
+    uint8_t version = 0;
+    uint32_t cachedSize = 0;
+    uint32_t cachedModified = 0;
+    char hash[HASH_LENGTH];
+    serialization::readPod(cacheFile, version);
+    serialization::readPod(cacheFile, cachedSize);
+    serialization::readPod(cacheFile, cachedModified);
+    const bool complete = cacheFile.read(hash, HASH_LENGTH) == static_cast<int>(HASH_LENGTH);
+    cacheFile.close();
+    if (complete && version == HASH_CACHE_VERSION && cachedSize == fileSize && cachedModified == modified) {
+      file.close();
+      LOG_DBG("KODoc", "Cached hash for %s", filePath.c_str());
+      return std::string(hash, HASH_LENGTH);
+    }
+  }
+
+  LOG_DBG("KODoc", "Calculating hash for file: %s", filePath.c_str());
+  std::string result = hashFile(file);
+  file.close();
+  if (result.size() != HASH_LENGTH) {
+    return result;
+  }
 
+  Storage.mkdir(cacheDir.c_str());
+  if (Storage.openFileForWrite("KODoc", cachePath, cacheFile)) {
+    serialization::writePod(cacheFile, HASH_CACHE_VERSION);
+    serialization::writePod(cacheFile, fileSize);
+    serialization::writePod(cacheFile, modified);
+    cacheFile.write(reinterpret_cast<const uint8_t*>(result.data()), HASH_LENGTH);
+    cacheFile.close();
+  }
+  return result;
+}
+
+std::string KOReaderDocumentId::hashFile(FsFile& file) {
   const size_t fileSize = file.fileSize();
-  LOG_DBG("KODoc", "Calculating hash for file: %s (size: %zu)", filePath.c_str(), fileSize);
 
   // Initialize MD5 builder
   MD5Builder md5;
@@ -84,8 +154,6 @@ std::string KOReaderDocumentId::calculate(const std::string& filePath) {
     }
   }
 
-  file.close();
-
   // Calculate final hash
   md5.calculate();
   std::string result = md5.toString().c_str();
@@ -1,6 +1,8 @@
 #pragma once
 #include <string>
 
+class FsFile;
+
 /**
  * Calculate KOReader document ID (partial MD5 hash).
  *
@@ -24,6 +26,17 @@ class KOReaderDocumentId {
    */
   static std::string calculate(const std::string& filePath);
 
+  /**
+   * Same as calculate(), but the hash is remembered in the book's cache directory
+   * together with the file size and modification time. Later calls for an
+   * unchanged file return it without reading the book.
+   *
+   * @param filePath Path to the file
+   * @param cacheDir The book's cache directory; created if missing
+   * @return 32-character lowercase hex string, or empty string on failure
+   */
+  static std::string calculate(const std::string& filePath, const std::string& cacheDir);
+
   /**
    * Calculate document hash from filename only (filename-based sync mode).
    * This is simpler and works when files have the same name across devices.
@@ -42,4 +55,7 @@ class KOReaderDocumentId {
 
   // Calculate offset for index i: 1024 << (2*i)
   static size_t getOffset(int i);
+
+  // Partial MD5 of an open file
+  static std::string hashFile(FsFile& file);
 };
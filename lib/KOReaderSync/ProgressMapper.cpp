@@ -16,8 +16,7 @@ KOReaderPosition ProgressMapper::toKOReader(const std::shared_ptr<Epub>& epub, c
   // Calculate overall book progress (0.0-1.0)
   result.percentage = epub->calculateProgress(pos.spineIndex, intraSpineProgress);
 
-  // Generate XPath with estimated paragraph position based on page
-  result.xpath = generateXPath(pos.spineIndex, pos.pageNumber, pos.totalPages);
+  result.xpath = generateXPath(pos.spineIndex, pos.elementPath);
 
   // Get chapter info for logging
   const int tocIndex = epub->getTocIndexForSpineIndex(pos.spineIndex);
@@ -45,8 +44,10 @@ CrossPointPosition ProgressMapper::toCrossPoint(const std::shared_ptr<Epub>& epu
   int xpathSpineIndex = parseDocFragmentIndex(koPos.xpath);
   if (xpathSpineIndex >= 0 && xpathSpineIndex < epub->getSpineItemsCount()) {
     result.spineIndex = xpathSpineIndex;
-    // When we have XPath, go to page 0 of the spine - byte-based page calculation is unreliable
+    // When we have XPath, go to page 0 of the spine - byte-based page calculation is unreliable. The element path, if
+    // any, lets the reader find the exact page once the section is loaded.
     result.pageNumber = 0;
+    result.elementPath = parseElementPath(koPos.xpath);
   } else {
     // Fall back to percentage-based lookup for both spine and page
     const size_t targetBytes = static_cast<size_t>(bookSize * koPos.percentage);
@@ -82,11 +83,31 @@ CrossPointPosition ProgressMapper::toCrossPoint(const std::shared_ptr<Epub>& epu
   return result;
 }
 
-std::string ProgressMapper::generateXPath(int spineIndex, int pageNumber, int totalPages) {
+std::string ProgressMapper::generateXPath(int spineIndex, const std::string& elementPath) {
   // KOReader uses 1-based DocFragment indices
-  // Use a simple xpath pointing to the DocFragment - KOReader will use the percentage for fine positioning
-  // Avoid specifying paragraph numbers as they may not exist in the target document
-  return "/body/DocFragment[" + std::to_string(spineIndex + 1) + "]/body";
+  const std::string docFragment = "/body/DocFragment[" + std::to_string(spineIndex + 1) + "]";
+  if (elementPath.empty()) {
+    // Point at the DocFragment only - KOReader will use the percentage for fine positioning
+    return docFragment + "/body";
+  }
+  return docFragment + elementPath;
+}
+
+std::string ProgressMapper::parseElementPath(const std::string& xpath) {
+  const size_t start = xpath.find("DocFragment[");
+  if (start == std::string::npos) {
+    return "";
+  }
+  const size_t end = xpath.find(']', start);
+  if (end == std::string::npos) {
+    return "";
+  }
+  std::string elementPath = xpath.substr(end + 1);
+  // A bare body is the chapter start, which page 0 already is
+  if (elementPath == "/body" || elementPath == "/body[1]") {
+    return "";
+  }
+  return elementPath;
 }
 
 int ProgressMapper::parseDocFragmentIndex(const std::string& xpath) {
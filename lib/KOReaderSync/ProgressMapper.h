@@ -11,6 +11,9 @@ struct CrossPointPosition {
   int spineIndex;  // Current spine item (chapter) index
   int pageNumber;  // Current page within the spine item
   int totalPages;  // Total pages in the current spine item
+  // Element at the top of the page within the chapter, e.g. "/body[1]/div[2]/p[5]". Empty if the chapter has no
+  // element index; the position is then only as precise as the page estimate.
+  std::string elementPath;
 };
 
 /**
@@ -27,9 +30,10 @@ struct KOReaderPosition {
  * CrossPoint tracks position as (spineIndex, pageNumber).
  * KOReader uses XPath-like strings + percentage.
  *
- * Since CrossPoint discards HTML structure during parsing, we generate
- * synthetic XPath strings based on spine index, using percentage as the
- * primary sync mechanism.
+ * Each section keeps an element index of its chapter (see ElementIndex), so
+ * the XPath names the element at the top of the page and KOReader positions
+ * resolve to the page holding that element. Without an index the XPath only
+ * names the chapter and the percentage does the fine positioning.
  */
 class ProgressMapper {
  public:
@@ -46,7 +50,9 @@ class ProgressMapper {
    * Convert KOReader position to CrossPoint format.
    *
    * Note: The returned pageNumber may be approximate since different
-   * rendering settings produce different page counts.
+   * rendering settings produce different page counts. When the XPath
+   * points into the chapter, elementPath carries that part and the
+   * reader resolves it to an exact page once the section is loaded.
    *
    * @param epub The EPUB book
    * @param koPos KOReader position
@@ -59,10 +65,16 @@ class ProgressMapper {
  private:
   /**
    * Generate XPath for KOReader compatibility.
-   * Format: /body/DocFragment[spineIndex+1]/body/p[estimatedParagraph]
-   * Paragraph is estimated based on page position within the chapter.
+   * Format: /body/DocFragment[spineIndex+1] followed by the element path,
+   * or /body/DocFragment[spineIndex+1]/body without one.
    */
-  static std::string generateXPath(int spineIndex, int pageNumber, int totalPages);
+  static std::string generateXPath(int spineIndex, const std::string& elementPath);
+
+  /**
+   * Element path after the DocFragment step, e.g. "/body/div[2]/p[5]/text().12".
+   * Empty if the XPath stops at the DocFragment or its body.
+   */
+  static std::string parseElementPath(const std::string& xpath);
 
   /**
    * Parse DocFragment index from XPath string.
@@ -84,7 +84,11 @@ void MarkdownParser::startNewTextBlock(const BlockStyle& blockStyle) {
     }
     makePages();
   }
-  currentTextBlock.reset(new ParsedText(extraParagraphSpacing, hyphenationEnabled, blockStyle));
+  if (!hyphenationWorkspace) {
+    hyphenationWorkspace.reset(new (std::nothrow) Hyphenator::Workspace());
+  }
+  currentTextBlock.reset(
+      new ParsedText(extraParagraphSpacing, hyphenationEnabled, blockStyle, hyphenationWorkspace.get()));
 }
 
 void MarkdownParser::addLineToPage(std::shared_ptr<TextBlock> line) {
@@ -37,6 +37,8 @@ class MarkdownParser {
 
   // Current state
   std::unique_ptr<ParsedText> currentTextBlock;
+  // Shared by the text blocks of this build, off the task stack
+  std::unique_ptr<Hyphenator::Workspace> hyphenationWorkspace;
   std::unique_ptr<Page> currentPage;
   int16_t currentPageNextY = 0;
 
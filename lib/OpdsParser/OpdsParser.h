@@ -2,6 +2,7 @@
 #include <Print.h>
 #include <expat.h>
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -42,9 +43,14 @@ using OpdsBook = OpdsEntry;
  *       }
  *     }
  *   }
+ *
+ * Large catalogs: set an entry callback to receive entries one by one instead of collecting them, and follow
+ * getNextHref() to the next page of the feed.
  */
 class OpdsParser final : public Print {
  public:
+  using EntryCallback = std::function<void(OpdsEntry&& entry)>;
+
   OpdsParser();
   ~OpdsParser();
 
@@ -68,6 +74,16 @@ class OpdsParser final : public Print {
   const std::vector<OpdsEntry>& getEntries() const& { return entries; }
   std::vector<OpdsEntry> getEntries() && { return std::move(entries); }
 
+  /**
+   * Hand each complete entry to `callback` instead of keeping it; getEntries() then stays empty.
+   */
+  void setEntryCallback(EntryCallback callback) { entryCallback = std::move(callback); }
+
+  /**
+   * Link to the next page of a paginated feed (rel="next"), as written in the feed; empty on the last page.
+   */
+  const std::string& getNextHref() const { return nextHref; }
+
   /**
    * Get only book entries (legacy compatibility).
    * @return Vector of book entries
@@ -90,6 +106,8 @@ class OpdsParser final : public Print {
 
   XML_Parser parser = nullptr;
   std::vector<OpdsEntry> entries;
+  EntryCallback entryCallback;
+  std::string nextHref;
   OpdsEntry currentEntry;
   std::string currentText;
 
@@ -2,12 +2,12 @@
 
 class FsFile;
 class Print;
+struct BmpOutputSpec;
 
 class PngToBmpConverter {
-  static bool pngFileToBmpStreamInternal(FsFile& pngFile, Print& bmpOut, int targetWidth, int targetHeight, bool oneBit,
-                                         bool crop = true);
-
  public:
+  // Decodes the image once and writes every requested BMP (e.g. cover, cropped cover and thumbnails) from it
+  static bool pngFileToBmpStreams(FsFile& pngFile, const BmpOutputSpec* outputs, int outputCount);
   static bool pngFileToBmpStream(FsFile& pngFile, Print& bmpOut, bool crop = true);
   static bool pngFileToBmpStreamWithSize(FsFile& pngFile, Print& bmpOut, int targetMaxWidth, int targetMaxHeight);
   static bool pngFileTo1BitBmpStreamWithSize(FsFile& pngFile, Print& bmpOut, int targetMaxWidth, int targetMaxHeight);
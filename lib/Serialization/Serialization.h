@@ -1,9 +1,30 @@
 #pragma once
 #include <HalStorage.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 namespace serialization {
+// Reads values back out of a byte string. Reading past the end yields zeros.
+class MemoryReader {
+  const std::string& data;
+  size_t position = 0;
+
+ public:
+  explicit MemoryReader(const std::string& data) : data(data) {}
+
+  size_t read(void* out, const size_t length) {
+    const size_t n = std::min(length, remaining());
+    memcpy(out, data.data() + position, n);
+    memset(static_cast<char*>(out) + n, 0, length - n);
+    position += n;
+    return n;
+  }
+  size_t remaining() const { return data.size() - position; }
+};
+
 template <typename T>
 static void writePod(std::ostream& os, const T& value) {
   os.write(reinterpret_cast<const char*>(&value), sizeof(T));
@@ -14,6 +35,11 @@ static void writePod(FsFile& file, const T& value) {
   file.write(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
 }
 
+template <typename T>
+static void writePod(std::string& out, const T& value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
 template <typename T>
 static void readPod(std::istream& is, T& value) {
   is.read(reinterpret_cast<char*>(&value), sizeof(T));
@@ -24,6 +50,11 @@ static void readPod(FsFile& file, T& value) {
   file.read(reinterpret_cast<uint8_t*>(&value), sizeof(T));
 }
 
+template <typename T>
+static void readPod(MemoryReader& in, T& value) {
+  in.read(&value, sizeof(T));
+}
+
 static void writeString(std::ostream& os, const std::string& s) {
   const uint32_t len = s.size();
   writePod(os, len);
@@ -36,6 +67,12 @@ static void writeString(FsFile& file, const std::string& s) {
   file.write(reinterpret_cast<const uint8_t*>(s.data()), len);
 }
 
+static void writeString(std::string& out, const std::string& s) {
+  const uint32_t len = s.size();
+  writePod(out, len);
+  out += s;
+}
+
 static void readString(std::istream& is, std::string& s) {
   uint32_t len;
   readPod(is, len);
@@ -43,6 +80,13 @@ static void readString(std::istream& is, std::string& s) {
   is.read(&s[0], len);
 }
 
+static void readString(MemoryReader& in, std::string& s) {
+  uint32_t len;
+  readPod(in, len);
+  s.resize(std::min<size_t>(len, in.remaining()));
+  in.read(&s[0], s.size());
+}
+
 static void readString(FsFile& file, std::string& s) {
   uint32_t len;
   readPod(file, len);
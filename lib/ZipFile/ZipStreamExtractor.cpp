@@ -0,0 +1,405 @@
+#include "ZipStreamExtractor.h"
+
+#include <Logging.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+constexpr uint32_t CENTRAL_DIR_SIGNATURE = 0x02014b50;
+constexpr uint32_t END_OF_CENTRAL_DIR_SIGNATURE = 0x06054b50;
+constexpr uint32_t DATA_DESCRIPTOR_SIGNATURE = 0x08074b50;
+constexpr size_t LOCAL_HEADER_SIZE = 26;  // Without the signature
+constexpr uint16_t FLAG_ENCRYPTED = 0x0001;
+constexpr uint16_t FLAG_DATA_DESCRIPTOR = 0x0008;
+
+uint16_t readLe16(const uint8_t* p) { return p[0] | p[1] << 8; }
+uint32_t readLe32(const uint8_t* p) { return readLe16(p) | static_cast<uint32_t>(readLe16(p + 2)) << 16; }
+
+// Turns a member name into a relative path; false for names that would land outside the destination
+bool sanitizeMemberName(std::string& name) {
+  std::replace(name.begin(), name.end(), '\\', '/');
+  name.erase(0, name.find_first_not_of('/'));
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t end = name.find('/', start);
+    if (end == std::string::npos) {
+      end = name.size();
+    }
+    if (name.compare(start, end - start, "..") == 0) {
+      return false;
+    }
+    start = end + 1;
+  }
+  return !name.empty();
+}
+
+// Whether any folder or file name along a sanitized member path is one `isProtected` rejects
+bool hasProtectedComponent(const std::string& name, const ZipStreamExtractor::ProtectedNameFn& isProtected) {
+  size_t start = 0;
+  while (start < name.size()) {
+    size_t end = name.find('/', start);
+    if (end == std::string::npos) {
+      end = name.size();
+    }
+    if (end > start && isProtected(name.substr(start, end - start))) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
+}  // namespace
+
+bool ZipStreamExtractor::begin(const std::string& destDir, FileDoneFn onFileDone, ProtectedNameFn isProtected) {
+  abort();
+
+  inflator = static_cast<tinfl_decompressor*>(malloc(sizeof(tinfl_decompressor)));
+  window = static_cast<uint8_t*>(malloc(TINFL_LZ_DICT_SIZE));
+  if (!inflator || !window) {
+    LOG_ERR("ZIP", "Failed to allocate memory for streaming unpack");
+    release();
+    return false;
+  }
+
+  this->destDir = destDir;
+  while (!this->destDir.empty() && this->destDir.back() == '/') {
+    this->destDir.pop_back();
+  }
+  if (!this->destDir.empty()) {
+    Storage.mkdir(this->destDir.c_str());
+  }
+  this->onFileDone = std::move(onFileDone);
+  this->isProtected = isProtected ? std::move(isProtected) : [](const std::string& component) {
+    return component[0] == '.';
+  };
+  error = nullptr;
+  fileCount = 0;
+  bytesWritten = 0;
+  writing = false;
+  expect(State::SIGNATURE, 4);
+  return true;
+}
+
+bool ZipStreamExtractor::write(const uint8_t* data, size_t length) {
+  while (length > 0 && state != State::FAILED) {
+    const size_t consumed = consume(data, length);
+    data += consumed;
+    length -= consumed;
+  }
+  return state != State::FAILED;
+}
+
+bool ZipStreamExtractor::finish() {
+  // An archive cut off after a whole member still leaves every file it announced intact
+  const bool complete = state == State::END || (state == State::SIGNATURE && recordLength == 0 && fileCount > 0);
+  if (!complete && state != State::FAILED) {
+    fail("Archive is incomplete");
+  }
+  abort();
+  return complete;
+}
+
+void ZipStreamExtractor::abort() {
+  if (out) {
+    out.close();
+    Storage.remove(memberPath.c_str());
+  }
+  release();
+}
+
+void ZipStreamExtractor::release() {
+  free(inflator);
+  inflator = nullptr;
+  free(window);
+  window = nullptr;
+}
+
+void ZipStreamExtractor::expect(const State next, const size_t length) {
+  state = next;
+  recordLength = 0;
+  recordWanted = length;
+}
+
+size_t ZipStreamExtractor::collect(const uint8_t* data, const size_t length) {
+  const size_t n = std::min(length, recordWanted - recordLength);
+  memcpy(record + recordLength, data, n);
+  recordLength += n;
+  return n;
+}
+
+size_t ZipStreamExtractor::consume(const uint8_t* data, const size_t length) {
+  switch (state) {
+    case State::SIGNATURE: {
+      const size_t n = collect(data, length);
+      if (recordLength < recordWanted) {
+        return n;
+      }
+      const uint32_t signature = readLe32(record);
+      if (signature == LOCAL_HEADER_SIGNATURE) {
+        expect(State::HEADER, LOCAL_HEADER_SIZE);
+      } else if (signature == CENTRAL_DIR_SIGNATURE || signature == END_OF_CENTRAL_DIR_SIGNATURE) {
+        // The central directory repeats what the local headers said; nothing left to unpack
+        state = State::END;
+      } else {
+        fail(fileCount == 0 ? "Not a ZIP archive" : "Corrupt archive");
+      }
+      return n;
+    }
+
+    case State::HEADER: {
+      const size_t n = collect(data, length);
+      if (recordLength < recordWanted) {
+        return n;
+      }
+      flags = readLe16(record + 2);
+      method = readLe16(record + 4);
+      expectedCrc = readLe32(record + 10);
+      compressedSize = readLe32(record + 14);
+      uncompressedSize = readLe32(record + 18);
+      nameLength = readLe16(record + 22);
+      extraRemaining = readLe16(record + 24);
+      name.clear();
+      name.reserve(nameLength);
+      state = State::NAME;
+      return n;
+    }
+
+    case State::NAME: {
+      const size_t n = std::min(length, static_cast<size_t>(nameLength - name.size()));
+      name.append(reinterpret_cast<const char*>(data), n);
+      if (name.size() == nameLength) {
+        state = State::EXTRA;
+      }
+      return n;
+    }
+
+    case State::EXTRA: {
+      const size_t n = std::min(length, static_cast<size_t>(extraRemaining));
+      extraRemaining -= n;
+      if (extraRemaining == 0 && startMember()) {
+        state = State::DATA;
+      }
+      return n;
+    }
+
+    case State::DATA:
+      return consumeData(data, length);
+
+    case State::DESCRIPTOR: {
+      const size_t n = collect(data, length);
+      if (recordWanted == 4 && recordLength == 4) {
+        // The descriptor signature is optional: crc, compressed size, uncompressed size
+        recordWanted = readLe32(record) == DATA_DESCRIPTOR_SIGNATURE ? 16 : 12;
+        return n;
+      }
+      if (recordLength < recordWanted) {
+        return n;
+      }
+      const uint8_t* fields = record + recordWanted - 12;
+      if (endMember(readLe32(fields), readLe32(fields + 8))) {
+        expect(State::SIGNATURE, 4);
+      }
+      return n;
+    }
+
+    case State::END:
+    case State::FAILED:
+      return length;
+  }
+  return length;
+}
+
+bool ZipStreamExtractor::startMember() {
+  if (flags & FLAG_ENCRYPTED) {
+    fail("Encrypted archives are not supported");
+    return false;
+  }
+  if (method != MZ_NO_COMPRESSION && method != MZ_DEFLATED) {
+    fail("Unsupported compression method");
+    return false;
+  }
+  if (method == MZ_NO_COMPRESSION && (flags & FLAG_DATA_DESCRIPTOR)) {
+    // Nothing tells where such a member ends
+    fail("Uncompressed members without sizes are not supported");
+    return false;
+  }
+  if (!sanitizeMemberName(name)) {
+    fail("Invalid path in archive");
+    return false;
+  }
+
+  memberPath = destDir + "/" + name;
+  const bool isDirectory = memberPath.back() == '/';
+  // Resource forks added by the macOS archiver
+  const bool isMetadata = name.compare(0, 9, "__MACOSX/") == 0;
+  // Hidden and firmware-owned paths such as .crosspoint/ are never written from an archive
+  const bool isProtectedPath = !isMetadata && hasProtectedComponent(name, isProtected);
+  if (isProtectedPath) {
+    LOG_ERR("ZIP", "Skipping protected path in archive: %s", name.c_str());
+  }
+  const bool skipped = isMetadata || isProtectedPath;
+  writing = !isDirectory && !skipped;
+  if (isDirectory && !skipped) {
+    memberPath.pop_back();
+    Storage.mkdir(memberPath.c_str());
+  } else if (writing) {
+    const size_t slash = memberPath.rfind('/');
+    if (slash > 0) {
+      Storage.mkdir(memberPath.substr(0, slash).c_str());
+    }
+    if (!Storage.openFileForWrite("ZIP", memberPath, out)) {
+      fail("Failed to create file");
+      return false;
+    }
+  }
+
+  compressedRemaining = compressedSize;
+  memberCrc = MZ_CRC32_INIT;
+  memberSize = 0;
+  windowLength = 0;
+  inputTailLength = 0;
+  tinfl_init(inflator);
+
+  // An empty stored member has no data at all
+  if (method == MZ_NO_COMPRESSION && compressedSize == 0) {
+    if (endMember(expectedCrc, uncompressedSize)) {
+      expect(State::SIGNATURE, 4);
+    }
+    return false;
+  }
+  return true;
+}
+
+size_t ZipStreamExtractor::consumeData(const uint8_t* data, const size_t length) {
+  const bool sizeKnown = !(flags & FLAG_DATA_DESCRIPTOR);
+
+  if (method == MZ_NO_COMPRESSION) {
+    const size_t n = std::min(length, static_cast<size_t>(compressedRemaining));
+    size_t copied = 0;
+    while (copied < n) {
+      const size_t chunk = std::min(n - copied, TINFL_LZ_DICT_SIZE - windowLength);
+      memcpy(window + windowLength, data + copied, chunk);
+      windowLength += chunk;
+      copied += chunk;
+      if (windowLength == TINFL_LZ_DICT_SIZE && !flushWindow()) {
+        return n;
+      }
+    }
+    compressedRemaining -= n;
+    if (compressedRemaining == 0 && endMember(expectedCrc, uncompressedSize)) {
+      expect(State::SIGNATURE, 4);
+    }
+    return n;
+  }
+
+  size_t inBytes = sizeKnown ? std::min(length, static_cast<size_t>(compressedRemaining)) : length;
+  size_t outBytes = TINFL_LZ_DICT_SIZE - windowLength;
+  const bool moreInput = !sizeKnown || compressedRemaining > inBytes;
+  const tinfl_status status = tinfl_decompress(inflator, data, &inBytes, window, window + windowLength, &outBytes,
+                                               moreInput ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+  windowLength += outBytes;
+  if (sizeKnown) {
+    compressedRemaining -= inBytes;
+  }
+  rememberInput(data, inBytes);
+
+  // The window doubles as the inflater's dictionary, so it is only written out once full
+  if (windowLength == TINFL_LZ_DICT_SIZE && !flushWindow()) {
+    return inBytes;
+  }
+
+  if (status == TINFL_STATUS_DONE) {
+    if (sizeKnown) {
+      if (compressedRemaining > 0) {
+        fail("Corrupt archive");
+      } else if (endMember(expectedCrc, uncompressedSize)) {
+        expect(State::SIGNATURE, 4);
+      }
+      return inBytes;
+    }
+
+    // Bytes read ahead in earlier calls belong to the data descriptor
+    const size_t readAhead = std::min(static_cast<size_t>(inflator->m_num_bits / 8), inputTailLength);
+    uint8_t replay[sizeof(inputTail)];
+    memcpy(replay, inputTail + inputTailLength - readAhead, readAhead);
+    expect(State::DESCRIPTOR, 4);
+    write(replay, readAhead);
+    return inBytes;
+  }
+
+  if (status < 0 || (status == TINFL_STATUS_NEEDS_MORE_INPUT && !moreInput)) {
+    fail("Corrupt archive");
+  }
+  return inBytes;
+}
+
+bool ZipStreamExtractor::endMember(const uint32_t crc, const uint32_t size) {
+  if (!flushWindow()) {
+    return false;
+  }
+  if (out) {
+    out.close();
+  }
+  if (memberCrc != crc || memberSize != size) {
+    LOG_ERR("ZIP", "Checksum mismatch in %s", name.c_str());
+    if (writing) {
+      Storage.remove(memberPath.c_str());
+    }
+    fail("Corrupt archive");
+    return false;
+  }
+
+  if (writing) {
+    fileCount++;
+    LOG_DBG("ZIP", "Unpacked %s (%u bytes)", memberPath.c_str(), static_cast<unsigned>(size));
+    if (onFileDone) {
+      onFileDone(memberPath, size);
+    }
+  }
+  return true;
+}
+
+bool ZipStreamExtractor::flushWindow() {
+  if (windowLength == 0) {
+    return true;
+  }
+  memberCrc = mz_crc32(memberCrc, window, windowLength);
+  memberSize += windowLength;
+  if (writing) {
+    if (out.write(window, windowLength) != windowLength) {
+      fail("Write failed - disk full?");
+      return false;
+    }
+    bytesWritten += windowLength;
+  }
+  windowLength = 0;
+  return true;
+}
+
+void ZipStreamExtractor::rememberInput(const uint8_t* data, const size_t length) {
+  if (length >= sizeof(inputTail)) {
+    memcpy(inputTail, data + length - sizeof(inputTail), sizeof(inputTail));
+    inputTailLength = sizeof(inputTail);
+    return;
+  }
+  const size_t keep = std::min(inputTailLength, sizeof(inputTail) - length);
+  memmove(inputTail, inputTail + inputTailLength - keep, keep);
+  memcpy(inputTail + keep, data, length);
+  inputTailLength = keep + length;
+}
+
+void ZipStreamExtractor::fail(const char* message) {
+  if (state == State::FAILED) {
+    return;
+  }
+  LOG_ERR("ZIP", "Unpacking failed: %s", message);
+  error = message;
+  state = State::FAILED;
+  if (out) {
+    out.close();
+    Storage.remove(memberPath.c_str());
+  }
+}
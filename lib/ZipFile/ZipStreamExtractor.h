@@ -0,0 +1,98 @@
+#pragma once
+#include <HalStorage.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+struct tinfl_decompressor_tag;
+
+// Unpacks a ZIP archive while it is being received, without ever storing the archive itself. The archive is read
+// front to back through its local file headers and each member is inflated straight into its file under the
+// destination folder; the central directory at the end is not needed. Members may use a data descriptor (sizes
+// after the data, as written by streaming zip tools) as long as they are deflated.
+//
+// Output goes to the card in 32 KB blocks (the inflate window), so the writes are large whatever the network chunk
+// size. Holds about 43 KB of heap between begin() and finish() / abort().
+class ZipStreamExtractor {
+ public:
+  // Called after each member file has been written and closed
+  using FileDoneFn = std::function<void(const std::string& path, uint32_t size)>;
+  // Whether a folder or file name must not be written to; members with such a name anywhere in their path are skipped
+  using ProtectedNameFn = std::function<bool(const std::string& name)>;
+
+  ZipStreamExtractor() = default;
+  ~ZipStreamExtractor() { abort(); }
+  ZipStreamExtractor(const ZipStreamExtractor&) = delete;
+  ZipStreamExtractor& operator=(const ZipStreamExtractor&) = delete;
+
+  // Starts a new archive that unpacks into `destDir`. Allocates the inflater and its window. Without `isProtected`,
+  // names starting with a dot are protected.
+  bool begin(const std::string& destDir, FileDoneFn onFileDone = nullptr, ProtectedNameFn isProtected = nullptr);
+  // Consumes the next `length` bytes of the archive. False once the archive is found to be invalid or a write
+  // fails; getError() says why.
+  bool write(const uint8_t* data, size_t length);
+  // Ends the archive and frees the buffers. True if every member was complete.
+  bool finish();
+  // Stops unpacking, removes the member being written and frees the buffers.
+  void abort();
+
+  bool isOpen() const { return window != nullptr; }
+  const char* getError() const { return error; }
+  uint16_t getFileCount() const { return fileCount; }
+  // Uncompressed bytes written to the card
+  uint32_t getBytesWritten() const { return bytesWritten; }
+
+ private:
+  enum class State : uint8_t { SIGNATURE, HEADER, NAME, EXTRA, DATA, DESCRIPTOR, END, FAILED };
+
+  std::string destDir;
+  FileDoneFn onFileDone;
+  ProtectedNameFn isProtected;
+  State state = State::SIGNATURE;
+  const char* error = nullptr;
+
+  // Fixed-size record being collected (signature, local header or data descriptor)
+  uint8_t record[30] = {};
+  size_t recordLength = 0;
+  size_t recordWanted = 0;
+
+  // Current member
+  uint16_t flags = 0;
+  uint16_t method = 0;
+  uint32_t expectedCrc = 0;
+  uint32_t compressedSize = 0;
+  uint32_t uncompressedSize = 0;
+  uint16_t extraRemaining = 0;
+  uint16_t nameLength = 0;
+  std::string name;
+  std::string memberPath;
+  FsFile out;
+  bool writing = false;  // false while skipping a member (folders, macOS metadata, protected paths)
+  uint32_t compressedRemaining = 0;
+  uint32_t memberCrc = 0;
+  uint32_t memberSize = 0;
+
+  tinfl_decompressor_tag* inflator = nullptr;
+  uint8_t* window = nullptr;
+  size_t windowLength = 0;
+  // Last input bytes handed to the inflater. It may read a few bytes past the end of a member it can only give back
+  // from the current call; the rest are replayed from here.
+  uint8_t inputTail[8] = {};
+  size_t inputTailLength = 0;
+
+  uint16_t fileCount = 0;
+  uint32_t bytesWritten = 0;
+
+  size_t consume(const uint8_t* data, size_t length);
+  size_t collect(const uint8_t* data, size_t length);
+  size_t consumeData(const uint8_t* data, size_t length);
+  void expect(State next, size_t length);
+  bool startMember();
+  bool endMember(uint32_t crc, uint32_t size);
+  bool flushWindow();
+  void rememberInput(const uint8_t* data, size_t length);
+  void fail(const char* message);
+  void release();
+};
@@ -0,0 +1,392 @@
+#!/usr/bin/env python3
+"""
+Convert a dictionary into the .cpdict format read by lib/Dictionary.
+
+Supported inputs:
+- StarDict:  the .ifo file (with .idx or .idx.gz, .dict or .dict.dz, and an optional .syn next to it)
+- dictd:     the .index file (with .dict or .dict.dz next to it)
+- TSV:       one "headword<TAB>definition" per line; "\\n" in a definition is a line break
+
+Definitions are converted to plain text: HTML, Pango and XDXF markup is stripped, keeping line breaks.
+
+The output is a single file. Copy it to /dictionaries on the SD card. See docs/file-formats.md for the layout.
+
+Usage:
+    python convert_dictionary.py <input> <output.cpdict> [--name NAME]
+
+Example:
+    python convert_dictionary.py stardict-wordnet/wordnet.ifo wordnet.cpdict
+"""
+
+import argparse
+import gzip
+import html
+import re
+import struct
+import sys
+import zlib
+from pathlib import Path
+
+MAGIC = b"CPDICT"
+VERSION = 1
+INDEX_BLOCK_BYTES = 4096
+CHUNK_BYTES = 16 * 1024
+MAX_KEY_BYTES = 255
+
+
+# --- Key folding; must match Dictionary::makeKey() and TextMatcher::foldCodepoint() ---
+
+
+def to_lower_latin(cp):
+    if ord("A") <= cp <= ord("Z"):
+        return cp - ord("A") + ord("a")
+    if 0xC0 <= cp <= 0xD6 or 0xD8 <= cp <= 0xDE:
+        return cp + 0x20
+    return {0x0152: 0x0153, 0x0178: 0x00FF, 0x1E9E: 0x00DF}.get(cp, cp)
+
+
+def to_lower_extended(cp):
+    if cp < 0x0100:
+        return to_lower_latin(cp)
+    if 0x0400 <= cp <= 0x052F:
+        if 0x0410 <= cp <= 0x042F:
+            return cp + 0x20
+        return 0x0451 if cp == 0x0401 else cp
+    if cp == 0x0130:
+        return ord("i")
+    if ((cp <= 0x0137 and cp % 2 == 0) or (0x0139 <= cp <= 0x0148 and cp % 2 == 1)
+            or (0x014A <= cp <= 0x0177 and cp % 2 == 0) or (0x0179 <= cp <= 0x017E and cp % 2 == 1)):
+        return cp + 1
+    if 0x0391 <= cp <= 0x03AB and cp != 0x03A2:
+        return cp + 0x20
+    if cp == 0x0386:
+        return 0x03AC
+    if cp in (0x0388, 0x0389, 0x038A):
+        return cp + 0x25
+    if cp == 0x038C:
+        return 0x03CC
+    if cp in (0x038E, 0x038F):
+        return cp + 0x3F
+    return to_lower_latin(cp)
+
+
+SPACES = {0x00A0, 0x1680, 0x202F, 0x205F, 0x3000}
+DROPPED = {0x00AD, 0x200B, 0x200C, 0x200D, 0x2060, 0xFEFF}
+QUOTES = {0x2018: "'", 0x2019: "'", 0x201B: "'", 0x02BC: "'", 0x201C: '"', 0x201D: '"', 0x201F: '"'}
+
+
+def fold_codepoint(cp):
+    """Returns the folded character, " " for spaces or None for characters that are ignored."""
+    if cp < 0x80:
+        if ord("A") <= cp <= ord("Z"):
+            return chr(cp + 0x20)
+        return " " if cp <= 0x20 else chr(cp)
+    if cp in SPACES or 0x2000 <= cp <= 0x200A:
+        return " "
+    if cp in DROPPED:
+        return None
+    if cp in QUOTES:
+        return QUOTES[cp]
+    return chr(to_lower_extended(cp))
+
+
+def is_word_char(c):
+    cp = ord(c)
+    if cp < 0x80:
+        return c.isascii() and (c.islower() or c.isdigit())
+    if cp < 0xC0 or cp in (0xD7, 0xF7):
+        return False
+    return not (0x2000 <= cp <= 0x2BFF) and not (0x3000 <= cp <= 0x303F)
+
+
+def fold_key(word):
+    """Lowercases, collapses whitespace and trims punctuation around the word."""
+    key = ""
+    word_end = 0
+    pending_space = False
+    for c in word:
+        folded = fold_codepoint(ord(c))
+        if folded is None:
+            continue
+        if folded == " ":
+            pending_space = bool(key)
+            continue
+        if not key and not is_word_char(folded):
+            continue
+        if pending_space:
+            key = key[:word_end] + " "
+            pending_space = False
+        key += folded
+        if is_word_char(folded):
+            word_end = len(key)
+    return key[:word_end]
+
+
+# --- Definition markup to plain text ---
+
+BREAK_TAGS = re.compile(r"<\s*(br|/p|/div|/li|/tr|/h\d|/blockquote|/def)\b[^>]*>", re.IGNORECASE)
+LIST_ITEM_TAGS = re.compile(r"<\s*li\b[^>]*>", re.IGNORECASE)
+TRANSCRIPTION_TAGS = re.compile(r"<\s*tr\s*>(.*?)<\s*/tr\s*>", re.IGNORECASE | re.DOTALL)
+DROPPED_ELEMENTS = re.compile(r"<\s*(script|style|rref)\b[^>]*>.*?<\s*/\1\s*>", re.IGNORECASE | re.DOTALL)
+TAGS = re.compile(r"<[^>]*>")
+BLANK_LINES = re.compile(r"\n\s*\n\s*\n+")
+SPACE_RUNS = re.compile(r"[ \t\r\f\v]+")
+
+
+def markup_to_text(text):
+    text = DROPPED_ELEMENTS.sub("", text)
+    # XDXF transcriptions read better in brackets than run into the definition
+    text = TRANSCRIPTION_TAGS.sub(r"[\1]", text)
+    text = BREAK_TAGS.sub("\n", text)
+    text = LIST_ITEM_TAGS.sub("\n• ", text)
+    text = TAGS.sub("", text)
+    text = html.unescape(text)
+    lines = [SPACE_RUNS.sub(" ", line).strip() for line in text.split("\n")]
+    return BLANK_LINES.sub("\n\n", "\n".join(lines)).strip()
+
+
+# --- Readers; each returns the dictionary name and a list of (headword, definition) pairs ---
+
+
+def read_maybe_compressed(path):
+    """Reads path, or path.gz / path.dz; dictzip files are gzip-compatible."""
+    for candidate in (path, path.with_name(path.name + ".dz"), path.with_name(path.name + ".gz")):
+        if candidate.exists():
+            data = candidate.read_bytes()
+            return gzip.decompress(data) if data[:2] == b"\x1f\x8b" else data
+    sys.exit(f"Missing {path}")
+
+
+def stardict_definition(data, type_sequence):
+    """Decodes one StarDict record. Lowercase type chars are strings, uppercase are sized binary fields."""
+
+    def text_field(kind, raw):
+        value = raw.decode("utf-8", errors="replace")
+        if kind in "hgx":
+            return markup_to_text(value)
+        if kind == "t":
+            return f"[{value.strip()}]"
+        if kind in "mly":
+            return value.strip()
+        return ""  # Unsupported text type, e.g. "k" (KingSoft) or "w" (MediaWiki)
+
+    parts = []
+    pos = 0
+    fields = list(type_sequence) if type_sequence else None
+    while pos < len(data):
+        if fields is not None:
+            if not fields:
+                break
+            kind = fields.pop(0)
+            last = not fields
+        else:
+            kind = chr(data[pos])
+            pos += 1
+            last = False
+        if kind.isupper():
+            if last:
+                size = len(data) - pos
+            else:
+                size = struct.unpack(">I", data[pos:pos + 4])[0]
+                pos += 4
+            pos += size  # Images, sounds and other resources can't be shown
+            continue
+        if last:
+            end = len(data)
+        else:
+            end = data.find(b"\0", pos)
+            end = len(data) if end < 0 else end
+        text = text_field(kind, data[pos:end])
+        if text:
+            parts.append(text)
+        pos = end + 1
+    # Phonetics go on the headword line
+    merged = []
+    for part in parts:
+        if merged and merged[-1].startswith("[") and merged[-1].endswith("]") and "\n" not in merged[-1]:
+            merged[-1] = f"{merged[-1]} {part}"
+        else:
+            merged.append(part)
+    return "\n".join(merged)
+
+
+def read_stardict(ifo_path):
+    info = {}
+    for line in ifo_path.read_text(encoding="utf-8", errors="replace").splitlines()[1:]:
+        if "=" in line:
+            key, value = line.split("=", 1)
+            info[key.strip()] = value.strip()
+    offset_bytes = 8 if info.get("idxoffsetbits") == "64" else 4
+    type_sequence = info.get("sametypesequence", "")
+
+    base = ifo_path.with_suffix("")
+    index = read_maybe_compressed(base.with_suffix(".idx"))
+    data = read_maybe_compressed(base.with_suffix(".dict"))
+
+    pairs = []
+    pos = 0
+    offset_format = ">Q" if offset_bytes == 8 else ">I"
+    while pos < len(index):
+        end = index.index(b"\0", pos)
+        word = index[pos:end].decode("utf-8", errors="replace")
+        pos = end + 1
+        offset = struct.unpack(offset_format, index[pos:pos + offset_bytes])[0]
+        size = struct.unpack(">I", index[pos + offset_bytes:pos + offset_bytes + 4])[0]
+        pos += offset_bytes + 4
+        pairs.append((word, stardict_definition(data[offset:offset + size], type_sequence)))
+
+    # Synonyms point at an entry of the main index
+    syn_path = base.with_suffix(".syn")
+    if syn_path.exists():
+        syn = syn_path.read_bytes()
+        entry_count = len(pairs)
+        pos = 0
+        while pos < len(syn):
+            end = syn.index(b"\0", pos)
+            word = syn[pos:end].decode("utf-8", errors="replace")
+            target = struct.unpack(">I", syn[end + 1:end + 5])[0]
+            pos = end + 5
+            if target < entry_count:
+                headword, definition = pairs[target]
+                pairs.append((word, f"→ {headword}\n{definition}"))
+    return info.get("bookname", base.name), pairs
+
+
+BASE64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+
+
+def dictd_number(text):
+    value = 0
+    for c in text:
+        value = value * 64 + BASE64.index(c)
+    return value
+
+
+def read_dictd(index_path):
+    data = read_maybe_compressed(index_path.with_suffix(".dict"))
+    pairs = []
+    for line in index_path.read_text(encoding="utf-8", errors="replace").splitlines():
+        fields = line.split("\t")
+        if len(fields) < 3:
+            continue
+        word = fields[0]
+        if word.startswith("00database") or word.startswith("00-database"):
+            continue
+        offset, size = dictd_number(fields[1]), dictd_number(fields[2])
+        definition = data[offset:offset + size].decode("utf-8", errors="replace")
+        # dictd repeats the headword on the first line of each definition
+        lines = definition.strip("\n").split("\n")
+        if lines and lines[0].strip().lower() == word.lower():
+            lines = lines[1:]
+        pairs.append((word, "\n".join(line.strip() for line in lines).strip()))
+    return index_path.stem, pairs
+
+
+def read_tsv(path):
+    pairs = []
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            if "\t" not in line:
+                continue
+            word, definition = line.rstrip("\n").split("\t", 1)
+            pairs.append((word, markup_to_text(definition.replace("\\n", "\n"))))
+    return path.stem, pairs
+
+
+# --- Writer ---
+
+
+def build(pairs, name):
+    # Headwords sharing a key keep one definition each, e.g. "Polish" and "polish"
+    definitions = bytearray()
+    entries = []
+    skipped = 0
+    seen = set()
+    for headword, definition in pairs:
+        headword = headword.strip()
+        key = fold_key(headword)
+        key_bytes = key.encode("utf-8")
+        headword_bytes = headword.encode("utf-8")
+        if not key_bytes or not definition or len(key_bytes) > MAX_KEY_BYTES or len(headword_bytes) > MAX_KEY_BYTES:
+            skipped += 1
+            continue
+        if (headword_bytes, definition) in seen:
+            continue
+        seen.add((headword_bytes, definition))
+        encoded = definition.encode("utf-8")
+        entries.append((key_bytes, b"" if headword_bytes == key_bytes else headword_bytes, len(definitions),
+                        len(encoded)))
+        definitions += encoded
+    entries.sort(key=lambda entry: (entry[0], entry[1]))
+
+    # Fixed-size index blocks; an entry never straddles two
+    blocks = []
+    block = bytearray()
+    block_keys = bytearray()
+    for key, headword, offset, length in entries:
+        record = bytes([len(key)]) + key + bytes([len(headword)]) + headword + struct.pack("<II", offset, length)
+        if len(block) + len(record) > INDEX_BLOCK_BYTES:
+            blocks.append(bytes(block) + bytes(INDEX_BLOCK_BYTES - len(block)))
+            block = bytearray()
+        if not block:
+            block_keys += bytes([len(key)]) + key
+        block += record
+    if block:
+        blocks.append(bytes(block) + bytes(INDEX_BLOCK_BYTES - len(block)))
+
+    # Raw deflate per chunk so any chunk inflates on its own
+    chunks = []
+    for start in range(0, len(definitions), CHUNK_BYTES):
+        compressor = zlib.compressobj(9, zlib.DEFLATED, -15)
+        chunks.append(compressor.compress(bytes(definitions[start:start + CHUNK_BYTES])) + compressor.flush())
+
+    name_bytes = name.encode("utf-8")[:255]
+    header_format = "<6sBBIIIIIIIIII"
+    header_size = struct.calcsize(header_format) + 2 + len(name_bytes)
+    block_keys_offset = header_size
+    chunk_table_offset = block_keys_offset + len(block_keys)
+    chunks_offset = chunk_table_offset + 4 * (len(chunks) + 1)
+    # Index blocks are aligned so each one is a single run of SD sectors
+    index_offset = chunks_offset + sum(len(chunk) for chunk in chunks)
+    index_offset = (index_offset + INDEX_BLOCK_BYTES - 1) // INDEX_BLOCK_BYTES * INDEX_BLOCK_BYTES
+
+    out = bytearray()
+    out += struct.pack(header_format, MAGIC, VERSION, 0, len(entries), INDEX_BLOCK_BYTES, len(blocks), index_offset,
+                       block_keys_offset, len(block_keys), CHUNK_BYTES, len(chunks), chunk_table_offset,
+                       len(definitions))
+    out += struct.pack("<H", len(name_bytes)) + name_bytes
+    out += block_keys
+    position = chunks_offset
+    for chunk in chunks:
+        out += struct.pack("<I", position)
+        position += len(chunk)
+    out += struct.pack("<I", position)
+    for chunk in chunks:
+        out += chunk
+    out += bytes(index_offset - len(out))
+    for block in blocks:
+        out += block
+    return bytes(out), len(entries), skipped, len(definitions)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a StarDict, dictd or TSV dictionary to .cpdict")
+    parser.add_argument("input", type=Path, help=".ifo (StarDict), .index (dictd) or .tsv/.txt file")
+    parser.add_argument("output", type=Path, help="output .cpdict file")
+    parser.add_argument("--name", help="name shown on the device (default: from the input)")
+    args = parser.parse_args()
+
+    readers = {".ifo": read_stardict, ".index": read_dictd, ".tsv": read_tsv, ".txt": read_tsv}
+    reader = readers.get(args.input.suffix.lower())
+    if reader is None:
+        sys.exit(f"Unsupported input {args.input}: expected .ifo, .index, .tsv or .txt")
+    name, pairs = reader(args.input)
+
+    data, entry_count, skipped, text_bytes = build(pairs, args.name or name)
+    args.output.write_bytes(data)
+    print(f"{args.output}: {entry_count} entries ({skipped} skipped), {text_bytes // 1024} KB of text "
+          f"in {len(data) // 1024} KB")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+Local HTTP stand-in for testing book downloads (HttpDownloader) on an unreliable connection.
+
+Serves the files of a directory with Range, ETag/Last-Modified and If-Range support, plus a minimal OPDS catalog at
+/opds listing every .epub, so the device's OPDS browser can be pointed straight at it. With --page-size the catalog is
+split into pages linked by rel="next"; it carries an ETag and answers If-None-Match with 304. Connections can be dropped
+after a number of body bytes and throttled, to check that interrupted downloads resume instead of starting over.
+Every request is logged with the range asked for and what was sent.
+
+Usage:
+    python http_download_standin.py <directory> [--port 8080] [--drop-after BYTES] [--rate KBPS] [--page-size N]
+
+Example:
+    python http_download_standin.py ~/books --drop-after 300000 --rate 200
+    # On the device, set the OPDS server URL to http://<this computer>:8080/opds and download a book: the log shows
+    # one 200 response cut short, then 206 responses continuing where the previous one stopped.
+"""
+
+import argparse
+import email.utils
+import hashlib
+import html
+import os
+import sys
+import time
+import urllib.parse
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+
+class StandInHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    root = "."
+    drop_after = 0
+    rate = 0.0
+    no_range = False
+    no_validators = False
+    page_size = 0
+
+    def log_message(self, format, *args):
+        sys.stderr.write(f"[{time.strftime('%H:%M:%S')}] {format % args}\n")
+
+    def do_GET(self):
+        url = urllib.parse.urlparse(self.path)
+        path = urllib.parse.unquote(url.path)
+        if path.rstrip("/") == "/opds":
+            page = urllib.parse.parse_qs(url.query).get("page", ["0"])[0]
+            self.send_catalog(int(page) if page.isdigit() else 0)
+            return
+        full = os.path.realpath(os.path.join(self.root, path.lstrip("/")))
+        if not full.startswith(os.path.realpath(self.root)) or not os.path.isfile(full):
+            self.send_error(404)
+            return
+        self.send_file(full)
+
+    def send_catalog(self, page):
+        names = sorted(name for name in os.listdir(self.root) if name.lower().endswith(".epub"))
+        next_link = ""
+        if self.page_size > 0:
+            if (page + 1) * self.page_size < len(names):
+                next_link = f'<link rel="next" type="application/atom+xml" href="/opds?page={page + 1}"/>'
+            names = names[page * self.page_size : (page + 1) * self.page_size]
+        entries = []
+        for name in names:
+            title = html.escape(os.path.splitext(name)[0])
+            href = html.escape("/" + urllib.parse.quote(name))
+            entries.append(
+                f"<entry><title>{title}</title><id>{href}</id>"
+                f'<link rel="http://opds-spec.org/acquisition" type="application/epub+zip" href="{href}"/></entry>'
+            )
+        body = (
+            '<?xml version="1.0" encoding="UTF-8"?>'
+            '<feed xmlns="http://www.w3.org/2005/Atom"><title>Stand-in</title>'
+            + next_link
+            + "".join(entries)
+            + "</feed>"
+        ).encode()
+        etag = '"' + hashlib.md5(body).hexdigest()[:16] + '"'
+        if not self.no_validators and self.headers.get("If-None-Match") == etag:
+            self.send_response(304)
+            self.send_header("ETag", etag)
+            self.end_headers()
+            self.log_message("catalog page %d not modified", page)
+            return
+        self.send_response(200)
+        self.send_header("Content-Type", "application/atom+xml")
+        self.send_header("Content-Length", str(len(body)))
+        if not self.no_validators:
+            self.send_header("ETag", etag)
+        self.end_headers()
+        self.wfile.write(body)
+        self.log_message("catalog page %d, %d entries%s", page, len(entries), " (more)" if next_link else "")
+
+    def send_file(self, full):
+        stat = os.stat(full)
+        size = stat.st_size
+        etag = '"' + hashlib.md5(f"{size}-{stat.st_mtime_ns}".encode()).hexdigest()[:16] + '"'
+        last_modified = email.utils.formatdate(stat.st_mtime, usegmt=True)
+
+        first, last = 0, size - 1
+        status = 200
+        range_header = self.headers.get("Range")
+        if_range = self.headers.get("If-Range")
+        if range_header and not self.no_range and (if_range is None or if_range in (etag, last_modified)):
+            spec = range_header.removeprefix("bytes=")
+            start, _, end = spec.partition("-")
+            if "," not in spec and start.isdigit():
+                first = int(start)
+                last = min(int(end), size - 1) if end.isdigit() else size - 1
+                if first >= size:
+                    self.send_response(416)
+                    self.send_header("Content-Range", f"bytes */{size}")
+                    self.send_header("Content-Length", "0")
+                    self.end_headers()
+                    return
+                status = 206
+
+        length = last - first + 1
+        self.send_response(status)
+        self.send_header("Content-Type", "application/epub+zip")
+        self.send_header("Content-Length", str(length))
+        self.send_header("Accept-Ranges", "none" if self.no_range else "bytes")
+        if not self.no_validators:
+            self.send_header("ETag", etag)
+            self.send_header("Last-Modified", last_modified)
+        if status == 206:
+            self.send_header("Content-Range", f"bytes {first}-{last}/{size}")
+        self.end_headers()
+
+        budget = self.drop_after if self.drop_after > 0 else length
+        sent = 0
+        started = time.monotonic()
+        with open(full, "rb") as f:
+            f.seek(first)
+            while sent < min(length, budget):
+                chunk = f.read(min(4096, min(length, budget) - sent))
+                if not chunk:
+                    break
+                self.wfile.write(chunk)
+                sent += len(chunk)
+                if self.rate > 0:
+                    # Sleep until the average rate is back at the limit
+                    ahead = sent / (self.rate * 1024) - (time.monotonic() - started)
+                    if ahead > 0:
+                        time.sleep(ahead)
+        dropped = sent < length
+        self.log_message(
+            "%s %d bytes %d-%d of %d, sent %d%s", os.path.basename(full), status, first, last, size, sent,
+            " (dropped)" if dropped else "",
+        )
+        if dropped:
+            self.close_connection = True
+            self.connection.shutdown(2)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="HTTP stand-in server for download testing")
+    parser.add_argument("directory", help="Directory to serve")
+    parser.add_argument("--port", type=int, default=8080)
+    parser.add_argument("--drop-after", type=int, default=0, help="Close each response after this many body bytes")
+    parser.add_argument("--rate", type=float, default=0.0, help="Limit each response to this many KB/s")
+    parser.add_argument("--no-range", action="store_true", help="Ignore Range headers (always send 200)")
+    parser.add_argument("--no-validators", action="store_true", help="Send no ETag or Last-Modified")
+    parser.add_argument("--page-size", type=int, default=0, help="Split the OPDS catalog into pages of N entries")
+    args = parser.parse_args()
+
+    StandInHandler.root = args.directory
+    StandInHandler.drop_after = args.drop_after
+    StandInHandler.rate = args.rate
+    StandInHandler.no_range = args.no_range
+    StandInHandler.no_validators = args.no_validators
+    StandInHandler.page_size = args.page_size
+
+    server = ThreadingHTTPServer(("0.0.0.0", args.port), StandInHandler)
+    print(f"Serving {args.directory} on port {args.port} (OPDS catalog at /opds)")
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
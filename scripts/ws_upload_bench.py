@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+"""
+Load client for the WebSocket upload endpoint (port 81), with a sustained-throughput report.
+
+Uploads a generated file with the legacy protocol (START, flow control left to TCP) and/or the windowed protocol
+(START2, credit window with ACK messages) and reports KB/s for each. Run it against a device, or without a host to
+start a local stand-in server that mimics the firmware: the legacy handler writes every frame to the card as it
+arrives; the windowed handler copies frames into two 16 KB blocks that a writer thread puts on the card. Card writes
+are simulated with a per-write overhead plus a sustained rate, and socket buffers are shrunk to lwIP-like sizes.
+
+Usage:
+    python ws_upload_bench.py [host] [--size-kb N] [--protocol legacy|windowed|both]
+
+Examples:
+    python ws_upload_bench.py                      # stand-in server on localhost
+    python ws_upload_bench.py 192.168.1.102 --path /bench --size-kb 4096
+"""
+
+import argparse
+import base64
+import hashlib
+import os
+import socket
+import struct
+import sys
+import threading
+import time
+
+WS_GUID = b"258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+OP_TEXT = 0x1
+OP_BINARY = 0x2
+OP_CLOSE = 0x8
+# lwIP's default TCP window on the ESP32 is about 4 segments
+SOCKET_BUFFER_BYTES = 5744
+LEGACY_CHUNK_BYTES = 4096
+
+
+# === WebSocket framing ===
+
+
+def recv_exact(sock, n):
+    data = bytearray()
+    while len(data) < n:
+        part = sock.recv(n - len(data))
+        if not part:
+            raise ConnectionError("connection closed")
+        data += part
+    return bytes(data)
+
+
+def send_frame(sock, opcode, payload, mask):
+    header = bytearray([0x80 | opcode])
+    mask_bit = 0x80 if mask else 0
+    if len(payload) < 126:
+        header.append(mask_bit | len(payload))
+    elif len(payload) < 65536:
+        header.append(mask_bit | 126)
+        header += struct.pack(">H", len(payload))
+    else:
+        header.append(mask_bit | 127)
+        header += struct.pack(">Q", len(payload))
+    if mask:
+        key = os.urandom(4)
+        header += key
+        # Masking byte by byte is slow in Python; XOR the whole payload as one integer instead
+        repeated = (key * (len(payload) // 4 + 1))[: len(payload)]
+        payload = (int.from_bytes(payload, "big") ^ int.from_bytes(repeated, "big")).to_bytes(len(payload), "big")
+    sock.sendall(bytes(header) + payload)
+
+
+def recv_frame(sock):
+    b0, b1 = recv_exact(sock, 2)
+    length = b1 & 0x7F
+    if length == 126:
+        (length,) = struct.unpack(">H", recv_exact(sock, 2))
+    elif length == 127:
+        (length,) = struct.unpack(">Q", recv_exact(sock, 8))
+    key = recv_exact(sock, 4) if b1 & 0x80 else None
+    payload = recv_exact(sock, length)
+    if key:
+        repeated = (key * (length // 4 + 1))[:length]
+        payload = (int.from_bytes(payload, "big") ^ int.from_bytes(repeated, "big")).to_bytes(length, "big")
+    return b0 & 0x0F, payload
+
+
+def client_handshake(host, port):
+    sock = socket.create_connection((host, port))
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, SOCKET_BUFFER_BYTES)
+    sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    key = base64.b64encode(os.urandom(16)).decode()
+    request = (
+        f"GET / HTTP/1.1\r\nHost: {host}:{port}\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+        f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n\r\n"
+    )
+    sock.sendall(request.encode())
+    response = b""
+    while b"\r\n\r\n" not in response:
+        part = sock.recv(1024)
+        if not part:
+            raise ConnectionError("handshake failed")
+        response += part
+    if b" 101 " not in response.split(b"\r\n", 1)[0]:
+        raise ConnectionError(f"handshake rejected: {response.splitlines()[0]!r}")
+    return sock
+
+
+# === Load client ===
+
+
+def upload(host, port, protocol, name, data, path):
+    """Uploads `data` and returns the seconds from START to DONE."""
+    sock = client_handshake(host, port)
+    command = "START2" if protocol == "windowed" else "START"
+    start = time.monotonic()
+    send_frame(sock, OP_TEXT, f"{command}:{name}:{len(data)}:{path}".encode(), mask=True)
+
+    _, reply = recv_frame(sock)
+    reply = reply.decode()
+    if not reply.startswith("READY"):
+        raise RuntimeError(f"unexpected reply: {reply}")
+
+    # Control messages are read on a separate thread so acknowledgements are seen while the sender is blocked
+    acked = 0
+    outcome = None
+    changed = threading.Condition()
+
+    def reader():
+        nonlocal acked, outcome
+        try:
+            while outcome is None:
+                opcode, payload = recv_frame(sock)
+                message = payload.decode(errors="replace") if opcode == OP_TEXT else ""
+                with changed:
+                    if message.startswith("ACK:"):
+                        acked = int(message[4:])
+                    elif message == "DONE" or message.startswith("ERROR:"):
+                        outcome = message
+                    elif opcode == OP_CLOSE:
+                        outcome = "ERROR:closed"
+                    changed.notify_all()
+        except (ConnectionError, OSError):
+            with changed:
+                outcome = outcome or "ERROR:connection lost"
+                changed.notify_all()
+
+    thread = threading.Thread(target=reader, daemon=True)
+    thread.start()
+
+    if protocol == "windowed":
+        parts = reply.split(":")
+        chunk_bytes = int(parts[1])
+        window_bytes = chunk_bytes * int(parts[2])
+    else:
+        chunk_bytes = LEGACY_CHUNK_BYTES
+        window_bytes = None
+
+    offset = 0
+    while offset < len(data):
+        chunk = data[offset : offset + chunk_bytes]
+        if window_bytes is not None:
+            with changed:
+                changed.wait_for(lambda: offset + len(chunk) - acked <= window_bytes or outcome is not None)
+        if outcome is not None:
+            break
+        send_frame(sock, OP_BINARY, chunk, mask=True)
+        offset += len(chunk)
+
+    with changed:
+        changed.wait_for(lambda: outcome is not None, timeout=120)
+    elapsed = time.monotonic() - start
+    try:
+        send_frame(sock, OP_CLOSE, b"", mask=True)
+    except OSError:
+        pass
+    sock.close()
+    if outcome != "DONE":
+        raise RuntimeError(outcome or "timed out waiting for DONE")
+    return elapsed
+
+
+# === Stand-in server ===
+
+
+class SimulatedCard:
+    """Sleeps for as long as the card would take to write `length` bytes."""
+
+    def __init__(self, overhead_ms, rate_kbps):
+        self.overhead = overhead_ms / 1000.0
+        self.rate = rate_kbps * 1024.0
+        self.bytes_written = 0
+
+    def write(self, length):
+        time.sleep(self.overhead + length / self.rate)
+        self.bytes_written += length
+
+
+class BlockWriter:
+    """Mirrors src/network/UploadBlockWriter: two blocks, one being filled while the other is written."""
+
+    BLOCK_SIZE = 16 * 1024
+
+    def __init__(self, card):
+        self.card = card
+        self.fill_length = 0
+        self.idle = threading.Event()
+        self.idle.set()
+
+    def _write_block(self, length):
+        self.card.write(length)
+        self.idle.set()
+
+    def append(self, length):
+        while length > 0:
+            n = min(length, self.BLOCK_SIZE - self.fill_length)
+            self.fill_length += n
+            length -= n
+            if self.fill_length == self.BLOCK_SIZE:
+                self.idle.wait()
+                self.idle.clear()
+                threading.Thread(target=self._write_block, args=(self.fill_length,), daemon=True).start()
+                self.fill_length = 0
+
+    def finish(self):
+        self.idle.wait()
+        if self.fill_length:
+            self.card.write(self.fill_length)
+            self.fill_length = 0
+
+
+def serve_connection(conn, args):
+    request = b""
+    while b"\r\n\r\n" not in request:
+        part = conn.recv(1024)
+        if not part:
+            return
+        request += part
+    key = next(
+        line.split(b":", 1)[1].strip()
+        for line in request.split(b"\r\n")
+        if line.lower().startswith(b"sec-websocket-key:")
+    )
+    accept = base64.b64encode(hashlib.sha1(key + WS_GUID).digest()).decode()
+    conn.sendall(
+        (
+            "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+            f"Sec-WebSocket-Accept: {accept}\r\n\r\n"
+        ).encode()
+    )
+
+    card = SimulatedCard(args.write_overhead_ms, args.card_kbps)
+    windowed = False
+    size = received = last_report = 0
+    writer = None
+    while True:
+        try:
+            opcode, payload = recv_frame(conn)
+        except ConnectionError:
+            return
+        if opcode == OP_CLOSE:
+            return
+        if opcode == OP_TEXT:
+            message = payload.decode()
+            windowed = message.startswith("START2:")
+            size = int(message.split(":")[2])
+            received = last_report = 0
+            writer = BlockWriter(card) if windowed else None
+            reply = "READY:4096:8" if windowed else "READY"
+            send_frame(conn, OP_TEXT, reply.encode(), mask=False)
+            continue
+
+        if writer:
+            writer.append(len(payload))
+        else:
+            card.write(len(payload))
+        received += len(payload)
+        if received < size:
+            if windowed and received - last_report >= 4096 * 8 // 2:
+                send_frame(conn, OP_TEXT, f"ACK:{received}".encode(), mask=False)
+                last_report = received
+            elif not windowed and received - last_report >= 65536:
+                send_frame(conn, OP_TEXT, f"PROGRESS:{received}:{size}".encode(), mask=False)
+                last_report = received
+        if received >= size:
+            if writer:
+                writer.finish()
+            send_frame(conn, OP_TEXT, b"DONE", mask=False)
+
+
+def start_stand_in(args):
+    server = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    server.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, SOCKET_BUFFER_BYTES)
+    server.bind(("127.0.0.1", 0))
+    server.listen(1)
+
+    def accept_loop():
+        while True:
+            conn, _ = server.accept()
+            with conn:
+                serve_connection(conn, args)
+
+    threading.Thread(target=accept_loop, daemon=True).start()
+    return server.getsockname()[1]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="WebSocket upload throughput benchmark")
+    parser.add_argument("host", nargs="?", help="Device address; omit to use a local stand-in server")
+    parser.add_argument("--port", type=int, default=81)
+    parser.add_argument("--size-kb", type=int, default=2048, help="Size of the uploaded file")
+    parser.add_argument("--protocol", choices=["legacy", "windowed", "both"], default="both")
+    parser.add_argument("--path", default="/", help="Destination folder on the device")
+    parser.add_argument("--runs", type=int, default=3, help="Uploads per protocol; the median is reported")
+    parser.add_argument("--write-overhead-ms", type=float, default=4.0, help="Stand-in: fixed cost of a card write")
+    parser.add_argument("--card-kbps", type=float, default=1200.0, help="Stand-in: sustained card write rate")
+    args = parser.parse_args()
+
+    host, port = args.host, args.port
+    if host is None:
+        host, port = "127.0.0.1", start_stand_in(args)
+        print(
+            f"Stand-in server on port {port} "
+            f"(card: {args.write_overhead_ms:g} ms per write + {args.card_kbps:g} KB/s)"
+        )
+
+    data = os.urandom(args.size_kb * 1024)
+    protocols = ["legacy", "windowed"] if args.protocol == "both" else [args.protocol]
+    print(f"{'protocol':<10} {'size KB':>8} {'median s':>9} {'KB/s':>8}")
+    for protocol in protocols:
+        times = sorted(
+            upload(host, port, protocol, f"ws_bench_{protocol}.bin", data, args.path) for _ in range(args.runs)
+        )
+        median = times[len(times) // 2]
+        print(f"{protocol:<10} {args.size_kb:>8} {median:>9.2f} {args.size_kb / median:>8.1f}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
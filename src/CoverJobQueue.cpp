@@ -0,0 +1,313 @@
+#include "CoverJobQueue.h"
+
+#include <Epub.h>
+#include <Epub/Section.h>
+#include <HalStorage.h>
+#include <KOReaderCredentialStore.h>
+#include <KOReaderDocumentId.h>
+#include <Logging.h>
+#include <Markdown.h>
+#include <Serialization.h>
+#include <Txt.h>
+#include <Xtc.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "CrossPointSettings.h"
+#include "CrossPointState.h"
+#include "LibraryCatalog.h"
+#include "components/UITheme.h"
+
+namespace {
+constexpr uint8_t COVER_JOBS_FILE_VERSION = 1;
+constexpr char COVER_JOBS_FILE[] = "/.crosspoint/cover_jobs.bin";
+// Plenty for a batch upload; anything beyond is generated on demand as before
+constexpr size_t MAX_COVER_JOBS = 64;
+// Paginating a chapter needs a few tens of KB; below this (e.g. with the web server up) the reader does it on open
+constexpr uint32_t MIN_FREE_HEAP_FOR_PAGINATION = 96 * 1024;
+
+bool wantsDocumentHash() {
+  return KOREADER_STORE.hasCredentials() && KOREADER_STORE.getMatchMethod() == DocumentMatchMethod::BINARY;
+}
+}  // namespace
+
+CoverJobQueue CoverJobQueue::instance;
+
+void CoverJobQueue::begin(GfxRenderer& renderer) {
+  if (taskHandle) {
+    return;
+  }
+  this->renderer = &renderer;
+  jobsMutex = xSemaphoreCreateMutex();
+  loadFromFile();
+  xTaskCreate(&CoverJobQueue::taskTrampoline, "CoverJobs", 8192, this, tskIDLE_PRIORITY, &taskHandle);
+}
+
+void CoverJobQueue::enqueue(const std::string& bookPath) {
+  const BookFormat format = LibraryCatalog::formatForName(bookPath);
+  if (format == BookFormat::Folder || format == BookFormat::Csv) {
+    return;
+  }
+  waitUntilIdle();
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  const bool queued = std::find(jobs.begin(), jobs.end(), bookPath) == jobs.end() && jobs.size() < MAX_COVER_JOBS;
+  if (queued) {
+    jobs.push_back(bookPath);
+  }
+  xSemaphoreGive(jobsMutex);
+  if (queued) {
+    LOG_DBG("CVQ", "Queued cover job for %s", bookPath.c_str());
+    saveToFile();
+  }
+}
+
+void CoverJobQueue::startHashSweep() {
+  if (!jobsMutex) {
+    return;
+  }
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  if (sweepDirs.empty() && sweepBooks.empty()) {
+    sweepDirs.emplace_back("/");
+  }
+  xSemaphoreGive(jobsMutex);
+  LOG_DBG("CVQ", "Started KOReader hash sweep");
+}
+
+bool CoverJobQueue::isHashSweepRunning() {
+  if (!jobsMutex) {
+    return false;
+  }
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  const bool running = !sweepDirs.empty() || !sweepBooks.empty();
+  xSemaphoreGive(jobsMutex);
+  return running;
+}
+
+bool CoverJobQueue::hasPending() {
+  if (!jobsMutex) {
+    return false;
+  }
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  const bool pending =
+      !jobs.empty() || LIBRARY_CATALOG.hasUncheckedDirectories() || !sweepDirs.empty() || !sweepBooks.empty();
+  xSemaphoreGive(jobsMutex);
+  return pending;
+}
+
+void CoverJobQueue::runNextJob() {
+  if (!taskHandle || busy || !hasPending()) {
+    return;
+  }
+  busy = true;
+  xTaskNotifyGive(taskHandle);
+}
+
+void CoverJobQueue::waitUntilIdle() const {
+  while (busy) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+void CoverJobQueue::taskTrampoline(void* param) {
+  auto* self = static_cast<CoverJobQueue*>(param);
+  self->taskLoop();
+}
+
+void CoverJobQueue::taskLoop() {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    xSemaphoreTake(jobsMutex, portMAX_DELAY);
+    std::string bookPath;
+    if (!jobs.empty()) {
+      bookPath = std::move(jobs.front());
+      jobs.erase(jobs.begin());
+    }
+    xSemaphoreGive(jobsMutex);
+
+    if (!bookPath.empty()) {
+      // Drop the job from the card before starting it: a book whose cover or chapter crashes the decoder or trips the
+      // watchdog is tried once, not again after every reboot. The reader builds what's missing on open.
+      saveToFile();
+
+      const unsigned long start = millis();
+      const bool ok = Storage.exists(bookPath.c_str()) && preIndex(bookPath);
+      LOG_DBG("CVQ", "Pre-index job for %s %s in %lu ms", bookPath.c_str(), ok ? "done" : "had no cover",
+              millis() - start);
+    } else if (LIBRARY_CATALOG.hasUncheckedDirectories()) {
+      LIBRARY_CATALOG.checkNextDirectory();
+    } else {
+      sweepStep();
+    }
+
+    busy = false;
+  }
+}
+
+bool CoverJobQueue::preIndex(const std::string& bookPath) const {
+  if (LibraryCatalog::formatForName(bookPath) != BookFormat::Epub) {
+    return generateCovers(bookPath);
+  }
+
+  // Unlike generateCovers(), build the CSS cache too: the reader needs it
+  const auto epub = std::make_shared<Epub>(bookPath, "/.crosspoint");
+  if (!epub->load(true, false)) {
+    return false;
+  }
+  const bool covers = epub->generateCoverBmps(UITheme::getCoverThumbHeights());
+  paginateFirstChapter(epub);
+  if (wantsDocumentHash()) {
+    KOReaderDocumentId::calculate(bookPath, epub->getCachePath());
+  }
+  return covers;
+}
+
+void CoverJobQueue::sweepStep() {
+  std::string bookPath;
+  std::string dirPath;
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  if (!sweepBooks.empty()) {
+    bookPath = std::move(sweepBooks.back());
+    sweepBooks.pop_back();
+  } else if (!sweepDirs.empty()) {
+    dirPath = std::move(sweepDirs.back());
+    sweepDirs.pop_back();
+  }
+  xSemaphoreGive(jobsMutex);
+
+  if (!bookPath.empty()) {
+    // Only the cache path is needed; the book itself isn't loaded
+    if (Storage.exists(bookPath.c_str())) {
+      KOReaderDocumentId::calculate(bookPath, Epub(bookPath, "/.crosspoint").getCachePath());
+    }
+    return;
+  }
+  if (dirPath.empty()) {
+    return;
+  }
+
+  // Listing through the catalog also leaves the folder ready for the library screen
+  std::vector<CatalogEntry> entries;
+  LIBRARY_CATALOG.listDirectory(dirPath, entries);
+  const std::string prefix = dirPath == "/" ? dirPath : dirPath + "/";
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  for (const auto& entry : entries) {
+    if (entry.format == BookFormat::Folder) {
+      sweepDirs.push_back(prefix + entry.name.substr(0, entry.name.size() - 1));
+    } else if (entry.format == BookFormat::Epub) {
+      sweepBooks.push_back(prefix + entry.name);
+    }
+  }
+  const bool done = sweepDirs.empty() && sweepBooks.empty();
+  xSemaphoreGive(jobsMutex);
+  if (done) {
+    LOG_DBG("CVQ", "KOReader hash sweep finished");
+  }
+}
+
+void CoverJobQueue::paginateFirstChapter(const std::shared_ptr<Epub>& epub) const {
+  const uint16_t viewportWidth = APP_STATE.readerViewportWidth;
+  const uint16_t viewportHeight = APP_STATE.readerViewportHeight;
+  if (!renderer || viewportWidth == 0 || viewportHeight == 0) {
+    return;
+  }
+  if (ESP.getFreeHeap() < MIN_FREE_HEAP_FOR_PAGINATION) {
+    LOG_DBG("CVQ", "Not enough memory to paginate %s in the background", epub->getPath().c_str());
+    return;
+  }
+
+  // The chapter EpubReaderActivity opens a new book at
+  Section section(epub, epub->getSpineIndexForTextReference(), *renderer);
+  if (section.loadSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
+                              SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
+                              viewportHeight, SETTINGS.hyphenationEnabled, SETTINGS.embeddedStyle)) {
+    return;
+  }
+  section.createSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
+                            SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth, viewportHeight,
+                            SETTINGS.hyphenationEnabled, SETTINGS.embeddedStyle);
+}
+
+bool CoverJobQueue::generateCovers(const std::string& bookPath) {
+  const std::vector<int> thumbHeights = UITheme::getCoverThumbHeights();
+
+  switch (LibraryCatalog::formatForName(bookPath)) {
+    case BookFormat::Epub: {
+      Epub epub(bookPath, "/.crosspoint");
+      // Skip loading css since we only need metadata here
+      return epub.load(true, true) && epub.generateCoverBmps(thumbHeights);
+    }
+    case BookFormat::Xtc:
+    case BookFormat::Xtch: {
+      // XTC pages are already bitmaps; there's no image decode to share between sizes
+      Xtc xtc(bookPath, "/.crosspoint");
+      if (!xtc.load() || !xtc.generateCoverBmp()) {
+        return false;
+      }
+      bool ok = true;
+      for (const int height : thumbHeights) {
+        ok = xtc.generateThumbBmp(height) && ok;
+      }
+      return ok;
+    }
+    case BookFormat::Txt: {
+      Txt txt(bookPath, "/.crosspoint");
+      return txt.load() && txt.generateCoverBmp();
+    }
+    case BookFormat::Markdown: {
+      Markdown markdown(bookPath, "/.crosspoint");
+      return markdown.load() && markdown.generateCoverBmp();
+    }
+    default:
+      return false;
+  }
+}
+
+bool CoverJobQueue::saveToFile() const {
+  Storage.mkdir("/.crosspoint");
+
+  FsFile outputFile;
+  if (!Storage.openFileForWrite("CVQ", COVER_JOBS_FILE, outputFile)) {
+    return false;
+  }
+
+  xSemaphoreTake(jobsMutex, portMAX_DELAY);
+  serialization::writePod(outputFile, COVER_JOBS_FILE_VERSION);
+  serialization::writePod(outputFile, static_cast<uint16_t>(jobs.size()));
+  for (const auto& job : jobs) {
+    serialization::writeString(outputFile, job);
+  }
+  xSemaphoreGive(jobsMutex);
+
+  outputFile.close();
+  return true;
+}
+
+bool CoverJobQueue::loadFromFile() {
+  FsFile inputFile;
+  if (!Storage.exists(COVER_JOBS_FILE) || !Storage.openFileForRead("CVQ", COVER_JOBS_FILE, inputFile)) {
+    return false;
+  }
+
+  uint8_t version;
+  serialization::readPod(inputFile, version);
+  if (version != COVER_JOBS_FILE_VERSION) {
+    LOG_ERR("CVQ", "Deserialization failed: Unknown version %u", version);
+    inputFile.close();
+    return false;
+  }
+
+  uint16_t count;
+  serialization::readPod(inputFile, count);
+  jobs.clear();
+  for (uint16_t i = 0; i < count && i < MAX_COVER_JOBS; i++) {
+    std::string path;
+    serialization::readString(inputFile, path);
+    jobs.push_back(std::move(path));
+  }
+
+  inputFile.close();
+  LOG_DBG("CVQ", "Loaded %d pending cover jobs", static_cast<int>(jobs.size()));
+  return true;
+}
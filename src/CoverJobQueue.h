@@ -0,0 +1,75 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Epub;
+class GfxRenderer;
+
+// Persistent queue of newly added books whose caches still need building, stored at /.crosspoint/cover_jobs.bin.
+// A job builds the book's metadata cache, its covers and thumbnails and, for EPUBs, the pages of the chapter a first
+// open lands on, so the first visit to Home and the first tap on the book find everything ready. Jobs run one at a
+// time on a low-priority task, and only when the main loop hands one over while the device is idle on USB power, or on
+// battery while the file transfer screen has no transfer going. With KOReader sync set up to match books by content, a
+// job also stores the book's document hash. Between books the task also re-checks library folders that were shown
+// from the catalog without being compared with the card (LibraryCatalog::checkNextDirectory()).
+//
+// The SD card is not safe to use from two tasks at once: the main loop must not run the current activity while
+// isBusy() and should call waitUntilIdle() before acting on input.
+class CoverJobQueue {
+  // Static instance
+  static CoverJobQueue instance;
+
+  std::vector<std::string> jobs;
+  SemaphoreHandle_t jobsMutex = nullptr;
+  TaskHandle_t taskHandle = nullptr;
+  GfxRenderer* renderer = nullptr;
+  volatile bool busy = false;
+  // KOReader hash sweep: folders still to list and EPUBs of the folder being swept. Not persisted.
+  std::vector<std::string> sweepDirs;
+  std::vector<std::string> sweepBooks;
+
+  [[noreturn]] static void taskTrampoline(void* param);
+  [[noreturn]] void taskLoop();
+  bool preIndex(const std::string& bookPath) const;
+  void paginateFirstChapter(const std::shared_ptr<Epub>& epub) const;
+  void sweepStep();
+  bool saveToFile() const;
+  bool loadFromFile();
+
+ public:
+  ~CoverJobQueue() = default;
+
+  // Get singleton instance
+  static CoverJobQueue& getInstance() { return instance; }
+
+  // Loads queued jobs from the card and starts the worker task. `renderer` measures text when paginating.
+  void begin(GfxRenderer& renderer);
+
+  // Queues `bookPath` if it is a book format with a cover; duplicates are ignored.
+  void enqueue(const std::string& bookPath);
+
+  // Computes the KOReader document hash of every EPUB in the library ahead of the first sync, one book per job
+  // once the queued books are done.
+  void startHashSweep();
+  bool isHashSweepRunning();
+
+  bool hasPending();
+  bool isBusy() const { return busy; }
+
+  // Hands the next job to the worker task. Call only while nothing else is using the SD card.
+  void runNextJob();
+  // Blocks until the job in flight (if any) has finished.
+  void waitUntilIdle() const;
+
+  // Writes the full-screen covers and the thumbnails for every theme height of `bookPath`, decoding the cover image
+  // once. Returns false if the book has no usable cover.
+  static bool generateCovers(const std::string& bookPath);
+};
+
+// Helper macro to access the cover job queue
+#define COVER_JOBS CoverJobQueue::getInstance()
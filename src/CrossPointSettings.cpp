@@ -1,20 +1,20 @@
 #include "CrossPointSettings.h"
 
-#include <HalStorage.h>
 #include <Logging.h>
 #include <Serialization.h>
 
 #include <cstring>
 #include <string>
 
+#include "StateStore.h"
 #include "fontIds.h"
 
 // Initialize the static instance
 CrossPointSettings CrossPointSettings::instance;
 
-void readAndValidate(FsFile& file, uint8_t& member, const uint8_t maxValue) {
+void readAndValidate(serialization::MemoryReader& in, uint8_t& member, const uint8_t maxValue) {
   uint8_t tempValue;
-  serialization::readPod(file, tempValue);
+  serialization::readPod(in, tempValue);
   if (tempValue < maxValue) {
     member = tempValue;
   }
@@ -23,6 +23,8 @@ void readAndValidate(FsFile& file, uint8_t& member, const uint8_t maxValue) {
 namespace {
 constexpr uint8_t SETTINGS_FILE_VERSION = 1;
 // SETTINGS_COUNT is now calculated automatically in saveToFile
+constexpr char SETTINGS_KEY[] = "settings";
+// Where settings were kept before the state store
 constexpr char SETTINGS_FILE[] = "/.crosspoint/settings.bin";
 
 // Validate front button mapping to ensure each hardware button is unique.
@@ -83,186 +85,182 @@ class SettingsWriter {
   uint8_t item_count = 0;
   template <typename T>
 
-  void writeItem(FsFile& file, const T& value) {
+  void writeItem(std::string& out, const T& value) {
     if (is_counting) {
       item_count++;
     } else {
-      serialization::writePod(file, value);
+      serialization::writePod(out, value);
     }
   }
 
-  void writeItemString(FsFile& file, const char* value) {
+  void writeItemString(std::string& out, const char* value) {
     if (is_counting) {
       item_count++;
     } else {
-      serialization::writeString(file, std::string(value));
+      serialization::writeString(out, std::string(value));
     }
   }
 };
 
-uint8_t CrossPointSettings::writeSettings(FsFile& file, bool count_only) const {
+uint8_t CrossPointSettings::writeSettings(std::string& out, bool count_only) const {
   SettingsWriter writer;
   writer.is_counting = count_only;
 
-  writer.writeItem(file, sleepScreen);
-  writer.writeItem(file, extraParagraphSpacing);
-  writer.writeItem(file, shortPwrBtn);
-  writer.writeItem(file, statusBar);
-  writer.writeItem(file, orientation);
-  writer.writeItem(file, frontButtonLayout);  // legacy
-  writer.writeItem(file, sideButtonLayout);
-  writer.writeItem(file, fontFamily);
-  writer.writeItem(file, fontSize);
-  writer.writeItem(file, lineSpacing);
-  writer.writeItem(file, paragraphAlignment);
-  writer.writeItem(file, sleepTimeout);
-  writer.writeItem(file, refreshFrequency);
-  writer.writeItem(file, screenMargin);
-  writer.writeItem(file, sleepScreenCoverMode);
-  writer.writeItemString(file, opdsServerUrl);
-  writer.writeItem(file, textAntiAliasing);
-  writer.writeItem(file, hideBatteryPercentage);
-  writer.writeItem(file, longPressChapterSkip);
-  writer.writeItem(file, hyphenationEnabled);
-  writer.writeItemString(file, opdsUsername);
-  writer.writeItemString(file, opdsPassword);
-  writer.writeItem(file, sleepScreenCoverFilter);
-  writer.writeItem(file, uiTheme);
-  writer.writeItem(file, frontButtonBack);
-  writer.writeItem(file, frontButtonConfirm);
-  writer.writeItem(file, frontButtonLeft);
-  writer.writeItem(file, frontButtonRight);
-  writer.writeItem(file, fadingFix);
-  writer.writeItem(file, embeddedStyle);
-  writer.writeItem(file, ankiDailyGoal);
+  writer.writeItem(out, sleepScreen);
+  writer.writeItem(out, extraParagraphSpacing);
+  writer.writeItem(out, shortPwrBtn);
+  writer.writeItem(out, statusBar);
+  writer.writeItem(out, orientation);
+  writer.writeItem(out, frontButtonLayout);  // legacy
+  writer.writeItem(out, sideButtonLayout);
+  writer.writeItem(out, fontFamily);
+  writer.writeItem(out, fontSize);
+  writer.writeItem(out, lineSpacing);
+  writer.writeItem(out, paragraphAlignment);
+  writer.writeItem(out, sleepTimeout);
+  writer.writeItem(out, refreshFrequency);
+  writer.writeItem(out, screenMargin);
+  writer.writeItem(out, sleepScreenCoverMode);
+  writer.writeItemString(out, opdsServerUrl);
+  writer.writeItem(out, textAntiAliasing);
+  writer.writeItem(out, hideBatteryPercentage);
+  writer.writeItem(out, longPressChapterSkip);
+  writer.writeItem(out, hyphenationEnabled);
+  writer.writeItemString(out, opdsUsername);
+  writer.writeItemString(out, opdsPassword);
+  writer.writeItem(out, sleepScreenCoverFilter);
+  writer.writeItem(out, uiTheme);
+  writer.writeItem(out, frontButtonBack);
+  writer.writeItem(out, frontButtonConfirm);
+  writer.writeItem(out, frontButtonLeft);
+  writer.writeItem(out, frontButtonRight);
+  writer.writeItem(out, fadingFix);
+  writer.writeItem(out, embeddedStyle);
+  writer.writeItem(out, ankiDailyGoal);
   // New fields need to be added at end for backward compatibility
 
   return writer.item_count;
 }
 
 bool CrossPointSettings::saveToFile() const {
-  // Make sure the directory exists
-  Storage.mkdir("/.crosspoint");
-
-  FsFile outputFile;
-  if (!Storage.openFileForWrite("CPS", SETTINGS_FILE, outputFile)) {
-    return false;
-  }
+  std::string data;
 
   // First pass: count the items
-  uint8_t item_count = writeSettings(outputFile, true);  // This will just count, not write
+  uint8_t item_count = writeSettings(data, true);  // This will just count, not write
 
   // Write header
-  serialization::writePod(outputFile, SETTINGS_FILE_VERSION);
-  serialization::writePod(outputFile, static_cast<uint8_t>(item_count));
+  serialization::writePod(data, SETTINGS_FILE_VERSION);
+  serialization::writePod(data, static_cast<uint8_t>(item_count));
   // Second pass: actually write the settings
-  writeSettings(outputFile);  // This will write the actual data
+  writeSettings(data);  // This will write the actual data
 
-  outputFile.close();
+  if (!STATE_STORE.put(SETTINGS_KEY, data)) {
+    return false;
+  }
 
-  LOG_DBG("CPS", "Settings saved to file");
+  LOG_DBG("CPS", "Settings saved");
   return true;
 }
 
 bool CrossPointSettings::loadFromFile() {
-  FsFile inputFile;
-  if (!Storage.openFileForRead("CPS", SETTINGS_FILE, inputFile)) {
+  std::string data;
+  if (!STATE_STORE.get(SETTINGS_KEY, data, SETTINGS_FILE)) {
     return false;
   }
+  serialization::MemoryReader input(data);
 
   uint8_t version;
-  serialization::readPod(inputFile, version);
+  serialization::readPod(input, version);
   if (version != SETTINGS_FILE_VERSION) {
     LOG_ERR("CPS", "Deserialization failed: Unknown version %u", version);
-    inputFile.close();
     return false;
   }
 
   uint8_t fileSettingsCount = 0;
-  serialization::readPod(inputFile, fileSettingsCount);
+  serialization::readPod(input, fileSettingsCount);
 
   // load settings that exist (support older files with fewer fields)
   uint8_t settingsRead = 0;
   // Track whether remap fields were present in the settings file.
   bool frontButtonMappingRead = false;
   do {
-    readAndValidate(inputFile, sleepScreen, SLEEP_SCREEN_MODE_COUNT);
+    readAndValidate(input, sleepScreen, SLEEP_SCREEN_MODE_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    serialization::readPod(inputFile, extraParagraphSpacing);
+    serialization::readPod(input, extraParagraphSpacing);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, shortPwrBtn, SHORT_PWRBTN_COUNT);
+    readAndValidate(input, shortPwrBtn, SHORT_PWRBTN_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, statusBar, STATUS_BAR_MODE_COUNT);
+    readAndValidate(input, statusBar, STATUS_BAR_MODE_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, orientation, ORIENTATION_COUNT);
+    readAndValidate(input, orientation, ORIENTATION_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, frontButtonLayout, FRONT_BUTTON_LAYOUT_COUNT);  // legacy
+    readAndValidate(input, frontButtonLayout, FRONT_BUTTON_LAYOUT_COUNT);  // legacy
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, sideButtonLayout, SIDE_BUTTON_LAYOUT_COUNT);
+    readAndValidate(input, sideButtonLayout, SIDE_BUTTON_LAYOUT_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, fontFamily, FONT_FAMILY_COUNT);
+    readAndValidate(input, fontFamily, FONT_FAMILY_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, fontSize, FONT_SIZE_COUNT);
+    readAndValidate(input, fontSize, FONT_SIZE_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, lineSpacing, LINE_COMPRESSION_COUNT);
+    readAndValidate(input, lineSpacing, LINE_COMPRESSION_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, paragraphAlignment, PARAGRAPH_ALIGNMENT_COUNT);
+    readAndValidate(input, paragraphAlignment, PARAGRAPH_ALIGNMENT_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, sleepTimeout, SLEEP_TIMEOUT_COUNT);
+    readAndValidate(input, sleepTimeout, SLEEP_TIMEOUT_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, refreshFrequency, REFRESH_FREQUENCY_COUNT);
+    readAndValidate(input, refreshFrequency, REFRESH_FREQUENCY_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    serialization::readPod(inputFile, screenMargin);
+    serialization::readPod(input, screenMargin);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, sleepScreenCoverMode, SLEEP_SCREEN_COVER_MODE_COUNT);
+    readAndValidate(input, sleepScreenCoverMode, SLEEP_SCREEN_COVER_MODE_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
     {
       std::string urlStr;
-      serialization::readString(inputFile, urlStr);
+      serialization::readString(input, urlStr);
       strncpy(opdsServerUrl, urlStr.c_str(), sizeof(opdsServerUrl) - 1);
       opdsServerUrl[sizeof(opdsServerUrl) - 1] = '\0';
     }
     if (++settingsRead >= fileSettingsCount) break;
-    serialization::readPod(inputFile, textAntiAliasing);
+    serialization::readPod(input, textAntiAliasing);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, hideBatteryPercentage, HIDE_BATTERY_PERCENTAGE_COUNT);
+    readAndValidate(input, hideBatteryPercentage, HIDE_BATTERY_PERCENTAGE_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    serialization::readPod(inputFile, longPressChapterSkip);
+    serialization::readPod(input, longPressChapterSkip);
     if (++settingsRead >= fileSettingsCount) break;
-    serialization::readPod(inputFile, hyphenationEnabled);
+    serialization::readPod(input, hyphenationEnabled);
     if (++settingsRead >= fileSettingsCount) break;
     {
       std::string usernameStr;
-      serialization::readString(inputFile, usernameStr);
+      serialization::readString(input, usernameStr);
       strncpy(opdsUsername, usernameStr.c_str(), sizeof(opdsUsername) - 1);
       opdsUsername[sizeof(opdsUsername) - 1] = '\0';
     }
     if (++settingsRead >= fileSettingsCount) break;
     {
       std::string passwordStr;
-      serialization::readString(inputFile, passwordStr);
+      serialization::readString(input, passwordStr);
       strncpy(opdsPassword, passwordStr.c_str(), sizeof(opdsPassword) - 1);
       opdsPassword[sizeof(opdsPassword) - 1] = '\0';
     }
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, sleepScreenCoverFilter, SLEEP_SCREEN_COVER_FILTER_COUNT);
+    readAndValidate(input, sleepScreenCoverFilter, SLEEP_SCREEN_COVER_FILTER_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    serialization::readPod(inputFile, uiTheme);
+    serialization::readPod(input, uiTheme);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, frontButtonBack, FRONT_BUTTON_HARDWARE_COUNT);
+    readAndValidate(input, frontButtonBack, FRONT_BUTTON_HARDWARE_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, frontButtonConfirm, FRONT_BUTTON_HARDWARE_COUNT);
+    readAndValidate(input, frontButtonConfirm, FRONT_BUTTON_HARDWARE_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, frontButtonLeft, FRONT_BUTTON_HARDWARE_COUNT);
+    readAndValidate(input, frontButtonLeft, FRONT_BUTTON_HARDWARE_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, frontButtonRight, FRONT_BUTTON_HARDWARE_COUNT);
+    readAndValidate(input, frontButtonRight, FRONT_BUTTON_HARDWARE_COUNT);
     frontButtonMappingRead = true;
     if (++settingsRead >= fileSettingsCount) break;
-    serialization::readPod(inputFile, fadingFix);
+    serialization::readPod(input, fadingFix);
     if (++settingsRead >= fileSettingsCount) break;
-    serialization::readPod(inputFile, embeddedStyle);
+    serialization::readPod(input, embeddedStyle);
     if (++settingsRead >= fileSettingsCount) break;
-    readAndValidate(inputFile, ankiDailyGoal, ANKI_DAILY_GOAL_COUNT);
+    readAndValidate(input, ankiDailyGoal, ANKI_DAILY_GOAL_COUNT);
     if (++settingsRead >= fileSettingsCount) break;
     // New fields added at end for backward compatibility
   } while (false);
@@ -273,8 +271,7 @@ bool CrossPointSettings::loadFromFile() {
     applyLegacyFrontButtonLayout(*this);
   }
 
-  inputFile.close();
-  LOG_DBG("CPS", "Settings loaded from file");
+  LOG_DBG("CPS", "Settings loaded");
   return true;
 }
 
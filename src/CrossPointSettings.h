@@ -1,9 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <iosfwd>
-
-// Forward declarations
-class FsFile;
+#include <string>
 
 class CrossPointSettings {
  private:
@@ -191,7 +189,7 @@ class CrossPointSettings {
   int getReaderFontId() const;
 
   // If count_only is true, returns the number of settings items that would be written.
-  uint8_t writeSettings(FsFile& file, bool count_only = false) const;
+  uint8_t writeSettings(std::string& out, bool count_only = false) const;
 
   bool saveToFile() const;
   bool loadFromFile();
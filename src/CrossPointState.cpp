@@ -1,62 +1,66 @@
 #include "CrossPointState.h"
 
-#include <HalStorage.h>
 #include <Logging.h>
 #include <Serialization.h>
 
+#include "StateStore.h"
+
 namespace {
-constexpr uint8_t STATE_FILE_VERSION = 4;
+constexpr uint8_t STATE_FILE_VERSION = 5;
+constexpr char STATE_KEY[] = "state";
+// Where the state was kept before the state store
 constexpr char STATE_FILE[] = "/.crosspoint/state.bin";
 }  // namespace
 
 CrossPointState CrossPointState::instance;
 
 bool CrossPointState::saveToFile() const {
-  FsFile outputFile;
-  if (!Storage.openFileForWrite("CPS", STATE_FILE, outputFile)) {
-    return false;
-  }
-
-  serialization::writePod(outputFile, STATE_FILE_VERSION);
-  serialization::writeString(outputFile, openEpubPath);
-  serialization::writePod(outputFile, lastSleepImage);
-  serialization::writePod(outputFile, readerActivityLoadCount);
-  serialization::writePod(outputFile, lastSleepFromReader);
-  outputFile.close();
-  return true;
+  std::string data;
+  serialization::writePod(data, STATE_FILE_VERSION);
+  serialization::writeString(data, openEpubPath);
+  serialization::writePod(data, lastSleepImage);
+  serialization::writePod(data, readerActivityLoadCount);
+  serialization::writePod(data, lastSleepFromReader);
+  serialization::writePod(data, readerViewportWidth);
+  serialization::writePod(data, readerViewportHeight);
+  return STATE_STORE.put(STATE_KEY, data);
 }
 
 bool CrossPointState::loadFromFile() {
-  FsFile inputFile;
-  if (!Storage.openFileForRead("CPS", STATE_FILE, inputFile)) {
+  std::string data;
+  if (!STATE_STORE.get(STATE_KEY, data, STATE_FILE)) {
     return false;
   }
+  serialization::MemoryReader input(data);
 
   uint8_t version;
-  serialization::readPod(inputFile, version);
+  serialization::readPod(input, version);
   if (version > STATE_FILE_VERSION) {
     LOG_ERR("CPS", "Deserialization failed: Unknown version %u", version);
-    inputFile.close();
     return false;
   }
 
-  serialization::readString(inputFile, openEpubPath);
+  serialization::readString(input, openEpubPath);
   if (version >= 2) {
-    serialization::readPod(inputFile, lastSleepImage);
+    serialization::readPod(input, lastSleepImage);
   } else {
     lastSleepImage = 0;
   }
 
   if (version >= 3) {
-    serialization::readPod(inputFile, readerActivityLoadCount);
+    serialization::readPod(input, readerActivityLoadCount);
   }
 
   if (version >= 4) {
-    serialization::readPod(inputFile, lastSleepFromReader);
+    serialization::readPod(input, lastSleepFromReader);
   } else {
     lastSleepFromReader = false;
   }
 
-  inputFile.close();
+  if (version >= 5) {
+    serialization::readPod(input, readerViewportWidth);
+    serialization::readPod(input, readerViewportHeight);
+  }
+
   return true;
 }
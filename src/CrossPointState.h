@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <iosfwd>
 #include <string>
 
@@ -11,6 +12,10 @@ class CrossPointState {
   uint8_t lastSleepImage;
   uint8_t readerActivityLoadCount = 0;
   bool lastSleepFromReader = false;
+  // Text area of the last chapter the reader paginated, so books can be paginated in the background for the same
+  // layout. 0 until a book has been opened.
+  uint16_t readerViewportWidth = 0;
+  uint16_t readerViewportHeight = 0;
   ~CrossPointState() = default;
 
   // Get singleton instance
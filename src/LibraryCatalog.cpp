@@ -0,0 +1,518 @@
+#include "LibraryCatalog.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "util/StringUtils.h"
+
+namespace {
+constexpr uint8_t CATALOG_FILE_VERSION = 1;
+constexpr char CATALOG_FILE[] = "/.crosspoint/catalog.bin";
+constexpr char CATALOG_TMP_FILE[] = "/.crosspoint/catalog.tmp";
+// version + table offset + dead bytes
+constexpr uint32_t HEADER_SIZE = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+constexpr uint32_t COMPACT_MIN_DEAD_BYTES = 32 * 1024;
+constexpr uint32_t MAX_STRING_LENGTH = 1024;
+constexpr uint16_t MAX_DIRS = 4096;
+// Empty-string lengths plus size, mtime and format; bounds entry counts read back from a damaged table.
+constexpr uint32_t MIN_ENTRY_BYTES = 4 * sizeof(uint32_t) + 2 * sizeof(uint32_t) + sizeof(uint8_t);
+constexpr uint32_t FNV_OFFSET = 2166136261u;
+constexpr uint32_t FNV_PRIME = 16777619u;
+
+void fnvMix(uint32_t& hash, const void* data, const size_t length) {
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < length; i++) {
+    hash ^= bytes[i];
+    hash *= FNV_PRIME;
+  }
+}
+
+uint32_t fatTimestamp(FsFile& file) {
+  uint16_t date = 0;
+  uint16_t time = 0;
+  if (!file.getModifyDateTime(&date, &time)) {
+    return 0;
+  }
+  return (static_cast<uint32_t>(date) << 16) | time;
+}
+
+bool isHiddenName(const char* name) { return name[0] == '.' || strcmp(name, "System Volume Information") == 0; }
+
+std::string normaliseDir(const std::string& path) {
+  std::string dir = path.empty() || path[0] != '/' ? "/" + path : path;
+  while (dir.size() > 1 && dir.back() == '/') {
+    dir.pop_back();
+  }
+  return dir;
+}
+
+std::string parentOf(const std::string& path) {
+  const std::string normalised = normaliseDir(path);
+  const size_t slash = normalised.find_last_of('/');
+  return slash == 0 || slash == std::string::npos ? "/" : normalised.substr(0, slash);
+}
+
+std::string baseName(const std::string& path) {
+  const std::string normalised = normaliseDir(path);
+  return normalised.substr(normalised.find_last_of('/') + 1);
+}
+
+// Folders first, then a case-insensitive natural order so "Book 2" sorts before "Book 10".
+bool naturalLess(const CatalogEntry& entry1, const CatalogEntry& entry2) {
+  const bool isDir1 = entry1.format == BookFormat::Folder;
+  const bool isDir2 = entry2.format == BookFormat::Folder;
+  if (isDir1 != isDir2) return isDir1;
+  return StringUtils::naturalLess(entry1.name.c_str(), entry2.name.c_str());
+}
+
+bool readBoundedString(FsFile& file, std::string& s, const uint32_t end) {
+  uint32_t len = 0;
+  serialization::readPod(file, len);
+  if (len > MAX_STRING_LENGTH || file.position() + len > end) {
+    return false;
+  }
+  s.resize(len);
+  return len == 0 || file.read(&s[0], len) == static_cast<int>(len);
+}
+
+void writeHeader(FsFile& file, const uint32_t tableOffset, const uint32_t deadBytes) {
+  file.seek(0);
+  serialization::writePod(file, CATALOG_FILE_VERSION);
+  serialization::writePod(file, tableOffset);
+  serialization::writePod(file, deadBytes);
+}
+
+std::vector<CatalogEntry>::iterator findByName(std::vector<CatalogEntry>& entries, const std::string& name) {
+  return std::find_if(entries.begin(), entries.end(), [&](const CatalogEntry& entry) { return entry.name == name; });
+}
+}  // namespace
+
+LibraryCatalog LibraryCatalog::instance;
+
+BookFormat LibraryCatalog::formatForName(const std::string& name) {
+  if (StringUtils::checkFileExtension(name, ".epub")) return BookFormat::Epub;
+  if (StringUtils::checkFileExtension(name, ".xtch")) return BookFormat::Xtch;
+  if (StringUtils::checkFileExtension(name, ".xtc")) return BookFormat::Xtc;
+  if (StringUtils::checkFileExtension(name, ".txt")) return BookFormat::Txt;
+  if (StringUtils::checkFileExtension(name, ".md") || StringUtils::checkFileExtension(name, ".markdown")) {
+    return BookFormat::Markdown;
+  }
+  if (StringUtils::checkFileExtension(name, ".csv")) return BookFormat::Csv;
+  return BookFormat::Folder;
+}
+
+void LibraryCatalog::ensureLoaded() {
+  if (loaded) {
+    return;
+  }
+  loaded = true;
+  dirs.clear();
+  uncheckedDirs.clear();
+  tableOffset = 0;
+  tableLength = 0;
+  deadBytes = 0;
+
+  FsFile file;
+  if (!Storage.exists(CATALOG_FILE) || !Storage.openFileForRead("CAT", CATALOG_FILE, file)) {
+    return;
+  }
+
+  const uint32_t fileSize = static_cast<uint32_t>(file.size());
+  uint8_t version = 0;
+  serialization::readPod(file, version);
+  serialization::readPod(file, tableOffset);
+  serialization::readPod(file, deadBytes);
+
+  bool ok = version == CATALOG_FILE_VERSION && tableOffset >= HEADER_SIZE && tableOffset < fileSize;
+  uint16_t count = 0;
+  if (ok) {
+    file.seek(tableOffset);
+    serialization::readPod(file, count);
+    ok = count <= MAX_DIRS;
+  }
+  for (uint16_t i = 0; ok && i < count; i++) {
+    DirRecord record;
+    ok = readBoundedString(file, record.path, fileSize);
+    serialization::readPod(file, record.modified);
+    serialization::readPod(file, record.signature);
+    serialization::readPod(file, record.entryCount);
+    serialization::readPod(file, record.offset);
+    serialization::readPod(file, record.length);
+    ok = ok && record.offset >= HEADER_SIZE && record.offset + record.length <= tableOffset &&
+         record.entryCount <= record.length / MIN_ENTRY_BYTES;
+    dirs.push_back(std::move(record));
+  }
+  tableLength = static_cast<uint32_t>(file.position()) - tableOffset;
+  file.close();
+
+  if (!ok) {
+    LOG_ERR("CAT", "Catalog unreadable, rebuilding");
+    clear();
+    return;
+  }
+  LOG_DBG("CAT", "Catalog loaded (%u folders, %u dead bytes)", static_cast<unsigned>(dirs.size()),
+          static_cast<unsigned>(deadBytes));
+}
+
+LibraryCatalog::DirRecord* LibraryCatalog::findDir(const std::string& dirPath) {
+  const auto it =
+      std::find_if(dirs.begin(), dirs.end(), [&](const DirRecord& record) { return record.path == dirPath; });
+  return it == dirs.end() ? nullptr : &*it;
+}
+
+bool LibraryCatalog::readBlock(const DirRecord& record, std::vector<CatalogEntry>& entries) const {
+  entries.clear();
+  FsFile file;
+  if (!Storage.openFileForRead("CAT", CATALOG_FILE, file)) {
+    return false;
+  }
+
+  const uint32_t end = record.offset + record.length;
+  file.seek(record.offset);
+  entries.reserve(record.entryCount);
+  bool ok = true;
+  for (uint32_t i = 0; ok && i < record.entryCount; i++) {
+    CatalogEntry entry;
+    uint8_t format = 0;
+    ok = readBoundedString(file, entry.name, end);
+    serialization::readPod(file, entry.size);
+    serialization::readPod(file, entry.modified);
+    serialization::readPod(file, format);
+    entry.format = static_cast<BookFormat>(format);
+    ok = ok && readBoundedString(file, entry.title, end) && readBoundedString(file, entry.author, end) &&
+         readBoundedString(file, entry.thumbPath, end) && !entry.name.empty();
+    entries.push_back(std::move(entry));
+  }
+  file.close();
+
+  if (!ok) {
+    LOG_ERR("CAT", "Corrupt catalog block for %s", record.path.c_str());
+    entries.clear();
+  }
+  return ok;
+}
+
+void LibraryCatalog::writeTable(FsFile& file) const {
+  const uint16_t count = static_cast<uint16_t>(dirs.size());
+  serialization::writePod(file, count);
+  for (const auto& record : dirs) {
+    serialization::writeString(file, record.path);
+    serialization::writePod(file, record.modified);
+    serialization::writePod(file, record.signature);
+    serialization::writePod(file, record.entryCount);
+    serialization::writePod(file, record.offset);
+    serialization::writePod(file, record.length);
+  }
+}
+
+bool LibraryCatalog::storeBlock(const std::string& dirPath, const uint32_t modified, const uint32_t signature,
+                                const std::vector<CatalogEntry>& entries) {
+  Storage.mkdir("/.crosspoint");
+
+  FsFile file = Storage.open(CATALOG_FILE, O_RDWR | O_CREAT);
+  if (!file) {
+    LOG_ERR("CAT", "Failed to open catalog for write");
+    return false;
+  }
+
+  // Append the block and a fresh table after everything that is live, then repoint the header.
+  uint32_t blockOffset = static_cast<uint32_t>(file.size());
+  if (blockOffset < HEADER_SIZE || tableOffset == 0) {
+    file.truncate(0);
+    writeHeader(file, 0, 0);
+    blockOffset = HEADER_SIZE;
+    deadBytes = 0;
+  } else {
+    deadBytes += tableLength;
+  }
+  file.seek(blockOffset);
+
+  for (const auto& entry : entries) {
+    serialization::writeString(file, entry.name);
+    serialization::writePod(file, entry.size);
+    serialization::writePod(file, entry.modified);
+    serialization::writePod(file, static_cast<uint8_t>(entry.format));
+    serialization::writeString(file, entry.title);
+    serialization::writeString(file, entry.author);
+    serialization::writeString(file, entry.thumbPath);
+  }
+  const uint32_t blockEnd = static_cast<uint32_t>(file.position());
+
+  DirRecord* record = findDir(dirPath);
+  if (!record) {
+    if (dirs.size() >= MAX_DIRS) {
+      file.close();
+      return false;
+    }
+    dirs.push_back({});
+    record = &dirs.back();
+    record->path = dirPath;
+  } else {
+    deadBytes += record->length;
+  }
+  record->modified = modified;
+  record->signature = signature;
+  record->entryCount = static_cast<uint32_t>(entries.size());
+  record->offset = blockOffset;
+  record->length = blockEnd - blockOffset;
+  record->state = DirState::Verified;
+
+  writeTable(file);
+  tableOffset = blockEnd;
+  tableLength = static_cast<uint32_t>(file.position()) - tableOffset;
+  writeHeader(file, tableOffset, deadBytes);
+  file.close();
+
+  if (deadBytes > COMPACT_MIN_DEAD_BYTES && deadBytes > tableOffset - deadBytes) {
+    compact();
+  }
+  return true;
+}
+
+void LibraryCatalog::compact() {
+  FsFile source;
+  FsFile target;
+  if (!Storage.openFileForRead("CAT", CATALOG_FILE, source)) {
+    return;
+  }
+  if (!Storage.openFileForWrite("CAT", CATALOG_TMP_FILE, target)) {
+    source.close();
+    return;
+  }
+
+  writeHeader(target, 0, 0);
+  std::vector<DirRecord> live;
+  live.reserve(dirs.size());
+  uint8_t buffer[512];
+  for (const auto& record : dirs) {
+    // Folders deleted from the card are dropped here rather than on every delete.
+    if (!Storage.exists(record.path.c_str())) {
+      continue;
+    }
+    DirRecord moved = record;
+    moved.offset = static_cast<uint32_t>(target.position());
+    source.seek(record.offset);
+    uint32_t remaining = record.length;
+    while (remaining > 0) {
+      const int chunk = source.read(buffer, std::min<uint32_t>(remaining, sizeof(buffer)));
+      if (chunk <= 0 || target.write(buffer, chunk) != static_cast<size_t>(chunk)) {
+        break;
+      }
+      remaining -= chunk;
+    }
+    if (remaining != 0) {
+      LOG_ERR("CAT", "Compaction failed copying %s", record.path.c_str());
+      source.close();
+      target.close();
+      Storage.remove(CATALOG_TMP_FILE);
+      return;
+    }
+    live.push_back(std::move(moved));
+  }
+  source.close();
+
+  dirs = std::move(live);
+  tableOffset = static_cast<uint32_t>(target.position());
+  writeTable(target);
+  tableLength = static_cast<uint32_t>(target.position()) - tableOffset;
+  deadBytes = 0;
+  writeHeader(target, tableOffset, deadBytes);
+  target.close();
+
+  Storage.remove(CATALOG_FILE);
+  FsFile tmpFile = Storage.open(CATALOG_TMP_FILE, O_RDWR);
+  if (!tmpFile || !tmpFile.rename(CATALOG_FILE)) {
+    LOG_ERR("CAT", "Failed to replace catalog after compaction");
+    if (tmpFile) tmpFile.close();
+    clear();
+    return;
+  }
+  tmpFile.close();
+  LOG_DBG("CAT", "Catalog compacted to %u bytes", static_cast<unsigned>(tableOffset + tableLength));
+}
+
+bool LibraryCatalog::listDirectory(const std::string& path, std::vector<CatalogEntry>& entries) {
+  entries.clear();
+  ensureLoaded();
+  const std::string dirPath = normaliseDir(path);
+
+  auto root = Storage.open(dirPath.c_str());
+  if (!root || !root.isDirectory()) {
+    if (root) root.close();
+    return false;
+  }
+  const uint32_t dirModified = fatTimestamp(root);
+  const unsigned long start = millis();
+
+  DirRecord* record = findDir(dirPath);
+  if (record && record->state != DirState::Stale && record->modified == dirModified && readBlock(*record, entries)) {
+    root.close();
+    // The directory mtime alone can't be trusted (FAT rarely updates it), so a record not yet checked this session is
+    // compared with the raw entries later, in idle time, rather than walking the folder before showing it.
+    if (record->state == DirState::Unchecked &&
+        std::find(uncheckedDirs.begin(), uncheckedDirs.end(), dirPath) == uncheckedDirs.end()) {
+      uncheckedDirs.push_back(dirPath);
+    }
+    LOG_DBG("CAT", "Listed %s from catalog (%u entries, %lu ms)", dirPath.c_str(),
+            static_cast<unsigned>(entries.size()), millis() - start);
+    return true;
+  }
+
+  // Compare a signature of the raw entries first. This pass builds no strings and does no sorting.
+  char name[500];
+  uint32_t signature = FNV_OFFSET;
+  for (auto file = root.openNextFile(); file; file = root.openNextFile()) {
+    file.getName(name, sizeof(name));
+    if (!isHiddenName(name)) {
+      const uint32_t size = file.isDirectory() ? 0 : static_cast<uint32_t>(file.size());
+      const uint32_t modified = file.isDirectory() ? 0 : fatTimestamp(file);
+      fnvMix(signature, name, strlen(name) + 1);
+      fnvMix(signature, &size, sizeof(size));
+      fnvMix(signature, &modified, sizeof(modified));
+    }
+    file.close();
+  }
+
+  if (record && record->signature == signature && readBlock(*record, entries)) {
+    record->state = DirState::Verified;
+    record->modified = dirModified;
+    root.close();
+    LOG_DBG("CAT", "Verified %s against catalog (%u entries, %lu ms)", dirPath.c_str(),
+            static_cast<unsigned>(entries.size()), millis() - start);
+    return true;
+  }
+
+  // Contents changed: rebuild the listing, keeping metadata for books that are still the same file.
+  std::vector<CatalogEntry> previous;
+  if (record) {
+    readBlock(*record, previous);
+  }
+
+  root.rewindDirectory();
+  for (auto file = root.openNextFile(); file; file = root.openNextFile()) {
+    file.getName(name, sizeof(name));
+    if (isHiddenName(name)) {
+      file.close();
+      continue;
+    }
+
+    CatalogEntry entry;
+    if (file.isDirectory()) {
+      entry.name = std::string(name) + "/";
+    } else {
+      entry.name = name;
+      entry.format = formatForName(entry.name);
+      entry.size = static_cast<uint32_t>(file.size());
+      entry.modified = fatTimestamp(file);
+    }
+    file.close();
+    if (entry.format == BookFormat::Folder && entry.name.back() != '/') {
+      continue;
+    }
+
+    const auto old = findByName(previous, entry.name);
+    if (old != previous.end() && old->size == entry.size && old->modified == entry.modified) {
+      entry.title = std::move(old->title);
+      entry.author = std::move(old->author);
+      entry.thumbPath = std::move(old->thumbPath);
+    }
+    entries.push_back(std::move(entry));
+  }
+  root.close();
+  std::sort(entries.begin(), entries.end(), naturalLess);
+
+  storeBlock(dirPath, dirModified, signature, entries);
+  LOG_DBG("CAT", "Rebuilt %s (%u entries, %lu ms)", dirPath.c_str(), static_cast<unsigned>(entries.size()),
+          millis() - start);
+  return true;
+}
+
+void LibraryCatalog::checkNextDirectory() {
+  if (uncheckedDirs.empty()) {
+    return;
+  }
+  const std::string dirPath = std::move(uncheckedDirs.back());
+  uncheckedDirs.pop_back();
+  DirRecord* record = findDir(dirPath);
+  if (!record || record->state != DirState::Unchecked) {
+    return;
+  }
+  // Forces the signature pass; an unchanged folder is marked verified, a changed one rebuilt for its next listing.
+  record->state = DirState::Stale;
+  std::vector<CatalogEntry> entries;
+  listDirectory(dirPath, entries);
+}
+
+bool LibraryCatalog::findBook(const std::string& path, CatalogEntry& entry) {
+  ensureLoaded();
+  const DirRecord* record = findDir(parentOf(path));
+  std::vector<CatalogEntry> entries;
+  if (!record || !readBlock(*record, entries)) {
+    return false;
+  }
+  const auto it = findByName(entries, baseName(path));
+  if (it == entries.end()) {
+    return false;
+  }
+  entry = std::move(*it);
+  return true;
+}
+
+void LibraryCatalog::updateBookInfo(const std::string& path, const std::string& title, const std::string& author,
+                                    const std::string& thumbPath) {
+  ensureLoaded();
+  const std::string dirPath = parentOf(path);
+  DirRecord* record = findDir(dirPath);
+  std::vector<CatalogEntry> entries;
+  if (!record || !readBlock(*record, entries)) {
+    return;
+  }
+  const auto it = findByName(entries, baseName(path));
+  if (it == entries.end() || (it->title == title && it->author == author && it->thumbPath == thumbPath)) {
+    return;
+  }
+  it->title = title;
+  it->author = author;
+  it->thumbPath = thumbPath;
+  const DirState state = record->state;
+  storeBlock(dirPath, record->modified, record->signature, entries);
+  if (DirRecord* updated = findDir(dirPath)) {
+    updated->state = state;
+  }
+}
+
+void LibraryCatalog::invalidateDirectory(const std::string& dirPath) {
+  ensureLoaded();
+  if (DirRecord* record = findDir(normaliseDir(dirPath))) {
+    // The stored signature no longer matches the card, so the next listing rebuilds this folder.
+    record->state = DirState::Stale;
+  }
+}
+
+void LibraryCatalog::invalidatePath(const std::string& itemPath) {
+  ensureLoaded();
+  invalidateDirectory(parentOf(itemPath));
+  const std::string dirPath = normaliseDir(itemPath);
+  const std::string prefix = dirPath + "/";
+  for (auto& record : dirs) {
+    if (record.path == dirPath || record.path.compare(0, prefix.size(), prefix) == 0) {
+      record.state = DirState::Stale;
+    }
+  }
+}
+
+void LibraryCatalog::clear() {
+  dirs.clear();
+  uncheckedDirs.clear();
+  tableOffset = 0;
+  tableLength = 0;
+  deadBytes = 0;
+  loaded = true;
+  if (Storage.exists(CATALOG_FILE)) {
+    Storage.remove(CATALOG_FILE);
+  }
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FsFile;
+
+enum class BookFormat : uint8_t { Folder = 0, Epub, Xtc, Xtch, Txt, Markdown, Csv };
+
+struct CatalogEntry {
+  std::string name;  // Directories keep a trailing '/'
+  uint32_t size = 0;
+  uint32_t modified = 0;  // FAT date << 16 | FAT time
+  BookFormat format = BookFormat::Folder;
+  std::string title;
+  std::string author;
+  std::string thumbPath;
+};
+
+// On-SD index of the library at /.crosspoint/catalog.bin. Each directory is stored as one block of pre-sorted entries
+// together with the directory mtime and a signature of its contents, so browsing a folder reads one block instead of
+// rebuilding and natural-sorting the listing. Book metadata (title, author, thumbnail) learned when a book is opened
+// is kept with the entry so other screens don't have to open the book again.
+//
+// A folder whose mtime still matches is shown from the catalog straight away; the signature check that catches changes
+// FAT doesn't reflect in the mtime runs later from the background job queue (checkNextDirectory()).
+//
+// Blocks are appended; the directory table is rewritten at the end of the file and the header is pointed at it last,
+// so an interrupted write leaves the previous table intact. The file is compacted once dead blocks outweigh live ones.
+class LibraryCatalog {
+  // Static instance
+  static LibraryCatalog instance;
+
+  enum class DirState : uint8_t {
+    Unchecked,  // Loaded from the card, not yet compared with the folder this session
+    Verified,   // Matches the folder
+    Stale,      // Known to have changed; the next listing compares signatures
+  };
+
+  struct DirRecord {
+    std::string path;
+    uint32_t modified = 0;
+    uint32_t signature = 0;
+    uint32_t entryCount = 0;
+    uint32_t offset = 0;
+    uint32_t length = 0;
+    // Not persisted: every record starts out unchecked after boot.
+    DirState state = DirState::Unchecked;
+  };
+
+  std::vector<DirRecord> dirs;
+  // Folders listed from an unchecked record, waiting for checkNextDirectory()
+  std::vector<std::string> uncheckedDirs;
+  uint32_t tableOffset = 0;
+  uint32_t tableLength = 0;
+  uint32_t deadBytes = 0;
+  bool loaded = false;
+
+  void ensureLoaded();
+  DirRecord* findDir(const std::string& dirPath);
+  bool readBlock(const DirRecord& record, std::vector<CatalogEntry>& entries) const;
+  bool storeBlock(const std::string& dirPath, uint32_t modified, uint32_t signature,
+                  const std::vector<CatalogEntry>& entries);
+  void writeTable(FsFile& file) const;
+  void compact();
+
+ public:
+  ~LibraryCatalog() = default;
+
+  // Get singleton instance
+  static LibraryCatalog& getInstance() { return instance; }
+
+  // Fills `entries` with the sorted, filtered listing of `dirPath` (folders first, natural order). Served from the
+  // catalog when the directory is unchanged, otherwise rescanned and stored. Returns false if the path is not a folder.
+  bool listDirectory(const std::string& dirPath, std::vector<CatalogEntry>& entries);
+
+  // Background work for the job queue: compares one folder listed from an unchecked record with the card and rebuilds
+  // its block if the contents changed.
+  bool hasUncheckedDirectories() const { return !uncheckedDirs.empty(); }
+  void checkNextDirectory();
+
+  // Looks up the catalog entry for a book path without touching the book itself.
+  bool findBook(const std::string& path, CatalogEntry& entry);
+
+  // Remembers book metadata for a path already present in the catalog.
+  void updateBookInfo(const std::string& path, const std::string& title, const std::string& author,
+                      const std::string& thumbPath);
+
+  // Reports that the contents of `dirPath` changed (upload, rename, move, delete, new folder).
+  void invalidateDirectory(const std::string& dirPath);
+  // Reports that `itemPath` was added or removed; drops its parent listing and, for folders, everything below it.
+  void invalidatePath(const std::string& itemPath);
+
+  // Deletes the catalog file; it is rebuilt as folders are browsed.
+  void clear();
+
+  // Returns the format for a supported book file name, or Folder if the file is not a book.
+  static BookFormat formatForName(const std::string& name);
+};
+
+// Helper macro to access the library catalog
+#define LIBRARY_CATALOG LibraryCatalog::getInstance()
@@ -1,17 +1,21 @@
 #include "RecentBooksStore.h"
 
 #include <Epub.h>
-#include <HalStorage.h>
 #include <Logging.h>
 #include <Serialization.h>
 #include <Xtc.h>
 
 #include <algorithm>
 
+#include "CoverJobQueue.h"
+#include "LibraryCatalog.h"
+#include "StateStore.h"
 #include "util/StringUtils.h"
 
 namespace {
 constexpr uint8_t RECENT_BOOKS_FILE_VERSION = 3;
+constexpr char RECENT_BOOKS_KEY[] = "recent";
+// Where the list was kept before the state store
 constexpr char RECENT_BOOKS_FILE[] = "/.crosspoint/recent.bin";
 constexpr int MAX_RECENT_BOOKS = 10;
 }  // namespace
@@ -36,6 +40,9 @@ void RecentBooksStore::addBook(const std::string& path, const std::string& title
   }
 
   saveToFile();
+  LIBRARY_CATALOG.updateBookInfo(path, title, author, coverBmpPath);
+  // Have the sleep screen cover and home thumbnails ready before they're first needed
+  COVER_JOBS.enqueue(path);
 }
 
 void RecentBooksStore::updateBook(const std::string& path, const std::string& title, const std::string& author,
@@ -49,30 +56,26 @@ void RecentBooksStore::updateBook(const std::string& path, const std::string& ti
     book.coverBmpPath = coverBmpPath;
     saveToFile();
   }
+  LIBRARY_CATALOG.updateBookInfo(path, title, author, coverBmpPath);
 }
 
 bool RecentBooksStore::saveToFile() const {
-  // Make sure the directory exists
-  Storage.mkdir("/.crosspoint");
-
-  FsFile outputFile;
-  if (!Storage.openFileForWrite("RBS", RECENT_BOOKS_FILE, outputFile)) {
-    return false;
-  }
-
-  serialization::writePod(outputFile, RECENT_BOOKS_FILE_VERSION);
+  std::string data;
+  serialization::writePod(data, RECENT_BOOKS_FILE_VERSION);
   const uint8_t count = static_cast<uint8_t>(recentBooks.size());
-  serialization::writePod(outputFile, count);
+  serialization::writePod(data, count);
 
   for (const auto& book : recentBooks) {
-    serialization::writeString(outputFile, book.path);
-    serialization::writeString(outputFile, book.title);
-    serialization::writeString(outputFile, book.author);
-    serialization::writeString(outputFile, book.coverBmpPath);
+    serialization::writeString(data, book.path);
+    serialization::writeString(data, book.title);
+    serialization::writeString(data, book.author);
+    serialization::writeString(data, book.coverBmpPath);
   }
 
-  outputFile.close();
-  LOG_DBG("RBS", "Recent books saved to file (%d entries)", count);
+  if (!STATE_STORE.put(RECENT_BOOKS_KEY, data)) {
+    return false;
+  }
+  LOG_DBG("RBS", "Recent books saved (%d entries)", count);
   return true;
 }
 
@@ -85,6 +88,12 @@ RecentBook RecentBooksStore::getDataFromBook(std::string path) const {
 
   LOG_DBG("RBS", "Loading recent book: %s", path.c_str());
 
+  // Prefer metadata the library catalog already learned over opening the book
+  CatalogEntry entry;
+  if (LIBRARY_CATALOG.findBook(path, entry) && !entry.title.empty()) {
+    return RecentBook{path, entry.title, entry.author, entry.thumbPath};
+  }
+
   // If epub, try to load the metadata for title/author and cover
   if (StringUtils::checkFileExtension(lastBookFileName, ".epub")) {
     Epub epub(path, "/.crosspoint");
@@ -105,31 +114,32 @@ RecentBook RecentBooksStore::getDataFromBook(std::string path) const {
 }
 
 bool RecentBooksStore::loadFromFile() {
-  FsFile inputFile;
-  if (!Storage.openFileForRead("RBS", RECENT_BOOKS_FILE, inputFile)) {
+  std::string data;
+  if (!STATE_STORE.get(RECENT_BOOKS_KEY, data, RECENT_BOOKS_FILE)) {
     return false;
   }
+  serialization::MemoryReader input(data);
 
   uint8_t version;
-  serialization::readPod(inputFile, version);
+  serialization::readPod(input, version);
   if (version != RECENT_BOOKS_FILE_VERSION) {
     if (version == 1 || version == 2) {
       // Old version, just read paths
       uint8_t count;
-      serialization::readPod(inputFile, count);
+      serialization::readPod(input, count);
       recentBooks.clear();
       recentBooks.reserve(count);
       for (uint8_t i = 0; i < count; i++) {
         std::string path;
-        serialization::readString(inputFile, path);
+        serialization::readString(input, path);
 
         // load book to get missing data
         RecentBook book = getDataFromBook(path);
         if (book.title.empty() && book.author.empty() && version == 2) {
           // Fall back to loading what we can from the store
           std::string title, author;
-          serialization::readString(inputFile, title);
-          serialization::readString(inputFile, author);
+          serialization::readString(input, title);
+          serialization::readString(input, author);
           recentBooks.push_back({path, title, author, ""});
         } else {
           recentBooks.push_back(book);
@@ -137,27 +147,25 @@ bool RecentBooksStore::loadFromFile() {
       }
     } else {
       LOG_ERR("RBS", "Deserialization failed: Unknown version %u", version);
-      inputFile.close();
       return false;
     }
   } else {
     uint8_t count;
-    serialization::readPod(inputFile, count);
+    serialization::readPod(input, count);
 
     recentBooks.clear();
     recentBooks.reserve(count);
 
     for (uint8_t i = 0; i < count; i++) {
       std::string path, title, author, coverBmpPath;
-      serialization::readString(inputFile, path);
-      serialization::readString(inputFile, title);
-      serialization::readString(inputFile, author);
-      serialization::readString(inputFile, coverBmpPath);
+      serialization::readString(input, path);
+      serialization::readString(input, title);
+      serialization::readString(input, author);
+      serialization::readString(input, coverBmpPath);
       recentBooks.push_back({path, title, author, coverBmpPath});
     }
   }
 
-  inputFile.close();
-  LOG_DBG("RBS", "Recent books loaded from file (%d entries)", recentBooks.size());
+  LOG_DBG("RBS", "Recent books loaded (%d entries)", recentBooks.size());
   return true;
 }
@@ -0,0 +1,386 @@
+#include "StateStore.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+#include <miniz.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr uint8_t LOG_VERSION = 1;
+constexpr char LOG_FILE[] = "/.crosspoint/state.log";
+constexpr char TMP_FILE[] = "/.crosspoint/state.log.tmp";
+// version
+constexpr uint32_t HEADER_SIZE = sizeof(uint8_t);
+// key length + value length + checksum
+constexpr uint32_t RECORD_HEADER_SIZE = 2 * sizeof(uint16_t) + sizeof(uint32_t);
+constexpr size_t MAX_KEY_LENGTH = 255;
+constexpr size_t MAX_VALUE_LENGTH = 8192;
+// Value length of a record that removes its key
+constexpr uint16_t REMOVED = 0xFFFF;
+// The log is compacted once it is at least this large and more than half of it is superseded records
+constexpr uint32_t COMPACT_MIN_SIZE = 16 * 1024;
+
+uint64_t hashKey(const char* key, const size_t length) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ static_cast<uint8_t>(key[i])) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Checksum over the lengths, the key and the value
+uint32_t recordCrc(const uint8_t* header, const char* body, const size_t bodyLength) {
+  const mz_ulong crc = mz_crc32(MZ_CRC32_INIT, header, 2 * sizeof(uint16_t));
+  return static_cast<uint32_t>(mz_crc32(crc, reinterpret_cast<const uint8_t*>(body), bodyLength));
+}
+
+std::string makeRecord(const std::string& key, const uint8_t* data, const size_t length, const bool removed,
+                       uint32_t& crc) {
+  const auto keyLength = static_cast<uint16_t>(key.size());
+  const uint16_t valueLength = removed ? REMOVED : static_cast<uint16_t>(length);
+  std::string record(RECORD_HEADER_SIZE, '\0');
+  memcpy(&record[0], &keyLength, sizeof(keyLength));
+  memcpy(&record[2], &valueLength, sizeof(valueLength));
+  record += key;
+  if (!removed) {
+    record.append(reinterpret_cast<const char*>(data), length);
+  }
+  crc = recordCrc(reinterpret_cast<const uint8_t*>(record.data()), record.data() + RECORD_HEADER_SIZE,
+                  record.size() - RECORD_HEADER_SIZE);
+  memcpy(&record[4], &crc, sizeof(crc));
+  return record;
+}
+}  // namespace
+
+StateStore StateStore::instance;
+
+bool StateStore::begin() {
+  if (!mutex) {
+    mutex = xSemaphoreCreateMutex();
+  }
+  Storage.mkdir("/.crosspoint");
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const bool ok = recoverLog();
+  xSemaphoreGive(mutex);
+  LOG_DBG("STS", "State log: %u keys, %u of %u bytes live", static_cast<unsigned>(entries.size()), liveSize,
+          logSize);
+  return ok;
+}
+
+bool StateStore::recoverLog() {
+  // Left over from an interrupted compaction. The new log is only complete once the old one has been removed.
+  if (Storage.exists(TMP_FILE)) {
+    if (Storage.exists(LOG_FILE)) {
+      Storage.remove(TMP_FILE);
+    } else if (!moveTmpToLog()) {
+      LOG_ERR("STS", "Could not recover %s", LOG_FILE);
+    }
+  }
+  return Storage.exists(LOG_FILE) ? scan() : startLog();
+}
+
+bool StateStore::moveTmpToLog() {
+  FsFile tmp = Storage.open(TMP_FILE, O_RDWR);
+  if (!tmp) {
+    return false;
+  }
+  if (tmp.rename(LOG_FILE)) {
+    tmp.close();
+    return true;
+  }
+
+  // Copy it over instead
+  FsFile log;
+  if (!tmp.seek(0) || !Storage.openFileForWrite("STS", LOG_FILE, log)) {
+    tmp.close();
+    return false;
+  }
+  uint8_t buffer[256];
+  bool ok = true;
+  int n;
+  while (ok && (n = tmp.read(buffer, sizeof(buffer))) > 0) {
+    ok = log.write(buffer, n) == static_cast<size_t>(n);
+  }
+  ok = ok && n == 0 && log.size() == tmp.size();
+  log.close();
+  tmp.close();
+  if (!ok) {
+    Storage.remove(LOG_FILE);
+    return false;
+  }
+  Storage.remove(TMP_FILE);
+  return true;
+}
+
+bool StateStore::startLog() {
+  entries.clear();
+  logSize = 0;
+  liveSize = 0;
+  FsFile file;
+  if (!Storage.openFileForWrite("STS", LOG_FILE, file)) {
+    LOG_ERR("STS", "Could not create %s", LOG_FILE);
+    return false;
+  }
+  serialization::writePod(file, LOG_VERSION);
+  file.close();
+  logSize = HEADER_SIZE;
+  liveSize = HEADER_SIZE;
+  return true;
+}
+
+bool StateStore::scan() {
+  entries.clear();
+  FsFile file;
+  if (!Storage.openFileForRead("STS", LOG_FILE, file)) {
+    return false;
+  }
+  uint8_t version = 0;
+  serialization::readPod(file, version);
+  if (version != LOG_VERSION) {
+    file.close();
+    LOG_ERR("STS", "Unknown state log version %u, starting a new log", version);
+    return startLog();
+  }
+
+  const uint32_t fileSize = file.size();
+  uint32_t offset = HEADER_SIZE;
+  liveSize = HEADER_SIZE;
+  std::string body;
+  while (offset + RECORD_HEADER_SIZE <= fileSize) {
+    uint8_t header[RECORD_HEADER_SIZE];
+    if (file.read(header, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE) {
+      break;
+    }
+    uint16_t keyLength = 0;
+    uint16_t valueLength = 0;
+    uint32_t crc = 0;
+    memcpy(&keyLength, header, sizeof(keyLength));
+    memcpy(&valueLength, header + 2, sizeof(valueLength));
+    memcpy(&crc, header + 4, sizeof(crc));
+    const bool removed = valueLength == REMOVED;
+    const uint32_t bodyLength = keyLength + (removed ? 0 : valueLength);
+    if (keyLength == 0 || keyLength > MAX_KEY_LENGTH || (!removed && valueLength > MAX_VALUE_LENGTH) ||
+        offset + RECORD_HEADER_SIZE + bodyLength > fileSize) {
+      break;
+    }
+    body.resize(bodyLength);
+    if (file.read(&body[0], bodyLength) != static_cast<int>(bodyLength) ||
+        recordCrc(header, body.data(), bodyLength) != crc) {
+      break;
+    }
+    const uint32_t size = RECORD_HEADER_SIZE + bodyLength;
+    index(hashKey(body.data(), keyLength), offset, size, crc, removed);
+    offset += size;
+  }
+  file.close();
+  logSize = offset;
+
+  if (offset < fileSize) {
+    // A record torn by a power loss, or garbage after it. Appends continue from the last good record.
+    LOG_ERR("STS", "Cutting %u bytes off the state log", fileSize - offset);
+    FsFile log = Storage.open(LOG_FILE, O_RDWR);
+    if (log) {
+      log.truncate(offset);
+      log.close();
+    }
+  }
+  return true;
+}
+
+std::vector<StateStore::Entry>::iterator StateStore::find(const uint64_t keyHash) {
+  const auto it = std::lower_bound(entries.begin(), entries.end(), keyHash,
+                                   [](const Entry& entry, const uint64_t hash) { return entry.keyHash < hash; });
+  return it != entries.end() && it->keyHash == keyHash ? it : entries.end();
+}
+
+void StateStore::index(const uint64_t keyHash, const uint32_t offset, const uint32_t size, const uint32_t crc,
+                       const bool removed) {
+  auto it = std::lower_bound(entries.begin(), entries.end(), keyHash,
+                             [](const Entry& entry, const uint64_t hash) { return entry.keyHash < hash; });
+  const bool exists = it != entries.end() && it->keyHash == keyHash;
+  if (exists) {
+    liveSize -= it->size;
+    if (removed) {
+      entries.erase(it);
+      return;
+    }
+  } else if (removed) {
+    return;
+  } else {
+    it = entries.insert(it, Entry{keyHash, 0, 0, 0});
+  }
+  *it = Entry{keyHash, offset, size, crc};
+  liveSize += size;
+}
+
+bool StateStore::append(const uint64_t keyHash, const std::string& record, const uint32_t crc, const bool removed) {
+  FsFile file = Storage.open(LOG_FILE, O_WRONLY | O_APPEND);
+  if (!file) {
+    LOG_ERR("STS", "Could not open %s", LOG_FILE);
+    return false;
+  }
+  // A failed append may have left part of a record behind
+  if (file.size() != logSize) {
+    file.truncate(logSize);
+  }
+  const bool ok = file.write(reinterpret_cast<const uint8_t*>(record.data()), record.size()) == record.size() &&
+                  file.size() == logSize + record.size();
+  file.close();
+  if (!ok) {
+    LOG_ERR("STS", "Could not append to %s", LOG_FILE);
+    return false;
+  }
+
+  index(keyHash, logSize, record.size(), crc, removed);
+  logSize += record.size();
+  if (logSize >= COMPACT_MIN_SIZE && logSize > 2 * liveSize) {
+    compactLocked();
+  }
+  return true;
+}
+
+bool StateStore::readRecord(const Entry& entry, std::string& record) const {
+  FsFile file;
+  if (!Storage.openFileForRead("STS", LOG_FILE, file)) {
+    return false;
+  }
+  record.resize(entry.size);
+  const bool ok = file.seek(entry.offset) && file.read(&record[0], entry.size) == static_cast<int>(entry.size);
+  file.close();
+  return ok;
+}
+
+bool StateStore::get(const std::string& key, std::string& value) {
+  if (!mutex) {
+    return false;
+  }
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const auto it = find(hashKey(key.data(), key.size()));
+  std::string record;
+  const bool found = it != entries.end() && readRecord(*it, record) &&
+                     record.compare(RECORD_HEADER_SIZE, key.size(), key) == 0;
+  if (found) {
+    value = record.substr(RECORD_HEADER_SIZE + key.size());
+  }
+  xSemaphoreGive(mutex);
+  return found;
+}
+
+bool StateStore::get(const std::string& key, std::string& value, const std::string& legacyPath) {
+  if (get(key, value)) {
+    return true;
+  }
+  FsFile file;
+  if (!Storage.exists(legacyPath.c_str()) || !Storage.openFileForRead("STS", legacyPath, file)) {
+    return false;
+  }
+  value.resize(std::min<size_t>(file.size(), MAX_VALUE_LENGTH));
+  const bool ok = value.empty() || file.read(&value[0], value.size()) == static_cast<int>(value.size());
+  file.close();
+  if (!ok) {
+    return false;
+  }
+  // The old file stays where it is but is no longer read
+  LOG_DBG("STS", "Imported %s as %s", legacyPath.c_str(), key.c_str());
+  put(key, value);
+  return true;
+}
+
+bool StateStore::put(const std::string& key, const uint8_t* data, const size_t length) {
+  if (!mutex || key.empty() || key.size() > MAX_KEY_LENGTH || length > MAX_VALUE_LENGTH) {
+    return false;
+  }
+  uint32_t crc = 0;
+  const std::string record = makeRecord(key, data, length, false, crc);
+  const uint64_t keyHash = hashKey(key.data(), key.size());
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const auto it = find(keyHash);
+  // Nothing to write if the key already has this value. A matching CRC and size only make that likely, so the stored
+  // record is read back to be sure; the read is far cheaper than the append it saves.
+  std::string stored;
+  const bool unchanged =
+      it != entries.end() && it->crc == crc && it->size == record.size() && readRecord(*it, stored) && stored == record;
+  const bool ok = unchanged || append(keyHash, record, crc, false);
+  xSemaphoreGive(mutex);
+  return ok;
+}
+
+bool StateStore::remove(const std::string& key) {
+  if (!mutex || key.empty() || key.size() > MAX_KEY_LENGTH) {
+    return false;
+  }
+  uint32_t crc = 0;
+  const std::string record = makeRecord(key, nullptr, 0, true, crc);
+  const uint64_t keyHash = hashKey(key.data(), key.size());
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const bool ok = find(keyHash) == entries.end() || append(keyHash, record, crc, true);
+  xSemaphoreGive(mutex);
+  return ok;
+}
+
+bool StateStore::compact() {
+  if (!mutex) {
+    return false;
+  }
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  const bool ok = compactLocked();
+  xSemaphoreGive(mutex);
+  return ok;
+}
+
+bool StateStore::compactLocked() {
+  FsFile log;
+  FsFile tmp;
+  if (!Storage.openFileForRead("STS", LOG_FILE, log)) {
+    return false;
+  }
+  if (!Storage.openFileForWrite("STS", TMP_FILE, tmp)) {
+    log.close();
+    return false;
+  }
+
+  serialization::writePod(tmp, LOG_VERSION);
+  std::vector<uint32_t> offsets;
+  offsets.reserve(entries.size());
+  uint32_t offset = HEADER_SIZE;
+  bool ok = true;
+  std::string record;
+  for (const auto& entry : entries) {
+    record.resize(entry.size);
+    ok = log.seek(entry.offset) && log.read(&record[0], entry.size) == static_cast<int>(entry.size) &&
+         tmp.write(reinterpret_cast<const uint8_t*>(record.data()), entry.size) == entry.size;
+    if (!ok) break;
+    offsets.push_back(offset);
+    offset += entry.size;
+  }
+  log.close();
+  tmp.close();
+  if (!ok) {
+    LOG_ERR("STS", "Could not compact %s", LOG_FILE);
+    Storage.remove(TMP_FILE);
+    return false;
+  }
+
+  // From here on begin() finishes the job if power is lost
+  Storage.remove(LOG_FILE);
+  if (!moveTmpToLog()) {
+    // Don't leave the store without a log until the next boot: take whatever recovery can get back
+    LOG_ERR("STS", "Could not replace %s", LOG_FILE);
+    recoverLog();
+    return false;
+  }
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    entries[i].offset = offsets[i];
+  }
+  LOG_DBG("STS", "Compacted state log from %u to %u bytes", logSize, offset);
+  logSize = offset;
+  liveSize = offset;
+  return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Key-value store for the small pieces of state that change often: settings, app state, recent books and the reading
+// progress of every book. It is one append-only log at /.crosspoint/state.log. Each put appends a checksummed record
+// with the key and its new value, so saving a page turn writes a few dozen bytes instead of rewriting a file, and a
+// put that would store the value a key already has writes nothing. A record torn by a power loss fails its checksum
+// and is cut off on the next boot, leaving the key's previous value in place.
+//
+// Only a 64-bit hash of each key and where its latest record is are kept in RAM; values are read from the card. Once
+// superseded records take up most of the log, the live ones are copied to a new log that replaces the old one.
+class StateStore {
+  // Static instance
+  static StateStore instance;
+
+  struct Entry {
+    uint64_t keyHash;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t crc;
+  };
+
+  std::vector<Entry> entries;  // Sorted by keyHash
+  uint32_t logSize = 0;
+  uint32_t liveSize = 0;
+  SemaphoreHandle_t mutex = nullptr;
+
+  // Finishes an interrupted compaction, then loads the log (or starts a new one)
+  bool recoverLog();
+  // Puts the compacted log in place of the removed one, copying it if renaming fails
+  bool moveTmpToLog();
+  bool startLog();
+  bool scan();
+  std::vector<Entry>::iterator find(uint64_t keyHash);
+  // Reads the stored bytes of an entry's latest record
+  bool readRecord(const Entry& entry, std::string& record) const;
+  // Points the key at its latest record, or drops it for a removal
+  void index(uint64_t keyHash, uint32_t offset, uint32_t size, uint32_t crc, bool removed);
+  bool append(uint64_t keyHash, const std::string& record, uint32_t crc, bool removed);
+  bool compactLocked();
+
+ public:
+  ~StateStore() = default;
+
+  // Get singleton instance
+  static StateStore& getInstance() { return instance; }
+
+  // Opens the log, recovering from an interrupted compaction and cutting off a torn record. Call after the SD card is
+  // up and before anything is loaded from the store.
+  bool begin();
+
+  bool get(const std::string& key, std::string& value);
+  // Same, but a key the store doesn't have yet is imported from `legacyPath`, the file its value was kept in before.
+  bool get(const std::string& key, std::string& value, const std::string& legacyPath);
+  bool put(const std::string& key, const uint8_t* data, size_t length);
+  bool put(const std::string& key, const std::string& value) {
+    return put(key, reinterpret_cast<const uint8_t*>(value.data()), value.size());
+  }
+  bool remove(const std::string& key);
+  // Rewrites the log with the live records only
+  bool compact();
+
+  // Key of the reading progress of the book cached at `cachePath`, which used to be <cachePath>/progress.bin
+  static std::string progressKey(const std::string& cachePath) { return cachePath + "/progress"; }
+};
+
+// Helper macro to access the state store
+#define STATE_STORE StateStore::getInstance()
@@ -1,5 +1,7 @@
 #include "Activity.h"
 
+#include "RenderStats.h"
+
 void Activity::renderTaskTrampoline(void* param) {
   auto* self = static_cast<Activity*>(param);
   self->renderTaskLoop();
@@ -10,11 +12,46 @@ void Activity::renderTaskLoop() {
     ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     {
       RenderLock lock(*this);
-      render(std::move(lock));
+      renderLatest(std::move(lock));
     }
   }
 }
 
+void Activity::renderLatest(RenderLock&& lock) {
+  const uint32_t requested = requestedRenders.load();
+  if (requested == startedRenders) {
+    // Left over from a request the previous render already served: it came in after that render was notified, but
+    // before it started
+    return;
+  }
+  startedRenders = requested;
+  renderAborted = false;
+
+  RENDER_STATS.beginRender(pendingRequestAt.exchange(0), renderer);
+  render(std::move(lock));
+  RENDER_STATS.endRender(name, renderer);
+
+  // A superseded render is finished by the one that follows it
+  if (!renderAborted) {
+    finishedRenders = requested;
+    xSemaphoreGive(renderFinished);
+  }
+}
+
+void Activity::dropPendingRenders() {
+  startedRenders = requestedRenders.load();
+  pendingRequestAt = 0;
+  finishedRenders = startedRenders;
+  xSemaphoreGive(renderFinished);
+}
+
+bool Activity::renderSuperseded() {
+  if (requestedRenders.load() != startedRenders) {
+    renderAborted = true;
+  }
+  return renderAborted;
+}
+
 void Activity::onEnter() {
   xTaskCreate(&renderTaskTrampoline, name.c_str(),
               8192,              // Stack size
@@ -37,16 +74,29 @@ void Activity::onExit() {
 }
 
 void Activity::requestUpdate() {
-  // Using direct notification to signal the render task to update
-  // Increment counter so multiple rapid calls won't be lost
+  // Using direct notification to signal the render task to update. Requests made before the render task gets to them
+  // are coalesced into one render of the latest state.
   if (renderTaskHandle) {
+    requestedRenders++;
+    unsigned long none = 0;
+    pendingRequestAt.compare_exchange_strong(none, millis());
     xTaskNotify(renderTaskHandle, 1, eIncrement);
   }
 }
 
 void Activity::requestUpdateAndWait() {
-  // FIXME @ngxson : properly implement this using freeRTOS notification
-  delay(100);
+  requestUpdate();
+  waitForUpdate();
+}
+
+void Activity::waitForUpdate() {
+  if (!renderTaskHandle || xTaskGetCurrentTaskHandle() == renderTaskHandle) {
+    return;  // The render task can't wait for itself
+  }
+  const uint32_t target = requestedRenders.load();
+  while (static_cast<int32_t>(target - finishedRenders.load()) > 0) {
+    xSemaphoreTake(renderFinished, portMAX_DELAY);
+  }
 }
 
 // RenderLock
@@ -5,6 +5,7 @@
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include <atomic>
 #include <cassert>
 #include <string>
 #include <utility>
@@ -26,14 +27,33 @@ class Activity {
   // Mutex to protect rendering operations from being deleted mid-render
   SemaphoreHandle_t renderingMutex = nullptr;
 
+  // Render requests are counted rather than queued: a render draws whatever the state is when it starts, so it serves
+  // every request made before then, and any request made while it runs supersedes it.
+  std::atomic<uint32_t> requestedRenders{0};
+  std::atomic<uint32_t> finishedRenders{0};
+  uint32_t startedRenders = 0;  // Render task only
+  bool renderAborted = false;   // Render task only
+  // Given each time finishedRenders moves, for requestUpdateAndWait()
+  SemaphoreHandle_t renderFinished = nullptr;
+
+  // millis() of the first requestUpdate() the next render serves; 0 if none is pending
+  std::atomic<unsigned long> pendingRequestAt{0};
+
  public:
   explicit Activity(std::string name, GfxRenderer& renderer, MappedInputManager& mappedInput)
-      : name(std::move(name)), renderer(renderer), mappedInput(mappedInput), renderingMutex(xSemaphoreCreateMutex()) {
+      : name(std::move(name)),
+        renderer(renderer),
+        mappedInput(mappedInput),
+        renderingMutex(xSemaphoreCreateMutex()),
+        renderFinished(xSemaphoreCreateBinary()) {
     assert(renderingMutex != nullptr && "Failed to create rendering mutex");
+    assert(renderFinished != nullptr && "Failed to create render semaphore");
   }
   virtual ~Activity() {
     vSemaphoreDelete(renderingMutex);
     renderingMutex = nullptr;
+    vSemaphoreDelete(renderFinished);
+    renderFinished = nullptr;
   };
   class RenderLock;
   virtual void onEnter();
@@ -42,10 +62,19 @@ class Activity {
 
   virtual void render(RenderLock&&) {}
   virtual void requestUpdate();
+  // Requests a render and blocks until it has been shown. Not for the render task itself.
   virtual void requestUpdateAndWait();
+  // Blocks until every render requested so far has been shown
+  void waitForUpdate();
+  // Whether every render requested so far has been shown, i.e. the render task is off the SD card
+  virtual bool isRenderIdle() const { return finishedRenders.load() == requestedRenders.load(); }
 
   virtual bool skipLoopDelay() { return false; }
   virtual bool preventAutoSleep() { return false; }
+  // Whether queued background jobs (CoverJobQueue) may take the SD card between loop() calls
+  virtual bool allowsBackgroundJobs() { return !skipLoopDelay() && !preventAutoSleep(); }
+  // Whether those jobs may also run on battery: only on the file transfer screens, where the radio is on anyway
+  virtual bool allowsBackgroundJobsOnBattery() { return false; }
   virtual bool isReaderActivity() const { return false; }
 
   // RAII helper to lock rendering mutex for the duration of a scope.
@@ -58,4 +87,15 @@ class Activity {
     RenderLock& operator=(const RenderLock&) = delete;
     ~RenderLock();
   };
+
+ protected:
+  // For render tasks, with the lock held: runs render() once for every request pending, and records its latency in
+  // RENDER_STATS
+  void renderLatest(RenderLock&& lock);
+  // For render tasks that skip rendering: counts the pending requests as served
+  void dropPendingRenders();
+  // For render(): whether a newer request came in since the render started. Checked at points where stopping is safe
+  // (after loading the page, between page elements, before handing a frame to the display); when it returns true,
+  // render() should return without showing anything more, and the next render picks up the latest state.
+  bool renderSuperseded();
 };
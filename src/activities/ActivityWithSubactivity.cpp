@@ -6,10 +6,12 @@ void ActivityWithSubactivity::renderTaskLoop() {
     {
       RenderLock lock(*this);
       if (!subActivity) {
-        render(std::move(lock));
+        renderLatest(std::move(lock));
+      } else {
+        // If subActivity is set, consume the notification but skip parent render
+        // Note: the sub-activity will call its render() from its own display task
+        dropPendingRenders();
       }
-      // If subActivity is set, consume the notification but skip parent render
-      // Note: the sub-activity will call its render() from its own display task
     }
   }
 }
@@ -18,4 +18,17 @@ class ActivityWithSubactivity : public Activity {
   // the subactivity should request its own renders. This pauses parent rendering until exit.
   void requestUpdate() override;
   void onExit() override;
+  // The subactivity's work counts as the parent's, so a search or index build two levels down still keeps the device
+  // awake and background jobs off the SD card
+  bool skipLoopDelay() override { return subActivity && subActivity->skipLoopDelay(); }
+  bool preventAutoSleep() override { return subActivity && subActivity->preventAutoSleep(); }
+  bool allowsBackgroundJobs() override {
+    return Activity::allowsBackgroundJobs() && (!subActivity || subActivity->allowsBackgroundJobs());
+  }
+  bool allowsBackgroundJobsOnBattery() override {
+    return subActivity && subActivity->allowsBackgroundJobsOnBattery();
+  }
+  bool isRenderIdle() const override {
+    return Activity::isRenderIdle() && (!subActivity || subActivity->isRenderIdle());
+  }
 };
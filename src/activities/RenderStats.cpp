@@ -0,0 +1,118 @@
+#include "RenderStats.h"
+
+#include <Arduino.h>
+#include <GfxRenderer.h>
+#include <Logging.h>
+
+#include <algorithm>
+
+namespace {
+// A button press counts towards a render requested within this long
+constexpr unsigned long INPUT_WINDOW_MS = 2000;
+
+uint16_t clampMs(const unsigned long ms) { return static_cast<uint16_t>(std::min<unsigned long>(ms, 0xFFFE)); }
+}  // namespace
+
+RenderStats RenderStats::instance;
+
+const char* RenderStats::spanName(const Span span) {
+  switch (span) {
+    case INPUT_SPAN:
+      return "input";
+    case QUEUED_SPAN:
+      return "queued";
+    case LOAD_SPAN:
+      return "load";
+    case DRAW_SPAN:
+      return "draw";
+    case PANEL_SPAN:
+      return "panel";
+    case TOTAL_SPAN:
+    default:
+      return "total";
+  }
+}
+
+void RenderStats::onPageLoaded() {
+  if (renderStartAt != 0 && pageLoadedAt == 0) {
+    pageLoadedAt = millis();
+  }
+}
+
+void RenderStats::beginRender(const unsigned long requestedAt, const GfxRenderer& renderer) {
+  renderStartAt = millis();
+  this->requestedAt = requestedAt != 0 ? requestedAt : renderStartAt;
+  pageLoadedAt = 0;
+  renderer.resetFrameTiming();
+}
+
+void RenderStats::endRender(const std::string& activity, const GfxRenderer& renderer) {
+  const unsigned long now = millis();
+  const unsigned long frameAt = renderer.getFirstFrameAt();
+  const unsigned long startAt = renderStartAt;
+  renderStartAt = 0;
+  if (frameAt == 0) {
+    return;  // Nothing was shown
+  }
+
+  const bool fromInput = lastInputAt != 0 && lastInputAt <= requestedAt && requestedAt - lastInputAt < INPUT_WINDOW_MS;
+  const unsigned long origin = fromInput ? lastInputAt : requestedAt;
+  if (fromInput) {
+    lastInputAt = 0;  // One press, one latency
+  }
+
+  Sample sample{};
+  sample.spans[INPUT_SPAN] = fromInput ? clampMs(requestedAt - origin) : NOT_MEASURED;
+  sample.spans[QUEUED_SPAN] = clampMs(startAt - requestedAt);
+  sample.spans[LOAD_SPAN] = pageLoadedAt != 0 ? clampMs(pageLoadedAt - startAt) : NOT_MEASURED;
+  sample.spans[DRAW_SPAN] = clampMs(frameAt - (pageLoadedAt != 0 ? pageLoadedAt : startAt));
+  sample.spans[PANEL_SPAN] = clampMs(renderer.getPanelMs());
+  sample.spans[TOTAL_SPAN] = clampMs(now - origin);
+
+  LOG_DBG("RND", "%s: input %u, queued %u, load %u, draw %u, panel %u, total %u ms", activity.c_str(),
+          fromInput ? sample.spans[INPUT_SPAN] : 0, sample.spans[QUEUED_SPAN],
+          pageLoadedAt != 0 ? sample.spans[LOAD_SPAN] : 0, sample.spans[DRAW_SPAN], sample.spans[PANEL_SPAN],
+          sample.spans[TOTAL_SPAN]);
+
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  auto it = std::find(activities.begin(), activities.end(), activity);
+  if (it == activities.end() && activities.size() < MAX_ACTIVITIES) {
+    it = activities.insert(activities.end(), activity);
+  }
+  if (it != activities.end()) {
+    sample.activity = static_cast<uint8_t>(it - activities.begin());
+    samples[nextSample] = sample;
+    nextSample = (nextSample + 1) % MAX_SAMPLES;
+    sampleCount = std::min(sampleCount + 1, MAX_SAMPLES);
+  }
+  xSemaphoreGive(mutex);
+}
+
+void RenderStats::forEachActivity(
+    const std::function<void(const std::string& activity, const Summary (&spans)[SPAN_COUNT])>& onActivity) const {
+  xSemaphoreTake(mutex, portMAX_DELAY);
+  uint16_t values[MAX_SAMPLES];
+  for (size_t a = 0; a < activities.size(); a++) {
+    Summary summaries[SPAN_COUNT];
+    for (int span = 0; span < SPAN_COUNT; span++) {
+      size_t count = 0;
+      for (size_t i = 0; i < sampleCount; i++) {
+        if (samples[i].activity == a && samples[i].spans[span] != NOT_MEASURED) {
+          values[count++] = samples[i].spans[span];
+        }
+      }
+      if (count == 0) continue;
+      std::sort(values, values + count);
+      auto& summary = summaries[span];
+      summary.samples = static_cast<uint16_t>(count);
+      summary.min = values[0];
+      summary.median = values[count / 2];
+      // Nearest rank
+      summary.p95 = values[(count * 95 + 99) / 100 - 1];
+    }
+    if (summaries[TOTAL_SPAN].samples > 0) {
+      onActivity(activities[a], summaries);
+    }
+  }
+  xSemaphoreGive(mutex);
+}
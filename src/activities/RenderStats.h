@@ -0,0 +1,79 @@
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class GfxRenderer;
+
+// Where the time between a button press and a finished refresh goes, kept for the last renders of every activity:
+//   input     button press -> requestUpdate()
+//   queued    requestUpdate() -> render task starts rendering
+//   load      render start -> page content in memory (readers only: section I/O, pagination, page decode)
+//   draw      page loaded (or render start) -> first frame handed to the panel
+//   panel     SPI transfer and refresh of every frame the render showed
+//   total     button press (or request) -> render done
+// Each activity's min, median and 95th percentile are served by /api/status.
+class RenderStats {
+ public:
+  enum Span : uint8_t { INPUT_SPAN, QUEUED_SPAN, LOAD_SPAN, DRAW_SPAN, PANEL_SPAN, TOTAL_SPAN, SPAN_COUNT };
+
+  struct Summary {
+    uint16_t samples = 0;
+    uint16_t min = 0;
+    uint16_t median = 0;
+    uint16_t p95 = 0;
+  };
+
+ private:
+  // Static instance
+  static RenderStats instance;
+
+  static constexpr size_t MAX_SAMPLES = 64;
+  static constexpr size_t MAX_ACTIVITIES = 16;
+  // Spans that don't apply to a render (no button press, no page load)
+  static constexpr uint16_t NOT_MEASURED = 0xFFFF;
+
+  struct Sample {
+    uint8_t activity;
+    uint16_t spans[SPAN_COUNT];
+  };
+
+  SemaphoreHandle_t mutex;
+  std::vector<std::string> activities;
+  Sample samples[MAX_SAMPLES] = {};
+  size_t sampleCount = 0;
+  size_t nextSample = 0;
+
+  unsigned long lastInputAt = 0;
+  unsigned long requestedAt = 0;
+  unsigned long renderStartAt = 0;
+  unsigned long pageLoadedAt = 0;
+
+  RenderStats() : mutex(xSemaphoreCreateMutex()) {}
+
+ public:
+  // Get singleton instance
+  static RenderStats& getInstance() { return instance; }
+
+  static const char* spanName(Span span);
+
+  // Main loop, when a button went down
+  void onInput(unsigned long at) { lastInputAt = at; }
+  // Readers, once the page to show is in memory
+  void onPageLoaded();
+  // Render task, around render(). `requestedAt` is when the first request the render serves was made.
+  void beginRender(unsigned long requestedAt, const GfxRenderer& renderer);
+  void endRender(const std::string& activity, const GfxRenderer& renderer);
+
+  // Summaries of the renders kept, per activity
+  void forEachActivity(
+      const std::function<void(const std::string& activity, const Summary (&spans)[SPAN_COUNT])>& onActivity) const;
+};
+
+// Helper macro to access render statistics
+#define RENDER_STATS RenderStats::getInstance()
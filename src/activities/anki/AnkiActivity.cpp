@@ -226,6 +226,9 @@ void AnkiActivity::onExit() {
   vSemaphoreDelete(renderingMutex);
   renderingMutex = nullptr;
   cardPages.clear();
+  if (deck) {
+    deck->compact();
+  }
   deck.reset();
 
   Storage.remove(TEMP_MD_PATH);
@@ -10,7 +10,6 @@
 #include "MappedInputManager.h"
 #include "anki/AnkiDeck.h"
 #include "anki/AnkiSessionManager.h"
-#include "anki/CsvParser.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 
@@ -150,15 +149,12 @@ void AnkiDeckExplorerActivity::scanDecks() {
       info.path = path;
       info.title = titleFromPath(path);
 
-      size_t due = AnkiDeck::countDueCards(path);
+      size_t total = 0;
+      size_t due = 0;
+      AnkiDeck::countCards(path, total, due);
+      info.totalCards = static_cast<uint16_t>(total);
       info.dueCount = static_cast<uint16_t>(due);
 
-      // Count total cards from the CSV (header row + data rows)
-      std::vector<CsvRow> rows;
-      if (CsvParser::parseFile(path, rows) && rows.size() > 1) {
-        info.totalCards = static_cast<uint16_t>(rows.size() - 1);
-      }
-
       decks.push_back(std::move(info));
     }
   }
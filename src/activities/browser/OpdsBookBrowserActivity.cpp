@@ -7,12 +7,17 @@
 #include <OpdsStream.h>
 #include <WiFi.h>
 
+#include "CoverJobQueue.h"
 #include "CrossPointSettings.h"
+#include "LibraryCatalog.h"
 #include "MappedInputManager.h"
+#include "StateStore.h"
 #include "activities/network/WifiSelectionActivity.h"
+#include "components/ThumbnailAtlas.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 #include "network/HttpDownloader.h"
+#include "network/OpdsFeedCache.h"
 #include "util/StringUtils.h"
 #include "util/UrlUtils.h"
 
@@ -25,6 +30,7 @@ void OpdsBookBrowserActivity::onEnter() {
 
   state = BrowserState::CHECK_WIFI;
   entries.clear();
+  feedPages.clear();
   navigationHistory.clear();
   currentPath = "";  // Root path - user provides full URL in settings
   selectorIndex = 0;
@@ -43,6 +49,7 @@ void OpdsBookBrowserActivity::onExit() {
   WiFi.mode(WIFI_OFF);
 
   entries.clear();
+  feedPages.clear();
   navigationHistory.clear();
 }
 
@@ -100,7 +107,7 @@ void OpdsBookBrowserActivity::loop() {
   if (state == BrowserState::BROWSING) {
     if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
       if (!entries.empty()) {
-        const auto& entry = entries[selectorIndex];
+        const auto& entry = entries[selectorIndex - windowStart];
         if (entry.type == OpdsEntryType::BOOK) {
           downloadBook(entry);
         } else {
@@ -111,27 +118,25 @@ void OpdsBookBrowserActivity::loop() {
       navigateBack();
     }
 
-    // Handle navigation
+    // Handle navigation; moving past the last known entry fetches the next feed page first
     if (!entries.empty()) {
       buttonNavigator.onNextRelease([this] {
-        selectorIndex = ButtonNavigator::nextIndex(selectorIndex, entries.size());
-        requestUpdate();
+        if (ensureEntryLoaded(selectorIndex + 1)) {
+          selectEntry(ButtonNavigator::nextIndex(selectorIndex, knownEntryCount));
+        }
       });
 
-      buttonNavigator.onPreviousRelease([this] {
-        selectorIndex = ButtonNavigator::previousIndex(selectorIndex, entries.size());
-        requestUpdate();
-      });
+      buttonNavigator.onPreviousRelease(
+          [this] { selectEntry(ButtonNavigator::previousIndex(selectorIndex, knownEntryCount)); });
 
       buttonNavigator.onNextContinuous([this] {
-        selectorIndex = ButtonNavigator::nextPageIndex(selectorIndex, entries.size(), PAGE_ITEMS);
-        requestUpdate();
+        if (ensureEntryLoaded((selectorIndex / PAGE_ITEMS + 1) * PAGE_ITEMS)) {
+          selectEntry(ButtonNavigator::nextPageIndex(selectorIndex, knownEntryCount, PAGE_ITEMS));
+        }
       });
 
-      buttonNavigator.onPreviousContinuous([this] {
-        selectorIndex = ButtonNavigator::previousPageIndex(selectorIndex, entries.size(), PAGE_ITEMS);
-        requestUpdate();
-      });
+      buttonNavigator.onPreviousContinuous(
+          [this] { selectEntry(ButtonNavigator::previousPageIndex(selectorIndex, knownEntryCount, PAGE_ITEMS)); });
     }
   }
 }
@@ -186,7 +191,7 @@ void OpdsBookBrowserActivity::render(Activity::RenderLock&&) {
   // Browsing state
   // Show appropriate button hint based on selected entry type
   const char* confirmLabel = tr(STR_OPEN);
-  if (!entries.empty() && entries[selectorIndex].type == OpdsEntryType::BOOK) {
+  if (!entries.empty() && entries[selectorIndex - windowStart].type == OpdsEntryType::BOOK) {
     confirmLabel = tr(STR_DOWNLOAD);
   }
   const auto labels = mappedInput.mapLabels(tr(STR_BACK), confirmLabel, "", "");
@@ -198,10 +203,9 @@ void OpdsBookBrowserActivity::render(Activity::RenderLock&&) {
     return;
   }
 
-  const auto pageStartIndex = selectorIndex / PAGE_ITEMS * PAGE_ITEMS;
-  renderer.fillRect(0, 60 + (selectorIndex % PAGE_ITEMS) * 30 - 2, pageWidth - 1, 30);
+  renderer.fillRect(0, 60 + (selectorIndex - windowStart) * 30 - 2, pageWidth - 1, 30);
 
-  for (size_t i = pageStartIndex; i < entries.size() && i < static_cast<size_t>(pageStartIndex + PAGE_ITEMS); i++) {
+  for (size_t i = 0; i < entries.size(); i++) {
     const auto& entry = entries[i];
 
     // Format display text with type indicator
@@ -217,8 +221,8 @@ void OpdsBookBrowserActivity::render(Activity::RenderLock&&) {
     }
 
     auto item = renderer.truncatedText(UI_10_FONT_ID, displayText.c_str(), renderer.getScreenWidth() - 40);
-    renderer.drawText(UI_10_FONT_ID, 20, 60 + (i % PAGE_ITEMS) * 30, item.c_str(),
-                      i != static_cast<size_t>(selectorIndex));
+    renderer.drawText(UI_10_FONT_ID, 20, 60 + static_cast<int>(i) * 30, item.c_str(),
+                      windowStart + static_cast<int>(i) != selectorIndex);
   }
 
   renderer.displayBuffer();
@@ -233,40 +237,143 @@ void OpdsBookBrowserActivity::fetchFeed(const std::string& path) {
     return;
   }
 
-  std::string url = UrlUtils::buildUrl(serverUrl, path);
+  feedPages.clear();
+  knownEntryCount = 0;
+  nextPageUrl = UrlUtils::buildUrl(serverUrl, path);
+  selectorIndex = 0;
+
+  if (!fetchNextFeedPage() || !loadWindow(0)) {
+    state = BrowserState::ERROR;
+    requestUpdate();
+    return;
+  }
+  LOG_DBG("OPDS", "Found %d entries%s", knownEntryCount, nextPageUrl.empty() ? "" : " on the first page");
+
+  if (entries.empty()) {
+    state = BrowserState::ERROR;
+    errorMessage = tr(STR_NO_ENTRIES);
+    requestUpdate();
+    return;
+  }
+
+  state = BrowserState::BROWSING;
+  requestUpdate();
+}
+
+bool OpdsBookBrowserActivity::fetchNextFeedPage() {
+  const std::string url = nextPageUrl;
   LOG_DBG("OPDS", "Fetching: %s", url.c_str());
 
+  const std::string cachePath = OpdsFeedCache::fetch(url);
+  if (cachePath.empty()) {
+    errorMessage = tr(STR_FETCH_FEED_FAILED);
+    return false;
+  }
+
+  uint16_t entryCount = 0;
+  std::string nextHref;
+  if (!readFeedPage(cachePath, knownEntryCount, 0, nullptr, entryCount, nextHref)) {
+    errorMessage = tr(STR_PARSE_FEED_FAILED);
+    return false;
+  }
+  feedPages.push_back({url, entryCount});
+  knownEntryCount += entryCount;
+
+  // A link back to a page already seen would never end
+  nextPageUrl = nextHref.empty() ? std::string() : UrlUtils::buildUrl(SETTINGS.opdsServerUrl, nextHref);
+  for (const auto& page : feedPages) {
+    if (page.url == nextPageUrl) {
+      nextPageUrl.clear();
+      break;
+    }
+  }
+  return true;
+}
+
+bool OpdsBookBrowserActivity::readFeedPage(const std::string& cachePath, const int firstIndex, const int windowFrom,
+                                           std::vector<OpdsEntry>* window, uint16_t& entryCount,
+                                           std::string& nextHref) const {
   OpdsParser parser;
+  int index = firstIndex;
+  parser.setEntryCallback([&index, windowFrom, window](OpdsEntry&& entry) {
+    if (window && index >= windowFrom && index < windowFrom + PAGE_ITEMS) {
+      window->push_back(std::move(entry));
+    }
+    index++;
+  });
+  if (!OpdsFeedCache::parse(cachePath, parser)) {
+    return false;
+  }
+  entryCount = static_cast<uint16_t>(index - firstIndex);
+  nextHref = parser.getNextHref();
+  return true;
+}
+
+bool OpdsBookBrowserActivity::loadWindow(const int start) {
+  if (!ensureEntryLoaded(start + PAGE_ITEMS - 1)) {
+    return false;
+  }
+
+  std::vector<OpdsEntry> window;
+  window.reserve(PAGE_ITEMS);
+  int pageFirst = 0;
+  for (const auto& page : feedPages) {
+    if (pageFirst >= start + PAGE_ITEMS) {
+      break;
+    }
+    if (pageFirst + page.entryCount > start) {
+      // Normally still cached from when the page was first fetched
+      std::string cachePath = OpdsFeedCache::find(page.url);
+      if (cachePath.empty()) {
+        cachePath = OpdsFeedCache::fetch(page.url);
+      }
+      uint16_t entryCount;
+      std::string nextHref;
+      if (cachePath.empty() || !readFeedPage(cachePath, pageFirst, start, &window, entryCount, nextHref)) {
+        errorMessage = tr(STR_FETCH_FEED_FAILED);
+        return false;
+      }
+    }
+    pageFirst += page.entryCount;
+  }
+
+  RenderLock lock(*this);
+  entries = std::move(window);
+  windowStart = start;
+  return true;
+}
+
+bool OpdsBookBrowserActivity::ensureEntryLoaded(const int index) {
+  if (index < knownEntryCount || nextPageUrl.empty()) {
+    return true;
+  }
 
-  {
-    OpdsParserStream stream{parser};
-    if (!HttpDownloader::fetchUrl(url, stream)) {
+  state = BrowserState::LOADING;
+  statusMessage = tr(STR_LOADING);
+  requestUpdate();
+  while (index >= knownEntryCount && !nextPageUrl.empty()) {
+    if (!fetchNextFeedPage()) {
       state = BrowserState::ERROR;
-      errorMessage = tr(STR_FETCH_FEED_FAILED);
       requestUpdate();
-      return;
+      return false;
     }
   }
+  state = BrowserState::BROWSING;
+  requestUpdate();
+  return true;
+}
 
-  if (!parser) {
-    state = BrowserState::ERROR;
-    errorMessage = tr(STR_PARSE_FEED_FAILED);
-    requestUpdate();
+void OpdsBookBrowserActivity::selectEntry(const int index) {
+  if (state != BrowserState::BROWSING) {
     return;
   }
-
-  entries = std::move(parser).getEntries();
-  LOG_DBG("OPDS", "Found %d entries", entries.size());
-  selectorIndex = 0;
-
-  if (entries.empty()) {
+  const int pageStart = index / PAGE_ITEMS * PAGE_ITEMS;
+  if (pageStart != windowStart && !loadWindow(pageStart)) {
     state = BrowserState::ERROR;
-    errorMessage = tr(STR_NO_ENTRIES);
     requestUpdate();
     return;
   }
-
-  state = BrowserState::BROWSING;
+  selectorIndex = index;
   requestUpdate();
 }
 
@@ -335,6 +442,10 @@ void OpdsBookBrowserActivity::downloadBook(const OpdsEntry& book) {
     // Invalidate any existing cache for this file to prevent stale metadata issues
     Epub epub(filename, "/.crosspoint");
     epub.clearCache();
+    STATE_STORE.remove(StateStore::progressKey(epub.getCachePath()));
+    ThumbnailAtlas::forgetBook(filename);
+    LIBRARY_CATALOG.invalidatePath(filename);
+    COVER_JOBS.enqueue(filename);
     LOG_DBG("OPDS", "Cleared cache for: %s", filename.c_str());
 
     state = BrowserState::BROWSING;
@@ -11,6 +11,8 @@
 /**
  * Activity for browsing and downloading books from an OPDS server.
  * Supports navigation through catalog hierarchy and downloading EPUBs.
+ * Paginated feeds (rel="next") are fetched page by page as the selection reaches their end. Feed pages are cached on
+ * the SD card and only the entries on screen are held in memory, so large catalogs browse with flat memory use.
  * When WiFi connection fails, launches WiFi selection to let user connect.
  */
 class OpdsBookBrowserActivity final : public ActivityWithSubactivity {
@@ -34,9 +36,19 @@ class OpdsBookBrowserActivity final : public ActivityWithSubactivity {
   void render(Activity::RenderLock&&) override;
 
  private:
+  // A page of the current feed that has been fetched (and cached)
+  struct FeedPage {
+    std::string url;
+    uint16_t entryCount;
+  };
+
   ButtonNavigator buttonNavigator;
   BrowserState state = BrowserState::LOADING;
-  std::vector<OpdsEntry> entries;
+  std::vector<OpdsEntry> entries;  // The screen page of entries starting at windowStart
+  int windowStart = 0;
+  std::vector<FeedPage> feedPages;
+  std::string nextPageUrl;  // Feed page not fetched yet; empty once the last one is known
+  int knownEntryCount = 0;  // Entries on the fetched feed pages
   std::vector<std::string> navigationHistory;  // Stack of previous feed paths for back navigation
   std::string currentPath;                     // Current feed path being displayed
   int selectorIndex = 0;
@@ -51,6 +63,15 @@ class OpdsBookBrowserActivity final : public ActivityWithSubactivity {
   void launchWifiSelection();
   void onWifiSelectionComplete(bool connected);
   void fetchFeed(const std::string& path);
+  bool fetchNextFeedPage();
+  // Parses a cached feed page whose first entry has index `firstIndex`, keeping those of the screen page at
+  // `windowFrom` in `window` (if given)
+  bool readFeedPage(const std::string& cachePath, int firstIndex, int windowFrom, std::vector<OpdsEntry>* window,
+                    uint16_t& entryCount, std::string& nextHref) const;
+  bool loadWindow(int start);
+  // Fetches feed pages until entry `index` is known or the feed ends. False (and ERROR state) if a fetch failed
+  bool ensureEntryLoaded(int index);
+  void selectEntry(int index);
   void navigateToEntry(const OpdsEntry& entry);
   void navigateBack();
   void downloadBook(const OpdsEntry& book);
@@ -1,25 +1,24 @@
 #include "HomeActivity.h"
 
 #include <Bitmap.h>
-#include <Epub.h>
 #include <GfxRenderer.h>
 #include <HalStorage.h>
 #include <I18n.h>
 #include <Utf8.h>
-#include <Xtc.h>
 
 #include <cstring>
 #include <vector>
 
 #include "Battery.h"
+#include "CoverJobQueue.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "InstapaperCredentialStore.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
+#include "components/ThumbnailAtlas.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
-#include "util/StringUtils.h"
 
 int HomeActivity::getMenuItemCount() const {
   int count = 4;  // My Library, Recents, File transfer, Settings
@@ -58,62 +57,51 @@ void HomeActivity::loadRecentBooks(int maxBooks) {
   }
 }
 
-void HomeActivity::loadRecentCovers(int coverHeight) {
-  recentsLoading = true;
-  bool showingLoading = false;
-  Rect popupRect;
+void HomeActivity::coverTaskTrampoline(void* param) {
+  auto* self = static_cast<HomeActivity*>(param);
+  self->importRecentCovers(UITheme::getInstance().getMetrics().homeCoverHeight);
+  {
+    RenderLock lock(*self);
+    self->coverTaskHandle = nullptr;
+  }
+  vTaskDelete(nullptr);
+}
+
+void HomeActivity::importRecentCovers(const int coverHeight) {
+  ThumbnailAtlas atlas(coverHeight);
 
-  int progress = 0;
   for (RecentBook& book : recentBooks) {
-    if (!book.coverBmpPath.empty()) {
-      std::string coverPath = UITheme::getCoverThumbPath(book.coverBmpPath, coverHeight);
-      if (!Storage.exists(coverPath.c_str())) {
-        // If epub, try to load the metadata for title/author and cover
-        if (StringUtils::checkFileExtension(book.path, ".epub")) {
-          Epub epub(book.path, "/.crosspoint");
-          // Skip loading css since we only need metadata here
-          epub.load(false, true);
-
-          // Try to generate thumbnail image for Continue Reading card
-          if (!showingLoading) {
-            showingLoading = true;
-            popupRect = GUI.drawPopup(renderer, tr(STR_LOADING));
-          }
-          GUI.fillPopupProgress(renderer, popupRect, 10 + progress * (90 / recentBooks.size()));
-          bool success = epub.generateThumbBmp(coverHeight);
-          if (!success) {
-            RECENT_BOOKS.updateBook(book.path, book.title, book.author, "");
-            book.coverBmpPath = "";
-          }
-          coverRendered = false;
-          requestUpdate();
-        } else if (StringUtils::checkFileExtension(book.path, ".xtch") ||
-                   StringUtils::checkFileExtension(book.path, ".xtc")) {
-          // Handle XTC file
-          Xtc xtc(book.path, "/.crosspoint");
-          if (xtc.load()) {
-            // Try to generate thumbnail image for Continue Reading card
-            if (!showingLoading) {
-              showingLoading = true;
-              popupRect = GUI.drawPopup(renderer, tr(STR_LOADING));
-            }
-            GUI.fillPopupProgress(renderer, popupRect, 10 + progress * (90 / recentBooks.size()));
-            bool success = xtc.generateThumbBmp(coverHeight);
-            if (!success) {
-              RECENT_BOOKS.updateBook(book.path, book.title, book.author, "");
-              book.coverBmpPath = "";
-            }
-            coverRendered = false;
-            requestUpdate();
-          }
+    if (coverTaskCancelled) {
+      return;
+    }
+    {
+      // The SD card is shared with the render task; hold the lock per book so navigation keeps redrawing in between
+      RenderLock lock(*this);
+      if (book.coverBmpPath.empty() || atlas.contains(book.path)) {
+        continue;
+      }
+
+      const std::string coverPath = UITheme::getCoverThumbPath(book.coverBmpPath, coverHeight);
+      bool hasThumb = Storage.exists(coverPath.c_str());
+      if (!hasThumb) {
+        // Not done by the background queue yet: generate every size now from a single decode
+        if (CoverJobQueue::generateCovers(book.path)) {
+          hasThumb = Storage.exists(coverPath.c_str());
+        } else {
+          RECENT_BOOKS.updateBook(book.path, book.title, book.author, "");
+          book.coverBmpPath = "";
         }
       }
+
+      if (hasThumb) {
+        atlas.addFromBmp(book.path, coverPath);
+      } else {
+        atlas.addEmpty(book.path);
+      }
+      coverRendered = false;
     }
-    progress++;
+    requestUpdate();
   }
-
-  recentsLoaded = true;
-  recentsLoading = false;
 }
 
 void HomeActivity::onEnter() {
@@ -130,9 +118,19 @@ void HomeActivity::onEnter() {
 
   // Trigger first update
   requestUpdate();
+
+  if (!recentBooks.empty()) {
+    coverTaskCancelled = false;
+    xTaskCreate(&HomeActivity::coverTaskTrampoline, "HomeCovers", 8192, this, tskIDLE_PRIORITY, &coverTaskHandle);
+  }
 }
 
 void HomeActivity::onExit() {
+  // The task checks the flag between books; let it close the atlas file rather than deleting it mid-import
+  coverTaskCancelled = true;
+  while (coverTaskHandle) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
   Activity::onExit();
 
   // Free the stored cover buffer if any
@@ -269,12 +267,4 @@ void HomeActivity::render(Activity::RenderLock&&) {
   GUI.drawButtonHints(renderer, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
 
   renderer.displayBuffer();
-
-  if (!firstRenderDone) {
-    firstRenderDone = true;
-    requestUpdate();
-  } else if (!recentsLoaded && !recentsLoading) {
-    recentsLoading = true;
-    loadRecentCovers(metrics.homeCoverHeight);
-  }
 }
@@ -12,14 +12,13 @@ struct Rect;
 class HomeActivity final : public Activity {
   ButtonNavigator buttonNavigator;
   int selectorIndex = 0;
-  bool recentsLoading = false;
-  bool recentsLoaded = false;
-  bool firstRenderDone = false;
   bool hasOpdsUrl = false;
   bool hasInstapaper = false;
   bool coverRendered = false;      // Track if cover has been rendered once
   bool coverBufferStored = false;  // Track if cover buffer is stored
   uint8_t* coverBuffer = nullptr;  // HomeActivity's own buffer for cover image
+  TaskHandle_t coverTaskHandle = nullptr;
+  volatile bool coverTaskCancelled = false;
   std::vector<RecentBook> recentBooks;
   const std::function<void(const std::string& path)> onSelectBook;
   const std::function<void()> onMyLibraryOpen;
@@ -35,7 +34,10 @@ class HomeActivity final : public Activity {
   bool restoreCoverBuffer();  // Restore frame buffer from stored cover
   void freeCoverBuffer();     // Free the stored cover buffer
   void loadRecentBooks(int maxBooks);
-  void loadRecentCovers(int coverHeight);
+  // Generates missing thumbnails and imports them into the cover atlas on a low-priority task, so the home screen
+  // shows up immediately and covers appear as they become ready.
+  static void coverTaskTrampoline(void* param);
+  void importRecentCovers(int coverHeight);
 
  public:
   explicit HomeActivity(GfxRenderer& renderer, MappedInputManager& mappedInput,
@@ -58,4 +60,6 @@ class HomeActivity final : public Activity {
   void onExit() override;
   void loop() override;
   void render(Activity::RenderLock&&) override;
+  // Keeps the background cover queue off the SD card while covers are being imported
+  bool preventAutoSleep() override { return coverTaskHandle != nullptr; }
 };
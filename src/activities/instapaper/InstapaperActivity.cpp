@@ -7,8 +7,11 @@
 #include <WiFi.h>
 
 #include <algorithm>
+#include <cstring>
 
+#include "CoverJobQueue.h"
 #include "InstapaperCredentialStore.h"
+#include "LibraryCatalog.h"
 #include "MappedInputManager.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
@@ -46,6 +49,89 @@ std::string languageFromUrl(const std::string& url) {
   return "en";
 }
 
+constexpr int LIST_LIMIT = 25;
+
+// Bookmark cache line: bookmarkId|title|url|time|hash|progress|progressTimestamp (older caches stop after time)
+std::vector<std::string> splitCacheLine(const std::string& line) {
+  std::vector<std::string> fields;
+  size_t start = 0;
+  while (true) {
+    size_t sep = line.find('|', start);
+    if (sep == std::string::npos) {
+      fields.push_back(line.substr(start));
+      break;
+    }
+    fields.push_back(line.substr(start, sep - start));
+    start = sep + 1;
+  }
+  return fields;
+}
+
+// Receives an article's HTML as it is downloaded and writes it to the card as Markdown straight away: each network
+// chunk is converted and appended before the next one is read, so neither the HTML nor the Markdown is ever held
+// whole. Output goes through one bounded write buffer.
+class ArticleWriter final : public Stream {
+ public:
+  ArticleWriter(FsFile& file, DownloadStats& stats)
+      : file(file), stats(stats), converter([this](const char* data, size_t length) { append(data, length); }) {}
+
+  int available() override { return 0; }
+  int peek() override { return -1; }
+  int read() override { return -1; }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* data, size_t size) override {
+    converter.feed(reinterpret_cast<const char*>(data), size);
+    htmlBytes += size;
+    stats.minFreeHeap = std::min<uint32_t>(stats.minFreeHeap, ESP.getFreeHeap());
+    return ok ? size : 0;
+  }
+
+  // Drops everything received so far, for a retry; the caller reopens the file
+  void restart() {
+    converter = HtmlToMarkdown::Converter([this](const char* data, size_t length) { append(data, length); });
+    length = 0;
+    htmlBytes = 0;
+    ok = true;
+  }
+
+  // Ends the Markdown and writes out what is still buffered
+  bool finish() {
+    converter.finish();
+    flush();
+    stats.htmlBytes += htmlBytes;
+    stats.markdownBytes += converter.getOutputBytes();
+    return ok;
+  }
+
+  void flush() override {
+    if (length > 0 && file.write(buffer, length) != length) {
+      ok = false;
+    }
+    length = 0;
+  }
+
+ private:
+  FsFile& file;
+  DownloadStats& stats;
+  HtmlToMarkdown::Converter converter;
+  uint8_t buffer[1024];
+  size_t length = 0;
+  size_t htmlBytes = 0;
+  bool ok = true;
+
+  void append(const char* data, size_t size) {
+    while (size > 0) {
+      const size_t chunk = std::min(size, sizeof(buffer) - length);
+      memcpy(buffer + length, data, chunk);
+      length += chunk;
+      data += chunk;
+      size -= chunk;
+      if (length == sizeof(buffer)) flush();
+    }
+  }
+};
+
 }  // namespace
 
 void InstapaperActivity::taskTrampoline(void* param) {
@@ -162,40 +248,25 @@ void InstapaperActivity::loadBookmarkCache() {
 
     for (int i = 0; i < bytesRead; i++) {
       if (buf[i] == '\n') {
-        // Parse line: bookmarkId|title|url|time
-        size_t sep = line.find('|');
-        if (sep != std::string::npos) {
-          std::string bmId = line.substr(0, sep);
-          std::string rest = line.substr(sep + 1);
-          std::string title, bmUrl;
-          long bmTime = 0;
-          size_t sep2 = rest.find('|');
-          if (sep2 != std::string::npos) {
-            title = rest.substr(0, sep2);
-            std::string rest2 = rest.substr(sep2 + 1);
-            size_t sep3 = rest2.find('|');
-            if (sep3 != std::string::npos) {
-              bmUrl = rest2.substr(0, sep3);
-              bmTime = atol(rest2.substr(sep3 + 1).c_str());
-            } else {
-              bmUrl = rest2;
-            }
-          } else {
-            title = rest;
-          }
+        const auto fields = splitCacheLine(line);
+        if (fields.size() >= 2) {
+          const std::string& bmId = fields[0];
+          const std::string& title = fields[1];
+          std::string bmUrl = fields.size() > 2 ? fields[2] : "";
+          long bmTime = fields.size() > 3 ? atol(fields[3].c_str()) : 0;
 
           // Check if already in list (from SD scan)
-          bool found = false;
+          DisplayBookmark* entry = nullptr;
           for (auto& existing : displayList) {
             if (existing.title == title) {
               existing.bookmarkId = bmId;
               if (!bmUrl.empty()) existing.url = bmUrl;
               if (bmTime > 0) existing.time = bmTime;
-              found = true;
+              entry = &existing;
               break;
             }
           }
-          if (!found) {
+          if (!entry) {
             DisplayBookmark bm;
             bm.bookmarkId = bmId;
             bm.title = title;
@@ -203,6 +274,12 @@ void InstapaperActivity::loadBookmarkCache() {
             bm.time = bmTime;
             bm.downloaded = false;
             displayList.push_back(std::move(bm));
+            entry = &displayList.back();
+          }
+          if (fields.size() >= 7) {
+            entry->hash = fields[4];
+            entry->progress = atof(fields[5].c_str());
+            entry->progressTimestamp = atol(fields[6].c_str());
           }
         }
         line.clear();
@@ -225,7 +302,10 @@ void InstapaperActivity::saveBookmarkCache() {
 
   for (const auto& bm : displayList) {
     if (bm.bookmarkId.empty()) continue;
-    std::string line = bm.bookmarkId + "|" + bm.title + "|" + bm.url + "|" + std::to_string(bm.time) + "\n";
+    char progress[48];
+    snprintf(progress, sizeof(progress), "|%.4f|%ld", bm.progress, bm.progressTimestamp);
+    std::string line = bm.bookmarkId + "|" + bm.title + "|" + bm.url + "|" + std::to_string(bm.time) + "|" + bm.hash +
+                       progress + "\n";
     file.write(reinterpret_cast<const uint8_t*>(line.data()), line.size());
   }
   file.close();
@@ -301,11 +381,26 @@ void InstapaperActivity::backgroundSyncWork() {
     }
   }
 
-  // Fetch bookmarks from API
+  // Fetch bookmarks from API. Only new and changed bookmarks come back; the ones we hold are sent as id:hash pairs.
   syncStatus = "Fetching...";
   updateRequired = true;
+  std::vector<InstapaperBookmark> known;
+  xSemaphoreTake(renderingMutex, portMAX_DELAY);
+  for (const auto& bm : displayList) {
+    if (bm.bookmarkId.empty() || bm.hash.empty()) continue;
+    InstapaperBookmark entry;
+    entry.bookmarkId = bm.bookmarkId;
+    entry.hash = bm.hash;
+    entry.progress = bm.progress;
+    entry.progressTimestamp = bm.progressTimestamp;
+    known.push_back(std::move(entry));
+  }
+  xSemaphoreGive(renderingMutex);
+
+  const unsigned long fetchStart = millis();
   std::vector<InstapaperBookmark> apiBookmarks;
-  if (!InstapaperClient::listBookmarks(25, apiBookmarks)) {
+  std::vector<std::string> deletedIds;
+  if (!InstapaperClient::listBookmarks(LIST_LIMIT, known, apiBookmarks, deletedIds)) {
     syncStatus = "Fetch failed";
     syncComplete = true;
     updateRequired = true;
@@ -315,29 +410,52 @@ void InstapaperActivity::backgroundSyncWork() {
   // Merge API results into displayList
   xSemaphoreTake(renderingMutex, portMAX_DELAY);
 
+  int added = 0;
   for (const auto& apiBm : apiBookmarks) {
-    // Check if we already have this article (match by sanitized filename)
+    // Check if we already have this article (by bookmark id, else by sanitized filename)
     std::string sanitizedTitle = StringUtils::sanitizeFilename(apiBm.title);
-    bool found = false;
+    DisplayBookmark* entry = nullptr;
     for (auto& existing : displayList) {
-      if (existing.title == sanitizedTitle) {
-        // Update bookmarkId, URL, and time so we can download/delete via API
-        existing.bookmarkId = apiBm.bookmarkId;
-        existing.url = apiBm.url;
-        existing.time = apiBm.time;
-        found = true;
+      if (!existing.bookmarkId.empty() && existing.bookmarkId == apiBm.bookmarkId) {
+        entry = &existing;
         break;
       }
     }
-    if (!found) {
+    for (auto it = displayList.begin(); !entry && it != displayList.end(); ++it) {
+      if (it->title == sanitizedTitle) entry = &*it;
+    }
+    if (!entry) {
       DisplayBookmark bm;
       bm.title = sanitizedTitle;
-      bm.bookmarkId = apiBm.bookmarkId;
-      bm.url = apiBm.url;
-      bm.time = apiBm.time;
       bm.downloaded = false;
       displayList.push_back(std::move(bm));
+      entry = &displayList.back();
+      added++;
     }
+    // Update bookmarkId, URL, and time so we can download/delete via API
+    entry->bookmarkId = apiBm.bookmarkId;
+    entry->url = apiBm.url;
+    entry->time = apiBm.time;
+    entry->hash = apiBm.hash;
+    entry->progress = apiBm.progress;
+    entry->progressTimestamp = apiBm.progressTimestamp;
+  }
+
+  // Archived or deleted on the server: downloaded copies stay as local files, the rest leave the list
+  for (const auto& id : deletedIds) {
+    for (auto it = displayList.begin(); it != displayList.end(); ++it) {
+      if (it->bookmarkId != id) continue;
+      if (it->downloaded) {
+        it->bookmarkId.clear();
+        it->hash.clear();
+      } else {
+        displayList.erase(it);
+      }
+      break;
+    }
+  }
+  if (selectorIndex >= static_cast<int>(displayList.size())) {
+    selectorIndex = std::max(0, static_cast<int>(displayList.size()) - 1);
   }
 
   // Sort by time descending (newest first, time=0 at the end)
@@ -354,7 +472,9 @@ void InstapaperActivity::backgroundSyncWork() {
   saveBookmarkCache();
   xSemaphoreGive(renderingMutex);
 
-  LOG_DBG("INS", "Background sync complete, %d items in list", displayList.size());
+  LOG_INF("INS", "Sync took %lu ms: %d known hashes sent, %d changed or new (%d added), %d removed, %d items",
+          millis() - fetchStart, static_cast<int>(known.size()), static_cast<int>(apiBookmarks.size()), added,
+          static_cast<int>(deletedIds.size()), static_cast<int>(displayList.size()));
 }
 
 void InstapaperActivity::loop() {
@@ -544,7 +664,10 @@ void InstapaperActivity::openArticle(int index) {
     }
   }
 
+  downloadStats = DownloadStats{};
+  downloadStats.startMs = millis();
   downloadSingleArticle(bm);
+  logDownloadStats();
 
   downloadCurrent = 1;
   state = State::BROWSING;
@@ -565,6 +688,7 @@ void InstapaperActivity::deleteArticle(int index) {
 
   std::string path = getArticlePath(bm);
   Storage.remove(path.c_str());
+  LIBRARY_CATALOG.invalidatePath(path);
   LOG_DBG("INS", "Deleted: %s", path.c_str());
 
   if (bm.bookmarkId.empty()) {
@@ -631,6 +755,8 @@ void InstapaperActivity::downloadNewest() {
     }
   }
 
+  downloadStats = DownloadStats{};
+  downloadStats.startMs = millis();
   for (int idx : toDownload) {
     auto& bm = displayList[idx];
     statusMessage = bm.title;
@@ -641,38 +767,52 @@ void InstapaperActivity::downloadNewest() {
     downloadCurrent++;
     updateRequired = true;
   }
+  logDownloadStats();
 
   state = State::BROWSING;
   updateRequired = true;
 }
 
 void InstapaperActivity::downloadSingleArticle(DisplayBookmark& bm) {
-  std::string html;
-  if (!InstapaperClient::getArticleText(bm.bookmarkId, html)) {
-    LOG_ERR("INS", "Failed to get text for: %s", bm.title.c_str());
-    return;
-  }
-
-  std::string markdown = HtmlToMarkdown::convert(html);
-  markdown = "# " + bm.title + "\n\n" + markdown;
-
   const auto& folder = INSTAPAPER_STORE.getDownloadFolder();
   Storage.mkdir(folder.c_str());
 
   std::string path = getArticlePath(bm);
+  // Written next to the article so a failed download leaves an earlier copy intact
+  const std::string tmpPath = path + ".tmp";
+  const std::string heading = "# " + bm.title + "\n\n";
+
+  FsFile file;
+  ArticleWriter writer(file, downloadStats);
+  bool opened = true;
+  bool ok = InstapaperClient::getArticleText(bm.bookmarkId, writer, [&]() {
+    file.close();
+    writer.restart();
+    opened = Storage.openFileForWrite("INS", tmpPath, file);
+    if (opened) file.write(reinterpret_cast<const uint8_t*>(heading.data()), heading.size());
+  });
+  ok = ok && opened && writer.finish();
+  file.close();
+  if (!ok) {
+    LOG_ERR("INS", "Failed to get text for: %s", bm.title.c_str());
+    Storage.remove(tmpPath.c_str());
+    return;
+  }
 
   if (Storage.exists(path.c_str())) {
     Storage.remove(path.c_str());
   }
-
-  FsFile file;
-  if (!Storage.openFileForWrite("INS", path.c_str(), file)) {
+  FsFile renamed = Storage.open(tmpPath.c_str(), O_RDWR);
+  if (!renamed || !renamed.rename(path.c_str())) {
     LOG_ERR("INS", "Failed to write: %s", path.c_str());
+    if (renamed) renamed.close();
+    Storage.remove(tmpPath.c_str());
     return;
   }
-
-  file.write(reinterpret_cast<const uint8_t*>(markdown.data()), markdown.size());
-  file.close();
+  renamed.close();
+  LIBRARY_CATALOG.invalidatePath(path);
+  COVER_JOBS.enqueue(path);
+  downloadStats.articles++;
 
   bm.downloaded = true;
   // Store filename so we can find the file later
@@ -681,6 +821,15 @@ void InstapaperActivity::downloadSingleArticle(DisplayBookmark& bm) {
   LOG_DBG("INS", "Saved article: %s", path.c_str());
 }
 
+void InstapaperActivity::logDownloadStats() const {
+  const unsigned long elapsedMs = std::max(1UL, millis() - downloadStats.startMs);
+  const uint32_t minFreeHeap = downloadStats.minFreeHeap == UINT32_MAX ? ESP.getFreeHeap() : downloadStats.minFreeHeap;
+  LOG_INF("INS", "Downloaded %d articles in %lu ms (%.1f/min), %u KB HTML -> %u KB Markdown, lowest free heap %u",
+          downloadStats.articles, elapsedMs, downloadStats.articles * 60000.0f / elapsedMs,
+          static_cast<unsigned>(downloadStats.htmlBytes / 1024),
+          static_cast<unsigned>(downloadStats.markdownBytes / 1024), static_cast<unsigned>(minFreeHeap));
+}
+
 std::string InstapaperActivity::getArticlePath(const DisplayBookmark& bm) const {
   const auto& folder = INSTAPAPER_STORE.getDownloadFolder();
   // Use stored filename if available (loaded from SD)
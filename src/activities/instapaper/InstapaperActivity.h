@@ -4,6 +4,7 @@
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <vector>
@@ -18,6 +19,18 @@ struct DisplayBookmark {
   std::string filename;     // Actual filename on SD (e.g., "Title.de.md")
   long time = 0;            // Unix timestamp when added (for sorting)
   bool downloaded;          // File exists on SD
+  std::string hash;         // Instapaper's bookmark hash as last synced, empty if never synced
+  float progress = 0;       // Reading progress as last synced
+  long progressTimestamp = 0;
+};
+
+// Throughput of one batch of article downloads, logged when the batch ends
+struct DownloadStats {
+  int articles = 0;
+  size_t htmlBytes = 0;
+  size_t markdownBytes = 0;
+  unsigned long startMs = 0;
+  uint32_t minFreeHeap = UINT32_MAX;
 };
 
 class InstapaperActivity final : public ActivityWithSubactivity {
@@ -51,6 +64,7 @@ class InstapaperActivity final : public ActivityWithSubactivity {
   std::string statusMessage;
   int downloadCurrent = 0;
   int downloadTotal = 0;
+  DownloadStats downloadStats;
 
   bool syncing = false;
   bool syncComplete = false;
@@ -74,6 +88,7 @@ class InstapaperActivity final : public ActivityWithSubactivity {
   void deleteArticle(int index);
   void downloadNewest();
   void downloadSingleArticle(DisplayBookmark& bm);
+  void logDownloadStats() const;
   std::string getArticlePath(const DisplayBookmark& bm) const;
   bool preventAutoSleep() override { return syncing || state == State::DOWNLOADING; }
 };
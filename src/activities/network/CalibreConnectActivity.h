@@ -44,4 +44,6 @@ class CalibreConnectActivity final : public ActivityWithSubactivity {
   void render(Activity::RenderLock&&) override;
   bool skipLoopDelay() override { return webServer && webServer->isRunning(); }
   bool preventAutoSleep() override { return webServer && webServer->isRunning(); }
+  bool allowsBackgroundJobs() override { return !webServer || webServer->isTransferIdle(); }
+  bool allowsBackgroundJobsOnBattery() override { return webServer && webServer->isRunning(); }
 };
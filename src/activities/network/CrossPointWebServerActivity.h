@@ -63,4 +63,10 @@ class CrossPointWebServerActivity final : public ActivityWithSubactivity {
   void render(Activity::RenderLock&&) override;
   bool skipLoopDelay() override { return webServer && webServer->isRunning(); }
   bool preventAutoSleep() override { return webServer && webServer->isRunning(); }
+  bool allowsBackgroundJobs() override {
+    return (!webServer || webServer->isTransferIdle()) && (!subActivity || subActivity->allowsBackgroundJobs());
+  }
+  bool allowsBackgroundJobsOnBattery() override {
+    return (webServer && webServer->isRunning()) || ActivityWithSubactivity::allowsBackgroundJobsOnBattery();
+  }
 };
@@ -3,18 +3,22 @@
 #include <Epub/Page.h>
 #include <FsHelpers.h>
 #include <GfxRenderer.h>
-#include <HalStorage.h>
 #include <I18n.h>
 #include <Logging.h>
 
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "EpubReaderChapterSelectionActivity.h"
+#include "EpubReaderIndexActivity.h"
+#include "EpubReaderLookupActivity.h"
 #include "EpubReaderPercentSelectionActivity.h"
+#include "EpubReaderSearchActivity.h"
 #include "KOReaderCredentialStore.h"
 #include "KOReaderSyncActivity.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
+#include "StateStore.h"
+#include "activities/RenderStats.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 
@@ -71,10 +75,11 @@ void EpubReaderActivity::onEnter() {
 
   epub->setupCacheDir();
 
-  FsFile f;
-  if (Storage.openFileForRead("ERS", epub->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[6];
-    int dataSize = f.read(data, 6);
+  std::string progress;
+  if (STATE_STORE.get(StateStore::progressKey(epub->getCachePath()), progress,
+                      epub->getCachePath() + "/progress.bin")) {
+    const auto* data = reinterpret_cast<const uint8_t*>(progress.data());
+    const size_t dataSize = progress.size();
     if (dataSize == 4 || dataSize == 6) {
       currentSpineIndex = data[0] + (data[1] << 8);
       nextPageNumber = data[2] + (data[3] << 8);
@@ -84,7 +89,6 @@ void EpubReaderActivity::onEnter() {
     if (dataSize == 6) {
       cachedChapterTotalPageCount = data[4] + (data[5] << 8);
     }
-    f.close();
   }
   // We may want a better condition to detect if we are opening for the first time.
   // This will trigger if the book is re-opened at Chapter 0.
@@ -357,10 +361,11 @@ void EpubReaderActivity::onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction
             exitActivity();
             requestUpdate();
           },
-          [this](const int newSpineIndex) {
-            if (currentSpineIndex != newSpineIndex) {
+          [this](const int newSpineIndex, const std::string& anchor) {
+            if (currentSpineIndex != newSpineIndex || !anchor.empty()) {
               currentSpineIndex = newSpineIndex;
               nextPageNumber = 0;
+              pendingAnchor = anchor;
               section.reset();
             }
             exitActivity();
@@ -378,6 +383,59 @@ void EpubReaderActivity::onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction
 
       break;
     }
+    case EpubReaderMenuActivity::MenuAction::SEARCH: {
+      exitActivity();
+      enterNewActivity(new EpubReaderSearchActivity(
+          renderer, mappedInput, epub, viewportWidth, viewportHeight, lastSearchQuery,
+          [this](const std::string& query) {
+            lastSearchQuery = query;
+            exitActivity();
+            requestUpdate();
+          },
+          [this](const std::string& query, const EpubReaderSearchActivity::Hit& hit) {
+            lastSearchQuery = query;
+            currentSpineIndex = hit.spineIndex;
+            nextPageNumber = hit.page >= 0 ? hit.page : 0;
+            if (hit.page < 0) {
+              // The chapter isn't paginated yet; land on the matching position once it is
+              pendingSpineProgress = hit.progress;
+              pendingPercentJump = true;
+            }
+            section.reset();
+            exitActivity();
+            requestUpdate();
+          }));
+      break;
+    }
+    case EpubReaderMenuActivity::MenuAction::BUILD_SEARCH_INDEX: {
+      exitActivity();
+      enterNewActivity(new EpubReaderIndexActivity(renderer, mappedInput, epub, viewportWidth, viewportHeight, [this] {
+        exitActivity();
+        requestUpdate();
+      }));
+      break;
+    }
+    case EpubReaderMenuActivity::MenuAction::LOOKUP_WORD: {
+      std::unique_ptr<Page> page;
+      {
+        RenderLock lock(*this);
+        if (section) {
+          page = section->loadPageFromSectionFile();
+        }
+      }
+      exitActivity();
+      if (!page) {
+        requestUpdate();
+        break;
+      }
+      enterNewActivity(new EpubReaderLookupActivity(renderer, mappedInput, std::move(page),
+                                                    SETTINGS.getReaderFontId(), contentMarginLeft, contentMarginTop,
+                                                    [this] {
+                                                      exitActivity();
+                                                      requestUpdate();
+                                                    }));
+      break;
+    }
     case EpubReaderMenuActivity::MenuAction::GO_TO_PERCENT: {
       // Launch the slider-based percent selector and return here on confirm/cancel.
       float bookProgress = 0.0f;
@@ -435,18 +493,22 @@ void EpubReaderActivity::onReaderMenuConfirm(EpubReaderMenuActivity::MenuAction
       if (KOREADER_STORE.hasCredentials()) {
         const int currentPage = section ? section->currentPage : 0;
         const int totalPages = section ? section->pageCount : 0;
+        std::string elementPath = section ? section->getElementPathForPage(currentPage) : "";
         exitActivity();
         enterNewActivity(new KOReaderSyncActivity(
             renderer, mappedInput, epub, epub->getPath(), currentSpineIndex, currentPage, totalPages,
+            std::move(elementPath),
             [this]() {
               // On cancel - defer exit to avoid use-after-free
               pendingSubactivityExit = true;
             },
-            [this](int newSpineIndex, int newPage) {
+            [this](int newSpineIndex, int newPage, const std::string& elementPath) {
               // On sync complete - update position and defer exit
-              if (currentSpineIndex != newSpineIndex || (section && section->currentPage != newPage)) {
+              if (currentSpineIndex != newSpineIndex || (section && section->currentPage != newPage) ||
+                  !elementPath.empty()) {
                 currentSpineIndex = newSpineIndex;
                 nextPageNumber = newPage;
+                pendingElementPath = elementPath;
                 section.reset();
               }
               pendingSubactivityExit = true;
@@ -533,8 +595,14 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
     LOG_DBG("ERS", "Loading file: %s, index: %d", filepath.c_str(), currentSpineIndex);
     section = std::unique_ptr<Section>(new Section(epub, currentSpineIndex, renderer));
 
-    const uint16_t viewportWidth = renderer.getScreenWidth() - orientedMarginLeft - orientedMarginRight;
-    const uint16_t viewportHeight = renderer.getScreenHeight() - orientedMarginTop - orientedMarginBottom;
+    viewportWidth = renderer.getScreenWidth() - orientedMarginLeft - orientedMarginRight;
+    viewportHeight = renderer.getScreenHeight() - orientedMarginTop - orientedMarginBottom;
+    // Lets the background pre-indexing paginate newly added books for this layout
+    if (APP_STATE.readerViewportWidth != viewportWidth || APP_STATE.readerViewportHeight != viewportHeight) {
+      APP_STATE.readerViewportWidth = viewportWidth;
+      APP_STATE.readerViewportHeight = viewportHeight;
+      APP_STATE.saveToFile();
+    }
 
     if (!section->loadSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
                                   SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
@@ -542,10 +610,20 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
       LOG_DBG("ERS", "Cache not found, building...");
 
       const auto popupFn = [this]() { GUI.drawPopup(renderer, tr(STR_INDEXING)); };
+      // A jump into the middle of the chapter shows an approximate page while the chapter is paginated
+      std::function<void(std::unique_ptr<Page>)> previewFn = nullptr;
+      if (pendingPercentJump) {
+        previewFn = [this, orientedMarginTop, orientedMarginLeft](std::unique_ptr<Page> page) {
+          renderer.clearScreen();
+          page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
+          renderer.displayBuffer();
+        };
+      }
 
       if (!section->createSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
                                       SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
-                                      viewportHeight, SETTINGS.hyphenationEnabled, SETTINGS.embeddedStyle, popupFn)) {
+                                      viewportHeight, SETTINGS.hyphenationEnabled, SETTINGS.embeddedStyle, popupFn,
+                                      pendingSpineProgress, previewFn)) {
         LOG_ERR("ERS", "Failed to persist page data to SD");
         section.reset();
         return;
@@ -572,14 +650,28 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
     }
 
     if (pendingPercentJump && section->pageCount > 0) {
-      // Apply the pending percent jump now that we know the new section's page count.
-      int newPage = static_cast<int>(pendingSpineProgress * static_cast<float>(section->pageCount));
+      // Apply the pending percent jump now that the section's pages are known. The progress is a byte position in
+      // the chapter, so locate it through the page offset map; counting pages is only a fallback.
+      int newPage = section->findPageForProgress(pendingSpineProgress);
+      if (newPage < 0) {
+        newPage = static_cast<int>(pendingSpineProgress * static_cast<float>(section->pageCount));
+      }
       if (newPage >= section->pageCount) {
         newPage = section->pageCount - 1;
       }
       section->currentPage = newPage;
       pendingPercentJump = false;
     }
+
+    if (!pendingAnchor.empty() || !pendingElementPath.empty()) {
+      const int newPage = pendingAnchor.empty() ? section->findPageForElementPath(pendingElementPath)
+                                                : section->findPageForAnchor(pendingAnchor);
+      if (newPage >= 0) {
+        section->currentPage = newPage;
+      }
+      pendingAnchor.clear();
+      pendingElementPath.clear();
+    }
   }
 
   renderer.clearScreen();
@@ -610,6 +702,12 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
       // TODO: prevent infinite loop if the page keeps failing to load for some reason
       return;
     }
+    RENDER_STATS.onPageLoaded();
+    if (renderSuperseded()) {
+      return;
+    }
+    contentMarginLeft = orientedMarginLeft;
+    contentMarginTop = orientedMarginTop;
     const auto start = millis();
     renderContents(std::move(p), orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
     LOG_DBG("ERS", "Rendered page in %dms", millis() - start);
@@ -618,17 +716,14 @@ void EpubReaderActivity::render(Activity::RenderLock&& lock) {
 }
 
 void EpubReaderActivity::saveProgress(int spineIndex, int currentPage, int pageCount) {
-  FsFile f;
-  if (Storage.openFileForWrite("ERS", epub->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[6];
-    data[0] = currentSpineIndex & 0xFF;
-    data[1] = (currentSpineIndex >> 8) & 0xFF;
-    data[2] = currentPage & 0xFF;
-    data[3] = (currentPage >> 8) & 0xFF;
-    data[4] = pageCount & 0xFF;
-    data[5] = (pageCount >> 8) & 0xFF;
-    f.write(data, 6);
-    f.close();
+  uint8_t data[6];
+  data[0] = currentSpineIndex & 0xFF;
+  data[1] = (currentSpineIndex >> 8) & 0xFF;
+  data[2] = currentPage & 0xFF;
+  data[3] = (currentPage >> 8) & 0xFF;
+  data[4] = pageCount & 0xFF;
+  data[5] = (pageCount >> 8) & 0xFF;
+  if (STATE_STORE.put(StateStore::progressKey(epub->getCachePath()), data, sizeof(data))) {
     LOG_DBG("ERS", "Progress saved: Chapter %d, Page %d", spineIndex, currentPage);
   } else {
     LOG_ERR("ERS", "Could not save progress!");
@@ -641,7 +736,12 @@ void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int or
   // as grayscale tones require half refresh to display correctly
   bool forceFullRefresh = page->hasImages() && SETTINGS.textAntiAliasing;
 
-  page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
+  // Page turns that came in meanwhile are shown instead
+  if (!page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop,
+                    [this] { return renderSuperseded(); }) ||
+      renderSuperseded()) {
+    return;
+  }
   renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
   if (forceFullRefresh || pagesUntilFullRefresh <= 1) {
     renderer.displayBuffer(HalDisplay::HALF_REFRESH);
@@ -656,7 +756,7 @@ void EpubReaderActivity::renderContents(std::unique_ptr<Page> page, const int or
 
   // grayscale rendering
   // TODO: Only do this if font supports it
-  if (SETTINGS.textAntiAliasing) {
+  if (SETTINGS.textAntiAliasing && !renderSuperseded()) {
     renderer.clearScreen(0x00);
     renderer.setRenderMode(GfxRenderer::GRAYSCALE_LSB);
     page->render(renderer, SETTINGS.getReaderFontId(), orientedMarginLeft, orientedMarginTop);
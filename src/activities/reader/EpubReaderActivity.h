@@ -18,6 +18,17 @@ class EpubReaderActivity final : public ActivityWithSubactivity {
   bool pendingPercentJump = false;
   // Normalized 0.0-1.0 progress within the target spine item, computed from book percentage.
   float pendingSpineProgress = 0.0f;
+  // Position within the next loaded section that its element index can resolve exactly: a TOC entry's anchor or an
+  // element path from KOReader sync. Cleared once applied; nextPageNumber stays in effect if it doesn't resolve.
+  std::string pendingAnchor;
+  std::string pendingElementPath;
+  // Layout of the last loaded section, so search can tell which section caches are current
+  uint16_t viewportWidth = 0;
+  uint16_t viewportHeight = 0;
+  // Where the last page was drawn, so word lookup can redraw it in place
+  int contentMarginLeft = 0;
+  int contentMarginTop = 0;
+  std::string lastSearchQuery;
   bool pendingSubactivityExit = false;  // Defer subactivity exit to avoid use-after-free
   bool pendingGoHome = false;           // Defer go home to avoid race condition with display task
   bool skipNextButtonCheck = false;     // Skip button processing for one frame after subactivity exit
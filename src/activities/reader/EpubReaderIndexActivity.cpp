@@ -0,0 +1,154 @@
+#include "EpubReaderIndexActivity.h"
+
+#include <Epub/Section.h>
+#include <GfxRenderer.h>
+#include <I18n.h>
+
+#include "CrossPointSettings.h"
+#include "MappedInputManager.h"
+#include "components/UITheme.h"
+#include "fontIds.h"
+
+namespace {
+// Redraw at most this often while building; chapters that are already paginated go by quickly
+constexpr unsigned long PROGRESS_UPDATE_MS = 1500;
+}  // namespace
+
+SearchIndex::Layout EpubReaderIndexActivity::getCurrentLayout(const uint16_t viewportWidth,
+                                                              const uint16_t viewportHeight) {
+  SearchIndex::Layout layout;
+  layout.fontId = SETTINGS.getReaderFontId();
+  layout.lineCompression = SETTINGS.getReaderLineCompression();
+  layout.extraParagraphSpacing = SETTINGS.extraParagraphSpacing;
+  layout.paragraphAlignment = SETTINGS.paragraphAlignment;
+  layout.viewportWidth = viewportWidth;
+  layout.viewportHeight = viewportHeight;
+  layout.hyphenationEnabled = SETTINGS.hyphenationEnabled;
+  layout.embeddedStyle = SETTINGS.embeddedStyle;
+  return layout;
+}
+
+void EpubReaderIndexActivity::onEnter() {
+  Activity::onEnter();
+  cancelRequested = false;
+  lastProgressUpdate = millis();
+  xTaskCreate(&EpubReaderIndexActivity::buildTaskTrampoline, "SearchIndex", 8192, this, tskIDLE_PRIORITY,
+              &buildTaskHandle);
+  requestUpdate();
+}
+
+void EpubReaderIndexActivity::onExit() {
+  stopBuild();
+  Activity::onExit();
+}
+
+void EpubReaderIndexActivity::stopBuild() {
+  cancelRequested = true;
+  // The task checks the flag between pages; let it remove its temporary files rather than deleting it mid-write
+  while (buildTaskHandle) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+void EpubReaderIndexActivity::buildTaskTrampoline(void* param) {
+  auto* self = static_cast<EpubReaderIndexActivity*>(param);
+  const bool built = self->buildIndex();
+  {
+    RenderLock lock(*self);
+    self->state = built ? State::DONE : State::FAILED;
+    self->buildTaskHandle = nullptr;
+  }
+  self->requestUpdate();
+  vTaskDelete(nullptr);
+}
+
+bool EpubReaderIndexActivity::buildIndex() {
+  if (viewportWidth == 0 || viewportHeight == 0) {
+    return false;
+  }
+
+  const unsigned long start = millis();
+  const SearchIndex::Layout layout = getCurrentLayout(viewportWidth, viewportHeight);
+  const int spineCount = epub->getSpineItemsCount();
+  std::unique_ptr<SearchIndexBuilder> builder(
+      new SearchIndexBuilder(getIndexPath(*epub), layout, static_cast<uint16_t>(spineCount)));
+
+  bool writable = true;
+  for (int i = 0; i < spineCount && writable && !cancelRequested; i++) {
+    Section section(epub, i, renderer);
+    if (!section.loadSectionFile(layout.fontId, layout.lineCompression, layout.extraParagraphSpacing,
+                                 layout.paragraphAlignment, layout.viewportWidth, layout.viewportHeight,
+                                 layout.hyphenationEnabled, layout.embeddedStyle) &&
+        !section.createSectionFile(layout.fontId, layout.lineCompression, layout.extraParagraphSpacing,
+                                   layout.paragraphAlignment, layout.viewportWidth, layout.viewportHeight,
+                                   layout.hyphenationEnabled, layout.embeddedStyle)) {
+      LOG_ERR("SRC", "Chapter %d could not be paginated, leaving it out of the index", i);
+    } else {
+      section.visitPageText(
+          [&builder](const std::string& word, const bool lastInLine) { builder->addWord(word, lastInLine); },
+          [&](int) {
+            writable = builder->endPage();
+            return writable && !cancelRequested;
+          });
+    }
+    builder->endChapter();
+
+    {
+      RenderLock lock(*this);
+      chaptersIndexed = i + 1;
+    }
+    if (millis() - lastProgressUpdate >= PROGRESS_UPDATE_MS) {
+      lastProgressUpdate = millis();
+      requestUpdate();
+    }
+  }
+  if (!writable || cancelRequested) {
+    return false;
+  }
+
+  SearchIndexBuilder::Stats builtStats;
+  if (!builder->finish(builtStats)) {
+    return false;
+  }
+  const unsigned long elapsed = millis() - start;
+  LOG_INF("SRC", "Search index built in %lu ms: %u terms, %u postings over %u pages, %u bytes", elapsed,
+          static_cast<unsigned>(builtStats.terms), static_cast<unsigned>(builtStats.postings),
+          static_cast<unsigned>(builtStats.pages), static_cast<unsigned>(builtStats.bytes));
+  {
+    RenderLock lock(*this);
+    stats = builtStats;
+    buildMillis = elapsed;
+  }
+  return true;
+}
+
+void EpubReaderIndexActivity::loop() {
+  if (mappedInput.wasReleased(MappedInputManager::Button::Back) ||
+      (buildTaskHandle == nullptr && mappedInput.wasReleased(MappedInputManager::Button::Confirm))) {
+    stopBuild();
+    onGoBack();
+  }
+}
+
+void EpubReaderIndexActivity::render(Activity::RenderLock&&) {
+  renderer.clearScreen();
+  renderer.drawCenteredText(UI_12_FONT_ID, 15, tr(STR_BUILD_SEARCH_INDEX), true, EpdFontFamily::BOLD);
+
+  char status[64];
+  if (state == State::BUILDING) {
+    snprintf(status, sizeof(status), tr(STR_SEARCH_INDEX_PROGRESS_FORMAT), chaptersIndexed,
+             epub->getSpineItemsCount());
+    renderer.drawCenteredText(UI_10_FONT_ID, 300, status, true, EpdFontFamily::BOLD);
+  } else if (state == State::DONE) {
+    snprintf(status, sizeof(status), tr(STR_SEARCH_INDEX_DONE_FORMAT), static_cast<unsigned>(stats.terms),
+             static_cast<unsigned>((stats.bytes + 1023) / 1024), static_cast<unsigned>((buildMillis + 500) / 1000));
+    renderer.drawCenteredText(UI_10_FONT_ID, 280, tr(STR_DONE), true, EpdFontFamily::BOLD);
+    renderer.drawCenteredText(UI_10_FONT_ID, 320, status);
+  } else {
+    renderer.drawCenteredText(UI_10_FONT_ID, 300, tr(STR_SEARCH_INDEX_FAILED), true, EpdFontFamily::BOLD);
+  }
+
+  const auto labels = mappedInput.mapLabels(tr(STR_BACK), state == State::BUILDING ? "" : tr(STR_DONE), "", "");
+  GUI.drawButtonHints(renderer, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
+  renderer.displayBuffer();
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <Epub.h>
+#include <Epub/search/SearchIndex.h>
+
+#include <functional>
+#include <memory>
+
+#include "../Activity.h"
+
+// Builds the book's search index in the background, paginating any chapters that have no section cache yet on the
+// way, and reports the index size and build time when done. Leaving the screen cancels the build.
+class EpubReaderIndexActivity final : public Activity {
+ public:
+  explicit EpubReaderIndexActivity(GfxRenderer& renderer, MappedInputManager& mappedInput,
+                                   const std::shared_ptr<Epub>& epub, const uint16_t viewportWidth,
+                                   const uint16_t viewportHeight, const std::function<void()>& onGoBack)
+      : Activity("EpubReaderIndex", renderer, mappedInput),
+        epub(epub),
+        viewportWidth(viewportWidth),
+        viewportHeight(viewportHeight),
+        onGoBack(onGoBack) {}
+  void onEnter() override;
+  void onExit() override;
+  void loop() override;
+  void render(Activity::RenderLock&&) override;
+  bool preventAutoSleep() override { return buildTaskHandle != nullptr; }
+
+  static std::string getIndexPath(const Epub& epub) { return epub.getCachePath() + "/search.idx"; }
+  // Layout of the section caches the reader uses with the current settings
+  static SearchIndex::Layout getCurrentLayout(uint16_t viewportWidth, uint16_t viewportHeight);
+
+ private:
+  enum class State { BUILDING, DONE, FAILED };
+
+  std::shared_ptr<Epub> epub;
+  uint16_t viewportWidth;
+  uint16_t viewportHeight;
+
+  // Shared with the build task; guarded by the render lock
+  State state = State::BUILDING;
+  int chaptersIndexed = 0;
+  SearchIndexBuilder::Stats stats;
+  unsigned long buildMillis = 0;
+
+  TaskHandle_t buildTaskHandle = nullptr;
+  volatile bool cancelRequested = false;
+  unsigned long lastProgressUpdate = 0;
+
+  const std::function<void()> onGoBack;
+
+  void stopBuild();
+  static void buildTaskTrampoline(void* param);
+  // Returns false if the index couldn't be written or the build was cancelled
+  bool buildIndex();
+};
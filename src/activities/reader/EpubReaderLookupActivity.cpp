@@ -0,0 +1,327 @@
+#include "EpubReaderLookupActivity.h"
+
+#include <GfxRenderer.h>
+#include <I18n.h>
+#include <Logging.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "MappedInputManager.h"
+#include "components/UITheme.h"
+#include "fontIds.h"
+
+namespace {
+constexpr char EM_SPACE[] = "\xe2\x80\x83";
+constexpr int DEFINITION_TOP = 50;
+constexpr int DEFINITION_SIDE_MARGIN = 20;
+}  // namespace
+
+void EpubReaderLookupActivity::onEnter() {
+  Activity::onEnter();
+  collectWords();
+  for (const auto& path : Dictionary::findInstalled()) {
+    std::unique_ptr<Dictionary> dictionary(new Dictionary());
+    if (dictionary->open(path)) {
+      dictionaries.push_back(std::move(dictionary));
+    }
+  }
+  if (dictionaries.empty()) {
+    state = State::MESSAGE;
+    message = tr(STR_NO_DICTIONARY);
+  }
+  // Start near the middle of the page, where the eye usually is
+  selected = words.empty() ? 0 : findWordOnLine(words[words.size() / 2].line, renderer.getScreenWidth() / 2);
+  requestUpdate();
+}
+
+void EpubReaderLookupActivity::onExit() {
+  dictionaries.clear();
+  page.reset();
+  Activity::onExit();
+}
+
+void EpubReaderLookupActivity::collectWords() {
+  words.clear();
+  uint16_t lineIndex = 0;
+  for (const auto& element : page->elements) {
+    if (element->getTag() != TAG_PageLine) {
+      continue;
+    }
+    const auto& block = static_cast<const PageLine&>(*element).getBlock();
+    const auto& lineWords = block.getWords();
+    const auto& lineXpos = block.getWordXpos();
+    const auto& lineStyles = block.getWordStyles();
+    if (lineWords.size() != lineXpos.size() || lineWords.size() != lineStyles.size()) {
+      continue;
+    }
+
+    const size_t firstOnLine = words.size();
+    auto xIt = lineXpos.begin();
+    auto styleIt = lineStyles.begin();
+    for (auto wordIt = lineWords.begin(); wordIt != lineWords.end(); ++wordIt, ++xIt, ++styleIt) {
+      std::string text = *wordIt;
+      int x = marginLeft + element->xPos + *xIt;
+      // Paragraph indents are drawn as a leading em space
+      if (text.compare(0, sizeof(EM_SPACE) - 1, EM_SPACE) == 0) {
+        x += renderer.getTextAdvanceX(fontId, EM_SPACE);
+        text.erase(0, sizeof(EM_SPACE) - 1);
+      }
+      if (Dictionary::makeKey(text).empty()) {
+        continue;  // Punctuation and dashes
+      }
+      WordBox box;
+      box.x = static_cast<int16_t>(x);
+      box.y = static_cast<int16_t>(marginTop + element->yPos);
+      box.width = static_cast<int16_t>(renderer.getTextWidth(fontId, text.c_str(), *styleIt));
+      box.line = lineIndex;
+      box.style = *styleIt;
+      box.lastInLine = false;
+      box.text = std::move(text);
+      words.push_back(std::move(box));
+    }
+    if (words.size() > firstOnLine) {
+      words.back().lastInLine = true;
+      lineIndex++;
+    }
+  }
+}
+
+int EpubReaderLookupActivity::findWordOnLine(const uint16_t line, const int x) const {
+  int best = -1;
+  int bestDistance = 0;
+  for (size_t i = 0; i < words.size(); i++) {
+    if (words[i].line != line) {
+      continue;
+    }
+    const int distance = std::abs(words[i].x + words[i].width / 2 - x);
+    if (best < 0 || distance < bestDistance) {
+      best = static_cast<int>(i);
+      bestDistance = distance;
+    }
+  }
+  return best;
+}
+
+bool EpubReaderLookupActivity::lookUp(const std::string& word, std::vector<Dictionary::Result>& results,
+                                      std::string& name) const {
+  for (const auto& dictionary : dictionaries) {
+    if (dictionary->lookup(word, results)) {
+      name = dictionary->getName();
+      return true;
+    }
+  }
+  return false;
+}
+
+void EpubReaderLookupActivity::lookUpSelected() {
+  const WordBox& box = words[selected];
+  std::vector<Dictionary::Result> results;
+  std::string name;
+  const unsigned long start = millis();
+
+  bool found = false;
+  const bool hyphenated = box.lastInLine && box.text.size() > 1 && box.text.back() == '-';
+  if (hyphenated && selected + 1 < static_cast<int>(words.size())) {
+    // The layout hyphenated this word; try it whole before the fragment
+    found = lookUp(box.text.substr(0, box.text.size() - 1) + words[selected + 1].text, results, name);
+  }
+  if (!found) {
+    found = lookUp(box.text, results, name);
+  }
+  LOG_DBG("DCT", "Looked up \"%s\" in %lu ms: %u results", box.text.c_str(), millis() - start,
+          static_cast<unsigned>(results.size()));
+
+  RenderLock lock(*this);
+  if (found) {
+    dictionaryName = std::move(name);
+    layoutDefinition(results);
+    definitionPage = 0;
+    state = State::DEFINITION;
+  } else {
+    message = tr(STR_WORD_NOT_FOUND);
+    state = State::MESSAGE;
+  }
+}
+
+void EpubReaderLookupActivity::layoutDefinition(const std::vector<Dictionary::Result>& results) {
+  definitionLines.clear();
+  const int maxWidth = renderer.getScreenWidth() - 2 * DEFINITION_SIDE_MARGIN;
+
+  // A single word wider than the screen is cut off rather than broken
+  const auto addLine = [this, maxWidth](const std::string& text, const bool bold) {
+    const auto style = bold ? EpdFontFamily::BOLD : EpdFontFamily::REGULAR;
+    definitionLines.push_back({renderer.truncatedText(UI_10_FONT_ID, text.c_str(), maxWidth, style), bold});
+  };
+
+  for (const auto& result : results) {
+    if (!definitionLines.empty()) {
+      addLine("", false);
+    }
+    addLine(result.headword, true);
+
+    // Greedy wrap, one paragraph per definition line
+    const std::string& text = result.definition;
+    size_t paragraphStart = 0;
+    while (paragraphStart <= text.size()) {
+      size_t paragraphEnd = text.find('\n', paragraphStart);
+      if (paragraphEnd == std::string::npos) {
+        paragraphEnd = text.size();
+      }
+      std::string line;
+      size_t wordStart = paragraphStart;
+      while (wordStart < paragraphEnd) {
+        size_t wordEnd = text.find(' ', wordStart);
+        if (wordEnd == std::string::npos || wordEnd > paragraphEnd) {
+          wordEnd = paragraphEnd;
+        }
+        std::string candidate = line;
+        if (!candidate.empty()) {
+          candidate += ' ';
+        }
+        candidate.append(text, wordStart, wordEnd - wordStart);
+        if (!line.empty() && renderer.getTextWidth(UI_10_FONT_ID, candidate.c_str()) > maxWidth) {
+          addLine(line, false);
+          line.assign(text, wordStart, wordEnd - wordStart);
+        } else {
+          line = std::move(candidate);
+        }
+        wordStart = wordEnd + 1;
+      }
+      addLine(line, false);
+      paragraphStart = paragraphEnd + 1;
+    }
+  }
+}
+
+int EpubReaderLookupActivity::getLinesPerPage() const {
+  const auto& metrics = UITheme::getInstance().getMetrics();
+  const int available = renderer.getScreenHeight() - DEFINITION_TOP - metrics.buttonHintsHeight - 10;
+  return std::max(1, available / renderer.getLineHeight(UI_10_FONT_ID));
+}
+
+void EpubReaderLookupActivity::loop() {
+  if (state == State::MESSAGE) {
+    if (!mappedInput.wasAnyReleased()) {
+      return;
+    }
+    if (dictionaries.empty() || mappedInput.wasReleased(MappedInputManager::Button::Back)) {
+      onGoBack();
+      return;
+    }
+    RenderLock lock(*this);
+    state = State::SELECTING;
+    requestUpdate();
+    return;
+  }
+
+  if (state == State::DEFINITION) {
+    const int linesPerPage = getLinesPerPage();
+    const int pageCount = (static_cast<int>(definitionLines.size()) + linesPerPage - 1) / linesPerPage;
+    if (mappedInput.wasReleased(MappedInputManager::Button::Back) ||
+        mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
+      RenderLock lock(*this);
+      state = State::SELECTING;
+      requestUpdate();
+    } else if ((mappedInput.wasReleased(MappedInputManager::Button::Right) ||
+                mappedInput.wasReleased(MappedInputManager::Button::Down) ||
+                mappedInput.wasReleased(MappedInputManager::Button::PageForward)) &&
+               definitionPage + 1 < pageCount) {
+      definitionPage++;
+      requestUpdate();
+    } else if ((mappedInput.wasReleased(MappedInputManager::Button::Left) ||
+                mappedInput.wasReleased(MappedInputManager::Button::Up) ||
+                mappedInput.wasReleased(MappedInputManager::Button::PageBack)) &&
+               definitionPage > 0) {
+      definitionPage--;
+      requestUpdate();
+    }
+    return;
+  }
+
+  if (mappedInput.wasReleased(MappedInputManager::Button::Back)) {
+    onGoBack();
+    return;
+  }
+  if (words.empty()) {
+    return;
+  }
+  if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
+    lookUpSelected();
+    requestUpdate();
+    return;
+  }
+
+  const int wordCount = static_cast<int>(words.size());
+  int next = selected;
+  if (mappedInput.wasReleased(MappedInputManager::Button::Right) ||
+      mappedInput.wasReleased(MappedInputManager::Button::PageForward)) {
+    next = (selected + 1) % wordCount;
+  } else if (mappedInput.wasReleased(MappedInputManager::Button::Left) ||
+             mappedInput.wasReleased(MappedInputManager::Button::PageBack)) {
+    next = (selected + wordCount - 1) % wordCount;
+  } else if (mappedInput.wasReleased(MappedInputManager::Button::Down)) {
+    const uint16_t lastLine = words.back().line;
+    const WordBox& box = words[selected];
+    next = findWordOnLine(box.line == lastLine ? 0 : box.line + 1, box.x + box.width / 2);
+  } else if (mappedInput.wasReleased(MappedInputManager::Button::Up)) {
+    const uint16_t lastLine = words.back().line;
+    const WordBox& box = words[selected];
+    next = findWordOnLine(box.line == 0 ? lastLine : box.line - 1, box.x + box.width / 2);
+  }
+  if (next >= 0 && next != selected) {
+    RenderLock lock(*this);
+    selected = next;
+    requestUpdate();
+  }
+}
+
+void EpubReaderLookupActivity::render(Activity::RenderLock&&) {
+  if (state == State::DEFINITION) {
+    renderDefinition();
+    return;
+  }
+  renderSelection();
+  if (state == State::MESSAGE && message) {
+    GUI.drawPopup(renderer, message);  // Draws and refreshes
+    return;
+  }
+  renderer.displayBuffer();
+}
+
+void EpubReaderLookupActivity::renderSelection() {
+  renderer.clearScreen();
+  page->render(renderer, fontId, marginLeft, marginTop);
+  if (words.empty() || state == State::MESSAGE) {
+    return;
+  }
+
+  const WordBox& box = words[selected];
+  renderer.fillRect(box.x - 2, box.y, box.width + 4, renderer.getLineHeight(fontId), true);
+  renderer.drawText(fontId, box.x, box.y, box.text.c_str(), false, box.style);
+}
+
+void EpubReaderLookupActivity::renderDefinition() {
+  renderer.clearScreen();
+  const int linesPerPage = getLinesPerPage();
+  const int pageCount = (static_cast<int>(definitionLines.size()) + linesPerPage - 1) / linesPerPage;
+
+  const std::string title = renderer.truncatedText(UI_12_FONT_ID, dictionaryName.c_str(),
+                                                   renderer.getScreenWidth() - 2 * DEFINITION_SIDE_MARGIN,
+                                                   EpdFontFamily::BOLD);
+  renderer.drawCenteredText(UI_12_FONT_ID, 15, title.c_str(), true, EpdFontFamily::BOLD);
+
+  const int lineHeight = renderer.getLineHeight(UI_10_FONT_ID);
+  const int first = definitionPage * linesPerPage;
+  const int last = std::min(static_cast<int>(definitionLines.size()), first + linesPerPage);
+  for (int i = first; i < last; i++) {
+    renderer.drawText(UI_10_FONT_ID, DEFINITION_SIDE_MARGIN, DEFINITION_TOP + (i - first) * lineHeight,
+                      definitionLines[i].text.c_str(), true,
+                      definitionLines[i].bold ? EpdFontFamily::BOLD : EpdFontFamily::REGULAR);
+  }
+
+  const auto labels = mappedInput.mapLabels(tr(STR_BACK), "", definitionPage > 0 ? tr(STR_DIR_UP) : "",
+                                            definitionPage + 1 < pageCount ? tr(STR_DIR_DOWN) : "");
+  GUI.drawButtonHints(renderer, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
+  renderer.displayBuffer();
+}
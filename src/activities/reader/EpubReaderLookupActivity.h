@@ -0,0 +1,77 @@
+#pragma once
+#include <Dictionary.h>
+#include <EpdFontFamily.h>
+#include <Epub/Page.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../Activity.h"
+
+// Dictionary lookup on the current page. The page is redrawn with one word highlighted; the buttons move the
+// highlight by word and by line, and Confirm shows the word's definition from the dictionaries in /dictionaries.
+class EpubReaderLookupActivity final : public Activity {
+ public:
+  explicit EpubReaderLookupActivity(GfxRenderer& renderer, MappedInputManager& mappedInput, std::unique_ptr<Page> page,
+                                    const int fontId, const int marginLeft, const int marginTop,
+                                    const std::function<void()>& onGoBack)
+      : Activity("EpubReaderLookup", renderer, mappedInput),
+        page(std::move(page)),
+        fontId(fontId),
+        marginLeft(marginLeft),
+        marginTop(marginTop),
+        onGoBack(onGoBack) {}
+  void onEnter() override;
+  void onExit() override;
+  void loop() override;
+  void render(Activity::RenderLock&&) override;
+
+ private:
+  enum class State { SELECTING, DEFINITION, MESSAGE };
+
+  // A selectable word and where the page drew it
+  struct WordBox {
+    std::string text;
+    int16_t x;
+    int16_t y;
+    int16_t width;
+    uint16_t line;
+    EpdFontFamily::Style style;
+    bool lastInLine;
+  };
+
+  struct DefinitionLine {
+    std::string text;
+    bool bold;
+  };
+
+  std::unique_ptr<Page> page;
+  int fontId;
+  int marginLeft;
+  int marginTop;
+  std::vector<WordBox> words;
+  std::vector<std::unique_ptr<Dictionary>> dictionaries;
+
+  // Guarded by the render lock
+  State state = State::SELECTING;
+  int selected = 0;
+  const char* message = nullptr;
+  std::string dictionaryName;
+  std::vector<DefinitionLine> definitionLines;
+  int definitionPage = 0;
+
+  const std::function<void()> onGoBack;
+
+  void collectWords();
+  // Index of the word on `line` closest to horizontal position `x`, or -1 if the line has no words
+  int findWordOnLine(uint16_t line, int x) const;
+  void lookUpSelected();
+  // Tries each dictionary in turn; `name` is the one that had the word
+  bool lookUp(const std::string& word, std::vector<Dictionary::Result>& results, std::string& name) const;
+  void layoutDefinition(const std::vector<Dictionary::Result>& results);
+  int getLinesPerPage() const;
+  void renderSelection();
+  void renderDefinition();
+};
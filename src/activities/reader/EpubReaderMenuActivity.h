@@ -12,7 +12,17 @@
 class EpubReaderMenuActivity final : public ActivityWithSubactivity {
  public:
   // Menu actions available from the reader menu.
-  enum class MenuAction { SELECT_CHAPTER, GO_TO_PERCENT, ROTATE_SCREEN, GO_HOME, SYNC, DELETE_CACHE };
+  enum class MenuAction {
+    SELECT_CHAPTER,
+    SEARCH,
+    BUILD_SEARCH_INDEX,
+    LOOKUP_WORD,
+    GO_TO_PERCENT,
+    ROTATE_SCREEN,
+    GO_HOME,
+    SYNC,
+    DELETE_CACHE
+  };
 
   explicit EpubReaderMenuActivity(GfxRenderer& renderer, MappedInputManager& mappedInput, const std::string& title,
                                   const int currentPage, const int totalPages, const int bookProgressPercent,
@@ -40,6 +50,9 @@ class EpubReaderMenuActivity final : public ActivityWithSubactivity {
 
   // Fixed menu layout (order matters for up/down navigation).
   const std::vector<MenuItem> menuItems = {{MenuAction::SELECT_CHAPTER, StrId::STR_SELECT_CHAPTER},
+                                           {MenuAction::SEARCH, StrId::STR_SEARCH_BOOK},
+                                           {MenuAction::BUILD_SEARCH_INDEX, StrId::STR_BUILD_SEARCH_INDEX},
+                                           {MenuAction::LOOKUP_WORD, StrId::STR_LOOKUP_WORD},
                                            {MenuAction::ROTATE_SCREEN, StrId::STR_ORIENTATION},
                                            {MenuAction::GO_TO_PERCENT, StrId::STR_GO_TO_PERCENT},
                                            {MenuAction::GO_HOME, StrId::STR_GO_HOME_BUTTON},
@@ -0,0 +1,367 @@
+#include "EpubReaderSearchActivity.h"
+
+#include <Epub/Section.h>
+#include <Epub/search/HtmlTextSearchStream.h>
+#include <Epub/search/SearchIndex.h>
+#include <Epub/search/TextMatcher.h>
+#include <GfxRenderer.h>
+#include <I18n.h>
+
+#include "CrossPointSettings.h"
+#include "EpubReaderIndexActivity.h"
+#include "MappedInputManager.h"
+#include "activities/util/KeyboardEntryActivity.h"
+#include "components/UITheme.h"
+#include "fontIds.h"
+
+namespace {
+// Bounds the result list (and its memory); a query this common is better refined than paged through
+constexpr size_t MAX_HITS = 100;
+constexpr size_t MAX_QUERY_LENGTH = 48;
+// Redraw at most this often while the search runs; every refresh competes with the search for the CPU
+constexpr unsigned long PROGRESS_UPDATE_MS = 1500;
+// Uncached chapters only know where a match is in the source; matches closer than about a page of XHTML apart are
+// listed once
+constexpr size_t APPROX_PAGE_SOURCE_BYTES = 2048;
+constexpr int LINE_HEIGHT = 30;
+constexpr int LIST_START_Y = 75;
+}  // namespace
+
+int EpubReaderSearchActivity::getPageItems() const {
+  const bool isPortraitInverted = renderer.getOrientation() == GfxRenderer::Orientation::PortraitInverted;
+  const int hintGutterHeight = isPortraitInverted ? 50 : 0;
+  const int availableHeight = renderer.getScreenHeight() - LIST_START_Y - hintGutterHeight - LINE_HEIGHT;
+  return std::max(1, availableHeight / LINE_HEIGHT);
+}
+
+void EpubReaderSearchActivity::onEnter() {
+  ActivityWithSubactivity::onEnter();
+  openKeyboard();
+}
+
+void EpubReaderSearchActivity::onExit() {
+  stopSearch();
+  ActivityWithSubactivity::onExit();
+}
+
+void EpubReaderSearchActivity::openKeyboard() {
+  enterNewActivity(new KeyboardEntryActivity(
+      renderer, mappedInput, tr(STR_SEARCH_BOOK), query, 10, MAX_QUERY_LENGTH, false,
+      [this](const std::string& text) {
+        query = text;
+        exitActivity();
+        startSearch();
+      },
+      [this]() {
+        // Going back deletes this activity, which is still inside subActivity->loop(); leave from our own loop
+        pendingGoBack = true;
+      }));
+}
+
+void EpubReaderSearchActivity::startSearch() {
+  stopSearch();
+  {
+    RenderLock lock(*this);
+    hits.clear();
+    chaptersSearched = 0;
+    selectorIndex = 0;
+    searching = true;
+  }
+  cancelRequested = false;
+  lastProgressUpdate = millis();
+  xTaskCreate(&EpubReaderSearchActivity::searchTaskTrampoline, "BookSearch", 8192, this, tskIDLE_PRIORITY,
+              &searchTaskHandle);
+  requestUpdate();
+}
+
+void EpubReaderSearchActivity::stopSearch() {
+  cancelRequested = true;
+  // The task checks the flag between pages and chunks; let it close its files rather than deleting it mid-read
+  while (searchTaskHandle) {
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+void EpubReaderSearchActivity::searchTaskTrampoline(void* param) {
+  auto* self = static_cast<EpubReaderSearchActivity*>(param);
+  self->runSearch();
+  {
+    RenderLock lock(*self);
+    self->searching = false;
+    self->searchTaskHandle = nullptr;
+  }
+  self->requestUpdate();
+  vTaskDelete(nullptr);
+}
+
+void EpubReaderSearchActivity::runSearch() {
+  std::unique_ptr<TextMatcher> matcher(new (std::nothrow) TextMatcher(query));
+  if (!matcher || !matcher->isValid()) {
+    return;
+  }
+
+  const unsigned long start = millis();
+  if (searchIndex()) {
+    LOG_DBG("SRC", "Looked up \"%s\" in the search index in %lu ms: %u hits", query.c_str(), millis() - start,
+            static_cast<unsigned>(hits.size()));
+    return;
+  }
+
+  const int spineCount = epub->getSpineItemsCount();
+  for (int i = 0; i < spineCount && !cancelRequested; i++) {
+    matcher->reset();
+    if (!searchCachedSection(i, *matcher)) {
+      matcher->reset();
+      searchChapterText(i, *matcher);
+    }
+    {
+      RenderLock lock(*this);
+      chaptersSearched = i + 1;
+      if (hits.size() >= MAX_HITS) {
+        break;
+      }
+    }
+    requestProgressUpdate();
+  }
+  LOG_DBG("SRC", "Searched %d chapters for \"%s\" in %lu ms: %u hits%s", chaptersSearched, query.c_str(),
+          millis() - start, static_cast<unsigned>(hits.size()), cancelRequested ? " (cancelled)" : "");
+}
+
+bool EpubReaderSearchActivity::searchIndex() {
+  if (viewportWidth == 0 || viewportHeight == 0) {
+    return false;
+  }
+  const int spineCount = epub->getSpineItemsCount();
+  std::unique_ptr<SearchIndex> index(new SearchIndex(EpubReaderIndexActivity::getIndexPath(*epub)));
+  if (!index->open(EpubReaderIndexActivity::getCurrentLayout(viewportWidth, viewportHeight),
+                   static_cast<uint16_t>(spineCount))) {
+    return false;
+  }
+  std::vector<SearchIndex::Location> pages;
+  if (!index->query(query, pages, MAX_HITS)) {
+    return false;
+  }
+
+  for (const auto& location : pages) {
+    const float pageCount = index->getPageCount(location.spineIndex);
+    addHit(location.spineIndex, location.page, static_cast<float>(location.page) / pageCount);
+  }
+  {
+    RenderLock lock(*this);
+    chaptersSearched = spineCount;
+  }
+  return true;
+}
+
+bool EpubReaderSearchActivity::searchCachedSection(const int spineIndex, TextMatcher& matcher) {
+  if (viewportWidth == 0 || viewportHeight == 0) {
+    return false;
+  }
+  Section section(epub, spineIndex, renderer);
+  if (!section.loadSectionFile(SETTINGS.getReaderFontId(), SETTINGS.getReaderLineCompression(),
+                               SETTINGS.extraParagraphSpacing, SETTINGS.paragraphAlignment, viewportWidth,
+                               viewportHeight, SETTINGS.hyphenationEnabled, SETTINGS.embeddedStyle)) {
+    return false;
+  }
+
+  const int pageCount = section.pageCount;
+  bool full = false;
+  return section.visitPageText(
+      [&matcher](const std::string& word, const bool lastInLine) {
+        // Rejoin words the layout hyphenated across a line break
+        if (lastInLine && word.size() > 1 && word.back() == '-') {
+          matcher.feed(word.data(), word.size() - 1);
+          return;
+        }
+        matcher.feed(word);
+        matcher.feedSeparator();
+      },
+      [&](const int page) {
+        if (matcher.takeMatches() > 0) {
+          full = !addHit(spineIndex, page, static_cast<float>(page) / static_cast<float>(pageCount));
+        }
+        return !cancelRequested && !full;
+      });
+}
+
+void EpubReaderSearchActivity::searchChapterText(const int spineIndex, TextMatcher& matcher) {
+  const size_t chapterEnd = epub->getCumulativeSpineItemSize(spineIndex);
+  const size_t chapterStart = spineIndex > 0 ? epub->getCumulativeSpineItemSize(spineIndex - 1) : 0;
+  const size_t chapterSize = chapterEnd > chapterStart ? chapterEnd - chapterStart : 0;
+
+  size_t lastHitOffset = 0;
+  bool hasHit = false;
+  bool full = false;
+  HtmlTextSearchStream stream(
+      matcher,
+      [&](const size_t offset) {
+        if (full || (hasHit && offset - lastHitOffset < APPROX_PAGE_SOURCE_BYTES)) {
+          return;
+        }
+        hasHit = true;
+        lastHitOffset = offset;
+        const float progress =
+            chapterSize > 0 ? std::min(1.0f, static_cast<float>(offset) / static_cast<float>(chapterSize)) : 0.0f;
+        full = !addHit(spineIndex, -1, progress);
+      },
+      &cancelRequested);
+  epub->readItemContentsToStream(epub->getSpineItem(spineIndex).href, stream, 1024);
+}
+
+bool EpubReaderSearchActivity::addHit(const int spineIndex, const int page, const float progress) {
+  Hit hit;
+  hit.spineIndex = spineIndex;
+  hit.page = page;
+  hit.progress = progress;
+  const int tocIndex = epub->getTocIndexForSpineIndex(spineIndex);
+  if (tocIndex >= 0) {
+    hit.chapterTitle = epub->getTocItem(tocIndex).title;
+  }
+
+  bool hasRoom;
+  {
+    RenderLock lock(*this);
+    hits.push_back(std::move(hit));
+    hasRoom = hits.size() < MAX_HITS;
+  }
+  requestProgressUpdate();
+  return hasRoom;
+}
+
+void EpubReaderSearchActivity::requestProgressUpdate() {
+  if (millis() - lastProgressUpdate >= PROGRESS_UPDATE_MS) {
+    lastProgressUpdate = millis();
+    requestUpdate();
+  }
+}
+
+void EpubReaderSearchActivity::loop() {
+  if (subActivity) {
+    subActivity->loop();
+    if (pendingGoBack) {
+      pendingGoBack = false;
+      exitActivity();
+      onGoBack(query);
+    }
+    return;
+  }
+
+  if (mappedInput.wasReleased(MappedInputManager::Button::Back)) {
+    stopSearch();
+    onGoBack(query);
+    return;
+  }
+
+  int hitCount;
+  {
+    RenderLock lock(*this);
+    hitCount = static_cast<int>(hits.size());
+  }
+
+  if (mappedInput.wasReleased(MappedInputManager::Button::Confirm)) {
+    if (hitCount == 0) {
+      // Nothing to open; edit the query instead
+      stopSearch();
+      openKeyboard();
+      return;
+    }
+    stopSearch();
+    const Hit hit = hits[selectorIndex];
+    onSelectHit(query, hit);
+    return;
+  }
+
+  if (hitCount == 0) {
+    return;
+  }
+  const int pageItems = getPageItems();
+
+  buttonNavigator.onNextRelease([this, hitCount] {
+    selectorIndex = ButtonNavigator::nextIndex(selectorIndex, hitCount);
+    requestUpdate();
+  });
+
+  buttonNavigator.onPreviousRelease([this, hitCount] {
+    selectorIndex = ButtonNavigator::previousIndex(selectorIndex, hitCount);
+    requestUpdate();
+  });
+
+  buttonNavigator.onNextContinuous([this, hitCount, pageItems] {
+    selectorIndex = ButtonNavigator::nextPageIndex(selectorIndex, hitCount, pageItems);
+    requestUpdate();
+  });
+
+  buttonNavigator.onPreviousContinuous([this, hitCount, pageItems] {
+    selectorIndex = ButtonNavigator::previousPageIndex(selectorIndex, hitCount, pageItems);
+    requestUpdate();
+  });
+}
+
+void EpubReaderSearchActivity::render(Activity::RenderLock&&) {
+  renderer.clearScreen();
+
+  const auto pageWidth = renderer.getScreenWidth();
+  const auto orientation = renderer.getOrientation();
+  // Landscape orientation: reserve a horizontal gutter for button hints.
+  const bool isLandscapeCw = orientation == GfxRenderer::Orientation::LandscapeClockwise;
+  const bool isLandscapeCcw = orientation == GfxRenderer::Orientation::LandscapeCounterClockwise;
+  // Inverted portrait: reserve vertical space for hints at the top.
+  const bool isPortraitInverted = orientation == GfxRenderer::Orientation::PortraitInverted;
+  const int hintGutterWidth = (isLandscapeCw || isLandscapeCcw) ? 30 : 0;
+  const int contentX = isLandscapeCw ? hintGutterWidth : 0;
+  const int contentWidth = pageWidth - hintGutterWidth;
+  const int contentY = isPortraitInverted ? 50 : 0;
+  const int pageItems = getPageItems();
+  const int totalItems = static_cast<int>(hits.size());
+
+  const std::string title =
+      renderer.truncatedText(UI_12_FONT_ID, ("\"" + query + "\"").c_str(), contentWidth - 40, EpdFontFamily::BOLD);
+  const int titleX =
+      contentX + (contentWidth - renderer.getTextWidth(UI_12_FONT_ID, title.c_str(), EpdFontFamily::BOLD)) / 2;
+  renderer.drawText(UI_12_FONT_ID, titleX, 15 + contentY, title.c_str(), true, EpdFontFamily::BOLD);
+
+  char status[64];
+  if (searching) {
+    snprintf(status, sizeof(status), tr(STR_SEARCH_PROGRESS_FORMAT), chaptersSearched, epub->getSpineItemsCount());
+  } else if (totalItems == 0) {
+    snprintf(status, sizeof(status), "%s", tr(STR_NO_MATCHES));
+  } else {
+    snprintf(status, sizeof(status), tr(STR_SEARCH_MATCHES_FORMAT), totalItems);
+  }
+  renderer.drawText(UI_10_FONT_ID, contentX + 20, 45 + contentY, status);
+
+  if (totalItems > 0) {
+    const int pageStartIndex = selectorIndex / pageItems * pageItems;
+    renderer.fillRect(contentX, LIST_START_Y + contentY + (selectorIndex % pageItems) * LINE_HEIGHT - 2,
+                      contentWidth - 1, LINE_HEIGHT);
+
+    for (int i = 0; i < pageItems; i++) {
+      const int itemIndex = pageStartIndex + i;
+      if (itemIndex >= totalItems) break;
+      const Hit& hit = hits[itemIndex];
+      const int displayY = LIST_START_Y + contentY + i * LINE_HEIGHT;
+      const bool isSelected = itemIndex == selectorIndex;
+
+      char location[16];
+      if (hit.page >= 0) {
+        snprintf(location, sizeof(location), tr(STR_SEARCH_PAGE_FORMAT), hit.page + 1);
+      } else {
+        snprintf(location, sizeof(location), tr(STR_SEARCH_APPROX_FORMAT), static_cast<int>(hit.progress * 100));
+      }
+      const int locationWidth = renderer.getTextWidth(UI_10_FONT_ID, location);
+      const int locationX = contentX + contentWidth - 20 - locationWidth;
+      renderer.drawText(UI_10_FONT_ID, locationX, displayY, location, !isSelected);
+
+      const std::string chapter =
+          hit.chapterTitle.empty() ? "#" + std::to_string(hit.spineIndex + 1) : hit.chapterTitle;
+      const std::string chapterName = renderer.truncatedText(UI_10_FONT_ID, chapter.c_str(), locationX - contentX - 40);
+      renderer.drawText(UI_10_FONT_ID, contentX + 20, displayY, chapterName.c_str(), !isSelected);
+    }
+  }
+
+  const auto labels = mappedInput.mapLabels(tr(STR_BACK), totalItems > 0 ? tr(STR_SELECT) : tr(STR_SEARCH_BOOK),
+                                            tr(STR_DIR_UP), tr(STR_DIR_DOWN));
+  GUI.drawButtonHints(renderer, labels.btn1, labels.btn2, labels.btn3, labels.btn4);
+
+  renderer.displayBuffer();
+}
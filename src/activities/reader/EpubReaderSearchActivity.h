@@ -0,0 +1,82 @@
+#pragma once
+#include <Epub.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../ActivityWithSubactivity.h"
+#include "util/ButtonNavigator.h"
+
+class TextMatcher;
+
+// Full-text search inside the open book. After the query is entered, a background task walks the spine: chapters with
+// a section cache for the current layout are read page by page, the rest are inflated and scanned as plain text. Hits
+// are listed as they come in, and leaving the screen cancels the search. Books with an up-to-date search index are
+// answered from the index instead, by word rather than by exact phrase.
+class EpubReaderSearchActivity final : public ActivityWithSubactivity {
+ public:
+  struct Hit {
+    int spineIndex = 0;
+    // Page within the chapter, or -1 if the chapter has no section cache and only `progress` is known
+    int page = -1;
+    // Position within the chapter, 0.0-1.0
+    float progress = 0.0f;
+    std::string chapterTitle;
+  };
+
+  explicit EpubReaderSearchActivity(GfxRenderer& renderer, MappedInputManager& mappedInput,
+                                    const std::shared_ptr<Epub>& epub, const uint16_t viewportWidth,
+                                    const uint16_t viewportHeight, const std::string& initialQuery,
+                                    const std::function<void(const std::string& query)>& onGoBack,
+                                    const std::function<void(const std::string& query, const Hit& hit)>& onSelectHit)
+      : ActivityWithSubactivity("EpubReaderSearch", renderer, mappedInput),
+        epub(epub),
+        viewportWidth(viewportWidth),
+        viewportHeight(viewportHeight),
+        query(initialQuery),
+        onGoBack(onGoBack),
+        onSelectHit(onSelectHit) {}
+  void onEnter() override;
+  void onExit() override;
+  void loop() override;
+  void render(Activity::RenderLock&&) override;
+  bool preventAutoSleep() override { return searchTaskHandle != nullptr; }
+
+ private:
+  std::shared_ptr<Epub> epub;
+  uint16_t viewportWidth;
+  uint16_t viewportHeight;
+  std::string query;
+  ButtonNavigator buttonNavigator;
+  int selectorIndex = 0;
+  bool pendingGoBack = false;
+
+  // Shared with the search task; guarded by the render lock
+  std::vector<Hit> hits;
+  int chaptersSearched = 0;
+  bool searching = false;
+
+  TaskHandle_t searchTaskHandle = nullptr;
+  volatile bool cancelRequested = false;
+  unsigned long lastProgressUpdate = 0;
+
+  const std::function<void(const std::string& query)> onGoBack;
+  const std::function<void(const std::string& query, const Hit& hit)> onSelectHit;
+
+  void openKeyboard();
+  void startSearch();
+  void stopSearch();
+  static void searchTaskTrampoline(void* param);
+  void runSearch();
+  // Answers the query from the book's search index if one matches the current layout; returns false otherwise
+  bool searchIndex();
+  // Returns false if the chapter couldn't be read at all
+  bool searchCachedSection(int spineIndex, TextMatcher& matcher);
+  void searchChapterText(int spineIndex, TextMatcher& matcher);
+  // Returns false once the result list is full
+  bool addHit(int spineIndex, int page, float progress);
+  void requestProgressUpdate();
+  int getPageItems() const;
+};
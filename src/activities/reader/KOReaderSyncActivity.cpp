@@ -76,7 +76,7 @@ void KOReaderSyncActivity::performSync() {
   if (KOREADER_STORE.getMatchMethod() == DocumentMatchMethod::FILENAME) {
     documentHash = KOReaderDocumentId::calculateFromFilename(epubPath);
   } else {
-    documentHash = KOReaderDocumentId::calculate(epubPath);
+    documentHash = KOReaderDocumentId::calculate(epubPath, epub ? epub->getCachePath() : std::string());
   }
   if (documentHash.empty()) {
     {
@@ -126,7 +126,7 @@ void KOReaderSyncActivity::performSync() {
   remotePosition = ProgressMapper::toCrossPoint(epub, koPos, totalPagesInSpine);
 
   // Calculate local progress in KOReader format (for display)
-  CrossPointPosition localPos = {currentSpineIndex, currentPage, totalPagesInSpine};
+  CrossPointPosition localPos = {currentSpineIndex, currentPage, totalPagesInSpine, currentElementPath};
   localProgress = ProgressMapper::toKOReader(epub, localPos);
 
   {
@@ -143,11 +143,10 @@ void KOReaderSyncActivity::performUpload() {
     state = UPLOADING;
     statusMessage = tr(STR_UPLOAD_PROGRESS);
   }
-  requestUpdate();
   requestUpdateAndWait();
 
   // Convert current position to KOReader format
-  CrossPointPosition localPos = {currentSpineIndex, currentPage, totalPagesInSpine};
+  CrossPointPosition localPos = {currentSpineIndex, currentPage, totalPagesInSpine, currentElementPath};
   KOReaderPosition koPos = ProgressMapper::toKOReader(epub, localPos);
 
   KOReaderProgress progress;
@@ -375,7 +374,7 @@ void KOReaderSyncActivity::loop() {
     if (mappedInput.wasPressed(MappedInputManager::Button::Confirm)) {
       if (selectedOption == 0) {
         // Apply remote progress
-        onSyncComplete(remotePosition.spineIndex, remotePosition.pageNumber);
+        onSyncComplete(remotePosition.spineIndex, remotePosition.pageNumber, remotePosition.elementPath);
       } else if (selectedOption == 1) {
         // Upload local progress
         performUpload();
@@ -395,7 +394,7 @@ void KOReaderSyncActivity::loop() {
         if (KOREADER_STORE.getMatchMethod() == DocumentMatchMethod::FILENAME) {
           documentHash = KOReaderDocumentId::calculateFromFilename(epubPath);
         } else {
-          documentHash = KOReaderDocumentId::calculate(epubPath);
+          documentHash = KOReaderDocumentId::calculate(epubPath, epub ? epub->getCachePath() : std::string());
         }
       }
       performUpload();
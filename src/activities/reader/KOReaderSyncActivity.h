@@ -21,18 +21,20 @@
 class KOReaderSyncActivity final : public ActivityWithSubactivity {
  public:
   using OnCancelCallback = std::function<void()>;
-  using OnSyncCompleteCallback = std::function<void(int newSpineIndex, int newPageNumber)>;
+  using OnSyncCompleteCallback =
+      std::function<void(int newSpineIndex, int newPageNumber, const std::string& elementPath)>;
 
   explicit KOReaderSyncActivity(GfxRenderer& renderer, MappedInputManager& mappedInput,
                                 const std::shared_ptr<Epub>& epub, const std::string& epubPath, int currentSpineIndex,
-                                int currentPage, int totalPagesInSpine, OnCancelCallback onCancel,
-                                OnSyncCompleteCallback onSyncComplete)
+                                int currentPage, int totalPagesInSpine, std::string currentElementPath,
+                                OnCancelCallback onCancel, OnSyncCompleteCallback onSyncComplete)
       : ActivityWithSubactivity("KOReaderSync", renderer, mappedInput),
         epub(epub),
         epubPath(epubPath),
         currentSpineIndex(currentSpineIndex),
         currentPage(currentPage),
         totalPagesInSpine(totalPagesInSpine),
+        currentElementPath(std::move(currentElementPath)),
         remoteProgress{},
         remotePosition{},
         localProgress{},
@@ -63,6 +65,7 @@ class KOReaderSyncActivity final : public ActivityWithSubactivity {
   int currentSpineIndex;
   int currentPage;
   int totalPagesInSpine;
+  std::string currentElementPath;
 
   State state = WIFI_SELECTION;
   std::string statusMessage;
@@ -12,6 +12,8 @@
 #include "CrossPointState.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
+#include "StateStore.h"
+#include "activities/RenderStats.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 
@@ -399,6 +401,10 @@ void MdReaderActivity::renderScreen() {
     renderer.displayBuffer();
     return;
   }
+  RENDER_STATS.onPageLoaded();
+  if (renderSuperseded()) {
+    return;
+  }
 
   renderer.clearScreen();
   renderContents(std::move(page), orientedMarginTop, orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
@@ -408,7 +414,12 @@ void MdReaderActivity::renderScreen() {
 void MdReaderActivity::renderContents(std::unique_ptr<Page> page, const int orientedMarginTop,
                                       const int orientedMarginRight, const int orientedMarginBottom,
                                       const int orientedMarginLeft) {
-  page->render(renderer, cachedFontId, orientedMarginLeft, orientedMarginTop);
+  // Page turns that came in meanwhile are shown instead
+  if (!page->render(renderer, cachedFontId, orientedMarginLeft, orientedMarginTop,
+                    [this] { return renderSuperseded(); }) ||
+      renderSuperseded()) {
+    return;
+  }
   renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
 
   if (pagesUntilFullRefresh <= 1) {
@@ -420,7 +431,7 @@ void MdReaderActivity::renderContents(std::unique_ptr<Page> page, const int orie
   }
 
   // Grayscale anti-aliasing pass
-  if (SETTINGS.textAntiAliasing) {
+  if (SETTINGS.textAntiAliasing && !renderSuperseded()) {
     renderer.storeBwBuffer();
 
     renderer.clearScreen(0x00);
@@ -508,23 +519,20 @@ void MdReaderActivity::renderStatusBar(const int orientedMarginRight, const int
 }
 
 void MdReaderActivity::saveProgress() const {
-  FsFile f;
-  if (Storage.openFileForWrite("MDR", md->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    data[0] = currentPage & 0xFF;
-    data[1] = (currentPage >> 8) & 0xFF;
-    data[2] = 0;
-    data[3] = 0;
-    f.write(data, 4);
-    f.close();
-  }
+  uint8_t data[4];
+  data[0] = currentPage & 0xFF;
+  data[1] = (currentPage >> 8) & 0xFF;
+  data[2] = 0;
+  data[3] = 0;
+  STATE_STORE.put(StateStore::progressKey(md->getCachePath()), data, sizeof(data));
 }
 
 void MdReaderActivity::loadProgress() {
-  FsFile f;
-  if (Storage.openFileForRead("MDR", md->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    if (f.read(data, 4) == 4) {
+  std::string progress;
+  if (STATE_STORE.get(StateStore::progressKey(md->getCachePath()), progress,
+                      md->getCachePath() + "/progress.bin")) {
+    const auto* data = reinterpret_cast<const uint8_t*>(progress.data());
+    if (progress.size() >= 4) {
       currentPage = data[0] + (data[1] << 8);
       if (currentPage >= totalPages) {
         currentPage = totalPages - 1;
@@ -534,6 +542,5 @@ void MdReaderActivity::loadProgress() {
       }
       LOG_DBG("MDR", "Loaded progress: page %d/%d", currentPage, totalPages);
     }
-    f.close();
   }
 }
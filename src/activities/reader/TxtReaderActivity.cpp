@@ -10,6 +10,8 @@
 #include "CrossPointState.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
+#include "StateStore.h"
+#include "activities/RenderStats.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 
@@ -365,6 +367,10 @@ void TxtReaderActivity::render(Activity::RenderLock&&) {
   size_t nextOffset;
   currentPageLines.clear();
   loadPageAtOffset(offset, currentPageLines, nextOffset);
+  RENDER_STATS.onPageLoaded();
+  if (renderSuperseded()) {
+    return;
+  }
 
   renderer.clearScreen();
   renderPage();
@@ -423,6 +429,10 @@ void TxtReaderActivity::renderPage() {
   // First pass: BW rendering
   renderLines();
   renderStatusBar(orientedMarginRight, orientedMarginBottom, orientedMarginLeft);
+  // Page turns that came in meanwhile are shown instead
+  if (renderSuperseded()) {
+    return;
+  }
 
   if (pagesUntilFullRefresh <= 1) {
     renderer.displayBuffer(HalDisplay::HALF_REFRESH);
@@ -433,7 +443,7 @@ void TxtReaderActivity::renderPage() {
   }
 
   // Grayscale rendering pass (for anti-aliased fonts)
-  if (SETTINGS.textAntiAliasing) {
+  if (SETTINGS.textAntiAliasing && !renderSuperseded()) {
     // Save BW buffer for restoration after grayscale pass
     renderer.storeBwBuffer();
 
@@ -530,23 +540,20 @@ void TxtReaderActivity::renderStatusBar(const int orientedMarginRight, const int
 }
 
 void TxtReaderActivity::saveProgress() const {
-  FsFile f;
-  if (Storage.openFileForWrite("TRS", txt->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    data[0] = currentPage & 0xFF;
-    data[1] = (currentPage >> 8) & 0xFF;
-    data[2] = 0;
-    data[3] = 0;
-    f.write(data, 4);
-    f.close();
-  }
+  uint8_t data[4];
+  data[0] = currentPage & 0xFF;
+  data[1] = (currentPage >> 8) & 0xFF;
+  data[2] = 0;
+  data[3] = 0;
+  STATE_STORE.put(StateStore::progressKey(txt->getCachePath()), data, sizeof(data));
 }
 
 void TxtReaderActivity::loadProgress() {
-  FsFile f;
-  if (Storage.openFileForRead("TRS", txt->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    if (f.read(data, 4) == 4) {
+  std::string progress;
+  if (STATE_STORE.get(StateStore::progressKey(txt->getCachePath()), progress,
+                      txt->getCachePath() + "/progress.bin")) {
+    const auto* data = reinterpret_cast<const uint8_t*>(progress.data());
+    if (progress.size() >= 4) {
       currentPage = data[0] + (data[1] << 8);
       if (currentPage >= totalPages) {
         currentPage = totalPages - 1;
@@ -556,7 +563,6 @@ void TxtReaderActivity::loadProgress() {
       }
       LOG_DBG("TRS", "Loaded progress: page %d/%d", currentPage, totalPages);
     }
-    f.close();
   }
 }
 
@@ -9,14 +9,15 @@
 
 #include <FsHelpers.h>
 #include <GfxRenderer.h>
-#include <HalStorage.h>
 #include <I18n.h>
 
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
+#include "StateStore.h"
 #include "XtcReaderChapterSelectionActivity.h"
+#include "activities/RenderStats.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 
@@ -189,6 +190,12 @@ void XtcReaderActivity::renderPage() {
     return;
   }
 
+  RENDER_STATS.onPageLoaded();
+  if (renderSuperseded()) {
+    free(pageBuffer);
+    return;
+  }
+
   // Clear screen first
   renderer.clearScreen();
 
@@ -242,6 +249,12 @@ void XtcReaderActivity::renderPage() {
       }
     }
 
+    // Page turns that came in meanwhile are shown instead
+    if (renderSuperseded()) {
+      free(pageBuffer);
+      return;
+    }
+
     // Display BW with conditional refresh based on pagesUntilFullRefresh
     if (pagesUntilFullRefresh <= 1) {
       renderer.displayBuffer(HalDisplay::HALF_REFRESH);
@@ -321,6 +334,11 @@ void XtcReaderActivity::renderPage() {
 
   // XTC pages already have status bar pre-rendered, no need to add our own
 
+  // Page turns that came in meanwhile are shown instead
+  if (renderSuperseded()) {
+    return;
+  }
+
   // Display with appropriate refresh
   if (pagesUntilFullRefresh <= 1) {
     renderer.displayBuffer(HalDisplay::HALF_REFRESH);
@@ -334,23 +352,20 @@ void XtcReaderActivity::renderPage() {
 }
 
 void XtcReaderActivity::saveProgress() const {
-  FsFile f;
-  if (Storage.openFileForWrite("XTR", xtc->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    data[0] = currentPage & 0xFF;
-    data[1] = (currentPage >> 8) & 0xFF;
-    data[2] = (currentPage >> 16) & 0xFF;
-    data[3] = (currentPage >> 24) & 0xFF;
-    f.write(data, 4);
-    f.close();
-  }
+  uint8_t data[4];
+  data[0] = currentPage & 0xFF;
+  data[1] = (currentPage >> 8) & 0xFF;
+  data[2] = (currentPage >> 16) & 0xFF;
+  data[3] = (currentPage >> 24) & 0xFF;
+  STATE_STORE.put(StateStore::progressKey(xtc->getCachePath()), data, sizeof(data));
 }
 
 void XtcReaderActivity::loadProgress() {
-  FsFile f;
-  if (Storage.openFileForRead("XTR", xtc->getCachePath() + "/progress.bin", f)) {
-    uint8_t data[4];
-    if (f.read(data, 4) == 4) {
+  std::string progress;
+  if (STATE_STORE.get(StateStore::progressKey(xtc->getCachePath()), progress,
+                      xtc->getCachePath() + "/progress.bin")) {
+    const auto* data = reinterpret_cast<const uint8_t*>(progress.data());
+    if (progress.size() >= 4) {
       currentPage = data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24);
       LOG_DBG("XTR", "Loaded progress: page %lu", currentPage);
 
@@ -359,6 +374,5 @@ void XtcReaderActivity::loadProgress() {
         currentPage = 0;
       }
     }
-    f.close();
   }
 }
@@ -5,6 +5,7 @@
 #include <I18n.h>
 #include <Logging.h>
 
+#include "LibraryCatalog.h"
 #include "MappedInputManager.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
@@ -109,6 +110,7 @@ void ClearCacheActivity::clearCache() {
     }
   }
   root.close();
+  LIBRARY_CATALOG.clear();
 
   LOG_DBG("CLEAR_CACHE", "Cache cleared: %d removed, %d failed", clearedCount, failedCount);
 
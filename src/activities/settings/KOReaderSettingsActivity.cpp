@@ -5,6 +5,7 @@
 
 #include <cstring>
 
+#include "CoverJobQueue.h"
 #include "KOReaderAuthActivity.h"
 #include "KOReaderCredentialStore.h"
 #include "MappedInputManager.h"
@@ -13,9 +14,9 @@
 #include "fontIds.h"
 
 namespace {
-constexpr int MENU_ITEMS = 5;
-const StrId menuNames[MENU_ITEMS] = {StrId::STR_USERNAME, StrId::STR_PASSWORD, StrId::STR_SYNC_SERVER_URL,
-                                     StrId::STR_DOCUMENT_MATCHING, StrId::STR_AUTHENTICATE};
+constexpr int MENU_ITEMS = 6;
+const StrId menuNames[MENU_ITEMS] = {StrId::STR_USERNAME,          StrId::STR_PASSWORD,     StrId::STR_SYNC_SERVER_URL,
+                                     StrId::STR_DOCUMENT_MATCHING, StrId::STR_AUTHENTICATE, StrId::STR_HASH_LIBRARY};
 }  // namespace
 
 void KOReaderSettingsActivity::onEnter() {
@@ -130,6 +131,13 @@ void KOReaderSettingsActivity::handleSelection() {
       exitActivity();
       requestUpdate();
     }));
+  } else if (selectedIndex == 5) {
+    // Prepare Library - hash every EPUB in the background so the first sync of a book doesn't have to
+    if (KOREADER_STORE.getMatchMethod() != DocumentMatchMethod::BINARY) {
+      return;
+    }
+    COVER_JOBS.startHashSweep();
+    requestUpdate();
   }
 }
 
@@ -166,6 +174,12 @@ void KOReaderSettingsActivity::render(Activity::RenderLock&&) {
                "]";
     } else if (i == 4) {
       status = KOREADER_STORE.hasCredentials() ? "" : std::string("[") + tr(STR_SET_CREDENTIALS_FIRST) + "]";
+    } else if (i == 5) {
+      if (KOREADER_STORE.getMatchMethod() != DocumentMatchMethod::BINARY) {
+        status = std::string("[") + tr(STR_BINARY_MATCHING_ONLY) + "]";
+      } else if (COVER_JOBS.isHashSweepRunning()) {
+        status = std::string("[") + tr(STR_HASHING) + "]";
+      }
     }
 
     const auto width = renderer.getTextWidth(UI_10_FONT_ID, status.c_str());
@@ -1,104 +1,93 @@
 #include "AnkiDeck.h"
 
-#include <HalStorage.h>
 #include <Logging.h>
-#include <Serialization.h>
 #include <esp_random.h>
 
 #include <algorithm>
-#include <functional>
+#include <utility>
 
 #include "AnkiSessionManager.h"
-#include "CsvParser.h"
 
-constexpr const char* AnkiDeck::SM2_HEADERS[];
-
-AnkiDeck::AnkiDeck(std::string csvPath) : csvPath(std::move(csvPath)) {}
+AnkiDeck::AnkiDeck(std::string csvPath)
+    : csvPath(std::move(csvPath)), index(this->csvPath), journal(this->csvPath) {}
 
 bool AnkiDeck::load() {
-  std::vector<CsvRow> rows;
-  if (!CsvParser::parseFile(csvPath, rows)) {
+  hasCurrent = false;
+  if (!index.open()) {
     return false;
   }
-
-  if (rows.size() < 2) {
+  if (index.getCardCount() == 0) {
     LOG_ERR("ANK", "CSV has no data rows");
     return false;
   }
 
-  // Check if SM-2 columns already exist
-  const auto& header = rows[0];
-  bool hasSM2 = header.fields.size() >= TOTAL_COLS;
-
-  cards.clear();
-  cards.reserve(rows.size() - 1);
-
-  for (size_t i = 1; i < rows.size(); i++) {
-    auto& row = rows[i];
-    if (row.fields.size() < 2) continue;
-
-    FlashCard card;
-    card.front = row.fields[COL_FRONT];
-    card.back = row.fields[COL_BACK];
-
-    if (hasSM2 && row.fields.size() >= TOTAL_COLS) {
-      card.schedule.repetitions = static_cast<uint16_t>(atoi(row.fields[COL_REPS].c_str()));
-      card.schedule.easinessFactor = static_cast<uint16_t>(atoi(row.fields[COL_EF].c_str()));
-      card.schedule.interval = static_cast<uint32_t>(atol(row.fields[COL_INTERVAL].c_str()));
-      card.schedule.nextReviewSession = static_cast<uint32_t>(atol(row.fields[COL_NEXT_SESSION].c_str()));
+  // Grades made since the CSV was last written
+  journaled.clear();
+  const bool journalValid = journal.replay([this](const uint32_t cardIndex, const CardSchedule& schedule) {
+    if (cardIndex < index.getCardCount()) {
+      journaled[cardIndex] = schedule;
     }
-    // Otherwise schedule stays at defaults (new card)
-
-    cards.push_back(std::move(card));
-  }
+  });
 
   // If no SM-2 columns, write them now
-  if (!hasSM2) {
+  if (!index.csvHasSchedules()) {
     LOG_DBG("ANK", "Adding SM-2 columns on first load");
     save();
+  } else if (!journalValid) {
+    journal.reset();
   }
 
-  LOG_DBG("ANK", "Loaded %zu cards from %s (global session %u)", cards.size(), csvPath.c_str(),
-                ANKI_SESSION.getSession());
-  return !cards.empty();
+  LOG_DBG("ANK", "Loaded %u cards from %s (global session %u)", index.getCardCount(), csvPath.c_str(),
+          ANKI_SESSION.getSession());
+  return true;
+}
+
+CardSchedule AnkiDeck::scheduleFor(const uint32_t cardIndex, const CardSchedule& stored) const {
+  const auto it = journaled.find(cardIndex);
+  return it == journaled.end() ? stored : it->second;
 }
 
 bool AnkiDeck::save() {
-  std::vector<CsvRow> rows;
-  rows.reserve(cards.size() + 1);
-
-  // Header
-  CsvRow header;
-  header.fields = {"Front", "Back"};
-  for (const auto& h : SM2_HEADERS) {
-    header.fields.emplace_back(h);
+  if (!index.rewrite([this](const uint32_t cardIndex, const CardSchedule& stored) {
+        return scheduleFor(cardIndex, stored);
+      })) {
+    return false;
   }
-  rows.push_back(std::move(header));
-
-  // Data rows
-  for (const auto& card : cards) {
-    CsvRow row;
-    row.fields.resize(TOTAL_COLS);
-    row.fields[COL_FRONT] = card.front;
-    row.fields[COL_BACK] = card.back;
-    row.fields[COL_REPS] = std::to_string(card.schedule.repetitions);
-    row.fields[COL_EF] = std::to_string(card.schedule.easinessFactor);
-    row.fields[COL_INTERVAL] = std::to_string(card.schedule.interval);
-    row.fields[COL_NEXT_SESSION] = std::to_string(card.schedule.nextReviewSession);
-    rows.push_back(std::move(row));
+  // The CSV has every journaled grade now
+  journaled.clear();
+  return journal.reset();
+}
+
+bool AnkiDeck::compact() {
+  if (journal.getRecordCount() == 0) {
+    return true;
   }
+  LOG_DBG("ANK", "Compacting %u journaled grades into %s", journal.getRecordCount(), csvPath.c_str());
+  return save();
+}
+
+void AnkiDeck::loadCurrentCard() {
+  hasCurrent = false;
+  if (duePosition >= dueIndices.size()) return;
 
-  return CsvParser::writeFile(csvPath, rows);
+  const uint32_t cardIndex = dueIndices[duePosition];
+  CardSchedule stored;
+  if (!index.readCard(cardIndex, current.front, current.back, stored)) {
+    LOG_ERR("ANK", "Failed to read card %u of %s", cardIndex, csvPath.c_str());
+    return;
+  }
+  current.schedule = scheduleFor(cardIndex, stored);
+  hasCurrent = true;
 }
 
 void AnkiDeck::buildDueList() {
   const uint32_t session = ANKI_SESSION.getSession();
   dueIndices.clear();
-  for (size_t i = 0; i < cards.size(); i++) {
-    if (cards[i].schedule.nextReviewSession <= session) {
-      dueIndices.push_back(i);
+  index.forEachSchedule([this, session](const uint32_t cardIndex, const CardSchedule& stored) {
+    if (scheduleFor(cardIndex, stored).nextReviewSession <= session) {
+      dueIndices.push_back(cardIndex);
     }
-  }
+  });
 
   // Fisher-Yates shuffle
   for (size_t i = dueIndices.size(); i > 1; i--) {
@@ -107,48 +96,60 @@ void AnkiDeck::buildDueList() {
   }
 
   duePosition = 0;
+  loadCurrentCard();
   LOG_DBG("ANK", "Built due list: %zu cards due at session %u", dueIndices.size(), session);
 }
 
 void AnkiDeck::buildStudyAheadList() {
   const uint32_t session = ANKI_SESSION.getSession();
-  dueIndices.clear();
-  for (size_t i = 0; i < cards.size(); i++) {
-    if (cards[i].schedule.nextReviewSession > session) {
-      dueIndices.push_back(i);
+  // (next review session, card index)
+  std::vector<std::pair<uint32_t, uint32_t>> future;
+  index.forEachSchedule([this, session, &future](const uint32_t cardIndex, const CardSchedule& stored) {
+    const uint32_t nextSession = scheduleFor(cardIndex, stored).nextReviewSession;
+    if (nextSession > session) {
+      future.emplace_back(nextSession, cardIndex);
     }
-  }
+  });
 
   // Sort by nextReviewSession ascending (soonest due first)
-  std::sort(dueIndices.begin(), dueIndices.end(), [this](size_t a, size_t b) {
-    return cards[a].schedule.nextReviewSession < cards[b].schedule.nextReviewSession;
-  });
+  std::sort(future.begin(), future.end());
+  dueIndices.clear();
+  dueIndices.reserve(future.size());
+  for (const auto& card : future) {
+    dueIndices.push_back(card.second);
+  }
 
   duePosition = 0;
+  loadCurrentCard();
   LOG_DBG("ANK", "Built study-ahead list: %zu future cards at session %u", dueIndices.size(), session);
 }
 
 FlashCard* AnkiDeck::currentCard() {
-  if (duePosition >= dueIndices.size()) return nullptr;
-  return &cards[dueIndices[duePosition]];
+  if (!hasCurrent || duePosition >= dueIndices.size()) return nullptr;
+  return &current;
 }
 
 bool AnkiDeck::gradeCurrentCard(Grade grade) {
-  if (duePosition >= dueIndices.size()) return false;
+  if (!currentCard()) return false;
 
   const uint32_t session = ANKI_SESSION.getSession();
-  auto& card = cards[dueIndices[duePosition]];
-  card.schedule = SM2::review(card.schedule, grade, session);
+  const uint32_t cardIndex = dueIndices[duePosition];
+  current.schedule = SM2::review(current.schedule, grade, session);
+  journaled[cardIndex] = current.schedule;
 
   // If Again, re-queue this card at end of due list
   if (grade == Grade::Again) {
-    dueIndices.push_back(dueIndices[duePosition]);
+    dueIndices.push_back(cardIndex);
   }
 
   duePosition++;
-  save();
+  // One small append per grade; the CSV only catches up now and then
+  if (!journal.append(cardIndex, current.schedule) || journal.getRecordCount() >= MAX_JOURNAL_RECORDS) {
+    compact();
+  }
 
   ANKI_SESSION.onCardReviewed();
+  loadCurrentCard();
 
   return duePosition < dueIndices.size();
 }
@@ -158,33 +159,38 @@ uint32_t AnkiDeck::getCurrentSession() const {
 }
 
 size_t AnkiDeck::countDueCards(const std::string& csvPath) {
-  std::vector<CsvRow> rows;
-  if (!CsvParser::parseFile(csvPath, rows)) {
-    return 0;
-  }
-
-  if (rows.size() < 2) return 0;
-
-  // Check if SM-2 columns exist
-  const auto& header = rows[0];
-  bool hasSM2 = header.fields.size() >= TOTAL_COLS;
+  size_t totalCards = 0;
+  size_t dueCards = 0;
+  countCards(csvPath, totalCards, dueCards);
+  return dueCards;
+}
 
-  if (!hasSM2) {
+bool AnkiDeck::countCards(const std::string& csvPath, size_t& totalCards, size_t& dueCards) {
+  totalCards = 0;
+  dueCards = 0;
+  AnkiDeckIndex index(csvPath);
+  if (!index.open()) {
+    return false;
+  }
+  totalCards = index.getCardCount();
+  if (!index.csvHasSchedules()) {
     // All cards are new (due at session 0)
-    return rows.size() - 1;
+    dueCards = totalCards;
+    return true;
   }
 
+  std::map<uint32_t, uint32_t> journaled;
+  AnkiJournal(csvPath).replay([&journaled](const uint32_t cardIndex, const CardSchedule& schedule) {
+    journaled[cardIndex] = schedule.nextReviewSession;
+  });
+
   const uint32_t session = ANKI_SESSION.getSession();
-  size_t count = 0;
-  for (size_t i = 1; i < rows.size(); i++) {
-    if (rows[i].fields.size() >= TOTAL_COLS) {
-      uint32_t nextSession = static_cast<uint32_t>(atol(rows[i].fields[COL_NEXT_SESSION].c_str()));
-      if (nextSession <= session) {
-        count++;
-      }
+  return index.forEachSchedule([&](const uint32_t cardIndex, const CardSchedule& stored) {
+    const auto it = journaled.find(cardIndex);
+    if ((it == journaled.end() ? stored.nextReviewSession : it->second) <= session) {
+      dueCards++;
     }
-  }
-  return count;
+  });
 }
 
 std::string AnkiDeck::getTitle() const {
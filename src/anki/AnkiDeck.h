@@ -1,8 +1,11 @@
 #pragma once
 
+#include <map>
 #include <string>
 #include <vector>
 
+#include "AnkiDeckIndex.h"
+#include "AnkiJournal.h"
 #include "SM2.h"
 
 struct FlashCard {
@@ -13,26 +16,29 @@ struct FlashCard {
 
 class AnkiDeck {
   std::string csvPath;
-  std::vector<FlashCard> cards;
-  std::vector<size_t> dueIndices;
+  AnkiDeckIndex index;
+  AnkiJournal journal;
+  // Journaled schedules that the CSV and the sidecar don't have yet
+  std::map<uint32_t, CardSchedule> journaled;
+  std::vector<uint32_t> dueIndices;
   size_t duePosition = 0;
+  // Only the card under review is kept in memory
+  FlashCard current;
+  bool hasCurrent = false;
 
-  // Column indices in CSV
-  static constexpr int COL_FRONT = 0;
-  static constexpr int COL_BACK = 1;
-  static constexpr int COL_REPS = 2;
-  static constexpr int COL_EF = 3;
-  static constexpr int COL_INTERVAL = 4;
-  static constexpr int COL_NEXT_SESSION = 5;
-  static constexpr int TOTAL_COLS = 6;
+  // Grades are journaled; the CSV is rewritten once this many have piled up, or by compact()
+  static constexpr uint32_t MAX_JOURNAL_RECORDS = 200;
 
-  static constexpr const char* SM2_HEADERS[] = {"Repetitions", "EasinessFactor", "Interval", "NextReviewSession"};
+  CardSchedule scheduleFor(uint32_t cardIndex, const CardSchedule& stored) const;
+  void loadCurrentCard();
 
  public:
   explicit AnkiDeck(std::string csvPath);
 
   bool load();
   bool save();
+  // Writes journaled grades back into the CSV and empties the journal. Cheap if nothing was graded.
+  bool compact();
 
   // Build due list for current global session (shuffle included)
   void buildDueList();
@@ -46,13 +52,15 @@ class AnkiDeck {
   // Grade current card and advance. Returns true if more cards remain.
   bool gradeCurrentCard(Grade grade);
 
-  // Lightweight: parse CSV and count cards due at global session, without loading full deck
+  // Lightweight: count cards due at global session from the sidecar, without loading the deck
   static size_t countDueCards(const std::string& csvPath);
+  // Same, along with the number of cards in the deck
+  static bool countCards(const std::string& csvPath, size_t& totalCards, size_t& dueCards);
 
   uint32_t getCurrentSession() const;
   size_t getDueCount() const { return dueIndices.size(); }
   size_t getDuePosition() const { return duePosition; }
-  size_t getTotalCards() const { return cards.size(); }
+  size_t getTotalCards() const { return index.getCardCount(); }
   size_t getRemainingCount() const { return duePosition < dueIndices.size() ? dueIndices.size() - duePosition : 0; }
   const std::string& getPath() const { return csvPath; }
 
@@ -0,0 +1,321 @@
+#include "AnkiDeckIndex.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <cstring>
+
+#include "CsvParser.h"
+
+namespace {
+constexpr uint8_t INDEX_VERSION = 1;
+// version + CSV size + CSV mtime + card count + schedules flag
+constexpr size_t HEADER_SIZE = sizeof(uint8_t) + 3 * sizeof(uint32_t) + sizeof(uint8_t);
+// row offset + row length + repetitions + easiness factor + interval + next review session
+constexpr size_t RECORD_SIZE = 2 * sizeof(uint32_t) + 2 * sizeof(uint16_t) + 2 * sizeof(uint32_t);
+// A row longer than this is not a flashcard
+constexpr uint32_t MAX_ROW_LENGTH = 64 * 1024;
+
+// Column indices in CSV
+constexpr int COL_FRONT = 0;
+constexpr int COL_BACK = 1;
+constexpr int COL_REPS = 2;
+constexpr int COL_EF = 3;
+constexpr int COL_INTERVAL = 4;
+constexpr int COL_NEXT_SESSION = 5;
+constexpr int TOTAL_COLS = 6;
+
+constexpr const char* CSV_HEADERS[] = {"Front", "Back", "Repetitions", "EasinessFactor", "Interval",
+                                       "NextReviewSession"};
+
+struct CardRecord {
+  uint32_t rowOffset = 0;
+  uint32_t rowLength = 0;
+  CardSchedule schedule;
+};
+
+void encodeRecord(const CardRecord& record, uint8_t* data) {
+  memcpy(data, &record.rowOffset, 4);
+  memcpy(data + 4, &record.rowLength, 4);
+  memcpy(data + 8, &record.schedule.repetitions, 2);
+  memcpy(data + 10, &record.schedule.easinessFactor, 2);
+  memcpy(data + 12, &record.schedule.interval, 4);
+  memcpy(data + 16, &record.schedule.nextReviewSession, 4);
+}
+
+void decodeRecord(const uint8_t* data, CardRecord& record) {
+  memcpy(&record.rowOffset, data, 4);
+  memcpy(&record.rowLength, data + 4, 4);
+  memcpy(&record.schedule.repetitions, data + 8, 2);
+  memcpy(&record.schedule.easinessFactor, data + 10, 2);
+  memcpy(&record.schedule.interval, data + 12, 4);
+  memcpy(&record.schedule.nextReviewSession, data + 16, 4);
+}
+
+bool writeRecord(FsFile& file, const CardRecord& record) {
+  uint8_t data[RECORD_SIZE];
+  encodeRecord(record, data);
+  return file.write(data, RECORD_SIZE) == RECORD_SIZE;
+}
+
+void writeHeader(FsFile& file, const uint8_t version, const uint32_t csvSize, const uint32_t csvModified,
+                 const uint32_t cardCount, const bool hasSchedules) {
+  file.seek(0);
+  serialization::writePod(file, version);
+  serialization::writePod(file, csvSize);
+  serialization::writePod(file, csvModified);
+  serialization::writePod(file, cardCount);
+  serialization::writePod(file, static_cast<uint8_t>(hasSchedules));
+}
+
+bool readRow(FsFile& csv, const CardRecord& record, CsvRow& row) {
+  if (record.rowLength > MAX_ROW_LENGTH || !csv.seek(record.rowOffset)) {
+    return false;
+  }
+  std::string line(record.rowLength, '\0');
+  if (record.rowLength > 0 && csv.read(&line[0], record.rowLength) != static_cast<int>(record.rowLength)) {
+    return false;
+  }
+  row = CsvParser::parseLine(line.data(), line.size());
+  return row.fields.size() >= 2;
+}
+
+// Replaces `path` by `tmpPath`
+bool replaceFile(const std::string& tmpPath, const std::string& path) {
+  Storage.remove(path.c_str());
+  FsFile tmp = Storage.open(tmpPath.c_str(), O_RDWR);
+  if (!tmp) {
+    return false;
+  }
+  const bool ok = tmp.rename(path.c_str());
+  tmp.close();
+  return ok;
+}
+}  // namespace
+
+AnkiDeckIndex::AnkiDeckIndex(const std::string& csvPath)
+    : path("/.ankix/deck_" + std::to_string(std::hash<std::string>{}(csvPath)) + ".idx"), csvPath(csvPath) {}
+
+bool AnkiDeckIndex::open() {
+  uint32_t csvSize = 0;
+  uint32_t csvModified = 0;
+  if (!CsvParser::getFileStamp(csvPath, csvSize, csvModified)) {
+    return false;
+  }
+
+  FsFile file;
+  if (Storage.exists(path.c_str()) && Storage.openFileForRead("ANK", path, file)) {
+    uint8_t version = 0;
+    uint32_t size = 0;
+    uint32_t modified = 0;
+    uint8_t schedules = 0;
+    serialization::readPod(file, version);
+    serialization::readPod(file, size);
+    serialization::readPod(file, modified);
+    serialization::readPod(file, cardCount);
+    serialization::readPod(file, schedules);
+    const bool current = version == INDEX_VERSION && size == csvSize && modified == csvModified &&
+                         file.size() == HEADER_SIZE + cardCount * RECORD_SIZE;
+    file.close();
+    if (current) {
+      hasSchedules = schedules != 0;
+      return true;
+    }
+  }
+  return build();
+}
+
+bool AnkiDeckIndex::build() {
+  cardCount = 0;
+  hasSchedules = false;
+  uint32_t csvSize = 0;
+  uint32_t csvModified = 0;
+  if (!CsvParser::getFileStamp(csvPath, csvSize, csvModified)) {
+    return false;
+  }
+  if (!Storage.exists("/.ankix")) {
+    Storage.mkdir("/.ankix");
+  }
+  FsFile file;
+  if (!Storage.openFileForWrite("ANK", path, file)) {
+    return false;
+  }
+
+  // Version 0 until the last record is written, so an interrupted build is redone
+  writeHeader(file, 0, 0, 0, 0, false);
+  bool headerRow = true;
+  bool ok = true;
+  const bool scanned = CsvParser::scanFile(csvPath, [&](const uint32_t offset, const std::string& line) {
+    const CsvRow row = CsvParser::parseLine(line.data(), line.size());
+    if (headerRow) {
+      // SM-2 columns already exist if the header has them
+      hasSchedules = row.fields.size() >= TOTAL_COLS;
+      headerRow = false;
+      return true;
+    }
+    if (row.fields.size() < 2) return true;
+
+    CardRecord record;
+    record.rowOffset = offset;
+    record.rowLength = line.size();
+    if (hasSchedules && row.fields.size() >= TOTAL_COLS) {
+      record.schedule.repetitions = static_cast<uint16_t>(atoi(row.fields[COL_REPS].c_str()));
+      record.schedule.easinessFactor = static_cast<uint16_t>(atoi(row.fields[COL_EF].c_str()));
+      record.schedule.interval = static_cast<uint32_t>(atol(row.fields[COL_INTERVAL].c_str()));
+      record.schedule.nextReviewSession = static_cast<uint32_t>(atol(row.fields[COL_NEXT_SESSION].c_str()));
+    }
+    // Otherwise schedule stays at defaults (new card)
+    ok = writeRecord(file, record);
+    cardCount++;
+    return ok;
+  });
+  ok = ok && scanned;
+  if (ok) {
+    writeHeader(file, INDEX_VERSION, csvSize, csvModified, cardCount, hasSchedules);
+  }
+  file.close();
+  if (!ok) {
+    LOG_ERR("ANK", "Failed to index %s", csvPath.c_str());
+    Storage.remove(path.c_str());
+    cardCount = 0;
+    return false;
+  }
+  LOG_DBG("ANK", "Indexed %u cards of %s", cardCount, csvPath.c_str());
+  return true;
+}
+
+bool AnkiDeckIndex::forEachSchedule(
+    const std::function<void(uint32_t cardIndex, const CardSchedule& schedule)>& onCard) const {
+  FsFile file;
+  if (!Storage.openFileForRead("ANK", path, file) || !file.seek(HEADER_SIZE)) {
+    return false;
+  }
+  uint8_t buffer[RECORD_SIZE * 32];
+  uint32_t index = 0;
+  bool ok = true;
+  while (ok && index < cardCount) {
+    const uint32_t batch = std::min<uint32_t>(cardCount - index, sizeof(buffer) / RECORD_SIZE);
+    const int bytes = static_cast<int>(batch * RECORD_SIZE);
+    ok = file.read(buffer, bytes) == bytes;
+    for (uint32_t i = 0; ok && i < batch; i++, index++) {
+      CardRecord record;
+      decodeRecord(buffer + i * RECORD_SIZE, record);
+      onCard(index, record.schedule);
+    }
+  }
+  file.close();
+  return ok;
+}
+
+bool AnkiDeckIndex::readCard(const uint32_t cardIndex, std::string& front, std::string& back,
+                             CardSchedule& schedule) const {
+  if (cardIndex >= cardCount) {
+    return false;
+  }
+  FsFile file;
+  if (!Storage.openFileForRead("ANK", path, file)) {
+    return false;
+  }
+  uint8_t data[RECORD_SIZE];
+  const bool found =
+      file.seek(HEADER_SIZE + cardIndex * RECORD_SIZE) && file.read(data, RECORD_SIZE) == RECORD_SIZE;
+  file.close();
+  if (!found) {
+    return false;
+  }
+  CardRecord record;
+  decodeRecord(data, record);
+
+  FsFile csv;
+  if (!Storage.openFileForRead("ANK", csvPath, csv)) {
+    return false;
+  }
+  CsvRow row;
+  const bool ok = readRow(csv, record, row);
+  csv.close();
+  if (!ok) {
+    return false;
+  }
+  front = std::move(row.fields[COL_FRONT]);
+  back = std::move(row.fields[COL_BACK]);
+  schedule = record.schedule;
+  return true;
+}
+
+bool AnkiDeckIndex::rewrite(
+    const std::function<CardSchedule(uint32_t cardIndex, const CardSchedule& stored)>& scheduleFor) {
+  const std::string tmpCsvPath = csvPath + ".tmp";
+  const std::string tmpPath = path + ".tmp";
+  FsFile index;
+  FsFile csv;
+  FsFile outCsv;
+  FsFile outIndex;
+  bool ok = Storage.openFileForRead("ANK", path, index) && index.seek(HEADER_SIZE) &&
+            Storage.openFileForRead("ANK", csvPath, csv) && Storage.openFileForWrite("ANK", tmpCsvPath, outCsv) &&
+            Storage.openFileForWrite("ANK", tmpPath, outIndex);
+
+  // Header
+  CsvRow header;
+  for (const auto& h : CSV_HEADERS) {
+    header.fields.emplace_back(h);
+  }
+  std::string line = CsvParser::serializeLine(header) + "\n";
+  uint32_t position = 0;
+  if (ok) {
+    writeHeader(outIndex, 0, 0, 0, 0, false);
+    ok = outCsv.write(reinterpret_cast<const uint8_t*>(line.data()), line.size()) == line.size();
+    position = line.size();
+  }
+
+  // Data rows, with the sidecar following along
+  CsvRow row;
+  row.fields.resize(TOTAL_COLS);
+  for (uint32_t i = 0; ok && i < cardCount; i++) {
+    uint8_t data[RECORD_SIZE];
+    CardRecord record;
+    CsvRow source;
+    ok = index.read(data, RECORD_SIZE) == RECORD_SIZE;
+    if (ok) {
+      decodeRecord(data, record);
+      ok = readRow(csv, record, source);
+    }
+    if (!ok) break;
+
+    record.schedule = scheduleFor(i, record.schedule);
+    row.fields[COL_FRONT] = std::move(source.fields[COL_FRONT]);
+    row.fields[COL_BACK] = std::move(source.fields[COL_BACK]);
+    row.fields[COL_REPS] = std::to_string(record.schedule.repetitions);
+    row.fields[COL_EF] = std::to_string(record.schedule.easinessFactor);
+    row.fields[COL_INTERVAL] = std::to_string(record.schedule.interval);
+    row.fields[COL_NEXT_SESSION] = std::to_string(record.schedule.nextReviewSession);
+    line = CsvParser::serializeLine(row);
+    record.rowOffset = position;
+    record.rowLength = line.size();
+    line += '\n';
+    ok = outCsv.write(reinterpret_cast<const uint8_t*>(line.data()), line.size()) == line.size() &&
+         writeRecord(outIndex, record);
+    position += line.size();
+  }
+  index.close();
+  csv.close();
+  outCsv.close();
+
+  uint32_t csvSize = 0;
+  uint32_t csvModified = 0;
+  ok = ok && replaceFile(tmpCsvPath, csvPath) && CsvParser::getFileStamp(csvPath, csvSize, csvModified);
+  if (ok) {
+    writeHeader(outIndex, INDEX_VERSION, csvSize, csvModified, cardCount, true);
+  }
+  outIndex.close();
+  ok = ok && replaceFile(tmpPath, path);
+  if (!ok) {
+    LOG_ERR("ANK", "Failed to rewrite %s", csvPath.c_str());
+    Storage.remove(tmpCsvPath.c_str());
+    Storage.remove(tmpPath.c_str());
+    return false;
+  }
+  hasSchedules = true;
+  LOG_DBG("ANK", "Wrote %u cards to %s", cardCount, csvPath.c_str());
+  return true;
+}
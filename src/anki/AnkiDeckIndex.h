@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "SM2.h"
+
+// Binary sidecar of a deck's CSV in /.ankix: every card's schedule and where its row is in the CSV, so due lists and
+// due counts come from 20 bytes per card and card text is read one row at a time when it is shown. The sidecar
+// remembers the size and mtime of the CSV it was built from and is rebuilt, streaming through the CSV once, when
+// either has changed.
+class AnkiDeckIndex {
+  std::string path;
+  std::string csvPath;
+  uint32_t cardCount = 0;
+  bool hasSchedules = false;
+
+  bool build();
+
+ public:
+  explicit AnkiDeckIndex(const std::string& csvPath);
+
+  // Checks the sidecar against the CSV and rebuilds it if needed. False if the CSV can't be read.
+  bool open();
+
+  uint32_t getCardCount() const { return cardCount; }
+  // False if the CSV has no SM-2 columns yet (all cards are new)
+  bool csvHasSchedules() const { return hasSchedules; }
+
+  // Streams the stored schedule of every card in CSV order
+  bool forEachSchedule(const std::function<void(uint32_t cardIndex, const CardSchedule& schedule)>& onCard) const;
+
+  // Reads one card's front and back from the CSV, and its stored schedule
+  bool readCard(uint32_t cardIndex, std::string& front, std::string& back, CardSchedule& schedule) const;
+
+  // Rewrites the CSV with SM-2 columns holding `scheduleFor(index, stored)` for every card, and the sidecar with it,
+  // in one pass through both files.
+  bool rewrite(const std::function<CardSchedule(uint32_t cardIndex, const CardSchedule& stored)>& scheduleFor);
+};
@@ -0,0 +1,100 @@
+#include "AnkiJournal.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include "CsvParser.h"
+
+namespace {
+constexpr uint8_t JOURNAL_VERSION = 1;
+// version + CSV size + CSV mtime
+constexpr size_t HEADER_SIZE = sizeof(uint8_t) + 2 * sizeof(uint32_t);
+
+// card index + repetitions + easiness factor + interval + next review session
+constexpr size_t RECORD_SIZE = sizeof(uint32_t) + 2 * sizeof(uint16_t) + 2 * sizeof(uint32_t);
+}  // namespace
+
+AnkiJournal::AnkiJournal(const std::string& csvPath)
+    : path("/.ankix/journal_" + std::to_string(std::hash<std::string>{}(csvPath)) + ".bin"), csvPath(csvPath) {}
+
+bool AnkiJournal::replay(const std::function<void(uint32_t cardIndex, const CardSchedule& schedule)>& onRecord) {
+  recordCount = 0;
+  uint32_t csvSize = 0;
+  uint32_t csvModified = 0;
+  FsFile file;
+  if (!CsvParser::getFileStamp(csvPath, csvSize, csvModified) || !Storage.exists(path.c_str()) ||
+      !Storage.openFileForRead("ANK", path, file)) {
+    return false;
+  }
+
+  uint8_t version = 0;
+  uint32_t size = 0;
+  uint32_t modified = 0;
+  serialization::readPod(file, version);
+  serialization::readPod(file, size);
+  serialization::readPod(file, modified);
+  if (version != JOURNAL_VERSION || size != csvSize || modified != csvModified) {
+    LOG_DBG("ANK", "Journal %s is for another version of %s, ignoring it", path.c_str(), csvPath.c_str());
+    file.close();
+    return false;
+  }
+
+  // A record cut short by a power loss is the last one and is dropped
+  while (file.available() >= static_cast<int>(RECORD_SIZE)) {
+    uint32_t cardIndex = 0;
+    CardSchedule schedule;
+    serialization::readPod(file, cardIndex);
+    serialization::readPod(file, schedule.repetitions);
+    serialization::readPod(file, schedule.easinessFactor);
+    serialization::readPod(file, schedule.interval);
+    serialization::readPod(file, schedule.nextReviewSession);
+    onRecord(cardIndex, schedule);
+    recordCount++;
+  }
+  file.close();
+  return true;
+}
+
+bool AnkiJournal::append(const uint32_t cardIndex, const CardSchedule& schedule) {
+  FsFile file = Storage.open(path.c_str(), O_WRONLY | O_APPEND);
+  if (!file) {
+    LOG_ERR("ANK", "Failed to open journal %s", path.c_str());
+    return false;
+  }
+
+  // Drop the tail of a record a power loss cut short, so the new one starts on a record boundary
+  uint32_t start = file.size();
+  const uint32_t aligned = start < HEADER_SIZE ? start : start - (start - HEADER_SIZE) % RECORD_SIZE;
+  if (aligned != start && file.truncate(aligned)) {
+    start = aligned;
+  }
+  serialization::writePod(file, cardIndex);
+  serialization::writePod(file, schedule.repetitions);
+  serialization::writePod(file, schedule.easinessFactor);
+  serialization::writePod(file, schedule.interval);
+  serialization::writePod(file, schedule.nextReviewSession);
+  const bool ok = file.size() == start + RECORD_SIZE;
+  file.close();
+  if (ok) {
+    recordCount++;
+  }
+  return ok;
+}
+
+bool AnkiJournal::reset() {
+  recordCount = 0;
+  uint32_t csvSize = 0;
+  uint32_t csvModified = 0;
+  FsFile file;
+  if (!CsvParser::getFileStamp(csvPath, csvSize, csvModified) || !Storage.openFileForWrite("ANK", path, file)) {
+    Storage.remove(path.c_str());
+    return false;
+  }
+  serialization::writePod(file, JOURNAL_VERSION);
+  serialization::writePod(file, csvSize);
+  serialization::writePod(file, csvModified);
+  const bool ok = file.size() == HEADER_SIZE;
+  file.close();
+  return ok;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "SM2.h"
+
+// Schedule changes of one deck since its CSV was last written, kept in /.ankix as fixed-size records so grading a
+// card costs one small append instead of a rewrite of the whole CSV. The journal remembers the size and mtime of the
+// CSV it applies to; if the CSV was changed elsewhere the journal no longer matches and is ignored. Records hold the
+// card's complete new schedule, so replaying them over a CSV that already contains them changes nothing.
+class AnkiJournal {
+  std::string path;
+  std::string csvPath;
+  uint32_t recordCount = 0;
+
+ public:
+  explicit AnkiJournal(const std::string& csvPath);
+
+  // Calls onRecord for every change in the order they were made. Returns false if there is no journal for the CSV as
+  // it is now, in which case nothing is replayed and reset() should be called before appending.
+  bool replay(const std::function<void(uint32_t cardIndex, const CardSchedule& schedule)>& onRecord);
+
+  bool append(uint32_t cardIndex, const CardSchedule& schedule);
+
+  // Starts an empty journal for the CSV as it is on the card now, e.g. right after it has been rewritten
+  bool reset();
+
+  uint32_t getRecordCount() const { return recordCount; }
+};
@@ -143,6 +143,68 @@ bool CsvParser::parseFile(const std::string& path, std::vector<CsvRow>& rows) {
   return !rows.empty();
 }
 
+bool CsvParser::scanFile(const std::string& path,
+                         const std::function<bool(uint32_t offset, const std::string& line)>& onLine) {
+  FsFile file;
+  if (!Storage.openFileForRead("CSV", path, file)) {
+    LOG_ERR("CSV", "Failed to open: %s", path.c_str());
+    return false;
+  }
+
+  // Same line splitting as parseFile(), one buffer at a time
+  char buf[512];
+  std::string line;
+  uint32_t lineStart = 0;
+  uint32_t pos = 0;
+  bool inLine = false;
+  bool inQuotes = false;
+  bool stopped = false;
+  const auto endLine = [&]() {
+    inLine = false;
+    // Strip trailing CR
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (!line.empty() && !onLine(lineStart, line)) stopped = true;
+  };
+
+  int bytesRead;
+  while (!stopped && (bytesRead = file.read(buf, sizeof(buf))) > 0) {
+    for (int i = 0; i < bytesRead && !stopped; i++, pos++) {
+      const char c = buf[i];
+      if (!inLine) {
+        // Skip empty lines
+        if (c == '\r' || c == '\n') continue;
+        inLine = true;
+        inQuotes = false;
+        lineStart = pos;
+        line.clear();
+      }
+      if (c == '"') {
+        inQuotes = !inQuotes;
+      } else if (!inQuotes && c == '\n') {
+        endLine();
+        continue;
+      }
+      line += c;
+    }
+  }
+  if (inLine && !stopped) endLine();
+  file.close();
+  return true;
+}
+
+bool CsvParser::getFileStamp(const std::string& path, uint32_t& size, uint32_t& modified) {
+  FsFile file;
+  if (!Storage.openFileForRead("CSV", path, file)) {
+    return false;
+  }
+  size = file.size();
+  uint16_t date = 0;
+  uint16_t time = 0;
+  modified = file.getModifyDateTime(&date, &time) ? (static_cast<uint32_t>(date) << 16) | time : 0;
+  file.close();
+  return true;
+}
+
 bool CsvParser::writeFile(const std::string& path, const std::vector<CsvRow>& rows) {
   // Write to temp file first, then replace
   std::string tmpPath = path + ".tmp";
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -15,6 +17,14 @@ class CsvParser {
   // Write rows back to CSV. Uses temp file + rename for crash safety.
   static bool writeFile(const std::string& path, const std::vector<CsvRow>& rows);
 
+  // Stream the non-empty logical lines of a CSV (quoted line breaks included) without loading the file, with the byte
+  // offset and length of each line in the file, line break excluded. onLine can return false to stop.
+  static bool scanFile(const std::string& path,
+                       const std::function<bool(uint32_t offset, const std::string& line)>& onLine);
+
+  // Size and FAT date << 16 | time of a file, which tie caches derived from a CSV to one version of it.
+  static bool getFileStamp(const std::string& path, uint32_t& size, uint32_t& modified);
+
   // Parse a single CSV line respecting RFC 4180 quoting.
   static CsvRow parseLine(const char* data, size_t len);
 
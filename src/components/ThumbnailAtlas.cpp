@@ -0,0 +1,364 @@
+#include "ThumbnailAtlas.h"
+
+#include <Bitmap.h>
+#include <GfxRenderer.h>
+#include <Logging.h>
+#include <Serialization.h>
+#include <ZipFile.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "components/UITheme.h"
+
+namespace {
+constexpr uint8_t ATLAS_FILE_VERSION = 1;
+constexpr char ATLAS_DIR[] = "/.crosspoint";
+constexpr char ATLAS_PREFIX[] = "thumbs_";
+constexpr char ATLAS_SUFFIX[] = ".atlas";
+constexpr char ATLAS_TMP_SUFFIX[] = ".tmp";
+// Rows left behind by replaced or removed covers are reclaimed once they exceed this and outweigh the live rows
+constexpr uint32_t COMPACT_MIN_DEAD_BYTES = 16 * 1024;
+// version + reserved + height + data end
+constexpr uint32_t HEADER_SIZE = 2 * sizeof(uint8_t) + sizeof(uint16_t) + sizeof(uint32_t);
+constexpr uint32_t DATA_START = HEADER_SIZE + ThumbnailAtlas::kMaxEntries * 16;
+// Rows are read in chunks of this size; also caps the supported thumbnail width at 4096 pixels.
+constexpr size_t READ_CHUNK = 512;
+
+std::string atlasPath(const int height) {
+  return std::string(ATLAS_DIR) + "/" + ATLAS_PREFIX + std::to_string(height) + ATLAS_SUFFIX;
+}
+
+uint64_t keyFor(const std::string& bookPath) {
+  const uint64_t key = ZipFile::fnvHash64(bookPath.c_str(), bookPath.size());
+  return key == 0 ? 1 : key;  // 0 marks an empty slot
+}
+
+uint32_t slotBytes(const uint16_t width, const uint16_t height) { return ((width + 7) / 8) * height; }
+}  // namespace
+
+ThumbnailAtlas::ThumbnailAtlas(const int height) : height(height), path(atlasPath(height)) {}
+
+ThumbnailAtlas::~ThumbnailAtlas() {
+  if (file) {
+    file.close();
+  }
+}
+
+bool ThumbnailAtlas::load() {
+  if (loaded) {
+    return valid;
+  }
+  loaded = true;
+  memset(slots, 0, sizeof(slots));
+  dataEnd = DATA_START;
+
+  if (!Storage.exists(path.c_str()) || !Storage.openFileForRead("ATL", path, file)) {
+    return false;
+  }
+
+  uint8_t version = 0;
+  uint8_t reserved = 0;
+  uint16_t fileHeight = 0;
+  serialization::readPod(file, version);
+  serialization::readPod(file, reserved);
+  serialization::readPod(file, fileHeight);
+  serialization::readPod(file, dataEnd);
+  const bool ok = version == ATLAS_FILE_VERSION && fileHeight == height && dataEnd >= DATA_START &&
+                  dataEnd <= file.size() &&
+                  file.read(reinterpret_cast<uint8_t*>(slots), sizeof(slots)) == static_cast<int>(sizeof(slots));
+  if (!ok) {
+    LOG_DBG("ATL", "Ignoring unreadable atlas %s", path.c_str());
+    memset(slots, 0, sizeof(slots));
+    dataEnd = DATA_START;
+    file.close();
+    return false;
+  }
+  valid = true;
+  return true;
+}
+
+ThumbnailAtlas::Slot* ThumbnailAtlas::findSlot(const uint64_t key) {
+  for (auto& slot : slots) {
+    if (slot.key == key) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+bool ThumbnailAtlas::contains(const std::string& bookPath) { return load() && findSlot(keyFor(bookPath)); }
+
+ThumbnailAtlas::DrawResult ThumbnailAtlas::draw(const GfxRenderer& renderer, const std::string& bookPath, const int x,
+                                                const int y, const int maxWidth, const int maxHeight) {
+  if (!load()) {
+    return DrawResult::NotCached;
+  }
+  const Slot* slot = findSlot(keyFor(bookPath));
+  if (!slot) {
+    return DrawResult::NotCached;
+  }
+  if (slot->width == 0) {
+    return DrawResult::NoCover;
+  }
+  if (!file && !Storage.openFileForRead("ATL", path, file)) {
+    return DrawResult::NotCached;
+  }
+
+  const int rowBytes = (slot->width + 7) / 8;
+  const int drawWidth = std::min<int>(slot->width, maxWidth);
+  const int drawHeight = std::min<int>(slot->height, maxHeight);
+  const int srcX = (slot->width - drawWidth) / 2;
+  const int srcY = (slot->height - drawHeight) / 2;
+  const int dstX = x + (maxWidth - drawWidth) / 2;
+  const int dstY = y + (maxHeight - drawHeight) / 2;
+  const int rowsPerChunk = static_cast<int>(READ_CHUNK) / rowBytes;
+  if (rowsPerChunk == 0 || !file.seek(slot->offset + srcY * rowBytes)) {
+    return DrawResult::NotCached;
+  }
+
+  uint8_t buffer[READ_CHUNK];
+  for (int row = 0; row < drawHeight;) {
+    const int rows = std::min(rowsPerChunk, drawHeight - row);
+    if (file.read(buffer, rows * rowBytes) != rows * rowBytes) {
+      LOG_ERR("ATL", "Short read in %s", path.c_str());
+      break;
+    }
+    for (int r = 0; r < rows; r++, row++) {
+      const uint8_t* bits = buffer + r * rowBytes;
+      for (int col = 0; col < drawWidth; col++) {
+        const int bx = srcX + col;
+        // Whole white bytes are the common case on covers; skip them without touching the frame buffer
+        if ((bx & 7) == 0 && bits[bx >> 3] == 0xFF) {
+          col += 7;
+          continue;
+        }
+        if (!(bits[bx >> 3] & (0x80 >> (bx & 7)))) {
+          renderer.drawPixel(dstX + col, dstY + row, true);
+        }
+      }
+    }
+  }
+  return DrawResult::Drawn;
+}
+
+bool ThumbnailAtlas::openForWrite() {
+  const bool wasValid = load();
+  if (file) {
+    file.close();
+  }
+  Storage.mkdir(ATLAS_DIR);
+  file = Storage.open(path.c_str(), O_RDWR | O_CREAT);
+  if (!file) {
+    LOG_ERR("ATL", "Failed to open %s for write", path.c_str());
+    return false;
+  }
+  valid = wasValid;
+  if (!valid) {
+    file.truncate(0);
+    memset(slots, 0, sizeof(slots));
+    dataEnd = DATA_START;
+    valid = writeIndex(file);
+  }
+  return valid;
+}
+
+bool ThumbnailAtlas::writeIndex(FsFile& target) const {
+  target.seek(0);
+  serialization::writePod(target, ATLAS_FILE_VERSION);
+  serialization::writePod(target, static_cast<uint8_t>(0));
+  serialization::writePod(target, static_cast<uint16_t>(height));
+  serialization::writePod(target, dataEnd);
+  return target.write(reinterpret_cast<const uint8_t*>(slots), sizeof(slots)) == sizeof(slots);
+}
+
+void ThumbnailAtlas::compactIfSparse() {
+  uint32_t liveBytes = 0;
+  for (const auto& slot : slots) {
+    if (slot.key != 0) {
+      liveBytes += slotBytes(slot.width, slot.height);
+    }
+  }
+  const uint32_t deadBytes = dataEnd - DATA_START > liveBytes ? dataEnd - DATA_START - liveBytes : 0;
+  if (deadBytes <= COMPACT_MIN_DEAD_BYTES || deadBytes <= liveBytes) {
+    return;
+  }
+
+  // Copy the live rows into a fresh file and swap it in; an interrupted compaction leaves the old atlas untouched.
+  const std::string tmpPath = path + ATLAS_TMP_SUFFIX;
+  FsFile target;
+  if (!Storage.openFileForWrite("ATL", tmpPath, target)) {
+    return;
+  }
+  Slot packed[kMaxEntries];
+  memcpy(packed, slots, sizeof(slots));
+  uint32_t packedEnd = DATA_START;
+  uint8_t buffer[READ_CHUNK];
+  bool ok = target.seek(DATA_START);
+  for (auto& slot : packed) {
+    if (!ok || slot.key == 0 || slot.width == 0) {
+      continue;
+    }
+    uint32_t remaining = slotBytes(slot.width, slot.height);
+    ok = file.seek(slot.offset);
+    slot.offset = packedEnd;
+    packedEnd += remaining;
+    while (ok && remaining > 0) {
+      const int chunk = file.read(buffer, std::min<uint32_t>(remaining, sizeof(buffer)));
+      ok = chunk > 0 && target.write(buffer, chunk) == static_cast<size_t>(chunk);
+      remaining -= ok ? chunk : 0;
+    }
+  }
+  if (!ok) {
+    LOG_ERR("ATL", "Compaction of %s failed", path.c_str());
+    target.close();
+    Storage.remove(tmpPath.c_str());
+    return;
+  }
+
+  const uint32_t oldEnd = dataEnd;
+  memcpy(slots, packed, sizeof(slots));
+  dataEnd = packedEnd;
+  ok = writeIndex(target);
+  target.close();
+  file.close();
+  if (ok) {
+    Storage.remove(path.c_str());
+    FsFile tmpFile = Storage.open(tmpPath.c_str(), O_RDWR);
+    ok = tmpFile && tmpFile.rename(path.c_str());
+    if (tmpFile) tmpFile.close();
+  }
+  if (!ok) {
+    // The old atlas may already be gone; start over on the next import
+    LOG_ERR("ATL", "Failed to replace %s after compaction", path.c_str());
+    Storage.remove(tmpPath.c_str());
+    loaded = false;
+    valid = false;
+    return;
+  }
+  file = Storage.open(path.c_str(), O_RDWR);
+  LOG_DBG("ATL", "Compacted %s from %u to %u bytes", path.c_str(), static_cast<unsigned>(oldEnd),
+          static_cast<unsigned>(dataEnd));
+}
+
+ThumbnailAtlas::Slot* ThumbnailAtlas::claimSlot(const uint64_t key) {
+  if (Slot* slot = findSlot(key)) {
+    return slot;
+  }
+  if (Slot* slot = findSlot(0)) {
+    return slot;
+  }
+  // Full: start over. Every entry can be re-imported from its BMP, so this only costs background work.
+  LOG_DBG("ATL", "Atlas %s full, resetting", path.c_str());
+  memset(slots, 0, sizeof(slots));
+  dataEnd = DATA_START;
+  file.truncate(DATA_START);
+  return &slots[0];
+}
+
+bool ThumbnailAtlas::addEmpty(const std::string& bookPath) {
+  if (!openForWrite()) {
+    return false;
+  }
+  Slot* slot = claimSlot(keyFor(bookPath));
+  *slot = Slot{keyFor(bookPath), 0, 0, 0};
+  const bool ok = writeIndex(file);
+  if (ok) {
+    compactIfSparse();
+  }
+  file.close();
+  return ok;
+}
+
+bool ThumbnailAtlas::addFromBmp(const std::string& bookPath, const std::string& bmpPath) {
+  FsFile bmpFile;
+  if (!Storage.openFileForRead("ATL", bmpPath, bmpFile)) {
+    return addEmpty(bookPath);
+  }
+  Bitmap bitmap(bmpFile);
+  const int width = bitmap.parseHeaders() == BmpReaderError::Ok ? bitmap.getWidth() : 0;
+  const int bmpHeight = width > 0 ? bitmap.getHeight() : 0;
+  const int rowBytes = (width + 7) / 8;
+  if (width <= 0 || bmpHeight <= 0 || bmpHeight > UINT16_MAX || rowBytes > static_cast<int>(READ_CHUNK)) {
+    bmpFile.close();
+    return addEmpty(bookPath);
+  }
+
+  auto* outputRow = static_cast<uint8_t*>(malloc((width + 3) / 4));
+  auto* rowBuffer = static_cast<uint8_t*>(malloc(bitmap.getRowBytes()));
+  uint8_t packed[READ_CHUNK];
+  if (!outputRow || !rowBuffer || !openForWrite()) {
+    free(outputRow);
+    free(rowBuffer);
+    bmpFile.close();
+    return false;
+  }
+
+  const uint64_t key = keyFor(bookPath);
+  Slot* slot = claimSlot(key);
+  // A re-imported cover that fits where the previous one was overwrites it rather than growing the file. The slot is
+  // dropped from the index first so an interrupted write never shows a mix of the two.
+  const bool reuse =
+      slot->key == key && slot->width != 0 && slotBytes(slot->width, slot->height) >= slotBytes(width, bmpHeight);
+  const uint32_t offset = reuse ? slot->offset : dataEnd;
+  bool ok = true;
+  if (reuse) {
+    *slot = Slot{};
+    ok = writeIndex(file);
+  }
+  for (int bmpY = 0; bmpY < bmpHeight && ok; bmpY++) {
+    if (bitmap.readNextRow(outputRow, rowBuffer) != BmpReaderError::Ok) {
+      ok = false;
+      break;
+    }
+    // Same threshold as GfxRenderer::drawBitmap1Bit: only the lightest level stays white
+    memset(packed, 0, rowBytes);
+    for (int bx = 0; bx < width; bx++) {
+      const uint8_t val = outputRow[bx / 4] >> (6 - ((bx * 2) % 8)) & 0x3;
+      if (val == 3) {
+        packed[bx >> 3] |= 0x80 >> (bx & 7);
+      }
+    }
+    const int row = bitmap.isTopDown() ? bmpY : bmpHeight - 1 - bmpY;
+    ok = file.seek(offset + row * rowBytes) && file.write(packed, rowBytes) == static_cast<size_t>(rowBytes);
+  }
+  free(outputRow);
+  free(rowBuffer);
+  bmpFile.close();
+
+  if (ok) {
+    *slot = Slot{key, offset, static_cast<uint16_t>(width), static_cast<uint16_t>(bmpHeight)};
+    dataEnd = std::max<uint32_t>(dataEnd, offset + bmpHeight * rowBytes);
+    ok = writeIndex(file);
+  }
+  if (ok) {
+    compactIfSparse();
+  }
+  file.close();
+  LOG_DBG("ATL", "Imported %s into %s (%dx%d): %s", bmpPath.c_str(), path.c_str(), width, bmpHeight,
+          ok ? "ok" : "failed");
+  return ok;
+}
+
+bool ThumbnailAtlas::removeKey(const uint64_t key) {
+  if (!load() || !findSlot(key) || !openForWrite()) {
+    return false;
+  }
+  *findSlot(key) = Slot{};
+  const bool ok = writeIndex(file);
+  if (ok) {
+    compactIfSparse();
+  }
+  file.close();
+  return ok;
+}
+
+void ThumbnailAtlas::forgetBook(const std::string& bookPath) {
+  // Atlases only exist for the cover heights of the themes, so there is no need to look for them on the card
+  const uint64_t key = keyFor(bookPath);
+  for (const int height : UITheme::getCoverThumbHeights()) {
+    ThumbnailAtlas atlas(height);
+    atlas.removeKey(key);
+  }
+}
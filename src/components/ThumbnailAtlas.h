@@ -0,0 +1,65 @@
+#pragma once
+
+#include <HalStorage.h>
+
+#include <cstdint>
+#include <string>
+
+class GfxRenderer;
+
+// Per-height file of packed cover thumbnails at /.crosspoint/thumbs_<height>.atlas. Each thumbnail is stored as
+// pre-dithered 1-bit rows in frame buffer bit order (MSB first, set bit = white), behind a fixed index keyed by book
+// path, so a page of covers is drawn with one open and a sequential read per cover instead of opening and parsing a
+// BMP per card. Entries are imported from the per-book thumbnail BMPs off the render path; a full atlas is reset and
+// refilled from those BMPs. A re-imported cover reuses its old rows when it fits, and the file is compacted once rows
+// no index entry points at outweigh the live ones.
+class ThumbnailAtlas {
+ public:
+  static constexpr int kMaxEntries = 64;
+
+  enum class DrawResult { NotCached, NoCover, Drawn };
+
+  explicit ThumbnailAtlas(int height);
+  ~ThumbnailAtlas();
+
+  // True if `bookPath` has an entry (possibly a "no cover" marker).
+  bool contains(const std::string& bookPath);
+
+  // Draws the thumbnail for `bookPath` centred in the box, cropping any overflow.
+  DrawResult draw(const GfxRenderer& renderer, const std::string& bookPath, int x, int y, int maxWidth,
+                  int maxHeight);
+
+  // Imports a thumbnail BMP for `bookPath`; an empty or unreadable BMP is recorded as "no cover".
+  bool addFromBmp(const std::string& bookPath, const std::string& bmpPath);
+  // Records that `bookPath` has no cover so it isn't retried on every visit.
+  bool addEmpty(const std::string& bookPath);
+
+  // Drops `bookPath` from every atlas on the card (e.g. when the book file is replaced).
+  static void forgetBook(const std::string& bookPath);
+
+ private:
+  struct Slot {
+    uint64_t key;
+    uint32_t offset;
+    uint16_t width;
+    uint16_t height;
+  };
+  static_assert(sizeof(Slot) == 16, "Atlas slots are written verbatim");
+
+  int height;
+  std::string path;
+  FsFile file;
+  Slot slots[kMaxEntries] = {};
+  uint32_t dataEnd = 0;
+  bool loaded = false;
+  bool valid = false;
+
+  bool load();
+  bool openForWrite();
+  bool writeIndex(FsFile& target) const;
+  // Rewrites the atlas without unreferenced rows if they make up most of it
+  void compactIfSparse();
+  Slot* findSlot(uint64_t key);
+  Slot* claimSlot(uint64_t key);
+  bool removeKey(uint64_t key);
+};
@@ -54,6 +54,10 @@ int UITheme::getNumberOfItemsPerPage(const GfxRenderer& renderer, bool hasHeader
   return availableHeight / rowHeight;
 }
 
+std::vector<int> UITheme::getCoverThumbHeights() {
+  return {BaseMetrics::values.homeCoverHeight, LyraMetrics::values.homeCoverHeight};
+}
+
 std::string UITheme::getCoverThumbPath(std::string coverBmpPath, int coverHeight) {
   size_t pos = coverBmpPath.find("[HEIGHT]", 0);
   if (pos != std::string::npos) {
@@ -21,6 +21,8 @@ class UITheme {
   static int getNumberOfItemsPerPage(const GfxRenderer& renderer, bool hasHeader, bool hasTabBar, bool hasButtonHints,
                                      bool hasSubtitle);
   static std::string getCoverThumbPath(std::string coverBmpPath, int coverHeight);
+  // Home cover heights of every theme, so thumbnails survive a theme switch
+  static std::vector<int> getCoverThumbHeights();
 
  private:
   const ThemeMetrics* currentMetrics;
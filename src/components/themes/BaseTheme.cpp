@@ -11,6 +11,7 @@
 #include "Battery.h"
 #include "I18n.h"
 #include "RecentBooksStore.h"
+#include "components/ThumbnailAtlas.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 
@@ -324,12 +325,15 @@ void BaseTheme::drawRecentBookCover(GfxRenderer& renderer, Rect rect, const std:
     // Only load from SD on first render, then use stored buffer
 
     if (hasContinueReading && !recentBooks[0].coverBmpPath.empty() && !coverRendered) {
+      // First time: draw from the thumbnail atlas, falling back to the BMP until it has been imported
+      ThumbnailAtlas atlas(BaseMetrics::values.homeCoverHeight);
+      const auto atlasResult = atlas.draw(renderer, recentBooks[0].path, bookX, bookY, bookWidth, bookHeight);
+      bool coverDrawn = atlasResult == ThumbnailAtlas::DrawResult::Drawn;
+
       const std::string coverBmpPath =
           UITheme::getCoverThumbPath(recentBooks[0].coverBmpPath, BaseMetrics::values.homeCoverHeight);
-
-      // First time: load cover from SD and render
       FsFile file;
-      if (Storage.openFileForRead("HOME", coverBmpPath, file)) {
+      if (atlasResult == ThumbnailAtlas::DrawResult::NotCached && Storage.openFileForRead("HOME", coverBmpPath, file)) {
         Bitmap bitmap(file);
         if (bitmap.parseHeaders() == BmpReaderError::Ok) {
           LOG_DBG("THEME", "Rendering bmp");
@@ -354,24 +358,27 @@ void BaseTheme::drawRecentBookCover(GfxRenderer& renderer, Rect rect, const std:
 
           // Draw the cover image centered within the book card
           renderer.drawBitmap(bitmap, coverX, coverY, bookWidth, bookHeight);
+          coverDrawn = true;
+        }
+        file.close();
+      }
 
-          // Draw border around the card
-          renderer.drawRect(bookX, bookY, bookWidth, bookHeight);
+      if (coverDrawn) {
+        // Draw border around the card
+        renderer.drawRect(bookX, bookY, bookWidth, bookHeight);
 
-          // No bookmark ribbon when cover is shown - it would just cover the art
+        // No bookmark ribbon when cover is shown - it would just cover the art
 
-          // Store the buffer with cover image for fast navigation
-          coverBufferStored = storeCoverBuffer();
-          coverRendered = true;
+        // Store the buffer with cover image for fast navigation
+        coverBufferStored = storeCoverBuffer();
+        coverRendered = true;
 
-          // First render: if selected, draw selection indicators now
-          if (bookSelected) {
-            LOG_DBG("THEME", "Drawing selection");
-            renderer.drawRect(bookX + 1, bookY + 1, bookWidth - 2, bookHeight - 2);
-            renderer.drawRect(bookX + 2, bookY + 2, bookWidth - 4, bookHeight - 4);
-          }
+        // First render: if selected, draw selection indicators now
+        if (bookSelected) {
+          LOG_DBG("THEME", "Drawing selection");
+          renderer.drawRect(bookX + 1, bookY + 1, bookWidth - 2, bookHeight - 2);
+          renderer.drawRect(bookX + 2, bookY + 2, bookWidth - 4, bookHeight - 4);
         }
-        file.close();
       }
     }
 
@@ -8,6 +8,7 @@
 
 #include "Battery.h"
 #include "RecentBooksStore.h"
+#include "components/ThumbnailAtlas.h"
 #include "components/UITheme.h"
 #include "fontIds.h"
 #include "util/StringUtils.h"
@@ -311,13 +312,18 @@ void LyraTheme::drawRecentBookCover(GfxRenderer& renderer, Rect rect, const std:
   // Only load from SD on first render, then use stored buffer
   if (hasContinueReading) {
     if (!coverRendered) {
+      // One atlas read per cover; books not imported yet fall back to their thumbnail BMP
+      ThumbnailAtlas atlas(LyraMetrics::values.homeCoverHeight);
       for (int i = 0; i < std::min(static_cast<int>(recentBooks.size()), LyraMetrics::values.homeRecentBooksCount);
            i++) {
         std::string coverPath = recentBooks[i].coverBmpPath;
         int tileX = LyraMetrics::values.contentSidePadding + tileWidth * i;
         renderer.drawRect(tileX + hPaddingInSelection, tileY + hPaddingInSelection, tileWidth - 2 * hPaddingInSelection,
                           LyraMetrics::values.homeCoverHeight);
-        if (!coverPath.empty()) {
+        if (!coverPath.empty() &&
+            atlas.draw(renderer, recentBooks[i].path, tileX + hPaddingInSelection, tileY + hPaddingInSelection,
+                       tileWidth - 2 * hPaddingInSelection,
+                       LyraMetrics::values.homeCoverHeight) == ThumbnailAtlas::DrawResult::NotCached) {
           const std::string coverBmpPath = UITheme::getCoverThumbPath(coverPath, LyraMetrics::values.homeCoverHeight);
 
           // First time: load cover from SD and render
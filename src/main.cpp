@@ -1,5 +1,7 @@
 #include <Arduino.h>
 #include <Epub.h>
+#include <Epub/hyphenation/LanguageRegistry.h>
+#include <Epub/hyphenation/SdHyphenationLoader.h>
 #include <GfxRenderer.h>
 #include <HalDisplay.h>
 #include <HalGPIO.h>
@@ -12,12 +14,15 @@
 #include <cstring>
 
 #include "Battery.h"
+#include "CoverJobQueue.h"
 #include "CrossPointSettings.h"
 #include "CrossPointState.h"
 #include "InstapaperCredentialStore.h"
 #include "KOReaderCredentialStore.h"
 #include "MappedInputManager.h"
 #include "RecentBooksStore.h"
+#include "StateStore.h"
+#include "activities/RenderStats.h"
 #include "activities/boot_sleep/BootActivity.h"
 #include "activities/boot_sleep/SleepActivity.h"
 #include "activities/browser/OpdsBookBrowserActivity.h"
@@ -179,6 +184,7 @@ void waitForPowerRelease() {
 
 // Enter deep sleep mode
 void enterDeepSleep() {
+  COVER_JOBS.waitUntilIdle();
   APP_STATE.lastSleepFromReader = currentActivity && currentActivity->isReaderActivity();
   APP_STATE.saveToFile();
   exitActivity();
@@ -322,8 +328,10 @@ void setup() {
     return;
   }
 
+  STATE_STORE.begin();
   SETTINGS.loadFromFile();
   I18N.loadSettings();
+  setExternalHyphenatorProvider(loadSdHyphenator, releaseSdHyphenator);
   KOREADER_STORE.loadFromFile();
   INSTAPAPER_STORE.loadFromFile();
   ANKI_SESSION.load();
@@ -358,6 +366,7 @@ void setup() {
 
   APP_STATE.loadFromFile();
   RECENT_BOOKS.loadFromFile();
+  COVER_JOBS.begin(renderer);
 
   // Boot to home screen if no book is open, last sleep was not from reader, back button is held, or reader activity
   // crashed (indicated by readerActivityLoadCount > 0)
@@ -408,6 +417,10 @@ void loop() {
     }
   }
 
+  if (gpio.wasAnyPressed()) {
+    RENDER_STATS.onInput(loopStartTime);
+  }
+
   // Check for any user activity (button press or release) or active background work
   static unsigned long lastActivityTime = millis();
   if (gpio.wasAnyPressed() || gpio.wasAnyReleased() || (currentActivity && currentActivity->preventAutoSleep())) {
@@ -428,6 +441,16 @@ void loop() {
     return;
   }
 
+  // Cover jobs share the SD card with the activity, so the two never run at once: while a job is in flight the
+  // activity only runs again once input arrives, and then after the job has finished.
+  if (COVER_JOBS.isBusy()) {
+    if (!gpio.wasAnyPressed() && !gpio.wasAnyReleased()) {
+      delay(10);
+      return;
+    }
+    COVER_JOBS.waitUntilIdle();
+  }
+
   const unsigned long activityStartTime = millis();
   if (currentActivity) {
     currentActivity->loop();
@@ -442,6 +465,21 @@ void loop() {
     }
   }
 
+  // Hand out background pre-indexing once the user has been idle for a while: on USB power, or on battery only on the
+  // file transfer screens, unless the activity has work of its own going on. A render still in flight (e.g. a chapter
+  // being paginated) has the SD card and the layout state, and only loop() waits for a job, not the render task.
+  static constexpr unsigned long COVER_JOB_IDLE_BATTERY_MS = 5000;
+  static constexpr unsigned long COVER_JOB_IDLE_USB_MS = 1000;
+  const bool usbPower = gpio.isUsbConnected();
+  const unsigned long coverJobIdleMs = usbPower ? COVER_JOB_IDLE_USB_MS : COVER_JOB_IDLE_BATTERY_MS;
+  const bool jobsAllowed = currentActivity
+                               ? currentActivity->allowsBackgroundJobs() && currentActivity->isRenderIdle() &&
+                                     (usbPower || currentActivity->allowsBackgroundJobsOnBattery())
+                               : usbPower;
+  if (millis() - lastActivityTime >= coverJobIdleMs && jobsAllowed) {
+    COVER_JOBS.runNextJob();
+  }
+
   // Add delay at the end of the loop to prevent tight spinning
   // When an activity requests skip loop delay (e.g., webserver running), use yield() for faster response
   // Otherwise, use longer delay to save power
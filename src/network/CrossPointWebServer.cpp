@@ -6,12 +6,20 @@
 #include <HalStorage.h>
 #include <Logging.h>
 #include <WiFi.h>
+#include <ZipStreamExtractor.h>
 #include <esp_task_wdt.h>
 
 #include <algorithm>
 
+#include "CoverJobQueue.h"
 #include "CrossPointSettings.h"
+#include "FileListingCache.h"
+#include "LibraryCatalog.h"
 #include "SettingsList.h"
+#include "StateStore.h"
+#include "UploadBlockWriter.h"
+#include "activities/RenderStats.h"
+#include "components/ThumbnailAtlas.h"
 #include "html/FilesPageHtml.generated.h"
 #include "html/HomePageHtml.generated.h"
 #include "html/SettingsPageHtml.generated.h"
@@ -28,8 +36,20 @@ constexpr uint16_t LOCAL_UDP_PORT = 8134;
 // Static pointer for WebSocket callback (WebSocketsServer requires C-style callback)
 CrossPointWebServer* wsInstance = nullptr;
 
+// Windowed upload protocol (START2, UNZIP): the client keeps at most WS_WINDOW_CHUNKS chunks of up to WS_CHUNK_SIZE
+// bytes unacknowledged, and the server acknowledges every WS_ACK_BYTES.
+constexpr size_t WS_CHUNK_SIZE = 4096;
+constexpr size_t WS_WINDOW_CHUNKS = 8;
+constexpr size_t WS_ACK_BYTES = WS_CHUNK_SIZE * WS_WINDOW_CHUNKS / 2;
+// Legacy protocol (START): progress every 64KB
+constexpr size_t WS_PROGRESS_BYTES = 65536;
+
 // WebSocket upload state
-FsFile wsUploadFile;
+UploadBlockWriter wsUploadWriter;
+ZipStreamExtractor wsZipExtractor;
+bool wsUploadWindowed = false;
+bool wsUploadUnzip = false;
+size_t wsLastProgressSent = 0;
 String wsUploadFileName;
 String wsUploadPath;
 size_t wsUploadSize = 0;
@@ -40,15 +60,36 @@ String wsLastCompleteName;
 size_t wsLastCompleteSize = 0;
 unsigned long wsLastCompleteAt = 0;
 
+// Sorted listing behind /api/files; a page is sent in chunks of about LIST_CHUNK_SIZE bytes
+FileListingCache webListing;
+constexpr uint32_t MAX_LIST_PAGE = 1000;
+constexpr size_t LIST_CHUNK_SIZE = 1400;
+
+// Background jobs get the SD card once no upload or download has moved data for this long
+constexpr unsigned long TRANSFER_IDLE_MS = 10000;
+unsigned long lastTransferAt = 0;
+
 // Helper function to clear epub cache after upload
 void clearEpubCacheIfNeeded(const String& filePath) {
   // Only clear cache for .epub files
   if (StringUtils::checkFileExtension(filePath, ".epub")) {
-    Epub(filePath.c_str(), "/.crosspoint").clearCache();
+    Epub epub(filePath.c_str(), "/.crosspoint");
+    epub.clearCache();
+    // A new file under the same name starts from the beginning
+    STATE_STORE.remove(StateStore::progressKey(epub.getCachePath()));
+    ThumbnailAtlas::forgetBook(filePath.c_str());
     LOG_DBG("WEB", "Cleared epub cache for: %s", filePath.c_str());
   }
 }
 
+// Same bookkeeping as for a single upload, for each file unpacked from an uploaded archive
+void onUnzippedFile(const std::string& path, uint32_t) {
+  clearEpubCacheIfNeeded(path.c_str());
+  LIBRARY_CATALOG.invalidatePath(path.c_str());
+  webListing.invalidate();
+  COVER_JOBS.enqueue(path);
+}
+
 String normalizeWebPath(const String& inputPath) {
   if (inputPath.isEmpty() || inputPath == "/") {
     return "/";
@@ -67,6 +108,78 @@ String normalizeWebPath(const String& inputPath) {
   return result;
 }
 
+// Download send loop: larger than the TCP segment so each write fills several segments
+constexpr size_t DOWNLOAD_CHUNK_SIZE = 8192;
+
+enum class RangeResult { None, Satisfiable, Unsatisfiable };
+
+// Parses a single "bytes=" range against a file of `size` bytes into inclusive [first, last]. Anything that isn't a
+// single byte range (several ranges, other units, bad syntax) is ignored and the whole file is sent.
+RangeResult parseRange(const String& header, const size_t size, size_t& first, size_t& last) {
+  if (!header.startsWith("bytes=") || header.indexOf(',') >= 0) {
+    return RangeResult::None;
+  }
+  const int dash = header.indexOf('-');
+  if (dash < 0) {
+    return RangeResult::None;
+  }
+  String from = header.substring(6, dash);
+  String to = header.substring(dash + 1);
+  from.trim();
+  to.trim();
+  char* end = nullptr;
+  if (from.isEmpty()) {
+    // Suffix range: the last N bytes
+    const unsigned long suffix = strtoul(to.c_str(), &end, 10);
+    if (to.isEmpty() || *end != '\0') {
+      return RangeResult::None;
+    }
+    if (suffix == 0 || size == 0) {
+      return RangeResult::Unsatisfiable;
+    }
+    first = suffix >= size ? 0 : size - suffix;
+    last = size - 1;
+    return RangeResult::Satisfiable;
+  }
+  first = strtoul(from.c_str(), &end, 10);
+  if (*end != '\0') {
+    return RangeResult::None;
+  }
+  last = size - 1;
+  if (!to.isEmpty()) {
+    last = strtoul(to.c_str(), &end, 10);
+    if (*end != '\0' || last < first) {
+      return RangeResult::None;
+    }
+    last = std::min(last, size - 1);
+  }
+  return first < size ? RangeResult::Satisfiable : RangeResult::Unsatisfiable;
+}
+
+// RFC 7231 date from a FAT timestamp. FAT keeps local time without a zone; it is reported as GMT, which is only used
+// to compare against the same value sent back by the client.
+String formatHttpDate(const uint16_t fatDate, const uint16_t fatTime) {
+  static const char* const DAYS[] = {"Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed"};
+  static const char* const MONTHS[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                       "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  int year = 1980 + (fatDate >> 9);
+  const int month = std::clamp((fatDate >> 5) & 0x0F, 1, 12);
+  const int day = std::clamp(fatDate & 0x1F, 1, 31);
+
+  // Days since 1970-01-01 (Howard Hinnant's days_from_civil) to get the weekday
+  const int y = month <= 2 ? year - 1 : year;
+  const int era = y / 400;
+  const int yoe = y - era * 400;
+  const int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  const long days = static_cast<long>(era) * 146097 + doe - 719468;
+
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%s, %02d %s %04d %02d:%02d:%02d GMT", DAYS[days % 7], day, MONTHS[month - 1], year,
+           fatTime >> 11, (fatTime >> 5) & 0x3F, (fatTime & 0x1F) * 2);
+  return buf;
+}
+
 bool isProtectedItemName(const String& name) {
   if (name.startsWith(".")) {
     return true;
@@ -78,6 +191,20 @@ bool isProtectedItemName(const String& name) {
   }
   return false;
 }
+
+// Whether any folder along an absolute path is protected
+bool hasProtectedComponent(const String& path) {
+  int start = 1;
+  while (start < static_cast<int>(path.length())) {
+    int end = path.indexOf('/', start);
+    if (end < 0) end = path.length();
+    if (end > start && isProtectedItemName(path.substring(start, end))) {
+      return true;
+    }
+    start = end + 1;
+  }
+  return false;
+}
 }  // namespace
 
 // File listing page template - now using generated headers:
@@ -108,6 +235,8 @@ void CrossPointWebServer::begin() {
   apMode = isInApMode;
 
   LOG_DBG("WEB", "[MEM] Free heap before begin: %d bytes", ESP.getFreeHeap());
+  // The card may have changed since the last session
+  webListing.invalidate();
   LOG_DBG("WEB", "Network mode: %s", apMode ? "AP" : "STA");
 
   LOG_DBG("WEB", "Creating web server on port %d...", port);
@@ -135,6 +264,9 @@ void CrossPointWebServer::begin() {
   server->on("/api/status", HTTP_GET, [this] { handleStatus(); });
   server->on("/api/files", HTTP_GET, [this] { handleFileListData(); });
   server->on("/download", HTTP_GET, [this] { handleDownload(); });
+  // Request headers the download handler looks at for resuming and revalidation
+  const char* downloadHeaders[] = {"Range", "If-Range", "If-None-Match", "If-Modified-Since"};
+  server->collectHeaders(downloadHeaders, sizeof(downloadHeaders) / sizeof(downloadHeaders[0]));
 
   // Upload endpoint with special handling for multipart form data
   server->on("/upload", HTTP_POST, [this] { handleUploadPost(upload); }, [this] { handleUpload(upload); });
@@ -194,8 +326,9 @@ void CrossPointWebServer::stop() {
   LOG_DBG("WEB", "[MEM] Free heap before stop: %d bytes", ESP.getFreeHeap());
 
   // Close any in-progress WebSocket upload
-  if (wsUploadInProgress && wsUploadFile) {
-    wsUploadFile.close();
+  if (wsUploadInProgress) {
+    wsUploadWriter.abort();
+    wsZipExtractor.abort();
     wsUploadInProgress = false;
   }
 
@@ -251,7 +384,10 @@ void CrossPointWebServer::handleClient() {
     lastDebugPrint = millis();
   }
 
-  server->handleClient();
+  // HTTP handlers use the SD card, so they wait while an upload block is being written
+  if (!wsUploadWriter.isBusy()) {
+    server->handleClient();
+  }
 
   // Handle WebSocket events
   if (wsServer) {
@@ -281,6 +417,10 @@ void CrossPointWebServer::handleClient() {
   }
 }
 
+bool CrossPointWebServer::isTransferIdle() const {
+  return !wsUploadInProgress && !upload.file && millis() - lastTransferAt >= TRANSFER_IDLE_MS;
+}
+
 CrossPointWebServer::WsUploadStatus CrossPointWebServer::getWsUploadStatus() const {
   WsUploadStatus status;
   status.inProgress = wsUploadInProgress;
@@ -321,6 +461,21 @@ void CrossPointWebServer::handleStatus() const {
   doc["freeHeap"] = ESP.getFreeHeap();
   doc["uptime"] = millis() / 1000;
 
+  // Render latency per activity, in ms
+  JsonObject render = doc["render"].to<JsonObject>();
+  RENDER_STATS.forEachActivity(
+      [&render](const std::string& activity, const RenderStats::Summary (&spans)[RenderStats::SPAN_COUNT]) {
+        JsonObject stats = render[activity].to<JsonObject>();
+        for (int i = 0; i < RenderStats::SPAN_COUNT; i++) {
+          if (spans[i].samples == 0) continue;
+          JsonObject span = stats[RenderStats::spanName(static_cast<RenderStats::Span>(i))].to<JsonObject>();
+          span["samples"] = spans[i].samples;
+          span["min"] = spans[i].min;
+          span["median"] = spans[i].median;
+          span["p95"] = spans[i].p95;
+        }
+      });
+
   String json;
   serializeJson(doc, json);
   server->send(200, "application/json", json);
@@ -369,9 +524,13 @@ void CrossPointWebServer::scanFiles(const char* path, const std::function<void(F
       if (info.isDirectory) {
         info.size = 0;
         info.isEpub = false;
+        info.modified = 0;
       } else {
         info.size = file.size();
         info.isEpub = isEpubFile(info.name);
+        uint16_t date = 0;
+        uint16_t time = 0;
+        info.modified = file.getModifyDateTime(&date, &time) ? (static_cast<uint32_t>(date) << 16) | time : 0;
       }
 
       callback(info);
@@ -412,36 +571,92 @@ void CrossPointWebServer::handleFileListData() const {
 
   bool showHidden = server->hasArg("showHidden") && server->arg("showHidden") == "1";
 
+  auto order = FileListingCache::Order::NAME;
+  if (server->arg("sort") == "size") {
+    order = FileListingCache::Order::SIZE;
+  } else if (server->arg("sort") == "modified") {
+    order = FileListingCache::Order::MODIFIED;
+  }
+  const bool descending = server->arg("order") == "desc";
+
+  // Without offset/limit the whole folder is sent as a plain array, as older clients expect
+  const bool paged = server->hasArg("offset") || server->hasArg("limit");
+  const uint32_t offset = server->hasArg("offset") ? std::max(0L, server->arg("offset").toInt()) : 0;
+  const uint32_t limit = server->hasArg("limit")
+                             ? std::clamp(server->arg("limit").toInt(), 1L, static_cast<long>(MAX_LIST_PAGE))
+                             : UINT32_MAX;
+
+  if (!webListing.matches(currentPath.c_str(), showHidden, order, descending)) {
+    const unsigned long startedAt = millis();
+    webListing.begin(currentPath.c_str(), showHidden, order, descending);
+    scanFiles(currentPath.c_str(), [](const FileInfo& info) {
+      webListing.add(info.name.c_str(), info.size, info.modified, info.isDirectory);
+    }, showHidden);
+    if (!webListing.commit()) {
+      server->send(500, "text/plain", "Failed to list folder");
+      return;
+    }
+    LOG_DBG("WEB", "Listed %u entries of %s in %lu ms", static_cast<unsigned>(webListing.getCount()),
+            currentPath.c_str(), millis() - startedAt);
+  }
+
   server->setContentLength(CONTENT_LENGTH_UNKNOWN);
   server->send(200, "application/json", "");
-  server->sendContent("[");
+
+  // Entries are batched so each chunk on the wire carries a few of them
+  String chunk;
+  chunk.reserve(LIST_CHUNK_SIZE + 512);
+  if (paged) {
+    char header[160];
+    snprintf(header, sizeof(header),
+             "{\"total\":%u,\"folders\":%u,\"bytes\":%llu,\"complete\":%s,\"offset\":%u,\"files\":[",
+             static_cast<unsigned>(webListing.getCount()), static_cast<unsigned>(webListing.getFolderCount()),
+             static_cast<unsigned long long>(webListing.getTotalBytes()), webListing.isComplete() ? "true" : "false",
+             static_cast<unsigned>(offset));
+    chunk += header;
+  } else {
+    chunk += "[";
+  }
+
   char output[512];
   constexpr size_t outputSize = sizeof(output);
   bool seenFirst = false;
   JsonDocument doc;
-
-  scanFiles(currentPath.c_str(), [this, &output, &doc, seenFirst](const FileInfo& info) mutable {
+  webListing.read(offset, limit, [this, &chunk, &output, &doc, &seenFirst](const ListingEntry& entry) {
     doc.clear();
-    doc["name"] = info.name;
-    doc["size"] = info.size;
-    doc["isDirectory"] = info.isDirectory;
-    doc["isEpub"] = info.isEpub;
+    doc["name"] = entry.name;
+    doc["size"] = entry.size;
+    doc["isDirectory"] = entry.isDirectory;
+    doc["isEpub"] = !entry.isDirectory && StringUtils::checkFileExtension(entry.name, ".epub");
+    if (entry.modified != 0) {
+      char modified[20];
+      const uint16_t date = entry.modified >> 16;
+      const uint16_t time = entry.modified & 0xFFFF;
+      snprintf(modified, sizeof(modified), "%04d-%02d-%02dT%02d:%02d:%02d", 1980 + (date >> 9), (date >> 5) & 0x0F,
+               date & 0x1F, time >> 11, (time >> 5) & 0x3F, (time & 0x1F) * 2);
+      doc["modified"] = modified;
+    }
 
     const size_t written = serializeJson(doc, output, outputSize);
     if (written >= outputSize) {
       // JSON output truncated; skip this entry to avoid sending malformed JSON
-      LOG_DBG("WEB", "Skipping file entry with oversized JSON for name: %s", info.name.c_str());
+      LOG_DBG("WEB", "Skipping file entry with oversized JSON for name: %s", entry.name.c_str());
       return;
     }
 
     if (seenFirst) {
-      server->sendContent(",");
+      chunk += ",";
     } else {
       seenFirst = true;
     }
-    server->sendContent(output);
-  }, showHidden);
-  server->sendContent("]");
+    chunk += output;
+    if (chunk.length() >= LIST_CHUNK_SIZE) {
+      server->sendContent(chunk);
+      chunk = "";
+    }
+  });
+  chunk += paged ? "]}" : "]";
+  server->sendContent(chunk);
   // End of streamed response, empty chunk to signal client
   server->sendContent("");
   LOG_DBG("WEB", "Served file listing page for path: %s", currentPath.c_str());
@@ -501,13 +716,104 @@ void CrossPointWebServer::handleDownload() const {
     filename = nameBuf;
   }
 
-  server->setContentLength(file.size());
+  // Validators: the ETag changes whenever the size or the modification time does
+  const size_t fileSize = file.size();
+  uint16_t fatDate = 0;
+  uint16_t fatTime = 0;
+  file.getModifyDateTime(&fatDate, &fatTime);
+  char etagBuf[32];
+  snprintf(etagBuf, sizeof(etagBuf), "\"%x-%04x%04x\"", static_cast<unsigned>(fileSize), fatDate, fatTime);
+  const String etag = etagBuf;
+  const String lastModified = formatHttpDate(fatDate, fatTime);
+
+  server->sendHeader("ETag", etag);
+  server->sendHeader("Last-Modified", lastModified);
+  server->sendHeader("Accept-Ranges", "bytes");
+
+  // If-None-Match wins over If-Modified-Since. The date is compared as sent by us, which is what clients echo back.
+  const String ifNoneMatch = server->header("If-None-Match");
+  const bool notModified = server->hasHeader("If-None-Match")
+                               ? (ifNoneMatch == "*" || ifNoneMatch.indexOf(etag) >= 0)
+                               : server->header("If-Modified-Since") == lastModified;
+  if (notModified) {
+    file.close();
+    server->send(304, contentType.c_str(), "");
+    return;
+  }
+
+  size_t first = 0;
+  size_t last = fileSize > 0 ? fileSize - 1 : 0;
+  RangeResult range = RangeResult::None;
+  if (server->hasHeader("Range")) {
+    // A stale If-Range means the client's partial copy is of another version: send the whole file
+    const String ifRange = server->header("If-Range");
+    if (ifRange.isEmpty() || ifRange == etag || ifRange == lastModified) {
+      range = parseRange(server->header("Range"), fileSize, first, last);
+    }
+  }
+
+  if (range == RangeResult::Unsatisfiable) {
+    file.close();
+    server->sendHeader("Content-Range", "bytes */" + String(fileSize));
+    server->send(416, "text/plain", "Range not satisfiable");
+    return;
+  }
+
+  const size_t length = fileSize > 0 ? last - first + 1 : 0;
+  if (first > 0 && !file.seek(first)) {
+    file.close();
+    server->send(500, "text/plain", "Failed to seek");
+    return;
+  }
+
+  server->setContentLength(length);
   server->sendHeader("Content-Disposition", "attachment; filename=\"" + filename + "\"");
-  server->send(200, contentType.c_str(), "");
+  if (range == RangeResult::Satisfiable) {
+    server->sendHeader("Content-Range", "bytes " + String(first) + "-" + String(last) + "/" + String(fileSize));
+    server->send(206, contentType.c_str(), "");
+  } else {
+    server->send(200, contentType.c_str(), "");
+  }
+
+  std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[DOWNLOAD_CHUNK_SIZE]);
+  if (!buffer) {
+    LOG_ERR("WEB", "Not enough memory for download buffer");
+    file.close();
+    return;
+  }
 
   WiFiClient client = server->client();
-  client.write(file);
+  const unsigned long start = millis();
+  size_t sent = 0;
+  while (sent < length && client.connected()) {
+    lastTransferAt = millis();
+    esp_task_wdt_reset();
+    const size_t wanted = std::min(DOWNLOAD_CHUNK_SIZE, length - sent);
+    const int read = file.read(buffer.get(), wanted);
+    if (read <= 0) {
+      LOG_ERR("WEB", "Download read failed at %u", static_cast<unsigned>(first + sent));
+      break;
+    }
+    // write() may accept less than asked while the TCP send buffer is full
+    size_t offset = 0;
+    while (offset < static_cast<size_t>(read)) {
+      const size_t written = client.write(buffer.get() + offset, read - offset);
+      if (written == 0) {
+        break;
+      }
+      offset += written;
+    }
+    sent += offset;
+    if (offset < static_cast<size_t>(read)) {
+      break;
+    }
+  }
   file.close();
+
+  const unsigned long elapsed = millis() - start;
+  LOG_DBG("WEB", "Download %s: %u/%u bytes from %u in %lu ms (%.1f KB/s)", filename.c_str(),
+          static_cast<unsigned>(sent), static_cast<unsigned>(length), static_cast<unsigned>(first), elapsed,
+          elapsed > 0 ? (sent / 1024.0) / (elapsed / 1000.0) : 0.0);
 }
 
 // Diagnostic counters for upload performance analysis
@@ -606,6 +912,7 @@ void CrossPointWebServer::handleUpload(UploadState& state) const {
 
     LOG_DBG("WEB", "[UPLOAD] File created successfully: %s", filePath.c_str());
   } else if (upload.status == UPLOAD_FILE_WRITE) {
+    lastTransferAt = millis();
     if (state.file && state.error.isEmpty()) {
       // Buffer incoming data and flush when buffer is full
       // This reduces SD card write operations and improves throughput
@@ -665,6 +972,9 @@ void CrossPointWebServer::handleUpload(UploadState& state) const {
         if (!filePath.endsWith("/")) filePath += "/";
         filePath += state.fileName;
         clearEpubCacheIfNeeded(filePath);
+        LIBRARY_CATALOG.invalidatePath(filePath.c_str());
+        webListing.invalidate();
+        COVER_JOBS.enqueue(filePath.c_str());
       }
     }
   } else if (upload.status == UPLOAD_FILE_ABORTED) {
@@ -733,6 +1043,8 @@ void CrossPointWebServer::handleCreateFolder() const {
 
   // Create the folder
   if (Storage.mkdir(folderPath.c_str())) {
+    LIBRARY_CATALOG.invalidatePath(folderPath.c_str());
+    webListing.invalidate();
     LOG_DBG("WEB", "Folder created successfully: %s", folderPath.c_str());
     server->send(200, "text/plain", "Folder created: " + folderName);
   } else {
@@ -815,6 +1127,8 @@ void CrossPointWebServer::handleRename() const {
   file.close();
 
   if (success) {
+    LIBRARY_CATALOG.invalidatePath(itemPath.c_str());
+    webListing.invalidate();
     LOG_DBG("WEB", "Renamed file: %s -> %s", itemPath.c_str(), newPath.c_str());
     server->send(200, "text/plain", "Renamed successfully");
   } else {
@@ -908,6 +1222,9 @@ void CrossPointWebServer::handleMove() const {
   file.close();
 
   if (success) {
+    LIBRARY_CATALOG.invalidatePath(itemPath.c_str());
+    LIBRARY_CATALOG.invalidatePath(newPath.c_str());
+    webListing.invalidate();
     LOG_DBG("WEB", "Moved file: %s -> %s", itemPath.c_str(), newPath.c_str());
     server->send(200, "text/plain", "Moved successfully");
   } else {
@@ -992,6 +1309,8 @@ void CrossPointWebServer::handleDelete() const {
   }
 
   if (success) {
+    LIBRARY_CATALOG.invalidatePath(itemPath.c_str());
+    webListing.invalidate();
     LOG_DBG("WEB", "Successfully deleted: %s", itemPath.c_str());
     server->send(200, "text/plain", "Deleted successfully");
   } else {
@@ -1171,17 +1490,22 @@ void CrossPointWebServer::wsEventCallback(uint8_t num, WStype_t type, uint8_t* p
 
 // WebSocket event handler for fast binary uploads
 // Protocol:
-//   1. Client sends TEXT message: "START:<filename>:<size>:<path>"
-//   2. Client sends BINARY messages with file data chunks
-//   3. Server sends TEXT "PROGRESS:<received>:<total>" after each chunk
-//   4. Server sends TEXT "DONE" or "ERROR:<message>" when complete
+//   1. Client sends TEXT message: "START2:<filename>:<size>:<path>" (or "START:..." for the legacy protocol), or
+//      "UNZIP:<filename>:<size>:<path>" to unpack a ZIP archive into <path> as it arrives
+//   2. Server responds "READY:<chunkSize>:<windowChunks>" ("READY" for legacy)
+//   3. Client sends BINARY messages of at most chunkSize bytes, with no more than windowChunks chunks unacknowledged
+//   4. Server sends TEXT "ACK:<received>" every half window (legacy: "PROGRESS:<received>:<total>" every 64KB)
+//   5. Server sends TEXT "DONE" or "ERROR:<message>" once the file is on the card; an archive's DONE is preceded by
+//      "EXTRACTED:<files>:<bytes>"
 void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length) {
   switch (type) {
     case WStype_DISCONNECTED:
       LOG_DBG("WS", "Client %u disconnected", num);
-      // Clean up any in-progress upload
-      if (wsUploadInProgress && wsUploadFile) {
-        wsUploadFile.close();
+      // Clean up any in-progress upload; files already unpacked from an archive are kept
+      if (wsUploadInProgress && wsUploadUnzip) {
+        wsZipExtractor.abort();
+      } else if (wsUploadInProgress && wsUploadWriter.isOpen()) {
+        wsUploadWriter.abort();
         // Delete incomplete file
         String filePath = wsUploadPath;
         if (!filePath.endsWith("/")) filePath += "/";
@@ -1202,16 +1526,26 @@ void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t*
       String msg = String((char*)payload);
       LOG_DBG("WS", "Text from client %u: %s", num, msg.c_str());
 
-      if (msg.startsWith("START:")) {
-        // Parse: START:<filename>:<size>:<path>
-        int firstColon = msg.indexOf(':', 6);
+      const bool unzip = msg.startsWith("UNZIP:");
+      const bool windowed = unzip || msg.startsWith("START2:");
+      if (windowed || msg.startsWith("START:")) {
+        // Parse: START[2]:<filename>:<size>:<path> or UNZIP:<filename>:<size>:<path>
+        const int nameStart = msg.indexOf(':') + 1;
+        int firstColon = msg.indexOf(':', nameStart);
         int secondColon = msg.indexOf(':', firstColon + 1);
 
         if (firstColon > 0 && secondColon > 0) {
-          wsUploadFileName = msg.substring(6, firstColon);
+          if (wsUploadInProgress) {
+            wsUploadWriter.abort();
+            wsZipExtractor.abort();
+          }
+          wsUploadFileName = msg.substring(nameStart, firstColon);
           wsUploadSize = msg.substring(firstColon + 1, secondColon).toInt();
           wsUploadPath = msg.substring(secondColon + 1);
           wsUploadReceived = 0;
+          wsLastProgressSent = 0;
+          wsUploadWindowed = windowed;
+          wsUploadUnzip = unzip;
           wsUploadStartTime = millis();
 
           // Ensure path is valid
@@ -1220,6 +1554,26 @@ void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t*
             wsUploadPath = wsUploadPath.substring(0, wsUploadPath.length() - 1);
           }
 
+          if (unzip) {
+            LOG_DBG("WS", "Starting archive upload: %s (%d bytes) into %s", wsUploadFileName.c_str(), wsUploadSize,
+                    wsUploadPath.c_str());
+            if (hasProtectedComponent(wsUploadPath)) {
+              wsServer->sendTXT(num, "ERROR:Cannot unpack into a protected folder");
+              wsUploadInProgress = false;
+              return;
+            }
+            esp_task_wdt_reset();
+            const auto isProtected = [](const std::string& name) { return isProtectedItemName(String(name.c_str())); };
+            if (!wsZipExtractor.begin(wsUploadPath.c_str(), onUnzippedFile, isProtected)) {
+              wsServer->sendTXT(num, "ERROR:Not enough memory to unpack");
+              wsUploadInProgress = false;
+              return;
+            }
+            wsUploadInProgress = true;
+            wsServer->sendTXT(num, "READY:" + String(WS_CHUNK_SIZE) + ":" + String(WS_WINDOW_CHUNKS));
+            return;
+          }
+
           // Build file path
           String filePath = wsUploadPath;
           if (!filePath.endsWith("/")) filePath += "/";
@@ -1236,7 +1590,7 @@ void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t*
 
           // Open file for writing
           esp_task_wdt_reset();
-          if (!Storage.openFileForWrite("WS", filePath, wsUploadFile)) {
+          if (!wsUploadWriter.begin(filePath.c_str())) {
             wsServer->sendTXT(num, "ERROR:Failed to create file");
             wsUploadInProgress = false;
             return;
@@ -1244,7 +1598,11 @@ void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t*
           esp_task_wdt_reset();
 
           wsUploadInProgress = true;
-          wsServer->sendTXT(num, "READY");
+          if (windowed) {
+            wsServer->sendTXT(num, "READY:" + String(WS_CHUNK_SIZE) + ":" + String(WS_WINDOW_CHUNKS));
+          } else {
+            wsServer->sendTXT(num, "READY");
+          }
         } else {
           wsServer->sendTXT(num, "ERROR:Invalid START format");
         }
@@ -1253,38 +1611,87 @@ void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t*
     }
 
     case WStype_BIN: {
-      if (!wsUploadInProgress || !wsUploadFile) {
+      if (!wsUploadInProgress || !(wsUploadUnzip ? wsZipExtractor.isOpen() : wsUploadWriter.isOpen())) {
         wsServer->sendTXT(num, "ERROR:No upload in progress");
         return;
       }
 
-      // Write binary data directly to file
+      // Copy into the current block; this only waits for the card when both blocks are full. Archives are unpacked
+      // right here instead, and the card only sees whole inflate windows.
       esp_task_wdt_reset();
-      size_t written = wsUploadFile.write(payload, length);
+      const bool queued =
+          wsUploadUnzip ? wsZipExtractor.write(payload, length) : wsUploadWriter.append(payload, length);
       esp_task_wdt_reset();
 
-      if (written != length) {
-        wsUploadFile.close();
+      if (!queued) {
         wsUploadInProgress = false;
+        if (wsUploadUnzip) {
+          wsZipExtractor.abort();
+          wsServer->sendTXT(num, String("ERROR:") + wsZipExtractor.getError());
+          return;
+        }
+        wsUploadWriter.abort();
         wsServer->sendTXT(num, "ERROR:Write failed - disk full?");
         return;
       }
 
-      wsUploadReceived += written;
-
-      // Send progress update (every 64KB or at end)
-      static size_t lastProgressSent = 0;
-      if (wsUploadReceived - lastProgressSent >= 65536 || wsUploadReceived >= wsUploadSize) {
-        String progress = "PROGRESS:" + String(wsUploadReceived) + ":" + String(wsUploadSize);
-        wsServer->sendTXT(num, progress);
-        lastProgressSent = wsUploadReceived;
+      wsUploadReceived += length;
+      lastTransferAt = millis();
+
+      // Acknowledge data so the client can keep its window full (or report progress for the legacy protocol).
+      // The final acknowledgement is implied by DONE.
+      if (wsUploadReceived < wsUploadSize) {
+        if (wsUploadWindowed && wsUploadReceived - wsLastProgressSent >= WS_ACK_BYTES) {
+          wsServer->sendTXT(num, "ACK:" + String(wsUploadReceived));
+          wsLastProgressSent = wsUploadReceived;
+        } else if (!wsUploadWindowed && wsUploadReceived - wsLastProgressSent >= WS_PROGRESS_BYTES) {
+          wsServer->sendTXT(num, "PROGRESS:" + String(wsUploadReceived) + ":" + String(wsUploadSize));
+          wsLastProgressSent = wsUploadReceived;
+        }
       }
 
       // Check if upload complete
-      if (wsUploadReceived >= wsUploadSize) {
-        wsUploadFile.close();
+      if (wsUploadReceived >= wsUploadSize && wsUploadUnzip) {
+        esp_task_wdt_reset();
+        const bool unpacked = wsZipExtractor.finish();
+        esp_task_wdt_reset();
+        wsUploadInProgress = false;
+
+        if (!unpacked) {
+          wsServer->sendTXT(num, String("ERROR:") + wsZipExtractor.getError());
+          return;
+        }
+
+        wsLastCompleteName = wsUploadFileName;
+        wsLastCompleteSize = wsUploadSize;
+        wsLastCompleteAt = millis();
+
+        const unsigned long elapsed = millis() - wsUploadStartTime;
+        const float seconds = elapsed > 0 ? elapsed / 1000.0f : 1.0f;
+        const uint32_t written = wsZipExtractor.getBytesWritten();
+        LOG_INF("WS", "Unpacked %s: %u files, %u bytes from %u in %lu ms (%.1f KB/s received, %.1f KB/s written)",
+                wsUploadFileName.c_str(), static_cast<unsigned>(wsZipExtractor.getFileCount()),
+                static_cast<unsigned>(written), static_cast<unsigned>(wsUploadSize), elapsed,
+                wsUploadSize / 1024.0f / seconds, written / 1024.0f / seconds);
+
+        wsServer->sendTXT(num, "EXTRACTED:" + String(wsZipExtractor.getFileCount()) + ":" + String(written));
+        wsServer->sendTXT(num, "DONE");
+      } else if (wsUploadReceived >= wsUploadSize) {
+        esp_task_wdt_reset();
+        const bool written = wsUploadWriter.finish();
+        esp_task_wdt_reset();
         wsUploadInProgress = false;
 
+        String filePath = wsUploadPath;
+        if (!filePath.endsWith("/")) filePath += "/";
+        filePath += wsUploadFileName;
+
+        if (!written) {
+          Storage.remove(filePath.c_str());
+          wsServer->sendTXT(num, "ERROR:Write failed - disk full?");
+          return;
+        }
+
         wsLastCompleteName = wsUploadFileName;
         wsLastCompleteSize = wsUploadSize;
         wsLastCompleteAt = millis();
@@ -1296,13 +1703,15 @@ void CrossPointWebServer::onWebSocketEvent(uint8_t num, WStype_t type, uint8_t*
                 elapsed, kbps);
 
         // Clear epub cache to prevent stale metadata issues when overwriting files
-        String filePath = wsUploadPath;
-        if (!filePath.endsWith("/")) filePath += "/";
-        filePath += wsUploadFileName;
         clearEpubCacheIfNeeded(filePath);
+        LIBRARY_CATALOG.invalidatePath(filePath.c_str());
+        webListing.invalidate();
+        COVER_JOBS.enqueue(filePath.c_str());
 
+        if (!wsUploadWindowed) {
+          wsServer->sendTXT(num, "PROGRESS:" + String(wsUploadReceived) + ":" + String(wsUploadSize));
+        }
         wsServer->sendTXT(num, "DONE");
-        lastProgressSent = 0;
       }
       break;
     }
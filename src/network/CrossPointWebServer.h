@@ -13,6 +13,7 @@
 struct FileInfo {
   String name;
   size_t size;
+  uint32_t modified;  // FAT date << 16 | FAT time, 0 for folders
   bool isEpub;
   bool isDirectory;
 };
@@ -64,6 +65,8 @@ class CrossPointWebServer {
   bool isRunning() const { return running; }
 
   WsUploadStatus getWsUploadStatus() const;
+  // True while no upload is open and nothing has been transferred for a few seconds
+  bool isTransferIdle() const;
 
   // Get the port number
   uint16_t getPort() const { return port; }
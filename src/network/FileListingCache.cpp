@@ -0,0 +1,158 @@
+#include "FileListingCache.h"
+
+#include <Arduino.h>
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "util/StringUtils.h"
+
+namespace {
+constexpr char LISTING_FILE[] = "/.crosspoint/weblist.bin";
+// Leave this much heap to the web server and WiFi while collecting names
+constexpr uint32_t MIN_FREE_HEAP = 40 * 1024;
+// size + mtime + directory flag + name length
+constexpr uint32_t RECORD_FIXED_BYTES = 2 * sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t);
+}  // namespace
+
+bool FileListingCache::matches(const std::string& dirPath, const bool showHidden, const Order order,
+                               const bool descending) const {
+  return valid && path == dirPath && this->showHidden == showHidden && this->order == order &&
+         this->descending == descending;
+}
+
+void FileListingCache::begin(const std::string& dirPath, const bool showHidden, const Order order,
+                             const bool descending) {
+  invalidate();
+  path = dirPath;
+  this->showHidden = showHidden;
+  this->order = order;
+  this->descending = descending;
+  complete = true;
+}
+
+bool FileListingCache::add(const char* name, const uint32_t size, const uint32_t modified, const bool isDirectory) {
+  if (!complete) {
+    return false;
+  }
+  if (ESP.getFreeHeap() < MIN_FREE_HEAP) {
+    LOG_ERR("WLC", "Low memory, listing of %s stops at %u entries", path.c_str(),
+            static_cast<unsigned>(pending.size()));
+    complete = false;
+    return false;
+  }
+  const size_t length = strlen(name);
+  pending.push_back({static_cast<uint32_t>(names.size()), size, modified, static_cast<uint16_t>(length), isDirectory});
+  // Keep the terminator so the sort can compare names in place
+  names.append(name, length + 1);
+  return true;
+}
+
+bool FileListingCache::commit() {
+  const char* pool = names.c_str();
+  const Order sortOrder = order;
+  const bool reverse = descending;
+  std::sort(pending.begin(), pending.end(), [pool, sortOrder, reverse](const PendingEntry& a, const PendingEntry& b) {
+    if (a.isDirectory != b.isDirectory) return a.isDirectory;
+    const PendingEntry& first = reverse ? b : a;
+    const PendingEntry& second = reverse ? a : b;
+    if (sortOrder == Order::SIZE && first.size != second.size) return first.size < second.size;
+    if (sortOrder == Order::MODIFIED && first.modified != second.modified) return first.modified < second.modified;
+    return StringUtils::naturalLess(pool + first.nameOffset, pool + second.nameOffset);
+  });
+
+  FsFile file;
+  bool ok = Storage.openFileForWrite("WLC", LISTING_FILE, file);
+  if (ok) {
+    const auto entryCount = static_cast<uint32_t>(pending.size());
+    // Record offsets go in front so a page starts with a single seek
+    std::vector<uint32_t> offsets;
+    offsets.reserve(entryCount);
+    uint32_t position = sizeof(uint32_t) * (1 + entryCount);
+    for (const auto& entry : pending) {
+      offsets.push_back(position);
+      position += RECORD_FIXED_BYTES + entry.nameLength;
+    }
+    serialization::writePod(file, entryCount);
+    file.write(reinterpret_cast<const uint8_t*>(offsets.data()), offsets.size() * sizeof(uint32_t));
+
+    folderCount = 0;
+    totalBytes = 0;
+    for (const auto& entry : pending) {
+      serialization::writePod(file, entry.size);
+      serialization::writePod(file, entry.modified);
+      serialization::writePod(file, static_cast<uint8_t>(entry.isDirectory));
+      serialization::writePod(file, static_cast<uint32_t>(entry.nameLength));
+      file.write(reinterpret_cast<const uint8_t*>(pool + entry.nameOffset), entry.nameLength);
+      folderCount += entry.isDirectory;
+      totalBytes += entry.size;
+    }
+    ok = file.size() == position;
+    file.close();
+    count = entryCount;
+  }
+  if (!ok) {
+    LOG_ERR("WLC", "Failed to store listing of %s", path.c_str());
+  }
+  valid = ok;
+
+  pending = std::vector<PendingEntry>();
+  names = std::string();
+  return ok;
+}
+
+bool FileListingCache::read(const uint32_t offset, const uint32_t limit,
+                            const std::function<void(const ListingEntry&)>& callback) const {
+  if (!valid) {
+    return false;
+  }
+  if (offset >= count || limit == 0) {
+    return true;
+  }
+  FsFile file;
+  if (!Storage.openFileForRead("WLC", LISTING_FILE, file)) {
+    return false;
+  }
+  uint32_t position = 0;
+  file.seek(sizeof(uint32_t) * (1 + offset));
+  serialization::readPod(file, position);
+  if (!file.seek(position)) {
+    file.close();
+    return false;
+  }
+
+  const uint32_t end = std::min(count, offset + std::min(limit, count - offset));
+  ListingEntry entry;
+  bool ok = true;
+  for (uint32_t i = offset; ok && i < end; i++) {
+    uint8_t isDirectory = 0;
+    uint32_t nameLength = 0;
+    serialization::readPod(file, entry.size);
+    serialization::readPod(file, entry.modified);
+    serialization::readPod(file, isDirectory);
+    serialization::readPod(file, nameLength);
+    entry.isDirectory = isDirectory != 0;
+    ok = nameLength <= UINT16_MAX;
+    if (ok) {
+      entry.name.resize(nameLength);
+      ok = nameLength == 0 || file.read(&entry.name[0], nameLength) == static_cast<int>(nameLength);
+    }
+    if (ok) {
+      callback(entry);
+    }
+  }
+  file.close();
+  return ok;
+}
+
+void FileListingCache::invalidate() {
+  valid = false;
+  count = 0;
+  folderCount = 0;
+  totalBytes = 0;
+  pending = std::vector<PendingEntry>();
+  names = std::string();
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ListingEntry {
+  std::string name;
+  uint32_t size = 0;
+  uint32_t modified = 0;  // FAT date << 16 | FAT time
+  bool isDirectory = false;
+};
+
+// Sorted listing of the folder last shown in the web file manager, kept on the SD card at /.crosspoint/weblist.bin
+// with a table of record offsets in front, so a page of a large folder costs one seek and the entries returned rather
+// than a directory scan and a sort. There is a single listing; it is only trusted within one server session and is
+// dropped whenever the web server changes a folder (upload, new folder, rename, move, delete).
+//
+// Building a listing holds all names of the folder in one buffer to sort them, about 16 bytes per entry plus the
+// names. It stops adding entries when the heap runs low and reports the listing as incomplete.
+class FileListingCache {
+ public:
+  enum class Order : uint8_t { NAME, SIZE, MODIFIED };
+
+  // True if the stored listing is for `dirPath` with these options
+  bool matches(const std::string& dirPath, bool showHidden, Order order, bool descending) const;
+
+  // Starts collecting a new listing; the previous one is dropped
+  void begin(const std::string& dirPath, bool showHidden, Order order, bool descending);
+  // Adds one entry to the listing being built. False once memory is short and the rest of the folder is left out.
+  bool add(const char* name, uint32_t size, uint32_t modified, bool isDirectory);
+  // Sorts the collected entries (folders first) and writes them to the card
+  bool commit();
+
+  // Calls `callback` for up to `limit` entries starting at `offset`. False if the listing can't be read.
+  bool read(uint32_t offset, uint32_t limit, const std::function<void(const ListingEntry&)>& callback) const;
+
+  void invalidate();
+
+  uint32_t getCount() const { return count; }
+  uint32_t getFolderCount() const { return folderCount; }
+  uint64_t getTotalBytes() const { return totalBytes; }
+  bool isComplete() const { return complete; }
+
+ private:
+  struct PendingEntry {
+    uint32_t nameOffset;
+    uint32_t size;
+    uint32_t modified;
+    uint16_t nameLength;
+    bool isDirectory;
+  };
+
+  std::string path;
+  bool showHidden = false;
+  Order order = Order::NAME;
+  bool descending = false;
+  bool valid = false;
+  bool complete = true;
+  uint32_t count = 0;
+  uint32_t folderCount = 0;
+  uint64_t totalBytes = 0;
+
+  // Only while building
+  std::vector<PendingEntry> pending;
+  std::string names;
+};
@@ -5,14 +5,93 @@
 #include <StreamString.h>
 #include <WiFiClient.h>
 #include <WiFiClientSecure.h>
+#include <Serialization.h>
 #include <base64.h>
 
+#include <algorithm>
 #include <cstring>
 #include <memory>
+#include <new>
 
 #include "CrossPointSettings.h"
 #include "util/UrlUtils.h"
 
+namespace {
+constexpr uint8_t PART_INFO_VERSION = 1;
+
+// Sidecar of a .part file: what it is a partial copy of
+struct PartInfo {
+  std::string url;
+  // ETag or Last-Modified, sent back as If-Range so a changed file is downloaded again from the start
+  std::string validator;
+  uint32_t total = 0;
+};
+
+bool loadPartInfo(const std::string& path, PartInfo& info) {
+  FsFile file;
+  if (!Storage.openFileForRead("HTTP", path, file)) {
+    return false;
+  }
+  uint8_t version = 0;
+  serialization::readPod(file, version);
+  // Both strings are short; anything bigger is a corrupt file
+  const bool ok = version == PART_INFO_VERSION && file.size() < 4096;
+  if (ok) {
+    serialization::readString(file, info.url);
+    serialization::readString(file, info.validator);
+    serialization::readPod(file, info.total);
+  }
+  file.close();
+  return ok;
+}
+
+bool savePartInfo(const std::string& path, const PartInfo& info) {
+  FsFile file;
+  if (!Storage.openFileForWrite("HTTP", path, file)) {
+    return false;
+  }
+  serialization::writePod(file, PART_INFO_VERSION);
+  serialization::writeString(file, info.url);
+  serialization::writeString(file, info.validator);
+  serialization::writePod(file, info.total);
+  file.close();
+  return true;
+}
+
+// Collects received data and writes it out in pieces that end on block boundaries of the file
+class BlockBuffer {
+  FsFile& file;
+  uint8_t* buffer;
+  const size_t blockSize;
+  size_t fileOffset;
+  size_t length = 0;
+
+  size_t capacity() const { return blockSize - fileOffset % blockSize; }
+
+ public:
+  BlockBuffer(FsFile& file, uint8_t* buffer, const size_t blockSize, const size_t fileOffset)
+      : file(file), buffer(buffer), blockSize(blockSize), fileOffset(fileOffset) {}
+
+  // Free space to receive into
+  uint8_t* space(size_t& available) {
+    available = capacity() - length;
+    return buffer + length;
+  }
+  bool commit(const size_t count) {
+    length += count;
+    return length < capacity() || flush();
+  }
+  bool flush() {
+    if (length > 0 && file.write(buffer, length) != length) {
+      return false;
+    }
+    fileOffset += length;
+    length = 0;
+    return true;
+  }
+};
+}  // namespace
+
 bool HttpDownloader::fetchUrl(const std::string& url, Stream& outContent) {
   // Use WiFiClientSecure for HTTPS, regular WiFiClient for HTTP
   std::unique_ptr<WiFiClient> client;
@@ -53,6 +132,66 @@ bool HttpDownloader::fetchUrl(const std::string& url, Stream& outContent) {
   return true;
 }
 
+HttpDownloader::FetchResult HttpDownloader::fetchUrlIfModified(const std::string& url, Stream& outContent,
+                                                               std::string& etag, std::string& lastModified) {
+  // Use WiFiClientSecure for HTTPS, regular WiFiClient for HTTP
+  std::unique_ptr<WiFiClient> client;
+  if (UrlUtils::isHttpsUrl(url)) {
+    auto* secureClient = new WiFiClientSecure();
+    secureClient->setInsecure();
+    client.reset(secureClient);
+  } else {
+    client.reset(new WiFiClient());
+  }
+  HTTPClient http;
+
+  LOG_DBG("HTTP", "Fetching: %s%s", url.c_str(), etag.empty() && lastModified.empty() ? "" : " (revalidating)");
+
+  http.begin(*client, url.c_str());
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  http.addHeader("User-Agent", "CrossPoint-ESP32-" CROSSPOINT_VERSION);
+
+  // Add Basic HTTP auth if credentials are configured
+  if (strlen(SETTINGS.opdsUsername) > 0 && strlen(SETTINGS.opdsPassword) > 0) {
+    std::string credentials = std::string(SETTINGS.opdsUsername) + ":" + SETTINGS.opdsPassword;
+    String encoded = base64::encode(credentials.c_str());
+    http.addHeader("Authorization", "Basic " + encoded);
+  }
+
+  if (!etag.empty()) {
+    http.addHeader("If-None-Match", etag.c_str());
+  }
+  if (!lastModified.empty()) {
+    http.addHeader("If-Modified-Since", lastModified.c_str());
+  }
+  const char* responseHeaders[] = {"ETag", "Last-Modified"};
+  http.collectHeaders(responseHeaders, sizeof(responseHeaders) / sizeof(responseHeaders[0]));
+
+  const int httpCode = http.GET();
+  if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+    http.end();
+    LOG_DBG("HTTP", "Not modified");
+    return NOT_MODIFIED;
+  }
+  if (httpCode != HTTP_CODE_OK) {
+    LOG_ERR("HTTP", "Fetch failed: %d", httpCode);
+    http.end();
+    return FETCH_FAILED;
+  }
+
+  etag = http.header("ETag").c_str();
+  lastModified = http.header("Last-Modified").c_str();
+  const int written = http.writeToStream(&outContent);
+  http.end();
+  if (written < 0) {
+    LOG_ERR("HTTP", "Fetch failed while reading: %d", written);
+    return FETCH_FAILED;
+  }
+
+  LOG_DBG("HTTP", "Fetch success");
+  return FETCHED;
+}
+
 bool HttpDownloader::fetchUrl(const std::string& url, std::string& outContent) {
   StreamString stream;
   if (!fetchUrl(url, stream)) {
@@ -63,7 +202,7 @@ bool HttpDownloader::fetchUrl(const std::string& url, std::string& outContent) {
 }
 
 bool HttpDownloader::postUrl(const std::string& url, const std::string& body, const std::string& authHeader,
-                             std::string& outContent) {
+                             Stream& outContent) {
   std::unique_ptr<WiFiClient> client;
   if (UrlUtils::isHttpsUrl(url)) {
     auto* secureClient = new WiFiClientSecure();
@@ -92,15 +231,89 @@ bool HttpDownloader::postUrl(const std::string& url, const std::string& body, co
     return false;
   }
 
-  outContent = http.getString().c_str();
+  const int written = http.writeToStream(&outContent);
   http.end();
+  if (written < 0) {
+    LOG_ERR("HTTP", "POST failed while reading: %d", written);
+    return false;
+  }
+
+  LOG_DBG("HTTP", "POST success (%d bytes)", written);
+  return true;
+}
 
-  LOG_DBG("HTTP", "POST success (%zu bytes)", outContent.size());
+bool HttpDownloader::postUrl(const std::string& url, const std::string& body, const std::string& authHeader,
+                             std::string& outContent) {
+  StreamString stream;
+  if (!postUrl(url, body, authHeader, stream)) {
+    return false;
+  }
+  outContent = stream.c_str();
   return true;
 }
 
 HttpDownloader::DownloadError HttpDownloader::downloadToFile(const std::string& url, const std::string& destPath,
                                                              ProgressCallback progress) {
+  const std::string partPath = destPath + ".part";
+  const std::string infoPath = partPath + ".info";
+
+  LOG_DBG("HTTP", "Downloading: %s", url.c_str());
+  LOG_DBG("HTTP", "Destination: %s", destPath.c_str());
+
+  DownloadError result = HTTP_ERROR;
+  bool retry = false;
+  for (int attempt = 0; attempt < MAX_DOWNLOAD_ATTEMPTS; attempt++) {
+    if (attempt > 0) {
+      LOG_DBG("HTTP", "Retrying download (attempt %d)...", attempt + 1);
+      delay(1000 * attempt);  // Give the connection a moment to come back
+    }
+    result = downloadAttempt(url, partPath, infoPath, progress, retry);
+    if (result == OK || !retry) {
+      break;
+    }
+  }
+
+  if (result != OK) {
+    // Keep the partial copy for the next call only if the connection was to blame
+    if (!retry) {
+      Storage.remove(partPath.c_str());
+      Storage.remove(infoPath.c_str());
+    }
+    return result;
+  }
+
+  if (Storage.exists(destPath.c_str())) {
+    Storage.remove(destPath.c_str());
+  }
+  FsFile part = Storage.open(partPath.c_str(), O_RDWR);
+  if (!part || !part.rename(destPath.c_str())) {
+    LOG_ERR("HTTP", "Failed to move download into place");
+    if (part) {
+      part.close();
+    }
+    return FILE_ERROR;
+  }
+  part.close();
+  Storage.remove(infoPath.c_str());
+  return OK;
+}
+
+HttpDownloader::DownloadError HttpDownloader::downloadAttempt(const std::string& url, const std::string& partPath,
+                                                              const std::string& infoPath,
+                                                              const ProgressCallback& progress, bool& retry) {
+  retry = false;
+
+  // Resume only a partial copy of this URL whose version the server can confirm
+  PartInfo info;
+  size_t existing = 0;
+  if (Storage.exists(partPath.c_str()) && loadPartInfo(infoPath, info) && info.url == url && !info.validator.empty()) {
+    FsFile part;
+    if (Storage.openFileForRead("HTTP", partPath, part)) {
+      existing = part.size();
+      part.close();
+    }
+  }
+
   // Use WiFiClientSecure for HTTPS, regular WiFiClient for HTTP
   std::unique_ptr<WiFiClient> client;
   if (UrlUtils::isHttpsUrl(url)) {
@@ -112,9 +325,6 @@ HttpDownloader::DownloadError HttpDownloader::downloadToFile(const std::string&
   }
   HTTPClient http;
 
-  LOG_DBG("HTTP", "Downloading: %s", url.c_str());
-  LOG_DBG("HTTP", "Destination: %s", destPath.c_str());
-
   http.begin(*client, url.c_str());
   http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
   http.addHeader("User-Agent", "CrossPoint-ESP32-" CROSSPOINT_VERSION);
@@ -126,83 +336,136 @@ HttpDownloader::DownloadError HttpDownloader::downloadToFile(const std::string&
     http.addHeader("Authorization", "Basic " + encoded);
   }
 
-  const int httpCode = http.GET();
-  if (httpCode != HTTP_CODE_OK) {
-    LOG_ERR("HTTP", "Download failed: %d", httpCode);
-    http.end();
-    return HTTP_ERROR;
+  if (existing > 0) {
+    LOG_DBG("HTTP", "Resuming at %zu bytes", existing);
+    http.addHeader("Range", ("bytes=" + std::to_string(existing) + "-").c_str());
+    http.addHeader("If-Range", info.validator.c_str());
   }
+  const char* responseHeaders[] = {"ETag", "Last-Modified", "Content-Range"};
+  http.collectHeaders(responseHeaders, sizeof(responseHeaders) / sizeof(responseHeaders[0]));
 
-  const size_t contentLength = http.getSize();
-  LOG_DBG("HTTP", "Content-Length: %zu", contentLength);
-
-  // Remove existing file if present
-  if (Storage.exists(destPath.c_str())) {
-    Storage.remove(destPath.c_str());
+  const int httpCode = http.GET();
+  if (httpCode == 416 && existing > 0 && existing == info.total) {
+    // The previous attempt got everything but the confirmation
+    http.end();
+    return OK;
   }
 
-  // Open file for writing
   FsFile file;
-  if (!Storage.openFileForWrite("HTTP", destPath.c_str(), file)) {
-    LOG_ERR("HTTP", "Failed to open file for writing");
+  if (httpCode == HTTP_CODE_PARTIAL_CONTENT && existing > 0) {
+    // "bytes <first>-<last>/<total>": only a range starting where the copy ends can be appended
+    const String contentRange = http.header("Content-Range");
+    const int dash = contentRange.indexOf('-');
+    if (!contentRange.startsWith("bytes ") || dash < 0 ||
+        strtoul(contentRange.substring(6, dash).c_str(), nullptr, 10) != existing) {
+      LOG_ERR("HTTP", "Unexpected Content-Range: %s", contentRange.c_str());
+      http.end();
+      return HTTP_ERROR;
+    }
+    file = Storage.open(partPath.c_str(), O_RDWR);
+    if (!file || !file.seek(existing)) {
+      LOG_ERR("HTTP", "Failed to reopen partial download");
+      http.end();
+      return FILE_ERROR;
+    }
+  } else if (httpCode == HTTP_CODE_OK) {
+    // Fresh copy: the server ignored the range, or the file changed since the partial copy was made
+    existing = 0;
+    const String etag = http.header("ETag");
+    info.url = url;
+    // If-Range needs a strong validator
+    info.validator = (!etag.isEmpty() && !etag.startsWith("W/")) ? etag.c_str() : http.header("Last-Modified").c_str();
+    info.total = http.getSize() > 0 ? http.getSize() : 0;
+    if (!Storage.openFileForWrite("HTTP", partPath, file)) {
+      LOG_ERR("HTTP", "Failed to open file for writing");
+      http.end();
+      return FILE_ERROR;
+    }
+    savePartInfo(infoPath, info);
+  } else {
+    LOG_ERR("HTTP", "Download failed: %d", httpCode);
     http.end();
-    return FILE_ERROR;
+    // Negative codes are connection failures rather than answers from the server
+    retry = httpCode < 0;
+    return HTTP_ERROR;
   }
 
+  LOG_DBG("HTTP", "Content-Length: %d, total: %u", http.getSize(), static_cast<unsigned>(info.total));
+
   // Get the stream for chunked reading
   WiFiClient* stream = http.getStreamPtr();
-  if (!stream) {
-    LOG_ERR("HTTP", "Failed to get stream");
+  std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[WRITE_BLOCK_SIZE]);
+  if (!stream || !buffer) {
+    LOG_ERR("HTTP", stream ? "Not enough memory for download buffer" : "Failed to get stream");
     file.close();
-    Storage.remove(destPath.c_str());
     http.end();
-    return HTTP_ERROR;
+    return stream ? FILE_ERROR : HTTP_ERROR;
   }
 
-  // Download in chunks
-  uint8_t buffer[DOWNLOAD_CHUNK_SIZE];
-  size_t downloaded = 0;
-  const size_t total = contentLength > 0 ? contentLength : 0;
+  BlockBuffer writer(file, buffer.get(), WRITE_BLOCK_SIZE, existing);
+  size_t downloaded = existing;
+  const size_t total = info.total;
+  unsigned long lastData = millis();
+  bool writeFailed = false;
+  // Without a Content-Length only the server closing the connection marks the end of the body
+  bool closedByServer = false;
 
-  while (http.connected() && (contentLength == 0 || downloaded < contentLength)) {
+  while (total == 0 || downloaded < total) {
     const size_t available = stream->available();
     if (available == 0) {
+      if (!http.connected()) {
+        closedByServer = true;
+        break;
+      }
+      if (millis() - lastData > STALL_TIMEOUT_MS) {
+        LOG_ERR("HTTP", "Download stalled at %zu bytes", downloaded);
+        break;
+      }
       delay(1);
       continue;
     }
 
-    const size_t toRead = available < DOWNLOAD_CHUNK_SIZE ? available : DOWNLOAD_CHUNK_SIZE;
-    const size_t bytesRead = stream->readBytes(buffer, toRead);
-
+    size_t space;
+    uint8_t* target = writer.space(space);
+    const size_t bytesRead = stream->readBytes(target, std::min(available, space));
     if (bytesRead == 0) {
       break;
     }
-
-    const size_t written = file.write(buffer, bytesRead);
-    if (written != bytesRead) {
-      LOG_ERR("HTTP", "Write failed: wrote %zu of %zu bytes", written, bytesRead);
-      file.close();
-      Storage.remove(destPath.c_str());
-      http.end();
-      return FILE_ERROR;
+    if (!writer.commit(bytesRead)) {
+      writeFailed = true;
+      break;
     }
 
     downloaded += bytesRead;
+    lastData = millis();
 
     if (progress && total > 0) {
       progress(downloaded, total);
     }
   }
 
+  writeFailed = writeFailed || !writer.flush();
   file.close();
   http.end();
 
+  if (writeFailed) {
+    LOG_ERR("HTTP", "Write failed at %zu bytes", downloaded);
+    return FILE_ERROR;
+  }
+
+  if (total == 0 && !closedByServer) {
+    LOG_ERR("HTTP", "Body of unknown length cut short at %zu bytes", downloaded);
+    retry = true;
+    return HTTP_ERROR;
+  }
+
   LOG_DBG("HTTP", "Downloaded %zu bytes", downloaded);
 
   // Verify download size if known
-  if (contentLength > 0 && downloaded != contentLength) {
-    LOG_ERR("HTTP", "Size mismatch: got %zu, expected %zu", downloaded, contentLength);
-    Storage.remove(destPath.c_str());
+  if (total > 0 && downloaded != total) {
+    LOG_ERR("HTTP", "Size mismatch: got %zu, expected %zu", downloaded, total);
+    // Resumable as long as the server gave a validator; otherwise the next attempt starts over anyway
+    retry = true;
     return HTTP_ERROR;
   }
 
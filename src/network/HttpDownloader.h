@@ -29,6 +29,23 @@ class HttpDownloader {
 
   static bool fetchUrl(const std::string& url, Stream& stream);
 
+  enum FetchResult {
+    FETCHED,
+    NOT_MODIFIED,
+    FETCH_FAILED,
+  };
+
+  /**
+   * Fetch a URL unless the server confirms that a cached copy is still current.
+   * @param url The URL to fetch
+   * @param stream Receives the content when it is FETCHED
+   * @param etag In: ETag of the cached copy, or empty. Out: ETag of the fetched content.
+   * @param lastModified In: Last-Modified of the cached copy, or empty. Out: that of the fetched content.
+   * @return FETCHED, NOT_MODIFIED (304, nothing written) or FETCH_FAILED
+   */
+  static FetchResult fetchUrlIfModified(const std::string& url, Stream& stream, std::string& etag,
+                                        std::string& lastModified);
+
   /**
    * POST to a URL and get the response body.
    * @param url The URL to POST to
@@ -40,8 +57,14 @@ class HttpDownloader {
   static bool postUrl(const std::string& url, const std::string& body, const std::string& authHeader,
                       std::string& outContent);
 
+  // POST with the response body streamed into `stream` as it arrives, so large responses need no buffer of their own
+  static bool postUrl(const std::string& url, const std::string& body, const std::string& authHeader, Stream& stream);
+
   /**
    * Download a file to the SD card.
+   * Data goes to "<destPath>.part", which is renamed once complete. Dropped connections are retried, resuming with a
+   * Range request when the server sent a validator (ETag or Last-Modified). A download that still fails leaves the
+   * .part file and its ".part.info" sidecar behind, and the next call for the same URL and path resumes it.
    * @param url The URL to download
    * @param destPath The destination path on SD card
    * @param progress Optional progress callback
@@ -51,5 +74,13 @@ class HttpDownloader {
                                       ProgressCallback progress = nullptr);
 
  private:
-  static constexpr size_t DOWNLOAD_CHUNK_SIZE = 1024;
+  // Writes end on multiples of this in the file, so they stay sector-aligned even after resuming mid-block
+  static constexpr size_t WRITE_BLOCK_SIZE = 8192;
+  static constexpr int MAX_DOWNLOAD_ATTEMPTS = 4;
+  // A connection that delivers nothing for this long counts as dropped
+  static constexpr unsigned long STALL_TIMEOUT_MS = 15000;
+
+  // One request; `retry` is set when the failure was the connection's and another attempt may succeed
+  static DownloadError downloadAttempt(const std::string& url, const std::string& partPath,
+                                       const std::string& infoPath, const ProgressCallback& progress, bool& retry);
 };
@@ -134,6 +134,31 @@ std::string jsonExtract(const std::string& json, const std::string& key, size_t
     return json.substr(pos, end - pos);
   }
 }
+// Ids in a "delete_ids" list, given either as a JSON array or as a comma-separated string
+void parseDeleteIds(const std::string& json, std::vector<std::string>& outIds) {
+  size_t pos = json.find("\"delete_ids\"");
+  if (pos == std::string::npos) return;
+  pos += 12;
+  while (pos < json.size() && (json[pos] == ' ' || json[pos] == ':')) pos++;
+  if (pos >= json.size()) return;
+
+  const char close = json[pos] == '[' ? ']' : json[pos] == '"' ? '"' : 0;
+  if (close == 0) return;
+  const size_t end = json.find(close, pos + 1);
+  if (end == std::string::npos) return;
+
+  std::string id;
+  for (size_t i = pos + 1; i <= end; i++) {
+    const char c = json[i];
+    if (c >= '0' && c <= '9') {
+      id += c;
+    } else if (c == ',' || i == end) {
+      if (!id.empty()) outIds.push_back(id);
+      id.clear();
+    }
+  }
+}
+
 template <typename Fn>
 bool withRetries(Fn fn, int maxRetries = 3) {
   for (int i = 0; i < maxRetries; i++) {
@@ -181,12 +206,27 @@ bool InstapaperClient::authenticate(const std::string& username, const std::stri
   return true;
 }
 
-bool InstapaperClient::listBookmarks(int limit, std::vector<InstapaperBookmark>& outBookmarks) {
+bool InstapaperClient::listBookmarks(int limit, const std::vector<InstapaperBookmark>& known,
+                                     std::vector<InstapaperBookmark>& outBookmarks,
+                                     std::vector<std::string>& outDeletedIds) {
   std::string url = std::string(BASE_URL) + "/api/1/bookmarks/list";
 
   std::map<std::string, std::string> params;
   params["limit"] = std::to_string(limit);
 
+  // have=id:hash:progress:progress_timestamp,... for everything we already hold
+  std::string have;
+  for (const auto& bm : known) {
+    if (bm.bookmarkId.empty() || bm.hash.empty()) continue;
+    char progress[48];
+    snprintf(progress, sizeof(progress), ":%.4f:%ld", bm.progress, bm.progressTimestamp);
+    if (!have.empty()) have += ",";
+    have += bm.bookmarkId + ":" + bm.hash + progress;
+  }
+  if (!have.empty()) {
+    params["have"] = have;
+  }
+
   const auto& token = INSTAPAPER_STORE.getToken();
   const auto& tokenSecret = INSTAPAPER_STORE.getTokenSecret();
 
@@ -202,6 +242,8 @@ bool InstapaperClient::listBookmarks(int limit, std::vector<InstapaperBookmark>&
 
   // Parse JSON array - find bookmark objects with "type":"bookmark"
   outBookmarks.clear();
+  outDeletedIds.clear();
+  parseDeleteIds(response, outDeletedIds);
   size_t pos = 0;
   while (pos < response.size()) {
     size_t typePos = response.find("\"type\"", pos);
@@ -231,6 +273,9 @@ bool InstapaperClient::listBookmarks(int limit, std::vector<InstapaperBookmark>&
       bm.title = jsonExtract(obj, "title");
       bm.url = jsonExtract(obj, "url");
       bm.time = atol(jsonExtract(obj, "time").c_str());
+      bm.hash = jsonExtract(obj, "hash");
+      bm.progress = atof(jsonExtract(obj, "progress").c_str());
+      bm.progressTimestamp = atol(jsonExtract(obj, "progress_timestamp").c_str());
 
       if (!bm.bookmarkId.empty()) {
         outBookmarks.push_back(std::move(bm));
@@ -240,11 +285,13 @@ bool InstapaperClient::listBookmarks(int limit, std::vector<InstapaperBookmark>&
     pos = objEnd;
   }
 
-  LOG_DBG("IPC", "Found %d bookmarks", outBookmarks.size());
+  LOG_DBG("IPC", "Found %d new or changed bookmarks, %d removed (%zu bytes)", outBookmarks.size(),
+          outDeletedIds.size(), response.size());
   return true;
 }
 
-bool InstapaperClient::getArticleText(const std::string& bookmarkId, std::string& outHtml) {
+bool InstapaperClient::getArticleText(const std::string& bookmarkId, Stream& out,
+                                      const std::function<void()>& beforeAttempt) {
   std::string url = std::string(BASE_URL) + "/api/1/bookmarks/get_text";
 
   std::map<std::string, std::string> params;
@@ -253,15 +300,17 @@ bool InstapaperClient::getArticleText(const std::string& bookmarkId, std::string
   const auto& token = INSTAPAPER_STORE.getToken();
   const auto& tokenSecret = INSTAPAPER_STORE.getTokenSecret();
 
-  std::string authHeader = InstapaperOAuth::sign("POST", url, params, InstapaperSecrets::consumerKey(), InstapaperSecrets::consumerSecret(), token, tokenSecret);
+  std::string authHeader = InstapaperOAuth::sign("POST", url, params, InstapaperSecrets::consumerKey(),
+                                                 InstapaperSecrets::consumerSecret(), token, tokenSecret);
   std::string body = buildBody(params);
 
-  bool ok = withRetries([&]() { return HttpDownloader::postUrl(url, body, authHeader, outHtml); });
+  bool ok = withRetries([&]() {
+    beforeAttempt();
+    return HttpDownloader::postUrl(url, body, authHeader, out);
+  });
   if (!ok) {
     LOG_ERR("IPC", "Get article text failed for bookmark %s after retries", bookmarkId.c_str());
     return false;
   }
-
-  LOG_DBG("IPC", "Got article text: %zu bytes", outHtml.size());
   return true;
 }
@@ -1,4 +1,7 @@
 #pragma once
+#include <Stream.h>
+
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -7,6 +10,10 @@ struct InstapaperBookmark {
   std::string title;
   std::string url;
   long time = 0;
+  // Changes whenever the bookmark does (title, progress, ...); sent back so unchanged bookmarks aren't listed again
+  std::string hash;
+  float progress = 0;  // Reading progress 0..1 as last synced
+  long progressTimestamp = 0;
 };
 
 class InstapaperClient {
@@ -15,9 +22,12 @@ class InstapaperClient {
   static bool authenticate(const std::string& username, const std::string& password, std::string& outToken,
                            std::string& outTokenSecret);
 
-  // List unread bookmarks (requires stored credentials)
-  static bool listBookmarks(int limit, std::vector<InstapaperBookmark>& outBookmarks);
+  // List unread bookmarks (requires stored credentials). Bookmarks in `known` with a hash are reported to the server,
+  // which then leaves out those that haven't changed and lists the ids of those that were archived or deleted.
+  static bool listBookmarks(int limit, const std::vector<InstapaperBookmark>& known,
+                            std::vector<InstapaperBookmark>& outBookmarks, std::vector<std::string>& outDeletedIds);
 
-  // Get article HTML text
-  static bool getArticleText(const std::string& bookmarkId, std::string& outHtml);
+  // Stream article HTML into `out` as it arrives. `beforeAttempt` runs before every try so the receiver can start over
+  // when a retry follows a partial response.
+  static bool getArticleText(const std::string& bookmarkId, Stream& out, const std::function<void()>& beforeAttempt);
 };
@@ -0,0 +1,179 @@
+#include "OpdsFeedCache.h"
+
+#include <HalStorage.h>
+#include <Logging.h>
+#include <Serialization.h>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "HttpDownloader.h"
+
+namespace {
+constexpr uint8_t OPDS_CACHE_FILE_VERSION = 1;
+constexpr char OPDS_CACHE_DIR[] = "/.crosspoint/opds";
+constexpr char OPDS_CACHE_INDEX[] = "/.crosspoint/opds/index.bin";
+// URLs and validators are short; a bigger string means the index is corrupt
+constexpr uint32_t MAX_STRING_LENGTH = 2048;
+
+uint32_t urlHash(const std::string& url) {
+  uint32_t hash = 2166136261u;
+  for (const char c : url) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+bool readBoundedString(FsFile& file, std::string& s) {
+  uint32_t length = 0;
+  serialization::readPod(file, length);
+  if (length > MAX_STRING_LENGTH) {
+    return false;
+  }
+  s.resize(length);
+  return file.read(reinterpret_cast<uint8_t*>(&s[0]), length) == static_cast<int>(length);
+}
+}  // namespace
+
+std::string OpdsFeedCache::pathFor(const std::string& url) {
+  char name[16];
+  snprintf(name, sizeof(name), "/%08x.xml", static_cast<unsigned>(urlHash(url)));
+  return std::string(OPDS_CACHE_DIR) + name;
+}
+
+bool OpdsFeedCache::loadIndex(std::vector<Feed>& feeds) {
+  feeds.clear();
+  FsFile file;
+  if (!Storage.exists(OPDS_CACHE_INDEX) || !Storage.openFileForRead("OPC", OPDS_CACHE_INDEX, file)) {
+    return false;
+  }
+  uint8_t version = 0;
+  uint8_t count = 0;
+  serialization::readPod(file, version);
+  serialization::readPod(file, count);
+  bool ok = version == OPDS_CACHE_FILE_VERSION && count <= MAX_FEEDS;
+  for (uint8_t i = 0; ok && i < count; i++) {
+    Feed feed;
+    ok = readBoundedString(file, feed.url) && readBoundedString(file, feed.etag) &&
+         readBoundedString(file, feed.lastModified);
+    serialization::readPod(file, feed.lastUsed);
+    feeds.push_back(std::move(feed));
+  }
+  file.close();
+  if (!ok) {
+    LOG_DBG("OPC", "Ignoring unreadable feed cache index");
+    feeds.clear();
+  }
+  return ok;
+}
+
+void OpdsFeedCache::saveIndex(const std::vector<Feed>& feeds) {
+  FsFile file;
+  if (!Storage.openFileForWrite("OPC", OPDS_CACHE_INDEX, file)) {
+    return;
+  }
+  serialization::writePod(file, OPDS_CACHE_FILE_VERSION);
+  serialization::writePod(file, static_cast<uint8_t>(feeds.size()));
+  for (const auto& feed : feeds) {
+    serialization::writeString(file, feed.url);
+    serialization::writeString(file, feed.etag);
+    serialization::writeString(file, feed.lastModified);
+    serialization::writePod(file, feed.lastUsed);
+  }
+  file.close();
+}
+
+std::string OpdsFeedCache::find(const std::string& url) {
+  std::vector<Feed> feeds;
+  loadIndex(feeds);
+  const std::string path = pathFor(url);
+  const bool cached = std::any_of(feeds.begin(), feeds.end(), [&url](const Feed& f) { return f.url == url; });
+  return cached && Storage.exists(path.c_str()) ? path : std::string();
+}
+
+std::string OpdsFeedCache::fetch(const std::string& url) {
+  Storage.mkdir(OPDS_CACHE_DIR);
+  std::vector<Feed> feeds;
+  loadIndex(feeds);
+
+  const std::string path = pathFor(url);
+  auto it = std::find_if(feeds.begin(), feeds.end(), [&url](const Feed& f) { return f.url == url; });
+  // Another URL with the same hash owns the file: replace it
+  const bool cached = it != feeds.end() && Storage.exists(path.c_str());
+  Feed feed = cached ? *it : Feed{url, "", "", 0};
+  if (it != feeds.end()) {
+    feeds.erase(it);
+  }
+  feeds.erase(std::remove_if(feeds.begin(), feeds.end(), [&path](const Feed& f) { return pathFor(f.url) == path; }),
+              feeds.end());
+
+  // Download next to the cached copy so a failed fetch leaves it intact
+  const std::string tmpPath = path + ".tmp";
+  FsFile tmp;
+  if (!Storage.openFileForWrite("OPC", tmpPath, tmp)) {
+    return cached ? path : std::string();
+  }
+  std::string etag = cached ? feed.etag : std::string();
+  std::string lastModified = cached ? feed.lastModified : std::string();
+  const auto result = HttpDownloader::fetchUrlIfModified(url, tmp, etag, lastModified);
+  tmp.close();
+
+  if (result == HttpDownloader::FETCHED) {
+    Storage.remove(path.c_str());
+    FsFile renamed = Storage.open(tmpPath.c_str(), O_RDWR);
+    if (!renamed || !renamed.rename(path.c_str())) {
+      LOG_ERR("OPC", "Failed to store feed %s", url.c_str());
+      if (renamed) {
+        renamed.close();
+      }
+      Storage.remove(tmpPath.c_str());
+      saveIndex(feeds);
+      return std::string();
+    }
+    renamed.close();
+    feed.etag = etag;
+    feed.lastModified = lastModified;
+  } else {
+    Storage.remove(tmpPath.c_str());
+    if (!cached) {
+      saveIndex(feeds);
+      return std::string();
+    }
+    if (result == HttpDownloader::FETCH_FAILED) {
+      LOG_DBG("OPC", "Server unreachable, using cached feed %s", url.c_str());
+    }
+  }
+
+  uint32_t newest = 0;
+  for (const auto& f : feeds) {
+    newest = std::max(newest, f.lastUsed);
+  }
+  feed.lastUsed = newest + 1;
+  feeds.push_back(std::move(feed));
+
+  // Drop the least recently used pages
+  while (feeds.size() > MAX_FEEDS) {
+    const auto oldest = std::min_element(feeds.begin(), feeds.end(),
+                                         [](const Feed& a, const Feed& b) { return a.lastUsed < b.lastUsed; });
+    Storage.remove(pathFor(oldest->url).c_str());
+    feeds.erase(oldest);
+  }
+  saveIndex(feeds);
+  return path;
+}
+
+bool OpdsFeedCache::parse(const std::string& path, OpdsParser& parser) {
+  FsFile file;
+  if (!Storage.openFileForRead("OPC", path, file)) {
+    return false;
+  }
+  uint8_t buffer[1024];
+  int read;
+  while ((read = file.read(buffer, sizeof(buffer))) > 0 && parser) {
+    parser.write(buffer, read);
+  }
+  file.close();
+  parser.flush();
+  return read >= 0 && static_cast<bool>(parser);
+}
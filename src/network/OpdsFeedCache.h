@@ -0,0 +1,35 @@
+#pragma once
+#include <OpdsParser.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Recently visited OPDS feed pages, kept on the SD card under /.crosspoint/opds and keyed by URL. A cached page is
+// revalidated with its ETag / Last-Modified, so going back to a catalog usually costs a 304 rather than the whole
+// feed, and it is used as is when the server can't be reached. The least recently used pages are dropped beyond
+// MAX_FEEDS.
+class OpdsFeedCache {
+ public:
+  static constexpr size_t MAX_FEEDS = 24;
+
+  // Makes sure an up-to-date copy of the feed at `url` is on the card. Returns its path, or an empty string if the
+  // feed could be neither fetched nor found in the cache.
+  static std::string fetch(const std::string& url);
+  // Path of the cached copy of `url` without asking the server, or an empty string if there is none.
+  static std::string find(const std::string& url);
+  // Feeds the cached file at `path` through `parser`. False on a read or parse error.
+  static bool parse(const std::string& path, OpdsParser& parser);
+
+ private:
+  struct Feed {
+    std::string url;
+    std::string etag;
+    std::string lastModified;
+    uint32_t lastUsed = 0;
+  };
+
+  static bool loadIndex(std::vector<Feed>& feeds);
+  static void saveIndex(const std::vector<Feed>& feeds);
+  static std::string pathFor(const std::string& url);
+};
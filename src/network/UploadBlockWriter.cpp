@@ -0,0 +1,118 @@
+#include "UploadBlockWriter.h"
+
+#include <Logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+bool UploadBlockWriter::begin(const std::string& path) {
+  abort();
+
+  if (!taskHandle) {
+    xTaskCreate(&UploadBlockWriter::taskTrampoline, "UploadWriter", 4096, this, tskIDLE_PRIORITY, &taskHandle);
+    if (!taskHandle) {
+      LOG_ERR("UPW", "Failed to start writer task");
+      return false;
+    }
+  }
+
+  fillBuffer = new (std::nothrow) uint8_t[BLOCK_SIZE];
+  writeBuffer = new (std::nothrow) uint8_t[BLOCK_SIZE];
+  if (!fillBuffer || !writeBuffer) {
+    LOG_ERR("UPW", "Not enough memory for upload blocks");
+    release();
+    return false;
+  }
+
+  if (!Storage.openFileForWrite("UPW", path, file)) {
+    release();
+    return false;
+  }
+  fillLength = 0;
+  writeLength = 0;
+  failed = false;
+  return true;
+}
+
+bool UploadBlockWriter::append(const uint8_t* data, size_t length) {
+  if (!fillBuffer || failed) {
+    return false;
+  }
+  while (length > 0) {
+    const size_t n = std::min(length, BLOCK_SIZE - fillLength);
+    memcpy(fillBuffer + fillLength, data, n);
+    fillLength += n;
+    data += n;
+    length -= n;
+    if (fillLength == BLOCK_SIZE && !submitBlock()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool UploadBlockWriter::submitBlock() {
+  waitUntilIdle();
+  if (failed) {
+    return false;
+  }
+  std::swap(fillBuffer, writeBuffer);
+  writeLength = fillLength;
+  fillLength = 0;
+  busy = true;
+  xTaskNotifyGive(taskHandle);
+  return true;
+}
+
+bool UploadBlockWriter::finish() {
+  if (!fillBuffer) {
+    return false;
+  }
+  waitUntilIdle();
+  // The writer task is idle, so the tail can go out from here
+  if (!failed && fillLength > 0 && file.write(fillBuffer, fillLength) != fillLength) {
+    failed = true;
+  }
+  const bool ok = !failed;
+  release();
+  return ok;
+}
+
+void UploadBlockWriter::abort() {
+  waitUntilIdle();
+  release();
+}
+
+void UploadBlockWriter::release() {
+  if (file) {
+    file.close();
+  }
+  delete[] fillBuffer;
+  delete[] writeBuffer;
+  fillBuffer = nullptr;
+  writeBuffer = nullptr;
+  fillLength = 0;
+}
+
+void UploadBlockWriter::waitUntilIdle() const {
+  while (busy) {
+    vTaskDelay(1);
+  }
+}
+
+void UploadBlockWriter::taskTrampoline(void* param) {
+  auto* self = static_cast<UploadBlockWriter*>(param);
+  self->taskLoop();
+}
+
+void UploadBlockWriter::taskLoop() {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (file.write(writeBuffer, writeLength) != writeLength) {
+      LOG_ERR("UPW", "Block write failed");
+      failed = true;
+    }
+    busy = false;
+  }
+}
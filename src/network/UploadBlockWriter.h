@@ -0,0 +1,51 @@
+#pragma once
+#include <HalStorage.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Double-buffered file writer for uploads. Incoming data is copied into one block while a low-priority task writes
+// the other, so the network keeps receiving during SD writes and the card only ever sees whole blocks. Files start
+// on a cluster boundary, so every write but the last is sector-aligned and fills whole clusters of up to 16 KB.
+//
+// The SD card is not safe to use from two tasks at once: while isBusy() the caller must not touch the card itself.
+class UploadBlockWriter {
+  TaskHandle_t taskHandle = nullptr;
+  FsFile file;
+  uint8_t* fillBuffer = nullptr;
+  uint8_t* writeBuffer = nullptr;
+  size_t fillLength = 0;
+  size_t writeLength = 0;
+  volatile bool busy = false;
+  volatile bool failed = false;
+
+  [[noreturn]] static void taskTrampoline(void* param);
+  [[noreturn]] void taskLoop();
+  bool submitBlock();
+  void release();
+
+ public:
+  static constexpr size_t BLOCK_SIZE = 16 * 1024;
+
+  UploadBlockWriter() = default;
+  ~UploadBlockWriter() { release(); }
+  UploadBlockWriter(const UploadBlockWriter&) = delete;
+  UploadBlockWriter& operator=(const UploadBlockWriter&) = delete;
+
+  // Creates (or truncates) `path` and allocates the two blocks. Starts the writer task on first use.
+  bool begin(const std::string& path);
+  // Queues `data` for writing. Blocks only while both blocks are full. False once any write has failed.
+  bool append(const uint8_t* data, size_t length);
+  // Writes what is left, closes the file and frees the blocks. False if any write failed.
+  bool finish();
+  // Closes the file without flushing the partial block and frees the blocks.
+  void abort();
+
+  bool isOpen() const { return fillBuffer != nullptr; }
+  bool isBusy() const { return busy; }
+  // Blocks until the block in flight (if any) is on the card.
+  void waitUntilIdle() const;
+};
@@ -1,5 +1,6 @@
 #include "StringUtils.h"
 
+#include <cctype>
 #include <cstring>
 
 namespace StringUtils {
@@ -61,4 +62,34 @@ bool checkFileExtension(const String& fileName, const char* extension) {
   return localFile.endsWith(localExtension);
 }
 
+bool naturalLess(const char* s1, const char* s2) {
+  while (*s1 && *s2) {
+    if (isdigit(*s1) && isdigit(*s2)) {
+      // Skip leading zeros, then a longer number is larger
+      while (*s1 == '0') s1++;
+      while (*s2 == '0') s2++;
+
+      int len1 = 0, len2 = 0;
+      while (isdigit(s1[len1])) len1++;
+      while (isdigit(s2[len2])) len2++;
+      if (len1 != len2) return len1 < len2;
+
+      for (int i = 0; i < len1; i++) {
+        if (s1[i] != s2[i]) return s1[i] < s2[i];
+      }
+      s1 += len1;
+      s2 += len2;
+    } else {
+      const char c1 = tolower(*s1);
+      const char c2 = tolower(*s2);
+      if (c1 != c2) return c1 < c2;
+      s1++;
+      s2++;
+    }
+  }
+
+  // One string is prefix of other
+  return *s1 == '\0' && *s2 != '\0';
+}
+
 }  // namespace StringUtils
@@ -19,4 +19,9 @@ std::string sanitizeFilename(const std::string& name, size_t maxLength = 100);
 bool checkFileExtension(const std::string& fileName, const char* extension);
 bool checkFileExtension(const String& fileName, const char* extension);
 
+/**
+ * Case-insensitive natural order, so "Book 2" sorts before "Book 10".
+ */
+bool naturalLess(const char* s1, const char* s2);
+
 }  // namespace StringUtils
@@ -1,18 +1,42 @@
 #include <Utf8.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "lib/Epub/Epub/hyphenation/HyphenationCache.h"
 #include "lib/Epub/Epub/hyphenation/HyphenationCommon.h"
+#include "lib/Epub/Epub/hyphenation/Hyphenator.h"
 #include "lib/Epub/Epub/hyphenation/LanguageHyphenator.h"
 #include "lib/Epub/Epub/hyphenation/LanguageRegistry.h"
+#include "lib/Epub/Epub/hyphenation/PagedHyphenationTrie.h"
+
+// Global allocation counter used by the benchmark mode to report heap allocations per hyphenated word.
+std::atomic<size_t> gAllocationCount{0};
+
+// Kept out of line so GCC doesn't flag the malloc/free pairing as a mismatched new/delete at inlined call sites.
+[[gnu::noinline]] void* operator new(std::size_t size) {
+  gAllocationCount.fetch_add(1, std::memory_order_relaxed);
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
 
 struct TestCase {
   std::string word;
@@ -302,7 +326,198 @@ void printResults(const std::string& language, const std::vector<TestCase>& test
   }
 }
 
+struct BenchmarkResult {
+  double wordsPerSecond = 0.0;
+  double allocationsPerWord = 0.0;
+  size_t breaks = 0;
+  size_t words = 0;
+};
+
+// Times `hyphenate` over every test word until at least kMinDuration has elapsed, counting heap allocations.
+BenchmarkResult runBenchmark(const std::vector<TestCase>& testCases,
+                             const std::function<size_t(const std::string&)>& hyphenate) {
+  constexpr auto kMinDuration = std::chrono::milliseconds(500);
+  BenchmarkResult result;
+  size_t words = 0;
+  size_t breaks = 0;
+
+  const size_t allocationsBefore = gAllocationCount.load();
+  const auto start = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::duration::zero();
+  do {
+    for (const auto& testCase : testCases) {
+      breaks += hyphenate(testCase.word);
+    }
+    words += testCases.size();
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed < kMinDuration);
+  const size_t allocations = gAllocationCount.load() - allocationsBefore;
+
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  result.wordsPerSecond = words / seconds;
+  result.allocationsPerWord = static_cast<double>(allocations) / words;
+  result.breaks = breaks;
+  result.words = words;
+  return result;
+}
+
+// Expands the test words by their corpus frequency (in shuffled order) to approximate the word stream of a book.
+std::vector<TestCase> buildBookStream(const std::vector<TestCase>& testCases) {
+  std::vector<TestCase> stream;
+  for (const auto& testCase : testCases) {
+    for (int i = 0; i < std::max(1, testCase.frequency); ++i) {
+      stream.push_back(testCase);
+    }
+  }
+  std::mt19937 rng(42);
+  std::shuffle(stream.begin(), stream.end(), rng);
+  return stream;
+}
+
+// Benchmarks the production path (Hyphenator::breakOffsets with a reused workspace, as a section build uses it) against
+// the allocating vector API kept for tooling, then replays a frequency-weighted book stream through the break cache.
+// stdio-backed trie source standing in for an SD card file.
+class StdioTrieSource final : public PagedHyphenationTrie::Source {
+ public:
+  explicit StdioTrieSource(FILE* file) : file_(file) {
+    std::fseek(file_, 0, SEEK_END);
+    size_ = static_cast<size_t>(std::ftell(file_));
+  }
+  ~StdioTrieSource() override { std::fclose(file_); }
+
+  size_t size() const override { return size_; }
+  size_t readAt(const size_t offset, uint8_t* buffer, const size_t length) override {
+    if (std::fseek(file_, static_cast<long>(offset), SEEK_SET) != 0) {
+      return 0;
+    }
+    return std::fread(buffer, 1, length, file_);
+  }
+
+ private:
+  FILE* file_;
+  size_t size_ = 0;
+};
+
+// Rebuilds the hypher `.bin` file (big-endian root header + automaton) from an embedded blob in a temporary file, the
+// same bytes a user would drop into /.crosspoint/hyphenation/<tag>.bin.
+std::unique_ptr<PagedHyphenationTrie> openPagedTrie(const SerializedHyphenationPatterns& patterns) {
+  FILE* file = std::tmpfile();
+  if (!file) {
+    return nullptr;
+  }
+  const uint32_t root = static_cast<uint32_t>(patterns.rootOffset + 4);
+  const uint8_t header[4] = {static_cast<uint8_t>(root >> 24), static_cast<uint8_t>(root >> 16),
+                             static_cast<uint8_t>(root >> 8), static_cast<uint8_t>(root)};
+  std::fwrite(header, 1, sizeof(header), file);
+  std::fwrite(patterns.data, 1, patterns.size, file);
+  std::fflush(file);
+  return std::make_unique<PagedHyphenationTrie>(std::make_unique<StdioTrieSource>(file));
+}
+
+// Compares lookups against the in-flash automaton with the same automaton read through the page cache.
+void runPagedBenchmarks(const std::vector<LanguageConfig>& languages) {
+  std::cout << "\nlanguage   flash words/s  paged words/s  page hit rate  misses/word  mismatches" << std::endl;
+  for (const auto& lang : languages) {
+    const LanguageEntry* entry = nullptr;
+    for (const auto& candidate : getLanguageEntries()) {
+      if (lang.cliName == candidate.cliName) {
+        entry = &candidate;
+      }
+    }
+    const std::vector<TestCase> testCases = entry ? loadTestData(lang.testDataFile) : std::vector<TestCase>{};
+    auto trie = entry ? openPagedTrie(*entry->patterns) : nullptr;
+    if (!trie || !trie->valid() || testCases.empty()) {
+      std::cerr << "Unable to build paged trie for " << lang.cliName << ". Skipping." << std::endl;
+      continue;
+    }
+
+    const LanguageHyphenator& flash = *entry->hyphenator;
+    const LiangWordConfig& config = flash.config();
+    const LanguageHyphenator paged(*trie, config.isLetter, config.toLower, config.minPrefix, config.minSuffix);
+
+    size_t mismatches = 0;
+    for (const auto& testCase : testCases) {
+      if (hyphenateWordWithHyphenator(testCase.word, flash) != hyphenateWordWithHyphenator(testCase.word, paged)) {
+        ++mismatches;
+      }
+    }
+
+    const auto countBreaks = [](const LanguageHyphenator& hyphenator) {
+      return [&hyphenator](const std::string& word) {
+        CodepointInfo codepoints[kMaxHyphenationWordBytes];
+        LiangWorkspace workspace;
+        const CodepointInfo* cps = codepoints;
+        size_t count = collectCodepoints(word, codepoints, kMaxHyphenationWordBytes);
+        trimSurroundingPunctuationAndFootnote(cps, count);
+        return hyphenator.breakIndexes(cps, count, workspace);
+      };
+    };
+    const auto flashResult = runBenchmark(testCases, countBreaks(flash));
+    const uint32_t hitsBefore = trie->pageHits();
+    const uint32_t missesBefore = trie->pageMisses();
+    const auto pagedResult = runBenchmark(testCases, countBreaks(paged));
+    const uint32_t hits = trie->pageHits() - hitsBefore;
+    const uint32_t misses = trie->pageMisses() - missesBefore;
+    const double hitRate = 100.0 * hits / std::max<uint32_t>(1, hits + misses);
+    const double missesPerWord = static_cast<double>(misses) / std::max<size_t>(1, pagedResult.words);
+
+    std::printf("%-9s %14.0f %14.0f %13.1f%% %12.3f %11zu\n", lang.cliName.c_str(), flashResult.wordsPerSecond,
+                pagedResult.wordsPerSecond, hitRate, missesPerWord, mismatches);
+  }
+}
+
+int runBenchmarks(const std::vector<LanguageConfig>& languages) {
+  std::cout << "language   words   workspace words/s  allocs/word   vector words/s  allocs/word"
+            << "   stream   cached words/s  hit rate" << std::endl;
+  for (const auto& lang : languages) {
+    const auto* hyphenator = getLanguageHyphenatorForPrimaryTag(lang.primaryTag);
+    if (!hyphenator) {
+      std::cerr << "No hyphenator registered for tag: " << lang.primaryTag << std::endl;
+      continue;
+    }
+    const std::vector<TestCase> testCases = loadTestData(lang.testDataFile);
+    if (testCases.empty()) {
+      std::cerr << "No test cases loaded for " << lang.cliName << ". Skipping." << std::endl;
+      continue;
+    }
+
+    Hyphenator::setPreferredLanguage(lang.primaryTag);
+    const auto workspaceResult = runBenchmark(testCases, [](const std::string& word) {
+      Hyphenator::Workspace workspace;
+      return Hyphenator::breakOffsets(word, false, workspace);
+    });
+    const auto vectorResult = runBenchmark(testCases, [hyphenator](const std::string& word) {
+      return hyphenateWordWithHyphenator(word, *hyphenator).size();
+    });
+
+    const std::vector<TestCase> stream = buildBookStream(testCases);
+    HyphenationCache cache;
+    Hyphenator::setCache(&cache);
+    const auto cachedResult = runBenchmark(stream, [](const std::string& word) {
+      Hyphenator::Workspace workspace;
+      return Hyphenator::breakOffsets(word, false, workspace);
+    });
+    Hyphenator::setCache(nullptr);
+    const double hitRate = 100.0 * cache.hits() / std::max<uint32_t>(1, cache.hits() + cache.misses());
+
+    std::printf("%-9s %6zu %18.0f %12.2f %16.0f %12.2f %8zu %16.0f %8.1f%%\n", lang.cliName.c_str(), testCases.size(),
+                workspaceResult.wordsPerSecond, workspaceResult.allocationsPerWord, vectorResult.wordsPerSecond,
+                vectorResult.allocationsPerWord, stream.size(), cachedResult.wordsPerSecond, hitRate);
+  }
+  runPagedBenchmarks(languages);
+  return 0;
+}
+
 int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "bench") {
+    const std::vector<LanguageConfig> languages = resolveLanguages(argc > 2 ? argv[2] : "all");
+    if (languages.empty()) {
+      std::cerr << "Unknown language: " << argv[2] << std::endl;
+      return 1;
+    }
+    return runBenchmarks(languages);
+  }
+
   const bool summaryMode = argc <= 1;
   const std::string languageSelection = summaryMode ? "all" : argv[1];
 
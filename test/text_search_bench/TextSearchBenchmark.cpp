@@ -0,0 +1,219 @@
+#include <Utf8.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "lib/Epub/Epub/hyphenation/HyphenationCommon.h"
+#include "lib/Epub/Epub/search/TextMatcher.h"
+
+namespace {
+
+// Same chunk size the section builder uses when inflating chapters
+constexpr size_t kFeedChunk = 1024;
+constexpr size_t kCorpusBytes = 8 * 1024 * 1024;
+
+struct CheckCase {
+  const char* text;
+  const char* query;
+  size_t expected;
+};
+
+// Behavioural checks, fed in slices of every size so codepoints and matches straddle feed boundaries.
+const CheckCase kChecks[] = {
+    {"The Quick brown fox", "quick", 1},
+    {"DON\xE2\x80\x99T PANIC, don't panic", "don't panic", 2},
+    {"line\n  break\tacross  words", "line break across", 1},
+    {"\xD0\x9C\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0 and \xD0\xBC\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0",
+     "\xD0\x9C\xD0\x9E\xD0\xA1\xD0\x9A\xD0\x92\xD0\x90", 2},
+    {"\xC3\x89tude, \xC3\xA9tude", "\xC3\xA9tude", 2},
+    {"hy\xC2\xADphen\xC2\xAD" "a\xC2\xADtion", "hyphenation", 1},
+    {"\xE2\x80\x83Indented paragraph", "indented", 1},
+    {"aaaa", "aa", 2},
+    {"no match here", "absent", 0},
+    {"needle at the end needle", "needle", 2},
+};
+
+size_t countMatches(const std::string& text, const std::string& query, const size_t slice) {
+  TextMatcher matcher(query);
+  size_t matches = 0;
+  for (size_t pos = 0; pos < text.size(); pos += slice) {
+    matcher.feed(text.data() + pos, std::min(slice, text.size() - pos));
+    matches += matcher.takeMatches();
+  }
+  return matches + matcher.takeMatches();
+}
+
+int runChecks() {
+  int failures = 0;
+  for (const auto& check : kChecks) {
+    const std::string text = check.text;
+    for (size_t slice = 1; slice <= text.size(); slice++) {
+      const size_t got = countMatches(text, check.query, slice);
+      if (got != check.expected) {
+        std::cout << "FAIL: '" << check.query << "' in '" << check.text << "' (slice " << slice << "): expected "
+                  << check.expected << ", got " << got << std::endl;
+        failures++;
+        break;
+      }
+    }
+  }
+
+  // Matches spanning the internal window must survive the carry-over
+  std::string longText(TextMatcher::kWindowBytes - 3, 'x');
+  longText += "Boundary";
+  longText += std::string(TextMatcher::kWindowBytes, 'y');
+  if (countMatches(longText, "xboundaryy", longText.size()) != 1) {
+    std::cout << "FAIL: match across window boundary" << std::endl;
+    failures++;
+  }
+  if (TextMatcher("   ").isValid()) {
+    std::cout << "FAIL: whitespace-only query accepted" << std::endl;
+    failures++;
+  }
+
+  std::cout << (failures == 0 ? "All matcher checks passed" : "Matcher checks failed") << std::endl;
+  return failures;
+}
+
+// Builds book-like text from the hyphenation corpora: frequency-weighted words in shuffled order, with some
+// capitalisation and punctuation, repeated up to kCorpusBytes.
+std::string buildCorpus(const std::string& resourceDir) {
+  const char* files[] = {"english", "french", "german", "italian", "russian", "spanish"};
+  std::vector<std::string> words;
+  for (const char* language : files) {
+    std::ifstream in(resourceDir + "/" + language + "_hyphenation_tests.txt");
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty() || line[0] == '#') {
+        continue;
+      }
+      const size_t firstBar = line.find('|');
+      const size_t lastBar = line.rfind('|');
+      if (firstBar == std::string::npos || lastBar == firstBar) {
+        continue;
+      }
+      const int frequency = std::max(1, std::atoi(line.c_str() + lastBar + 1));
+      for (int i = 0; i < std::min(frequency, 20); i++) {
+        words.push_back(line.substr(0, firstBar));
+      }
+    }
+  }
+  if (words.empty()) {
+    return {};
+  }
+
+  std::mt19937 rng(42);
+  std::shuffle(words.begin(), words.end(), rng);
+  std::string corpus;
+  corpus.reserve(kCorpusBytes + 64);
+  for (size_t i = 0; corpus.size() < kCorpusBytes; i++) {
+    corpus += words[i % words.size()];
+    corpus += (i % 13 == 12) ? ".\n" : (i % 7 == 6 ? ", " : " ");
+  }
+  return corpus;
+}
+
+void appendUtf8(std::string& out, const uint32_t cp) {
+  if (cp < 0x80) {
+    out += static_cast<char>(cp);
+  } else if (cp < 0x800) {
+    out += static_cast<char>(0xC0 | (cp >> 6));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += static_cast<char>(0xE0 | (cp >> 12));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (cp >> 18));
+    out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (cp & 0x3F));
+  }
+}
+
+std::string foldText(const char* text, const size_t length) {
+  std::string folded;
+  folded.reserve(length);
+  const auto* cursor = reinterpret_cast<const unsigned char*>(text);
+  const auto* end = cursor + length;
+  while (cursor < end) {
+    appendUtf8(folded, toLowerExtended(utf8NextCodepoint(&cursor)));
+  }
+  return folded;
+}
+
+// What a search without TextMatcher would look like: decode and lowercase each chunk into a string and use
+// std::string::find. Chunks are cut on whitespace so no codepoint is split.
+size_t naiveSearch(const std::string& corpus, const std::string& query) {
+  const std::string foldedQuery = foldText(query.data(), query.size());
+  size_t matches = 0;
+  std::string carry;
+  for (size_t pos = 0; pos < corpus.size();) {
+    size_t end = std::min(pos + kFeedChunk, corpus.size());
+    while (end < corpus.size() && corpus[end] != ' ') {
+      end++;
+    }
+    const std::string chunk = carry + foldText(corpus.data() + pos, end - pos);
+    for (size_t at = chunk.find(foldedQuery); at != std::string::npos; at = chunk.find(foldedQuery, at + 1)) {
+      if (at + foldedQuery.size() > carry.size()) {
+        matches++;
+      }
+    }
+    carry = chunk.size() >= foldedQuery.size() ? chunk.substr(chunk.size() - foldedQuery.size() + 1) : chunk;
+    pos = end;
+  }
+  return matches;
+}
+
+template <typename Fn>
+double megabytesPerSecond(const size_t bytes, Fn&& fn, size_t& result) {
+  constexpr auto kMinDuration = std::chrono::milliseconds(500);
+  size_t rounds = 0;
+  const auto start = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::duration::zero();
+  do {
+    result = fn();
+    rounds++;
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed < kMinDuration);
+  return static_cast<double>(bytes) * rounds / (1024.0 * 1024.0) / std::chrono::duration<double>(elapsed).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int failures = runChecks();
+  if (failures != 0) {
+    return 1;
+  }
+
+  const std::string resourceDir = argc > 1 ? argv[1] : "test/hyphenation_eval/resources";
+  const std::string corpus = buildCorpus(resourceDir);
+  if (corpus.empty()) {
+    std::cout << "No corpus found in " << resourceDir << std::endl;
+    return 1;
+  }
+
+  std::cout << "\nCorpus: " << corpus.size() / 1024 << " KiB, fed in " << kFeedChunk << " byte chunks" << std::endl;
+  std::cout << "query                 matches   TextMatcher MB/s   fold+find MB/s" << std::endl;
+  const char* queries[] = {"the", "Nikolai", "something that never appears", "\xD0\xB8"};
+  for (const char* query : queries) {
+    size_t matches = 0;
+    size_t naiveMatches = 0;
+    const double matcherRate = megabytesPerSecond(
+        corpus.size(), [&] { return countMatches(corpus, query, kFeedChunk); }, matches);
+    const double naiveRate =
+        megabytesPerSecond(corpus.size(), [&] { return naiveSearch(corpus, query); }, naiveMatches);
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-20.20s %8zu   %16.1f   %14.1f", query, matches, matcherRate, naiveRate);
+    std::cout << line << std::endl;
+  }
+  return 0;
+}